@@ -0,0 +1,202 @@
+//
+// Pluggable allocators for the hashmap, its vectors and pairs, and an arena.
+//
+#include <string.h>
+#include "allocator.h"
+
+void *arena_take (void *context, size_t size);
+void *arena_grow (void *context, void *ptr, size_t old_size, size_t new_size);
+arena_chunk *arena_add_chunk (arena *a, size_t size);
+size_t arena_round (size_t size);
+
+/**
+ * Allocates size bytes with the allocator.
+ * @param a an allocator, NULL for malloc.
+ * @param size the number of bytes.
+ * @return the block, NULL on failure.
+ */
+void *allocator_alloc (const allocator *a, size_t size)
+{
+    if (a == NULL) {return malloc (size);}
+    return a->alloc (a->context, size);
+}
+
+/**
+ * Resizes a block of the allocator, as realloc.
+ * @param a an allocator, NULL for realloc.
+ * @param ptr the block, NULL to allocate a new one.
+ * @param old_size the size the block was allocated with.
+ * @param new_size the new size.
+ * @return the resized block, NULL on failure (the block is left unchanged).
+ */
+void *allocator_realloc (const allocator *a, void *ptr, size_t old_size, size_t new_size)
+{
+    if (a == NULL) {return realloc (ptr, new_size);}
+    return a->realloc (a->context, ptr, old_size, new_size);
+}
+
+/**
+ * Frees a block of the allocator, nothing is done if ptr is NULL.
+ * @param a an allocator, NULL for free.
+ * @param ptr the block.
+ * @param size the size the block was allocated with.
+ */
+void allocator_free (const allocator *a, void *ptr, size_t size)
+{
+    if (ptr == NULL) {return;}
+    if (a == NULL)
+    {
+        free (ptr);
+    }
+    else if (a->free != NULL)
+    {
+        a->free (a->context, ptr, size);
+    }
+}
+
+/**
+ * @param a an allocator, NULL for malloc.
+ * @return 1 if the memory of the allocator is released all at once by its owner
+ * (its free is NULL), 0 otherwise.
+ */
+int allocator_releases_all (const allocator *a)
+{
+    return (a != NULL) && (a->free == NULL);
+}
+
+/**
+ * Returns the pages backing a block of the allocator.
+ * @param a an allocator, NULL for malloc.
+ * @param ptr the block.
+ * @param size the size the block was allocated with.
+ * @return the backing of the block, ALLOCATOR_BACKING_HEAP if the allocator does
+ * not tell.
+ */
+allocator_backing allocator_backing_of (const allocator *a, const void *ptr, size_t size)
+{
+    if ((a == NULL) || (a->backing == NULL) || (ptr == NULL)) {return ALLOCATOR_BACKING_HEAP;}
+    return a->backing (a->context, ptr, size);
+}
+
+/**
+ * Allocates dynamically an empty arena.
+ * @param chunk_size the size of the chunks taken from malloc, 0 for ARENA_CHUNK_SIZE.
+ * @return pointer to dynamically allocated arena.
+ * @if_fail return NULL.
+ */
+arena *arena_alloc (size_t chunk_size)
+{
+    arena *a = (arena *) malloc (sizeof(arena));
+    if (a == NULL) {return NULL;}
+    a->allocator.alloc = arena_take;
+    a->allocator.realloc = arena_grow;
+    a->allocator.free = NULL;
+    a->allocator.context = a;
+    a->allocator.backing = NULL;
+    a->chunks = NULL;
+    a->chunk_size = arena_round ((chunk_size == 0) ? ARENA_CHUNK_SIZE : chunk_size);
+    a->bytes = 0;
+    return a;
+}
+
+/**
+ * Frees an arena and all the memory handed out from it.
+ * @param p_arena pointer to dynamically allocated pointer to arena.
+ */
+void arena_free (arena **p_arena)
+{
+    if ((p_arena == NULL) || (*p_arena == NULL)) {return;}
+    arena_chunk *chunk = (*p_arena)->chunks;
+    while (chunk != NULL)
+    {
+        arena_chunk *next = chunk->next;
+        free (chunk);
+        chunk = next;
+    }
+    free (*p_arena);
+    *p_arena = NULL;
+}
+
+/**
+ * Returns the allocator of the arena, e.g. for hashmap_alloc_ex.
+ * @param a an arena.
+ * @return the allocator of the arena, NULL if a is NULL.
+ */
+const allocator *arena_allocator (arena *a)
+{
+    if (a == NULL) {return NULL;}
+    return &(a->allocator);
+}
+
+/**
+ * Rounds a size up to ARENA_ALIGNMENT.
+ */
+size_t arena_round (size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+/**
+ * Adds a chunk of at least size bytes of data in front of the chunks of the arena.
+ * @return the chunk, NULL on failure.
+ */
+arena_chunk *arena_add_chunk (arena *a, size_t size)
+{
+    if (size < a->chunk_size) {size = a->chunk_size;}
+    size_t header = arena_round (sizeof(arena_chunk));
+    if (size > (size_t) -1 - header) {return NULL;}
+    arena_chunk *chunk = (arena_chunk *) malloc (header + size);
+    if (chunk == NULL) {return NULL;}
+    chunk->next = a->chunks;
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->last = 0;
+    chunk->data = (unsigned char *) chunk + header;
+    a->chunks = chunk;
+    a->bytes += header + size;
+    return chunk;
+}
+
+/**
+ * The alloc function of an arena: hands out the next size bytes of the current chunk.
+ * @param context the arena.
+ */
+void *arena_take (void *context, size_t size)
+{
+    arena *a = (arena *) context;
+    size_t rounded = arena_round (size);
+    if (rounded < size) {return NULL;}
+    arena_chunk *chunk = a->chunks;
+    if ((chunk == NULL) || (chunk->size - chunk->used < rounded))
+    {
+        chunk = arena_add_chunk (a, rounded);
+        if (chunk == NULL) {return NULL;}
+    }
+    chunk->last = chunk->used;
+    chunk->used += rounded;
+    return chunk->data + chunk->last;
+}
+
+/**
+ * The realloc function of an arena: the last block of the current chunk grows (or
+ * shrinks) in place, any other block is copied to a new one.
+ * @param context the arena.
+ */
+void *arena_grow (void *context, void *ptr, size_t old_size, size_t new_size)
+{
+    arena *a = (arena *) context;
+    if (ptr == NULL) {return arena_take (a, new_size);}
+    arena_chunk *chunk = a->chunks;
+    size_t rounded = arena_round (new_size);
+    if ((rounded >= new_size) && (chunk != NULL)
+        && ((unsigned char *) ptr == chunk->data + chunk->last)
+        && (chunk->size - chunk->last >= rounded))
+    {
+        chunk->used = chunk->last + rounded;
+        return ptr;
+    }
+    void *block = arena_take (a, new_size);
+    if (block == NULL) {return NULL;}
+    memcpy (block, ptr, (old_size < new_size) ? old_size : new_size);
+    return block;
+}
@@ -0,0 +1,154 @@
+#ifndef ALLOCATOR_H_
+#define ALLOCATOR_H_
+
+#include <stdlib.h>
+
+/**
+ * @def ARENA_ALIGNMENT
+ * The alignment of the allocations of an arena, enough for any scalar type.
+ */
+#define ARENA_ALIGNMENT 16UL
+
+/**
+ * @def ARENA_CHUNK_SIZE
+ * The default size of the chunks an arena takes from malloc.
+ */
+#define ARENA_CHUNK_SIZE 65536UL
+
+/**
+ * @enum allocator_backing
+ * The pages backing a block of an allocator.
+ * @param ALLOCATOR_BACKING_HEAP the heap (malloc, an arena).
+ * @param ALLOCATOR_BACKING_PAGES a mapping of regular pages.
+ * @param ALLOCATOR_BACKING_TRANSPARENT a mapping the kernel backs (at least partly)
+ * with transparent huge pages.
+ * @param ALLOCATOR_BACKING_HUGETLB a mapping of explicit (hugetlbfs) huge pages.
+ */
+typedef enum allocator_backing {
+    ALLOCATOR_BACKING_HEAP,
+    ALLOCATOR_BACKING_PAGES,
+    ALLOCATOR_BACKING_TRANSPARENT,
+    ALLOCATOR_BACKING_HUGETLB
+} allocator_backing;
+
+/**
+ * @struct allocator - the memory functions of a hash map, its vectors and pairs.
+ * The sizes of the blocks are passed back on realloc and free, so allocators which
+ * do not keep them (arenas, size classes) can be plugged in. A NULL allocator is
+ * malloc, realloc and free.
+ * @param alloc returns a block of size bytes (aligned as malloc), NULL on failure.
+ * @param realloc resizes a block (ptr may be NULL), as realloc: on failure it returns
+ * NULL and the block is left unchanged.
+ * @param free frees a block. NULL if the memory is released all at once by its owner
+ * (see arena): the frees are skipped, and a hash map is freed in O(1) without
+ * walking its pairs.
+ * @param context passed to the functions, e.g. the arena.
+ * @param backing returns the pages backing a block (see allocator_backing_of), NULL
+ * if all the blocks are on the heap.
+ */
+typedef struct allocator {
+    void *(*alloc) (void *context, size_t size);
+    void *(*realloc) (void *context, void *ptr, size_t old_size, size_t new_size);
+    void (*free) (void *context, void *ptr, size_t size);
+    void *context;
+    allocator_backing (*backing) (void *context, const void *ptr, size_t size);
+} allocator;
+
+/**
+ * Allocates size bytes with the allocator.
+ * @param a an allocator, NULL for malloc.
+ * @param size the number of bytes.
+ * @return the block, NULL on failure.
+ */
+void *allocator_alloc (const allocator *a, size_t size);
+
+/**
+ * Resizes a block of the allocator, as realloc.
+ * @param a an allocator, NULL for realloc.
+ * @param ptr the block, NULL to allocate a new one.
+ * @param old_size the size the block was allocated with.
+ * @param new_size the new size.
+ * @return the resized block, NULL on failure (the block is left unchanged).
+ */
+void *allocator_realloc (const allocator *a, void *ptr, size_t old_size, size_t new_size);
+
+/**
+ * Frees a block of the allocator, nothing is done if ptr is NULL.
+ * @param a an allocator, NULL for free.
+ * @param ptr the block.
+ * @param size the size the block was allocated with.
+ */
+void allocator_free (const allocator *a, void *ptr, size_t size);
+
+/**
+ * @param a an allocator, NULL for malloc.
+ * @return 1 if the memory of the allocator is released all at once by its owner
+ * (its free is NULL), 0 otherwise.
+ */
+int allocator_releases_all (const allocator *a);
+
+/**
+ * Returns the pages backing a block of the allocator, as obtained from the kernel
+ * (not as requested).
+ * @param a an allocator, NULL for malloc.
+ * @param ptr the block.
+ * @param size the size the block was allocated with.
+ * @return the backing of the block.
+ */
+allocator_backing allocator_backing_of (const allocator *a, const void *ptr, size_t size);
+
+/**
+ * @struct arena_chunk - a block of memory an arena hands out from.
+ * @param next the chunk allocated before this one.
+ * @param size the number of bytes of data.
+ * @param used the number of bytes of data handed out.
+ * @param last the offset of the last block handed out, which can grow in place.
+ * @param data the memory handed out (aligned to ARENA_ALIGNMENT).
+ */
+typedef struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size;
+    size_t used;
+    size_t last;
+    unsigned char *data;
+} arena_chunk;
+
+/**
+ * @struct arena - a bump allocator: blocks are handed out from large chunks and never
+ * freed one by one, all the memory is released by arena_free (e.g. at the end of a
+ * request). Not thread safe.
+ * @param allocator the allocator handing out the memory of the arena, its free is NULL.
+ * @param chunks the chunks, the current one first.
+ * @param chunk_size the size of a new chunk (larger blocks get a chunk of their own).
+ * @param bytes the number of bytes the chunks take.
+ */
+typedef struct arena {
+    allocator allocator;
+    arena_chunk *chunks;
+    size_t chunk_size;
+    size_t bytes;
+} arena;
+
+/**
+ * Allocates dynamically an empty arena.
+ * @param chunk_size the size of the chunks taken from malloc, 0 for ARENA_CHUNK_SIZE.
+ * @return pointer to dynamically allocated arena.
+ * @if_fail return NULL.
+ */
+arena *arena_alloc (size_t chunk_size);
+
+/**
+ * Frees an arena and all the memory handed out from it.
+ * @param p_arena pointer to dynamically allocated pointer to arena.
+ */
+void arena_free (arena **p_arena);
+
+/**
+ * Returns the allocator of the arena, e.g. for hashmap_alloc_ex. It is valid until
+ * the arena is freed.
+ * @param a an arena.
+ * @return the allocator of the arena, NULL if a is NULL.
+ */
+const allocator *arena_allocator (arena *a);
+
+#endif //ALLOCATOR_H_
@@ -0,0 +1,1517 @@
+//
+// Throughput benchmarks for the hashmap library.
+//
+// Usage: hashmap_bench [--max-size N] [--output FILE] [--trials N]
+//                      [--save-baseline FILE] [--compare FILE] [--threshold PCT]
+// Every hashmap workload is run for int, double and string keys, for sequential,
+// uniform and zipfian key distributions, and for map sizes 1K, 10K, ... up to
+// --max-size (10M by default). Besides the plain operations:
+//  - hashmap_build loads the keys of hashmap_insert with a hashmap_builder.
+//  - hashmap_insert_bg_resize inserts them with the extensions done by a background
+//    thread. For the uniform distribution, its longest insertion and that of
+//    hashmap_insert go to the standard output.
+//  - hashmap_at_miss_filter repeats the misses with a Bloom filter attached to the map.
+//  - hashmap_at_hit_huge (uniform distribution, from 1M keys) repeats the hits on a
+//    map allocated from a page_pool of transparent huge pages. The dTLB load misses
+//    per lookup of both maps go to the standard output, where the kernel allows
+//    perf_event_open to count them.
+//  - The counting workloads compare int values counted through hashmap_find_or_insert
+//    with the inline counts of counter_map.
+//  - The ordered_ workloads run on an ordered_hashmap.
+//  - The typed_ workloads (int keys only) run on a map generated by HASHMAP_DEFINE.
+//  - The durable_ workloads (uniform distribution, up to 1M keys) log to
+//    bench_durable.log: insert and upsert with group commit, compact, replay, and
+//    upsert_sync with an fsync every 1000 records. Their write amplification goes to
+//    the standard output.
+// The vector microbenchmarks are run for the same sizes: push_back, at, find, erase,
+// erase_unordered and clear of int elements, and push_back, append_range and find of
+// an element-size vector of ints.
+// Every trial's results are written as CSV to FILE (bench_output.txt by default) and
+// summarized on the standard output.
+//
+// The trials of a workload are summarized by their median, mean, standard deviation
+// and 95% confidence interval. --save-baseline writes these summaries to a CSV file,
+// --compare reads such a file and exits with BENCH_REGRESSION_EXIT if a workload
+// got slower than the baseline by more than --threshold percent (of the median),
+// and the difference of the means is statistically significant (Welch's t-test).
+//
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "hashmap.h"
+#include "hash_funcs.h"
+#include "bench_pairs.h"
+#include "latency_histogram.h"
+#include "counter_map.h"
+#include "ordered_hashmap.h"
+#include "typed_hashmap.h"
+#include "durable_hashmap.h"
+#include "hashmap_builder.h"
+#include "page_pool.h"
+
+// the int keys hashed as hash_int does, with the hash and comparison inlined
+static inline size_t bench_int_hash (int key) {return (size_t) key;}
+static inline int bench_int_eq (int key1, int key2) {return key1 == key2;}
+
+HASHMAP_DEFINE (bench_int_map, int, int, bench_int_hash, bench_int_eq)
+
+/**
+ * @def BENCH_MIN_SIZE
+ * The smallest map size benchmarked, every next size is 10 times larger.
+ */
+#define BENCH_MIN_SIZE 1000UL
+
+/**
+ * @def BENCH_MAX_SIZE
+ * The default largest map size benchmarked.
+ */
+#define BENCH_MAX_SIZE 10000000UL
+
+/**
+ * @def BENCH_ZIPF_THETA
+ * The skew of the zipfian distribution (as in YCSB).
+ */
+#define BENCH_ZIPF_THETA 0.99
+
+/**
+ * @def BENCH_MIXED_READ_PERCENT
+ * The percentage of lookups in the mixed workload, the rest are writes.
+ */
+#define BENCH_MIXED_READ_PERCENT 90UL
+
+/**
+ * @def BENCH_MIN_VISITS
+ * hashmap_apply_if is repeated until at least this many pairs were visited.
+ */
+#define BENCH_MIN_VISITS 1000000UL
+
+/**
+ * @def BENCH_LINEAR_BUDGET
+ * The number of elements the linear vector workloads (find, erase in the middle)
+ * may visit in total, their number of operations is derived from it.
+ */
+#define BENCH_LINEAR_BUDGET 100000000UL
+
+/**
+ * @def BENCH_FILTER_FP_RATE
+ * The false positive rate of the filter of the hashmap_at_miss_filter workload.
+ */
+#define BENCH_FILTER_FP_RATE 0.01
+
+/**
+ * @def BENCH_HUGE_MIN_SIZE
+ * The smallest map size of the hashmap_at_hit_huge workload, whose bucket array
+ * spans many huge pages.
+ */
+#define BENCH_HUGE_MIN_SIZE 1000000UL
+
+/**
+ * @def BENCH_DURABLE_MAX_SIZE
+ * The largest map size of the durable_ workloads, whose logs are written to disk.
+ */
+#define BENCH_DURABLE_MAX_SIZE 1000000UL
+
+/**
+ * @def BENCH_DURABLE_LOG
+ * The path of the log of the durable_ workloads, removed after them.
+ */
+#define BENCH_DURABLE_LOG "bench_durable.log"
+
+/**
+ * @def BENCH_DURABLE_SYNC_RECORDS
+ * The fsync cadence of the durable_upsert_sync workload, in records.
+ */
+#define BENCH_DURABLE_SYNC_RECORDS 1000UL
+
+/**
+ * @def BENCH_STRING_KEY_LEN
+ * The storage of every string key: 10 digits and the null terminator.
+ */
+#define BENCH_STRING_KEY_LEN 12UL
+
+/**
+ * @def BENCH_OUTPUT
+ * The default path of the CSV results.
+ */
+#define BENCH_OUTPUT "bench_output.txt"
+
+/**
+ * @def BENCH_TRIALS
+ * The default number of times every workload is run.
+ */
+#define BENCH_TRIALS 5UL
+
+/**
+ * @def BENCH_MAX_TRIALS
+ * The maximal number of times a workload can be run.
+ */
+#define BENCH_MAX_TRIALS 100UL
+
+/**
+ * @def BENCH_THRESHOLD
+ * The default slowdown (in percent of the baseline median) considered a regression.
+ */
+#define BENCH_THRESHOLD 10.0
+
+/**
+ * @def BENCH_REGRESSION_EXIT
+ * The exit code of a comparison that found a regression.
+ */
+#define BENCH_REGRESSION_EXIT 3
+
+/**
+ * @def BENCH_ID_LEN
+ * The storage of a workload id: "workload,key_type,distribution,size".
+ */
+#define BENCH_ID_LEN 128UL
+
+typedef enum key_type {
+    KEY_INT,
+    KEY_DOUBLE,
+    KEY_STRING,
+    KEY_TYPES
+} key_type;
+
+typedef enum distribution {
+    DIST_SEQUENTIAL,
+    DIST_UNIFORM,
+    DIST_ZIPF,
+    DISTRIBUTIONS
+} distribution;
+
+static const char *key_type_names[KEY_TYPES] = {"int", "double", "string"};
+static const char *distribution_names[DISTRIBUTIONS] = {"sequential", "uniform", "zipf"};
+
+/**
+ * @struct key_set
+ * @param size the number of keys inserted to the map.
+ * @param keys 2 * size keys: [0, size) are inserted to the map,
+ * [size, 2 * size) are never inserted (used for missed lookups).
+ * @param storage the memory the keys point into.
+ */
+typedef struct key_set {
+    size_t size;
+    const void **keys;
+    void *storage;
+} key_set;
+
+/**
+ * @struct bench_samples
+ * @param id the workload id: "workload,key_type,distribution,size".
+ * @param count the number of trials recorded.
+ * @param samples the ns/op of every trial.
+ */
+typedef struct bench_samples {
+    char id[BENCH_ID_LEN];
+    size_t count;
+    double samples[BENCH_MAX_TRIALS];
+} bench_samples;
+
+/**
+ * @struct bench_summary
+ * @param id the workload id: "workload,key_type,distribution,size".
+ * @param trials the number of trials summarized.
+ * @param median, mean, stddev - of the ns/op of the trials.
+ * @param ci95 half the width of the 95% confidence interval of the mean.
+ */
+typedef struct bench_summary {
+    char id[BENCH_ID_LEN];
+    size_t trials;
+    double median;
+    double mean;
+    double stddev;
+    double ci95;
+} bench_summary;
+
+/**
+ * @struct bench_context
+ * @param out the CSV results stream.
+ * @param key_type, distribution, size - the current benchmark.
+ * @param trial the number of the current trial.
+ * @param results the samples of every workload run so far.
+ * @param num_results, results_capacity - the size and capacity of results.
+ * @param sink accumulates lookup results, so they are not optimized away.
+ */
+typedef struct bench_context {
+    FILE *out;
+    key_type key_type;
+    distribution distribution;
+    size_t size;
+    size_t trial;
+    bench_samples *results;
+    size_t num_results;
+    size_t results_capacity;
+    size_t sink;
+} bench_context;
+
+/**
+ * xorshift64* pseudo random generator.
+ */
+unsigned long long bench_rand (unsigned long long *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+/**
+ * Maps a key index to the number the key is made of. Sequential keys are the
+ * indices themselves, the other distributions scramble them (bijectively).
+ */
+unsigned int key_number (distribution dist, size_t index)
+{
+    if (dist == DIST_SEQUENTIAL) {return (unsigned int) index;}
+    return (unsigned int) index * 2654435761U;
+}
+
+/**
+ * Creates the keys of a benchmark of the given type, distribution and size.
+ * @return 1 on success, 0 otherwise.
+ */
+int key_set_alloc (key_set *set, key_type type, distribution dist, size_t size)
+{
+    set->size = size;
+    set->keys = malloc (sizeof(void *) * 2 * size);
+    size_t elem_size = sizeof(int);
+    if (type == KEY_DOUBLE) {elem_size = sizeof(double);}
+    if (type == KEY_STRING) {elem_size = BENCH_STRING_KEY_LEN;}
+    set->storage = malloc (elem_size * 2 * size);
+    if ((set->keys == NULL) || (set->storage == NULL))
+    {
+        free (set->keys);
+        free (set->storage);
+        return 0;
+    }
+    for (size_t i = 0; i < 2 * size; ++i)
+    {
+        unsigned int number = key_number (dist, i);
+        if (type == KEY_INT)
+        {
+            int *key = (int *) set->storage + i;
+            *key = (int) number;
+            set->keys[i] = key;
+        }
+        else if (type == KEY_DOUBLE)
+        {
+            // hash_double truncates, the fraction keeps the keys distinct from their hash
+            double *key = (double *) set->storage + i;
+            *key = (double) number + 0.5;
+            set->keys[i] = key;
+        }
+        else
+        {
+            char *key = (char *) set->storage + i * BENCH_STRING_KEY_LEN;
+            snprintf (key, BENCH_STRING_KEY_LEN, "%010u", number);
+            set->keys[i] = key;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Frees the keys of a benchmark.
+ */
+void key_set_free (key_set *set)
+{
+    free (set->keys);
+    free (set->storage);
+    set->keys = NULL;
+    set->storage = NULL;
+}
+
+/**
+ * Draws zipfian ranks in [0, n), rank 0 being the most frequent
+ * (Gray et al., "Quickly generating billion-record synthetic databases").
+ */
+typedef struct zipf_generator {
+    size_t n;
+    double zetan;
+    double alpha;
+    double eta;
+    double half_pow_theta;
+} zipf_generator;
+
+/**
+ * Prepares a zipfian generator over [0, n), in O(n).
+ */
+void zipf_init (zipf_generator *zipf, size_t n)
+{
+    double zeta2 = 1.0 + pow (0.5, BENCH_ZIPF_THETA);
+    zipf->n = n;
+    zipf->zetan = 0;
+    for (size_t i = 1; i <= n; ++i)
+    {
+        zipf->zetan += 1.0 / pow ((double) i, BENCH_ZIPF_THETA);
+    }
+    zipf->alpha = 1.0 / (1.0 - BENCH_ZIPF_THETA);
+    zipf->eta = (1.0 - pow (2.0 / (double) n, 1.0 - BENCH_ZIPF_THETA)) /
+                (1.0 - zeta2 / zipf->zetan);
+    zipf->half_pow_theta = pow (0.5, BENCH_ZIPF_THETA);
+}
+
+/**
+ * Draws the next zipfian rank.
+ */
+size_t zipf_next (const zipf_generator *zipf, unsigned long long *state)
+{
+    double u = (double) (bench_rand (state) >> 11) / 9007199254740992.0;
+    double uz = u * zipf->zetan;
+    if (uz < 1.0) {return 0;}
+    if (uz < 1.0 + zipf->half_pow_theta) {return 1;}
+    size_t rank = (size_t) ((double) zipf->n * pow (zipf->eta * u - zipf->eta + 1.0, zipf->alpha));
+    return rank < zipf->n ? rank : zipf->n - 1;
+}
+
+/**
+ * Creates a stream of count key indices in [0, n) drawn from the distribution.
+ * If permutation is 1, uniform streams are a shuffle of [0, n) (every key once),
+ * sequential streams are always [0, n) in order, repeated.
+ */
+size_t *op_stream_alloc (distribution dist, size_t n, size_t count, int permutation,
+                         unsigned long long seed)
+{
+    size_t *stream = malloc (sizeof(size_t) * count);
+    if (stream == NULL) {return NULL;}
+    unsigned long long state = seed;
+    zipf_generator zipf;
+    if (dist == DIST_ZIPF) {zipf_init (&zipf, n);}
+    for (size_t i = 0; i < count; ++i)
+    {
+        if ((dist == DIST_SEQUENTIAL) || ((dist == DIST_UNIFORM) && permutation))
+        {
+            stream[i] = i % n;
+        }
+        else if (dist == DIST_UNIFORM)
+        {
+            stream[i] = bench_rand (&state) % n;
+        }
+        else
+        {
+            stream[i] = zipf_next (&zipf, &state);
+        }
+    }
+    if ((dist == DIST_UNIFORM) && permutation)
+    {
+        for (size_t i = count - 1; i > 0; --i)
+        {
+            size_t j = bench_rand (&state) % (i + 1);
+            size_t temp = stream[i];
+            stream[i] = stream[j];
+            stream[j] = temp;
+        }
+    }
+    return stream;
+}
+
+/**
+ * Resets the peak resident set size of the process (Linux only, ignored elsewhere).
+ */
+void reset_peak_rss (void)
+{
+    FILE *f = fopen ("/proc/self/clear_refs", "w");
+    if (f == NULL) {return;}
+    fputs ("5", f);
+    fclose (f);
+}
+
+/**
+ * Returns the peak resident set size of the process, in KB, since the last
+ * reset_peak_rss (or since the process started, where it can not be reset).
+ */
+long peak_rss_kb (void)
+{
+    FILE *f = fopen ("/proc/self/status", "r");
+    if (f != NULL)
+    {
+        char line[256];
+        long kb = -1;
+        while (fgets (line, sizeof(line), f) != NULL)
+        {
+            if (sscanf (line, "VmHWM: %ld kB", &kb) == 1) {break;}
+        }
+        fclose (f);
+        if (kb >= 0) {return kb;}
+    }
+    struct rusage usage;
+    getrusage (RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * Adds the ns/op of the current trial to the samples of a workload.
+ * @return 1 on success, 0 otherwise.
+ */
+int record_sample (bench_context *ctx, const char *id, double ns_per_op)
+{
+    bench_samples *samples = NULL;
+    for (size_t i = 0; (i < ctx->num_results) && (samples == NULL); ++i)
+    {
+        if (strcmp (ctx->results[i].id, id) == 0) {samples = &(ctx->results[i]);}
+    }
+    if (samples == NULL)
+    {
+        if (ctx->num_results == ctx->results_capacity)
+        {
+            size_t capacity = ctx->results_capacity == 0 ? 64 : ctx->results_capacity * 2;
+            bench_samples *temp = realloc (ctx->results, sizeof(bench_samples) * capacity);
+            if (temp == NULL) {return 0;}
+            ctx->results = temp;
+            ctx->results_capacity = capacity;
+        }
+        samples = &(ctx->results[ctx->num_results]);
+        ++(ctx->num_results);
+        snprintf (samples->id, BENCH_ID_LEN, "%s", id);
+        samples->count = 0;
+    }
+    if (samples->count < BENCH_MAX_TRIALS)
+    {
+        samples->samples[samples->count] = ns_per_op;
+        ++(samples->count);
+    }
+    return 1;
+}
+
+/**
+ * Writes one result line, as CSV to the results stream and readable to stdout,
+ * and records it in the samples of the workload.
+ */
+void report (bench_context *ctx, const char *workload, size_t ops,
+             unsigned long long elapsed_ns, const hashmap *map)
+{
+    hashmap_statistics stats = {0};
+    if (map != NULL) {hashmap_stats (map, &stats);}
+    double ns_per_op = ops > 0 ? (double) elapsed_ns / (double) ops : 0;
+    long rss = peak_rss_kb ();
+    char id[BENCH_ID_LEN];
+    snprintf (id, BENCH_ID_LEN, "%s,%s,%s,%zu", workload, key_type_names[ctx->key_type],
+              distribution_names[ctx->distribution], ctx->size);
+    record_sample (ctx, id, ns_per_op);
+    fprintf (ctx->out, "%s,%zu,%zu,%.2f,%ld,%zu,%zu\n",
+             id, ctx->trial, ops, ns_per_op, rss,
+             stats.counters.resizes_up, stats.counters.resizes_down);
+    printf ("%-24s %-7s %-10s %9zu %10.2f ns/op  rss %8ld KB  resizes %zu/%zu\n",
+            workload, key_type_names[ctx->key_type], distribution_names[ctx->distribution],
+            ctx->size, ns_per_op, rss,
+            stats.counters.resizes_up, stats.counters.resizes_down);
+    fflush (ctx->out);
+}
+
+/**
+ * Inserts the keys of the stream into a new hash map, timing every insertion.
+ * @param hard_load_factor 0 to resize the hash map inline, the hard load factor of
+ * its background resize otherwise.
+ * @return the longest insertion in nanoseconds, 0 on failure.
+ */
+unsigned long long max_insert_pause (bench_context *ctx, hash_func func,
+                                     const key_set *keys, const size_t *stream,
+                                     const pair *in_pair, double hard_load_factor)
+{
+    hashmap *map = hashmap_alloc (func);
+    if ((map == NULL) || ((hard_load_factor != 0) &&
+                          (hashmap_background_resize_enable (map, hard_load_factor) == 0)))
+    {
+        hashmap_free (&map);
+        return 0;
+    }
+    pair key_pair = *in_pair;
+    unsigned long long max_pause = 0;
+    for (size_t i = 0; i < ctx->size; ++i)
+    {
+        key_pair.key = (keyT) keys->keys[stream[i]];
+        unsigned long long start = latency_now_ns ();
+        ctx->sink += hashmap_insert (map, &key_pair);
+        unsigned long long pause = latency_now_ns () - start;
+        if (pause > max_pause) {max_pause = pause;}
+    }
+    hashmap_free (&map);
+    return max_pause;
+}
+
+/**
+ * Opens a counter of the dTLB load misses of the calling thread, in user space.
+ * @return its file descriptor, -1 if the kernel or the machine do not provide it.
+ */
+int dtlb_counter_open (void)
+{
+    struct perf_event_attr attr;
+    memset (&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/**
+ * Looks up the keys of the stream in a hash map, counting the dTLB load misses.
+ * @param counter the counter (see dtlb_counter_open), -1 for none.
+ * @param misses set to the dTLB load misses per lookup, -1 if they were not counted.
+ * @return the elapsed nanoseconds.
+ */
+unsigned long long counted_hits (bench_context *ctx, const hashmap *map,
+                                 const key_set *keys, const size_t *stream,
+                                 int counter, double *misses)
+{
+    *misses = -1;
+    if (counter >= 0)
+    {
+        ioctl (counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl (counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    unsigned long long start = latency_now_ns ();
+    for (size_t i = 0; i < ctx->size; ++i)
+    {
+        ctx->sink += (hashmap_at (map, keys->keys[stream[i]]) != NULL);
+    }
+    unsigned long long elapsed = latency_now_ns () - start;
+    unsigned long long count = 0;
+    if ((counter >= 0) && (ioctl (counter, PERF_EVENT_IOC_DISABLE, 0) == 0) &&
+        (read (counter, &count, sizeof(count)) == (ssize_t) sizeof(count)))
+    {
+        *misses = (double) count / (double) ctx->size;
+    }
+    return elapsed;
+}
+
+/**
+ * Repeats the hits of hashmap_at_hit on a copy of the map allocated from a page pool
+ * of transparent huge pages, and writes the dTLB load misses per lookup of both maps,
+ * and the pages actually obtained, to the standard output.
+ * @param map the map of hashmap_at_hit, with all the keys.
+ * @param in_pair the pair the keys are inserted with.
+ * @return 1 on success, 0 otherwise.
+ */
+int run_huge_page_hits (bench_context *ctx, const hashmap *map, const key_set *keys,
+                        const size_t *stream, pair *in_pair)
+{
+    static const char *backing_names[] = {"heap", "pages", "transparent", "hugetlb"};
+    page_pool *pool = page_pool_alloc (PAGE_POOL_HUGE_TRANSPARENT,
+                                       PAGE_POOL_NUMA_FIRST_TOUCH);
+    hashmap *huge = hashmap_alloc_ex (map->hash_func, page_pool_allocator (pool));
+    if ((huge == NULL) || (hashmap_reserve (huge, map->size) == 0))
+    {
+        hashmap_free (&huge);
+        page_pool_free (&pool);
+        return 0;
+    }
+    for (size_t i = 0; i < ctx->size; ++i)
+    {
+        in_pair->key = (keyT) keys->keys[i];
+        hashmap_insert (huge, in_pair);
+    }
+    int counter = dtlb_counter_open ();
+    double heap_misses = 0, huge_misses = 0;
+    counted_hits (ctx, map, keys, stream, counter, &heap_misses);
+    hashmap_reset_counters (huge);
+    unsigned long long elapsed = counted_hits (ctx, huge, keys, stream, counter,
+                                               &huge_misses);
+    report (ctx, "hashmap_at_hit_huge", ctx->size, elapsed, huge);
+    hashmap_statistics stats = {0};
+    hashmap_stats (huge, &stats);
+    if (counter >= 0) {close (counter);}
+    if ((heap_misses < 0) || (huge_misses < 0))
+    {
+        printf ("%-24s %-7s %-10s %9zu        n/a malloc        n/a huge   dTLB misses/op"
+                "  buckets %s\n", "hashmap_at_hit_dtlb", key_type_names[ctx->key_type],
+                distribution_names[ctx->distribution], ctx->size,
+                backing_names[stats.bucket_backing]);
+    }
+    else
+    {
+        printf ("%-24s %-7s %-10s %9zu %10.3f malloc %10.3f huge   dTLB misses/op"
+                "  buckets %s\n", "hashmap_at_hit_dtlb", key_type_names[ctx->key_type],
+                distribution_names[ctx->distribution], ctx->size, heap_misses,
+                huge_misses, backing_names[stats.bucket_backing]);
+    }
+    hashmap_free (&huge);
+    page_pool_free (&pool);
+    return 1;
+}
+
+/**
+ * Runs all the hashmap workloads for the current key type, distribution and size.
+ * @return 1 on success, 0 otherwise.
+ */
+int run_hashmap_workloads (bench_context *ctx)
+{
+    static const hash_func hash_funcs[KEY_TYPES] = {hash_int, hash_double, hash_string};
+    static const pair_key_cpy key_cpys[KEY_TYPES] = {int_key_cpy, double_key_cpy,
+                                                     string_key_cpy};
+    static const pair_key_cmp key_cmps[KEY_TYPES] = {int_key_cmp, double_key_cmp,
+                                                     string_key_cmp};
+    static const keyT_func predicates[KEY_TYPES] = {is_even_int, is_even_double,
+                                                    is_even_string};
+    size_t n = ctx->size;
+    key_set keys;
+    if (key_set_alloc (&keys, ctx->key_type, ctx->distribution, n) == 0) {return 0;}
+    size_t *insert_stream = op_stream_alloc (ctx->distribution, n, n, 1, 1);
+    size_t *lookup_stream = op_stream_alloc (ctx->distribution, n, n, 0, 2);
+    unsigned long long mix_state = 3;
+    hashmap *map = hashmap_alloc (hash_funcs[ctx->key_type]);
+    if ((insert_stream == NULL) || (lookup_stream == NULL) || (map == NULL))
+    {
+        free (insert_stream);
+        free (lookup_stream);
+        hashmap_free (&map);
+        key_set_free (&keys);
+        return 0;
+    }
+    int value = 0;
+    pair in_pair = {NULL, &value, key_cpys[ctx->key_type], bench_value_cpy,
+                    key_cmps[ctx->key_type], bench_value_cmp,
+                    bench_key_free, bench_value_free, NULL, NULL};
+
+    // insert: zipfian streams repeat keys, so some insertions find the key
+    reset_peak_rss ();
+    unsigned long long start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        in_pair.key = (keyT) keys.keys[insert_stream[i]];
+        ctx->sink += hashmap_insert (map, &in_pair);
+    }
+    report (ctx, "hashmap_insert", n, latency_now_ns () - start, map);
+    for (size_t i = 0; i < n; ++i)
+    {
+        in_pair.key = (keyT) keys.keys[i];
+        hashmap_insert (map, &in_pair);
+    }
+
+    // the same keys bulk loaded: the bucket array allocated once, filled bucket by bucket
+    const_keyT *build_keys = (const_keyT *) malloc (n * sizeof(const_keyT));
+    const_valueT *build_values = (const_valueT *) malloc (n * sizeof(const_valueT));
+    if ((build_keys != NULL) && (build_values != NULL))
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            build_keys[i] = keys.keys[insert_stream[i]];
+            build_values[i] = &value;
+        }
+        reset_peak_rss ();
+        start = latency_now_ns ();
+        hashmap_builder *builder = hashmap_builder_alloc (hash_funcs[ctx->key_type], &in_pair,
+                                                          HASH_MAP_BUILD_KEEP_FIRST);
+        hashmap_builder_add_array (builder, build_keys, build_values, n);
+        hashmap *built = hashmap_builder_build (&builder);
+        report (ctx, "hashmap_build", n, latency_now_ns () - start, built);
+        ctx->sink += (built != NULL) ? built->size : 0;
+        hashmap_free (&built);
+    }
+    free (build_keys);
+    free (build_values);
+
+    // insert again, the extensions handed to a background thread
+    hashmap *background = hashmap_alloc (hash_funcs[ctx->key_type]);
+    if ((background != NULL) &&
+        (hashmap_background_resize_enable (background, HASH_MAP_HARD_LOAD_FACTOR) == 1))
+    {
+        reset_peak_rss ();
+        start = latency_now_ns ();
+        for (size_t i = 0; i < n; ++i)
+        {
+            in_pair.key = (keyT) keys.keys[insert_stream[i]];
+            ctx->sink += hashmap_insert (background, &in_pair);
+        }
+        hashmap_resize_wait (background);
+        report (ctx, "hashmap_insert_bg_resize", n, latency_now_ns () - start, background);
+    }
+    hashmap_free (&background);
+    if (ctx->distribution == DIST_UNIFORM)
+    {
+        unsigned long long inline_pause = max_insert_pause (ctx, hash_funcs[ctx->key_type],
+                                                            &keys, insert_stream,
+                                                            &in_pair, 0);
+        unsigned long long background_pause = max_insert_pause (
+            ctx, hash_funcs[ctx->key_type], &keys, insert_stream, &in_pair,
+            HASH_MAP_HARD_LOAD_FACTOR);
+        printf ("%-24s %-7s %-10s %9zu %10.2f us inline %10.2f us background\n",
+                "hashmap_insert_max_pause", key_type_names[ctx->key_type],
+                distribution_names[ctx->distribution], ctx->size,
+                (double) inline_pause / 1000.0, (double) background_pause / 1000.0);
+    }
+
+    hashmap_reset_counters (map);
+    start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        ctx->sink += (hashmap_at (map, keys.keys[lookup_stream[i]]) != NULL);
+    }
+    report (ctx, "hashmap_at_hit", n, latency_now_ns () - start, map);
+
+    // the same hits on a map whose buckets and pairs are backed by huge pages
+    if ((ctx->distribution == DIST_UNIFORM) && (n >= BENCH_HUGE_MIN_SIZE))
+    {
+        run_huge_page_hits (ctx, map, &keys, lookup_stream, &in_pair);
+    }
+
+    hashmap_reset_counters (map);
+    start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        ctx->sink += (hashmap_at (map, keys.keys[n + lookup_stream[i]]) != NULL);
+    }
+    report (ctx, "hashmap_at_miss", n, latency_now_ns () - start, map);
+
+    // the same misses, answered by a Bloom filter of the keys
+    if (hashmap_filter_enable (map, BENCH_FILTER_FP_RATE, 0) == 1)
+    {
+        hashmap_reset_counters (map);
+        start = latency_now_ns ();
+        for (size_t i = 0; i < n; ++i)
+        {
+            ctx->sink += (hashmap_at (map, keys.keys[n + lookup_stream[i]]) != NULL);
+        }
+        report (ctx, "hashmap_at_miss_filter", n, latency_now_ns () - start, map);
+        hashmap_filter_disable (map);
+    }
+
+    // mixed: lookups, and writes that keep the size of the map stable
+    hashmap_reset_counters (map);
+    start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        const void *key = keys.keys[lookup_stream[i]];
+        unsigned long long dice = bench_rand (&mix_state) % 100;
+        if (dice < BENCH_MIXED_READ_PERCENT)
+        {
+            ctx->sink += (hashmap_at (map, key) != NULL);
+        }
+        else if (dice % 2 == 0)
+        {
+            in_pair.key = (keyT) key;
+            ctx->sink += hashmap_upsert (map, &in_pair);
+        }
+        else
+        {
+            in_pair.key = (keyT) key;
+            ctx->sink += hashmap_erase (map, key);
+            ctx->sink += hashmap_insert (map, &in_pair);
+        }
+    }
+    report (ctx, "hashmap_mixed", n, latency_now_ns () - start, map);
+
+    hashmap_reset_counters (map);
+    size_t visited = 0;
+    start = latency_now_ns ();
+    while (visited < BENCH_MIN_VISITS)
+    {
+        ctx->sink += hashmap_apply_if (map, predicates[ctx->key_type], increment_value);
+        visited += map->size;
+    }
+    report (ctx, "hashmap_apply_if", visited, latency_now_ns () - start, map);
+
+    hashmap_reset_counters (map);
+    start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        ctx->sink += hashmap_erase (map, keys.keys[insert_stream[i]]);
+    }
+    report (ctx, "hashmap_erase", n, latency_now_ns () - start, map);
+    hashmap_free (&map);
+
+    // counting: an int value per key through hashmap_find_or_insert, then inline counts
+    map = hashmap_alloc (hash_funcs[ctx->key_type]);
+    counter_map *counters = counter_map_alloc (hash_funcs[ctx->key_type],
+                                               key_cpys[ctx->key_type],
+                                               key_cmps[ctx->key_type], bench_key_free);
+    const_keyT *batch = (const_keyT *) malloc (n * sizeof(const_keyT));
+    if ((map == NULL) || (counters == NULL) || (batch == NULL))
+    {
+        hashmap_free (&map);
+        counter_map_free (&counters);
+        free (batch);
+        free (insert_stream);
+        free (lookup_stream);
+        key_set_free (&keys);
+        return 0;
+    }
+    start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        in_pair.key = (keyT) keys.keys[lookup_stream[i]];
+        valueT *slot = hashmap_find_or_insert (map, &in_pair, NULL);
+        if (slot != NULL) {++(*(int *) *slot);}
+    }
+    report (ctx, "hashmap_count", n, latency_now_ns () - start, map);
+
+    start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        ctx->sink += counter_map_increment (counters, keys.keys[lookup_stream[i]], 1);
+    }
+    report (ctx, "counter_increment", n, latency_now_ns () - start, counters->map);
+    counter_map_free (&counters);
+
+    counters = counter_map_alloc (hash_funcs[ctx->key_type], key_cpys[ctx->key_type],
+                                  key_cmps[ctx->key_type], bench_key_free);
+    for (size_t i = 0; i < n; ++i)
+    {
+        batch[i] = keys.keys[lookup_stream[i]];
+    }
+    start = latency_now_ns ();
+    ctx->sink += counter_map_increment_batch (counters, batch, NULL, n);
+    report (ctx, "counter_increment_batch", n, latency_now_ns () - start,
+            (counters != NULL) ? counters->map : NULL);
+
+    counter_map_free (&counters);
+    free (batch);
+    hashmap_free (&map);
+
+    // insertion ordered: dense entries and a sparse index table
+    ordered_hashmap *ordered = ordered_hashmap_alloc (hash_funcs[ctx->key_type]);
+    if (ordered == NULL)
+    {
+        free (insert_stream);
+        free (lookup_stream);
+        key_set_free (&keys);
+        return 0;
+    }
+    reset_peak_rss ();
+    start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        in_pair.key = (keyT) keys.keys[insert_stream[i]];
+        ctx->sink += ordered_hashmap_insert (ordered, &in_pair);
+    }
+    report (ctx, "ordered_insert", n, latency_now_ns () - start, NULL);
+    for (size_t i = 0; i < n; ++i)
+    {
+        in_pair.key = (keyT) keys.keys[i];
+        ordered_hashmap_insert (ordered, &in_pair);
+    }
+
+    start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        ctx->sink += (ordered_hashmap_at (ordered, keys.keys[lookup_stream[i]]) != NULL);
+    }
+    report (ctx, "ordered_at_hit", n, latency_now_ns () - start, NULL);
+
+    visited = 0;
+    start = latency_now_ns ();
+    while (visited < BENCH_MIN_VISITS)
+    {
+        size_t cursor = 0;
+        pair *p;
+        while ((p = ordered_hashmap_next (ordered, &cursor)) != NULL)
+        {
+            ctx->sink += *(int *) p->value;
+        }
+        visited += ordered->size;
+    }
+    report (ctx, "ordered_iterate", visited, latency_now_ns () - start, NULL);
+
+    ordered_hashmap_free (&ordered);
+
+    // type specialized (int keys only): keys and values stored by value
+    if (ctx->key_type == KEY_INT)
+    {
+        bench_int_map *typed = bench_int_map_alloc ();
+        if (typed == NULL)
+        {
+            free (insert_stream);
+            free (lookup_stream);
+            key_set_free (&keys);
+            return 0;
+        }
+        reset_peak_rss ();
+        start = latency_now_ns ();
+        for (size_t i = 0; i < n; ++i)
+        {
+            ctx->sink += bench_int_map_insert (typed, *(int *) keys.keys[insert_stream[i]], 1);
+        }
+        report (ctx, "typed_insert", n, latency_now_ns () - start, NULL);
+        for (size_t i = 0; i < n; ++i)
+        {
+            bench_int_map_insert (typed, *(int *) keys.keys[i], 1);
+        }
+
+        start = latency_now_ns ();
+        for (size_t i = 0; i < n; ++i)
+        {
+            ctx->sink += (bench_int_map_at (typed, *(int *) keys.keys[lookup_stream[i]]) != NULL);
+        }
+        report (ctx, "typed_at_hit", n, latency_now_ns () - start, NULL);
+        bench_int_map_free (&typed);
+    }
+
+    free (insert_stream);
+    free (lookup_stream);
+    key_set_free (&keys);
+    return 1;
+}
+
+/**
+ * Runs the durable map workloads for the current key type and size: the inserts
+ * and updates of keys logged with group commit, the compaction of the log, its
+ * replay, and the updates with a periodic fsync. The write amplification (bytes
+ * logged and compacted per byte of key and value encodings) goes to the standard
+ * output.
+ * @return 1 on success, 0 otherwise.
+ */
+int run_durable_workloads (bench_context *ctx)
+{
+    static const hash_func hash_funcs[KEY_TYPES] = {hash_int, hash_double, hash_string};
+    static const durable_encode_func encoders[KEY_TYPES] = {int_encode, double_encode,
+                                                            string_encode};
+    static const durable_decode_func decoders[KEY_TYPES] = {int_decode, double_decode,
+                                                            string_decode};
+    static const pair_key_cpy key_cpys[KEY_TYPES] = {int_key_cpy, double_key_cpy,
+                                                     string_key_cpy};
+    static const pair_key_cmp key_cmps[KEY_TYPES] = {int_key_cmp, double_key_cmp,
+                                                     string_key_cmp};
+    size_t n = ctx->size;
+    key_set keys;
+    if (key_set_alloc (&keys, ctx->key_type, ctx->distribution, n) == 0) {return 0;}
+    size_t *insert_stream = op_stream_alloc (ctx->distribution, n, n, 1, 1);
+    size_t *update_stream = op_stream_alloc (ctx->distribution, n, n, 0, 2);
+    durable_codec codec = {encoders[ctx->key_type], int_encode, decoders[ctx->key_type],
+                           int_decode, key_cpys[ctx->key_type], bench_value_cpy,
+                           key_cmps[ctx->key_type], bench_value_cmp, bench_key_free,
+                           bench_value_free};
+    // no automatic compaction, it is timed apart
+    durable_options options = {DURABLE_BUFFER_BYTES, 0, 0};
+    remove (BENCH_DURABLE_LOG);
+    durable_hashmap *durable = durable_hashmap_open (BENCH_DURABLE_LOG,
+                                                     hash_funcs[ctx->key_type], &codec,
+                                                     &options);
+    if ((insert_stream == NULL) || (update_stream == NULL) || (durable == NULL))
+    {
+        free (insert_stream);
+        free (update_stream);
+        durable_hashmap_free (&durable);
+        remove (BENCH_DURABLE_LOG);
+        key_set_free (&keys);
+        return 0;
+    }
+    int value = 0;
+    pair in_pair = {NULL, &value, key_cpys[ctx->key_type], bench_value_cpy,
+                    key_cmps[ctx->key_type], bench_value_cmp,
+                    bench_key_free, bench_value_free, NULL, NULL};
+
+    reset_peak_rss ();
+    unsigned long long start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        in_pair.key = (keyT) keys.keys[insert_stream[i]];
+        ctx->sink += durable_hashmap_insert (durable, &in_pair);
+    }
+    ctx->sink += durable_hashmap_sync (durable);
+    report (ctx, "durable_insert", n, latency_now_ns () - start, durable->map);
+
+    start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        value = (int) i;
+        in_pair.key = (keyT) keys.keys[update_stream[i]];
+        ctx->sink += durable_hashmap_upsert (durable, &in_pair);
+    }
+    ctx->sink += durable_hashmap_sync (durable);
+    report (ctx, "durable_upsert", n, latency_now_ns () - start, durable->map);
+
+    // the log holds 2n records of n keys
+    start = latency_now_ns ();
+    ctx->sink += durable_hashmap_compact (durable);
+    ctx->sink += durable_hashmap_compact_wait (durable);
+    report (ctx, "durable_compact", durable->map->size, latency_now_ns () - start,
+            durable->map);
+    const durable_counters *counters = &(durable->counters);
+    if (counters->payload_bytes > 0)
+    {
+        printf ("%-24s %-7s %-10s %9zu %10.2f log B/op %6.2f payload B/op  write amp %.2f\n",
+                "durable_log", key_type_names[ctx->key_type],
+                distribution_names[ctx->distribution], ctx->size,
+                (double) counters->log_bytes / (double) counters->records,
+                (double) counters->payload_bytes / (double) counters->records,
+                (double) (counters->log_bytes + counters->compacted_bytes)
+                / (double) counters->payload_bytes);
+    }
+    durable_hashmap_free (&durable);
+
+    reset_peak_rss ();
+    start = latency_now_ns ();
+    durable = durable_hashmap_open (BENCH_DURABLE_LOG, hash_funcs[ctx->key_type], &codec,
+                                    &options);
+    unsigned long long elapsed = latency_now_ns () - start;
+    if (durable != NULL)
+    {
+        report (ctx, "durable_replay", durable->counters.replayed, elapsed, durable->map);
+        durable_hashmap_free (&durable);
+    }
+
+    // group commit with an fsync every BENCH_DURABLE_SYNC_RECORDS records
+    remove (BENCH_DURABLE_LOG);
+    options.sync_records = BENCH_DURABLE_SYNC_RECORDS;
+    durable = durable_hashmap_open (BENCH_DURABLE_LOG, hash_funcs[ctx->key_type], &codec,
+                                    &options);
+    if (durable != NULL)
+    {
+        start = latency_now_ns ();
+        for (size_t i = 0; i < n; ++i)
+        {
+            in_pair.key = (keyT) keys.keys[update_stream[i]];
+            ctx->sink += durable_hashmap_upsert (durable, &in_pair);
+        }
+        ctx->sink += durable_hashmap_sync (durable);
+        report (ctx, "durable_upsert_sync", n, latency_now_ns () - start, durable->map);
+        durable_hashmap_free (&durable);
+    }
+    remove (BENCH_DURABLE_LOG);
+
+    free (insert_stream);
+    free (update_stream);
+    key_set_free (&keys);
+    return 1;
+}
+
+/**
+ * Runs the element-size vector microbenchmarks for the current size, with ints
+ * stored contiguously.
+ * @param linear_ops the number of linear operations (find) to run.
+ * @return 1 on success, 0 otherwise.
+ */
+int run_vector_elem_workloads (bench_context *ctx, size_t linear_ops)
+{
+    size_t n = ctx->size;
+    vector *v = vector_alloc_elem (sizeof(int));
+    int *values = malloc (sizeof(int) * n);
+    if ((v == NULL) || (values == NULL))
+    {
+        vector_free (&v);
+        free (values);
+        return 0;
+    }
+    unsigned long long state = 5;
+    for (size_t i = 0; i < n; ++i)
+    {
+        values[i] = (int) i;
+    }
+
+    ctx->key_type = KEY_INT;
+    ctx->distribution = DIST_SEQUENTIAL;
+    unsigned long long start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        ctx->sink += vector_push_back (v, &(values[i]));
+    }
+    report (ctx, "vector_elem_push_back", n, latency_now_ns () - start, NULL);
+
+    vector_clear (v);
+    start = latency_now_ns ();
+    ctx->sink += vector_append_range (v, values, n);
+    report (ctx, "vector_elem_append_range", n, latency_now_ns () - start, NULL);
+
+    ctx->distribution = DIST_UNIFORM;
+    start = latency_now_ns ();
+    for (size_t i = 0; i < linear_ops; ++i)
+    {
+        int value = (int) (bench_rand (&state) % n);
+        ctx->sink += (size_t) vector_find (v, &value);
+    }
+    report (ctx, "vector_elem_find", linear_ops, latency_now_ns () - start, NULL);
+
+    free (values);
+    vector_free (&v);
+    return 1;
+}
+
+/**
+ * Runs the vector microbenchmarks for the current size, with int elements.
+ * @return 1 on success, 0 otherwise.
+ */
+int run_vector_workloads (bench_context *ctx)
+{
+    size_t n = ctx->size;
+    size_t linear_ops = BENCH_LINEAR_BUDGET / n;
+    if (linear_ops > 1000) {linear_ops = 1000;}
+    if (linear_ops < 10) {linear_ops = 10;}
+    if (linear_ops > n / 2) {linear_ops = n / 2;}
+    vector *v = vector_alloc (int_key_cpy, int_key_cmp, bench_key_free);
+    if (v == NULL) {return 0;}
+    unsigned long long state = 4;
+
+    ctx->key_type = KEY_INT;
+    ctx->distribution = DIST_SEQUENTIAL;
+    unsigned long long start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        int value = (int) i;
+        ctx->sink += vector_push_back (v, &value);
+    }
+    report (ctx, "vector_push_back", n, latency_now_ns () - start, NULL);
+
+    ctx->distribution = DIST_UNIFORM;
+    start = latency_now_ns ();
+    for (size_t i = 0; i < n; ++i)
+    {
+        ctx->sink += (vector_at (v, bench_rand (&state) % n) != NULL);
+    }
+    report (ctx, "vector_at", n, latency_now_ns () - start, NULL);
+
+    start = latency_now_ns ();
+    for (size_t i = 0; i < linear_ops; ++i)
+    {
+        int value = (int) (bench_rand (&state) % n);
+        ctx->sink += (size_t) vector_find (v, &value);
+    }
+    report (ctx, "vector_find", linear_ops, latency_now_ns () - start, NULL);
+
+    start = latency_now_ns ();
+    for (size_t i = 0; i < linear_ops; ++i)
+    {
+        ctx->sink += vector_erase (v, bench_rand (&state) % v->size);
+    }
+    report (ctx, "vector_erase", linear_ops, latency_now_ns () - start, NULL);
+
+    size_t unordered_ops = v->size / 2;
+    start = latency_now_ns ();
+    for (size_t i = 0; i < unordered_ops; ++i)
+    {
+        ctx->sink += vector_erase_unordered (v, bench_rand (&state) % v->size);
+    }
+    report (ctx, "vector_erase_unordered", unordered_ops, latency_now_ns () - start, NULL);
+
+    ctx->distribution = DIST_SEQUENTIAL;
+    size_t erased = v->size;
+    start = latency_now_ns ();
+    while (v->size > 0)
+    {
+        ctx->sink += vector_erase (v, v->size - 1);
+    }
+    report (ctx, "vector_erase_back", erased, latency_now_ns () - start, NULL);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        int value = (int) i;
+        vector_push_back (v, &value);
+    }
+    start = latency_now_ns ();
+    vector_clear (v);
+    report (ctx, "vector_clear", n, latency_now_ns () - start, NULL);
+
+    vector_free (&v);
+    return run_vector_elem_workloads (ctx, linear_ops);
+}
+
+/**
+ * @struct bench_options
+ * The command line options, see the usage at the top of the file.
+ */
+typedef struct bench_options {
+    size_t max_size;
+    const char *output;
+    size_t trials;
+    const char *save_baseline;
+    const char *compare;
+    double threshold;
+} bench_options;
+
+/**
+ * Parses the command line.
+ * @return 1 on success, 0 on a bad argument.
+ */
+int parse_args (int argc, char *argv[], bench_options *options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if ((strcmp (argv[i], "--max-size") == 0) && (i + 1 < argc))
+        {
+            options->max_size = strtoul (argv[++i], NULL, 10);
+        }
+        else if ((strcmp (argv[i], "--output") == 0) && (i + 1 < argc))
+        {
+            options->output = argv[++i];
+        }
+        else if ((strcmp (argv[i], "--trials") == 0) && (i + 1 < argc))
+        {
+            options->trials = strtoul (argv[++i], NULL, 10);
+            if ((options->trials == 0) || (options->trials > BENCH_MAX_TRIALS)) {return 0;}
+        }
+        else if ((strcmp (argv[i], "--save-baseline") == 0) && (i + 1 < argc))
+        {
+            options->save_baseline = argv[++i];
+        }
+        else if ((strcmp (argv[i], "--compare") == 0) && (i + 1 < argc))
+        {
+            options->compare = argv[++i];
+        }
+        else if ((strcmp (argv[i], "--threshold") == 0) && (i + 1 < argc))
+        {
+            options->threshold = strtod (argv[++i], NULL);
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Returns the two-sided 95% critical value of Student's t distribution.
+ * @param df degrees of freedom.
+ */
+double t_critical (double df)
+{
+    static const double table[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365,
+                                     2.306, 2.262, 2.228, 2.201, 2.179, 2.160, 2.145,
+                                     2.131, 2.120, 2.110, 2.101, 2.093, 2.086, 2.080,
+                                     2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048,
+                                     2.045, 2.042};
+    if (df < 1) {return table[0];}
+    if (df <= 30) {return table[(size_t) df - 1];}
+    if (df <= 60) {return 2.000;}
+    if (df <= 120) {return 1.980;}
+    return 1.960;
+}
+
+/**
+ * Compares doubles, for qsort.
+ */
+int cmp_double (const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Summarizes the samples of a workload.
+ */
+void summarize (const bench_samples *samples, bench_summary *summary)
+{
+    double sorted[BENCH_MAX_TRIALS];
+    size_t n = samples->count;
+    memcpy (sorted, samples->samples, sizeof(double) * n);
+    qsort (sorted, n, sizeof(double), cmp_double);
+    snprintf (summary->id, BENCH_ID_LEN, "%s", samples->id);
+    summary->trials = n;
+    summary->median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    summary->mean = 0;
+    for (size_t i = 0; i < n; ++i) {summary->mean += sorted[i] / (double) n;}
+    double variance = 0;
+    for (size_t i = 0; (i < n) && (n > 1); ++i)
+    {
+        variance += (sorted[i] - summary->mean) * (sorted[i] - summary->mean) / (double) (n - 1);
+    }
+    summary->stddev = sqrt (variance);
+    summary->ci95 = n > 1 ? t_critical ((double) (n - 1)) * summary->stddev / sqrt ((double) n) : 0;
+}
+
+/**
+ * Writes the summaries of all the workloads to a baseline file.
+ * @return 1 on success, 0 otherwise.
+ */
+int save_baseline (const bench_context *ctx, const char *path)
+{
+    FILE *f = fopen (path, "w");
+    if (f == NULL) {return 0;}
+    fprintf (f, "workload,key_type,distribution,size,trials,median_ns,mean_ns,stddev_ns,ci95_ns\n");
+    for (size_t i = 0; i < ctx->num_results; ++i)
+    {
+        bench_summary summary;
+        summarize (&(ctx->results[i]), &summary);
+        fprintf (f, "%s,%zu,%.4f,%.4f,%.4f,%.4f\n", summary.id, summary.trials,
+                 summary.median, summary.mean, summary.stddev, summary.ci95);
+    }
+    return fclose (f) == 0;
+}
+
+/**
+ * Reads a baseline file written by save_baseline.
+ * @param count set to the number of summaries read.
+ * @return dynamically allocated array of the summaries, NULL on failure.
+ */
+bench_summary *load_baseline (const char *path, size_t *count)
+{
+    FILE *f = fopen (path, "r");
+    if (f == NULL) {return NULL;}
+    size_t capacity = 64;
+    bench_summary *summaries = malloc (sizeof(bench_summary) * capacity);
+    char line[512];
+    *count = 0;
+    while ((summaries != NULL) && (fgets (line, sizeof(line), f) != NULL))
+    {
+        // the id is made of the first 4 fields
+        char *field = line;
+        for (int commas = 0; (field != NULL) && (commas < 4); ++commas)
+        {
+            field = strchr (field, ',');
+            if (field != NULL) {++field;}
+        }
+        bench_summary summary;
+        if ((field == NULL) || (field - line > (long) BENCH_ID_LEN) ||
+            (sscanf (field, "%zu,%lf,%lf,%lf,%lf", &summary.trials, &summary.median,
+                     &summary.mean, &summary.stddev, &summary.ci95) != 5))
+        {
+            continue; // the header, or a malformed line
+        }
+        snprintf (summary.id, (size_t) (field - line), "%s", line);
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            bench_summary *temp = realloc (summaries, sizeof(bench_summary) * capacity);
+            if (temp == NULL)
+            {
+                free (summaries);
+                summaries = NULL;
+                break;
+            }
+            summaries = temp;
+        }
+        summaries[*count] = summary;
+        ++(*count);
+    }
+    fclose (f);
+    return summaries;
+}
+
+/**
+ * Compares the results of this run with a baseline. A workload regressed if its
+ * median got slower by more than threshold percent, and its mean is slower
+ * beyond the noise of both runs (Welch's t-test at 95%).
+ * @return the number of regressed workloads, -1 if the baseline can not be read.
+ */
+int compare_with_baseline (const bench_context *ctx, const char *path, double threshold)
+{
+    size_t count = 0;
+    bench_summary *baseline = load_baseline (path, &count);
+    if (baseline == NULL) {return -1;}
+    int regressions = 0;
+    printf ("\ncomparison with %s (threshold %.1f%%):\n", path, threshold);
+    for (size_t i = 0; i < ctx->num_results; ++i)
+    {
+        bench_summary current;
+        summarize (&(ctx->results[i]), &current);
+        const bench_summary *base = NULL;
+        for (size_t j = 0; (j < count) && (base == NULL); ++j)
+        {
+            if (strcmp (baseline[j].id, current.id) == 0) {base = &(baseline[j]);}
+        }
+        if ((base == NULL) || (base->median <= 0)) {continue;}
+
+        double change = (current.median / base->median - 1.0) * 100.0;
+        double v1 = current.stddev * current.stddev / (double) current.trials;
+        double v2 = base->stddev * base->stddev / (double) base->trials;
+        double se = sqrt (v1 + v2);
+        int significant = 1;
+        if ((se > 0) && (current.trials > 1) && (base->trials > 1))
+        {
+            double df = (v1 + v2) * (v1 + v2) /
+                        (v1 * v1 / (double) (current.trials - 1) +
+                         v2 * v2 / (double) (base->trials - 1));
+            significant = (current.mean - base->mean) > t_critical (df) * se;
+        }
+        const char *verdict = "ok";
+        if ((change > threshold) && significant)
+        {
+            verdict = "REGRESSION";
+            ++regressions;
+        }
+        else if ((change < -threshold) && significant)
+        {
+            verdict = "improved";
+        }
+        printf ("%-10s %s: %.2f -> %.2f ns/op (%+.1f%%, +-%.2f)\n", verdict, current.id,
+                base->median, current.median, change, current.ci95);
+    }
+    free (baseline);
+    printf ("%d regression(s)\n", regressions);
+    return regressions;
+}
+
+int main (int argc, char *argv[])
+{
+    bench_options options = {BENCH_MAX_SIZE, BENCH_OUTPUT, BENCH_TRIALS, NULL, NULL,
+                             BENCH_THRESHOLD};
+    if (parse_args (argc, argv, &options) == 0)
+    {
+        fprintf (stderr, "usage: %s [--max-size N] [--output FILE] [--trials N]\n"
+                         "       [--save-baseline FILE] [--compare FILE] [--threshold PCT]\n",
+                 argv[0]);
+        return 2;
+    }
+    bench_context ctx = {0};
+    ctx.out = fopen (options.output, "w");
+    if (ctx.out == NULL)
+    {
+        perror (options.output);
+        return 1;
+    }
+    fprintf (ctx.out, "workload,key_type,distribution,size,trial,ops,ns_per_op,"
+                      "peak_rss_kb,resizes_up,resizes_down\n");
+    int result = 0;
+    // the trials are interleaved, so a slow drift of the machine spreads over all workloads
+    for (ctx.trial = 0; (ctx.trial < options.trials) && (result == 0); ++ctx.trial)
+    {
+        for (size_t size = BENCH_MIN_SIZE; (size <= options.max_size) && (result == 0);
+             size *= 10)
+        {
+            ctx.size = size;
+            if (run_vector_workloads (&ctx) == 0)
+            {
+                fprintf (stderr, "out of memory at size %zu\n", size);
+                result = 1;
+            }
+            for (int type = 0; (type < KEY_TYPES) && (result == 0); ++type)
+            {
+                for (int dist = 0; (dist < DISTRIBUTIONS) && (result == 0); ++dist)
+                {
+                    ctx.size = size;
+                    ctx.key_type = type;
+                    ctx.distribution = dist;
+                    if (run_hashmap_workloads (&ctx) == 0)
+                    {
+                        fprintf (stderr, "out of memory at size %zu\n", size);
+                        result = 1;
+                    }
+                    if ((result == 0) && (dist == DIST_UNIFORM)
+                        && (size <= BENCH_DURABLE_MAX_SIZE)
+                        && (run_durable_workloads (&ctx) == 0))
+                    {
+                        fprintf (stderr, "could not run the durable workloads at size %zu\n",
+                                 size);
+                        result = 1;
+                    }
+                }
+            }
+        }
+    }
+    fclose (ctx.out);
+    printf ("results written to %s (checksum %zu)\n", options.output, ctx.sink);
+
+    if ((result == 0) && (options.save_baseline != NULL))
+    {
+        if (save_baseline (&ctx, options.save_baseline) == 0)
+        {
+            perror (options.save_baseline);
+            result = 1;
+        }
+    }
+    if ((result == 0) && (options.compare != NULL))
+    {
+        int regressions = compare_with_baseline (&ctx, options.compare, options.threshold);
+        if (regressions == -1)
+        {
+            perror (options.compare);
+            result = 1;
+        }
+        else if (regressions > 0)
+        {
+            result = BENCH_REGRESSION_EXIT;
+        }
+    }
+    free (ctx.results);
+    return result;
+}
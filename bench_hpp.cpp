@@ -0,0 +1,211 @@
+//
+// Throughput benchmarks of the C++ front-end (hashmap.hpp) against std::unordered_map.
+//
+// Usage: hashmap_bench_hpp [--max-size N] [--trials N]
+// Both containers run the same workloads for int and std::string keys, uniformly
+// random, for map sizes 1K, 10K, ... up to --max-size (1M by default): insert
+// (try_emplace), insert_reserved (after reserve), find_hit, find_miss, find_view
+// (std::string keys searched by std::string_view: a transparent lookup in hashmap,
+// a temporary std::string in std::unordered_map), iterate and erase. The median
+// ns/op of the trials is written to the standard output.
+//
+#include "hashmap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t bench_min_size = 1000;
+constexpr std::size_t bench_max_size = 1000000;
+constexpr std::size_t bench_trials = 3;
+constexpr std::size_t bench_min_visits = 10000000;
+
+using int_map = hashmap_library::hashmap<int, int>;
+using int_unordered_map = std::unordered_map<int, int>;
+using string_map = hashmap_library::string_hashmap<int>;
+using string_unordered_map = std::unordered_map<std::string, int>;
+
+enum workload {INSERT, INSERT_RESERVED, FIND_HIT, FIND_MISS, FIND_VIEW, ITERATE, ERASE, WORKLOADS};
+const char *workload_names[WORKLOADS] = {"insert", "insert_reserved", "find_hit",
+                                         "find_miss", "find_view", "iterate", "erase"};
+
+volatile std::size_t sink;
+
+double now_ns ()
+{
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds> (
+        std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+/**
+ * The keys of a benchmark: keys to insert, as many keys which are not inserted, and
+ * the indices of the inserted keys to look up, uniformly random.
+ */
+template <class Key>
+struct key_set {
+    std::vector<Key> present;
+    std::vector<Key> missing;
+    std::vector<std::size_t> lookups;
+};
+
+// distinct, scattered numbers: i times an odd constant is a permutation of 32 bits
+unsigned int key_number (std::size_t i)
+{
+    return (unsigned int) (i * 2654435761UL);
+}
+
+int make_key (unsigned int number, int *)
+{
+    return (int) number;
+}
+
+std::string make_key (unsigned int number, std::string *)
+{
+    char key[16];
+    std::snprintf (key, sizeof(key), "%010u", number);
+    return key;
+}
+
+template <class Key>
+key_set<Key> make_keys (std::size_t size)
+{
+    key_set<Key> keys;
+    for (std::size_t i = 0; i < 2 * size; ++i)
+    {
+        Key key = make_key (key_number (i), (Key *) nullptr);
+        (i < size ? keys.present : keys.missing).push_back (std::move (key));
+    }
+    std::mt19937_64 random (size);
+    std::uniform_int_distribution<std::size_t> index (0, size - 1);
+    for (std::size_t i = 0; i < size; ++i) {keys.lookups.push_back (index (random));}
+    return keys;
+}
+
+// a lookup by std::string_view: transparent in hashmap, by a copy in std::unordered_map
+bool found_view (const string_map &map, std::string_view key)
+{
+    return map.find (key) != map.end ();
+}
+
+bool found_view (const string_unordered_map &map, std::string_view key)
+{
+    return map.find (std::string (key)) != map.end ();
+}
+
+/**
+ * Runs the workloads once on a new map.
+ * @param ns the ns/op of every workload, -1 for the workloads not run.
+ */
+template <class Map, class Key>
+void run_trial (const key_set<Key> &keys, double ns[WORKLOADS])
+{
+    const double n = (double) keys.present.size ();
+    Map map;
+    double start = now_ns ();
+    for (const Key &key : keys.present) {sink += map.try_emplace (key, 1).second;}
+    ns[INSERT] = (now_ns () - start) / n;
+
+    Map reserved;
+    start = now_ns ();
+    reserved.reserve (keys.present.size ());
+    for (const Key &key : keys.present) {sink += reserved.try_emplace (key, 1).second;}
+    ns[INSERT_RESERVED] = (now_ns () - start) / n;
+
+    start = now_ns ();
+    for (std::size_t i : keys.lookups) {sink += map.find (keys.present[i]) != map.end ();}
+    ns[FIND_HIT] = (now_ns () - start) / n;
+
+    start = now_ns ();
+    for (const Key &key : keys.missing) {sink += map.find (key) != map.end ();}
+    ns[FIND_MISS] = (now_ns () - start) / n;
+
+    ns[FIND_VIEW] = -1;
+    if constexpr (std::is_same<Key, std::string>::value)
+    {
+        std::vector<std::string_view> views (keys.present.begin (), keys.present.end ());
+        start = now_ns ();
+        for (std::size_t i : keys.lookups) {sink += found_view (map, views[i]);}
+        ns[FIND_VIEW] = (now_ns () - start) / n;
+    }
+
+    std::size_t visited = 0;
+    start = now_ns ();
+    while (visited < bench_min_visits)
+    {
+        for (const auto &p : map) {sink += p.second;}
+        visited += map.size ();
+    }
+    ns[ITERATE] = (now_ns () - start) / (double) visited;
+
+    start = now_ns ();
+    for (const Key &key : keys.present) {sink += map.erase (key);}
+    ns[ERASE] = (now_ns () - start) / n;
+}
+
+/**
+ * Runs the trials of a container and prints the median of every workload.
+ */
+template <class Map, class Key>
+void run_container (const char *container, const char *key_name, const key_set<Key> &keys,
+                    std::size_t trials)
+{
+    std::vector<double> samples[WORKLOADS];
+    for (std::size_t trial = 0; trial < trials; ++trial)
+    {
+        double ns[WORKLOADS];
+        run_trial<Map> (keys, ns);
+        for (int w = 0; w < WORKLOADS; ++w) {samples[w].push_back (ns[w]);}
+    }
+    for (int w = 0; w < WORKLOADS; ++w)
+    {
+        std::vector<double> &s = samples[w];
+        std::sort (s.begin (), s.end ());
+        double median = s[s.size () / 2];
+        if (median < 0) {continue;}
+        std::printf ("%-16s %-14s %-7s %9zu %10.2f ns/op\n", workload_names[w], container,
+                     key_name, keys.present.size (), median);
+    }
+    std::fflush (stdout);
+}
+
+}  // namespace
+
+int main (int argc, char *argv[])
+{
+    std::size_t max_size = bench_max_size;
+    std::size_t trials = bench_trials;
+    for (int i = 1; i < argc; ++i)
+    {
+        if ((std::strcmp (argv[i], "--max-size") == 0) && (i + 1 < argc))
+        {
+            max_size = std::strtoul (argv[++i], nullptr, 10);
+        }
+        else if ((std::strcmp (argv[i], "--trials") == 0) && (i + 1 < argc))
+        {
+            trials = std::max (std::strtoul (argv[++i], nullptr, 10), 1UL);
+        }
+        else
+        {
+            std::fprintf (stderr, "Usage: %s [--max-size N] [--trials N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    for (std::size_t size = bench_min_size; size <= max_size; size *= 10)
+    {
+        key_set<int> ints = make_keys<int> (size);
+        run_container<int_map> ("hashmap", "int", ints, trials);
+        run_container<int_unordered_map> ("unordered_map", "int", ints, trials);
+        key_set<std::string> strings = make_keys<std::string> (size);
+        run_container<string_map> ("hashmap", "string", strings, trials);
+        run_container<string_unordered_map> ("unordered_map", "string", strings, trials);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,210 @@
+/**
+ * Pairs used by the benchmarks: { int: int }, { double: int } and { char *: int }.
+ * The value type is always int *.
+ */
+
+#ifndef BENCH_PAIRS_H_
+#define BENCH_PAIRS_H_
+
+#include <stdlib.h>
+#include <string.h>
+#include "pair.h"
+
+/**
+ * Copies the int key of the pair.
+ */
+void *int_key_cpy (const_keyT key)
+{
+    int *new_int = malloc (sizeof (int));
+    *new_int = *((int *) key);
+    return new_int;
+}
+
+/**
+ * Compares the int key of the pair.
+ */
+int int_key_cmp (const_keyT key_1, const_keyT key_2)
+{
+    return *(int *) key_1 == *(int *) key_2;
+}
+
+/**
+ * Copies the double key of the pair.
+ */
+void *double_key_cpy (const_keyT key)
+{
+    double *new_double = malloc (sizeof (double));
+    *new_double = *((double *) key);
+    return new_double;
+}
+
+/**
+ * Compares the double key of the pair.
+ */
+int double_key_cmp (const_keyT key_1, const_keyT key_2)
+{
+    return *(double *) key_1 == *(double *) key_2;
+}
+
+/**
+ * Copies the string key of the pair.
+ */
+void *string_key_cpy (const_keyT key)
+{
+    size_t length = strlen ((const char *) key) + 1;
+    char *new_string = malloc (length);
+    memcpy (new_string, key, length);
+    return new_string;
+}
+
+/**
+ * Compares the string key of the pair.
+ */
+int string_key_cmp (const_keyT key_1, const_keyT key_2)
+{
+    return strcmp ((const char *) key_1, (const char *) key_2) == 0;
+}
+
+/**
+ * Frees the key of the pair (any of the types above).
+ */
+void bench_key_free (keyT *key)
+{
+    if (key && *key)
+    {
+        free (*key);
+        *key = NULL;
+    }
+}
+
+/**
+ * Copies the int value of the pair.
+ */
+void *bench_value_cpy (const_valueT value)
+{
+    int *new_int = malloc (sizeof (int));
+    *new_int = *((int *) value);
+    return new_int;
+}
+
+/**
+ * Compares the int value of the pair.
+ */
+int bench_value_cmp (const_valueT val_1, const_valueT val_2)
+{
+    return *(int *) val_1 == *(int *) val_2;
+}
+
+/**
+ * Frees the int value of the pair.
+ */
+void bench_value_free (valueT *val)
+{
+    if (val && *val)
+    {
+        free (*val);
+        *val = NULL;
+    }
+}
+
+/**
+ * @param elem pointer to an int key
+ * @return 1 if the key is even, else - 0
+ */
+int is_even_int (const_keyT elem)
+{
+    return (*(int *) elem % 2) == 0;
+}
+
+/**
+ * @param elem pointer to a double key
+ * @return 1 if the integer part of the key is even, else - 0
+ */
+int is_even_double (const_keyT elem)
+{
+    return ((long) *(double *) elem % 2) == 0;
+}
+
+/**
+ * @param elem pointer to a string key
+ * @return 1 if the last character of the key is an even digit, else - 0
+ */
+int is_even_string (const_keyT elem)
+{
+    const char *key = elem;
+    size_t length = strlen (key);
+    return (length > 0) && ((key[length - 1] - '0') % 2 == 0);
+}
+
+/**
+ * increments the value pointed to by the given pointer
+ * @param elem pointer to an integer
+ */
+void increment_value (valueT elem)
+{
+    ++(*((int *) elem));
+}
+
+/**
+ * Encodes the int key or value of the pair for a durable map, in its native bytes.
+ */
+size_t int_encode (const void *elem, unsigned char *buffer, size_t capacity)
+{
+    if (capacity >= sizeof (int)) {memcpy (buffer, elem, sizeof (int));}
+    return sizeof (int);
+}
+
+/**
+ * Decodes the int key or value of the pair for a durable map.
+ */
+void *int_decode (const unsigned char *data, size_t size)
+{
+    if (size != sizeof (int)) {return NULL;}
+    int *new_int = malloc (sizeof (int));
+    if (new_int != NULL) {memcpy (new_int, data, sizeof (int));}
+    return new_int;
+}
+
+/**
+ * Encodes the double key of the pair for a durable map, in its native bytes.
+ */
+size_t double_encode (const void *elem, unsigned char *buffer, size_t capacity)
+{
+    if (capacity >= sizeof (double)) {memcpy (buffer, elem, sizeof (double));}
+    return sizeof (double);
+}
+
+/**
+ * Decodes the double key of the pair for a durable map.
+ */
+void *double_decode (const unsigned char *data, size_t size)
+{
+    if (size != sizeof (double)) {return NULL;}
+    double *new_double = malloc (sizeof (double));
+    if (new_double != NULL) {memcpy (new_double, data, sizeof (double));}
+    return new_double;
+}
+
+/**
+ * Encodes the string key of the pair for a durable map, without its null terminator.
+ */
+size_t string_encode (const void *elem, unsigned char *buffer, size_t capacity)
+{
+    size_t length = strlen ((const char *) elem);
+    if (capacity >= length) {memcpy (buffer, elem, length);}
+    return length;
+}
+
+/**
+ * Decodes the string key of the pair for a durable map.
+ */
+void *string_decode (const unsigned char *data, size_t size)
+{
+    char *new_string = malloc (size + 1);
+    if (new_string == NULL) {return NULL;}
+    memcpy (new_string, data, size);
+    new_string[size] = '\0';
+    return new_string;
+}
+
+#endif //BENCH_PAIRS_H_
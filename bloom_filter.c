@@ -0,0 +1,179 @@
+//
+// A blocked Bloom filter, used by the hashmap to answer most misses without
+// scanning a bucket.
+//
+#include <math.h>
+#include "bloom_filter.h"
+
+/**
+ * @def BLOOM_FILTER_BLOCK_BYTES
+ * The size of a block, a cache line.
+ */
+#define BLOOM_FILTER_BLOCK_BYTES (BLOOM_FILTER_BLOCK_WORDS * sizeof(uint64_t))
+
+/**
+ * @def BLOOM_FILTER_LN2
+ * ln(2), the bits per item of the optimal filter are -ln(p) / ln(2)^2.
+ */
+#define BLOOM_FILTER_LN2 0.69314718055994530942
+
+uint64_t mix_hash (uint64_t hash);
+const uint64_t *block_of (const bloom_filter *filter, uint64_t mixed);
+
+/**
+ * Allocates dynamically an empty filter sized for expected_items hashes at the
+ * false positive rate fp_rate, or for fewer bits if they take more than max_bytes.
+ * The number of blocks is rounded up to a power of 2.
+ * @param expected_items the number of hashes the filter is sized for.
+ * @param fp_rate the false positive rate, between 0 and 1 (exclusive).
+ * @param max_bytes the maximal size of the blocks, 0 for no limit.
+ * @return pointer to dynamically allocated filter.
+ * @if_fail return NULL.
+ */
+bloom_filter *bloom_filter_alloc (size_t expected_items, double fp_rate, size_t max_bytes)
+{
+    if (!((fp_rate > 0) && (fp_rate < 1))) {return NULL;}
+    if (expected_items == 0) {expected_items = 1;}
+    double bits_per_item = -log (fp_rate) / (BLOOM_FILTER_LN2 * BLOOM_FILTER_LN2);
+    double hashes = bits_per_item * BLOOM_FILTER_LN2 + 0.5;
+    if (hashes < 1) {hashes = 1;}
+    if (hashes > BLOOM_FILTER_MAX_HASHES) {hashes = BLOOM_FILTER_MAX_HASHES;}
+    double bits = bits_per_item * (double) expected_items;
+    size_t block_count = 1;
+    while ((double) block_count * (double) (BLOOM_FILTER_BLOCK_BYTES * 8) < bits)
+    {
+        block_count *= 2;
+    }
+    while ((max_bytes != 0) && (block_count > 1) &&
+           (block_count * BLOOM_FILTER_BLOCK_BYTES > max_bytes))
+    {
+        block_count /= 2;
+    }
+
+    bloom_filter *filter = (bloom_filter *) malloc (sizeof(bloom_filter));
+    if (filter == NULL) {return NULL;}
+    // one extra block leaves room to align the blocks to a cache line
+    filter->storage = calloc (block_count + 1, BLOOM_FILTER_BLOCK_BYTES);
+    if (filter->storage == NULL)
+    {
+        free (filter);
+        return NULL;
+    }
+    uintptr_t address = (uintptr_t) filter->storage;
+    address = (address + BLOOM_FILTER_BLOCK_BYTES - 1) &
+              ~(uintptr_t) (BLOOM_FILTER_BLOCK_BYTES - 1);
+    filter->blocks = (uint64_t *) address;
+    filter->block_count = block_count;
+    filter->hashes = (unsigned) hashes;
+    filter->items = 0;
+    filter->fp_rate = fp_rate;
+    filter->max_bytes = max_bytes;
+    return filter;
+}
+
+/**
+ * Frees a filter.
+ * @param p_filter pointer to dynamically allocated pointer to filter.
+ */
+void bloom_filter_free (bloom_filter **p_filter)
+{
+    if ((p_filter != NULL) && (*p_filter != NULL))
+    {
+        free ((*p_filter)->storage);
+        free (*p_filter);
+        *p_filter = NULL;
+    }
+}
+
+/**
+ * Adds a hash to the filter: the mixed hash picks a block, and a second mix of
+ * it picks the bits by double hashing, all of them within the block.
+ * @param filter a filter.
+ * @param hash the hash, it need not be well mixed.
+ */
+void bloom_filter_add (bloom_filter *filter, size_t hash)
+{
+    if (filter == NULL) {return;}
+    uint64_t mixed = mix_hash ((uint64_t) hash);
+    uint64_t *block = (uint64_t *) block_of (filter, mixed);
+    uint64_t bits = mix_hash (mixed);
+    uint32_t position = (uint32_t) bits;
+    uint32_t step = (uint32_t) (bits >> 32) | 1;
+    for (unsigned i = 0; i < filter->hashes; ++i)
+    {
+        // the top 9 bits of the position address the 512 bits of the block
+        uint32_t bit = position >> 23;
+        block[bit >> 6] |= 1ULL << (bit & 63);
+        position += step;
+    }
+    ++(filter->items);
+}
+
+/**
+ * Checks whether a hash may have been added to the filter.
+ * @param filter a filter.
+ * @param hash the hash.
+ * @return 0 if the hash was surely not added, 1 otherwise.
+ */
+int bloom_filter_may_contain (const bloom_filter *filter, size_t hash)
+{
+    if (filter == NULL) {return 1;}
+    uint64_t mixed = mix_hash ((uint64_t) hash);
+    const uint64_t *block = block_of (filter, mixed);
+    uint64_t bits = mix_hash (mixed);
+    uint32_t position = (uint32_t) bits;
+    uint32_t step = (uint32_t) (bits >> 32) | 1;
+    // the bits are gathered per word first, so the check has no data dependent branch
+    uint64_t masks[BLOOM_FILTER_BLOCK_WORDS] = {0};
+    for (unsigned i = 0; i < filter->hashes; ++i)
+    {
+        uint32_t bit = position >> 23;
+        masks[bit >> 6] |= 1ULL << (bit & 63);
+        position += step;
+    }
+    uint64_t missing = 0;
+    for (size_t i = 0; i < BLOOM_FILTER_BLOCK_WORDS; ++i)
+    {
+        missing |= masks[i] & ~block[i];
+    }
+    return missing == 0;
+}
+
+/**
+ * Returns the number of bytes of the blocks of the filter.
+ * @param filter a filter.
+ * @return the size of the blocks, 0 if filter is NULL.
+ */
+size_t bloom_filter_bytes (const bloom_filter *filter)
+{
+    if (filter == NULL) {return 0;}
+    return filter->block_count * BLOOM_FILTER_BLOCK_BYTES;
+}
+
+/**
+ * Mixes the bits of a hash (the finalizer of MurmurHash3), so weak hashes such
+ * as small integers spread over all the blocks and bits.
+ * @param hash a hash.
+ * @return the mixed hash.
+ */
+uint64_t mix_hash (uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * Returns the block of a mixed hash.
+ * @param filter a filter.
+ * @param mixed a mixed hash.
+ * @return the first word of the block.
+ */
+const uint64_t *block_of (const bloom_filter *filter, uint64_t mixed)
+{
+    size_t index = (size_t) (mixed >> 32) & (filter->block_count - 1);
+    return filter->blocks + index * BLOOM_FILTER_BLOCK_WORDS;
+}
@@ -0,0 +1,82 @@
+#ifndef BLOOM_FILTER_H_
+#define BLOOM_FILTER_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/**
+ * @def BLOOM_FILTER_BLOCK_WORDS
+ * The number of 64 bit words of a block: a block is one 64 byte cache line,
+ * and all the bits of a key are set in a single block.
+ */
+#define BLOOM_FILTER_BLOCK_WORDS 8UL
+
+/**
+ * @def BLOOM_FILTER_MAX_HASHES
+ * The maximal number of bits set per key.
+ */
+#define BLOOM_FILTER_MAX_HASHES 16U
+
+/**
+ * @struct bloom_filter - a blocked Bloom filter over hashes: it tells that a hash
+ * was never added, or that it may have been. Every query reads one cache line.
+ * @param blocks the cache line aligned blocks of the filter.
+ * @param storage the allocation blocks lie in.
+ * @param block_count the number of blocks (a power of 2).
+ * @param hashes the number of bits set per added hash.
+ * @param items the number of hashes added.
+ * @param fp_rate the false positive rate the filter was sized for.
+ * @param max_bytes the limit of the size of the blocks it was sized with, 0 for none.
+ */
+typedef struct bloom_filter {
+    uint64_t *blocks;
+    void *storage;
+    size_t block_count;
+    unsigned hashes;
+    size_t items;
+    double fp_rate;
+    size_t max_bytes;
+} bloom_filter;
+
+/**
+ * Allocates dynamically an empty filter sized for expected_items hashes at the
+ * false positive rate fp_rate, or for fewer bits if they take more than max_bytes
+ * (the false positive rate then grows).
+ * @param expected_items the number of hashes the filter is sized for.
+ * @param fp_rate the false positive rate, between 0 and 1 (exclusive).
+ * @param max_bytes the maximal size of the blocks, 0 for no limit (at least one
+ * block is allocated).
+ * @return pointer to dynamically allocated filter.
+ * @if_fail return NULL.
+ */
+bloom_filter *bloom_filter_alloc (size_t expected_items, double fp_rate, size_t max_bytes);
+
+/**
+ * Frees a filter.
+ * @param p_filter pointer to dynamically allocated pointer to filter.
+ */
+void bloom_filter_free (bloom_filter **p_filter);
+
+/**
+ * Adds a hash to the filter.
+ * @param filter a filter.
+ * @param hash the hash, it need not be well mixed.
+ */
+void bloom_filter_add (bloom_filter *filter, size_t hash);
+
+/**
+ * Checks whether a hash may have been added to the filter.
+ * @param filter a filter.
+ * @param hash the hash.
+ * @return 0 if the hash was surely not added, 1 otherwise.
+ */
+int bloom_filter_may_contain (const bloom_filter *filter, size_t hash);
+
+/**
+ * Returns the number of bytes of the blocks of the filter.
+ * @param filter a filter.
+ * @return the size of the blocks, 0 if filter is NULL.
+ */
+size_t bloom_filter_bytes (const bloom_filter *filter);
+
+#endif //BLOOM_FILTER_H_
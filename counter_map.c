@@ -0,0 +1,359 @@
+//
+// A hash map from keys to integer counts, kept inline in the stored pairs.
+//
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include "counter_map.h"
+
+/**
+ * @def COUNTER_MAP_PREFETCH
+ * Hints the processor to fetch the cache line of an address, ahead of its use.
+ */
+#if defined(__GNUC__)
+#define COUNTER_MAP_PREFETCH(address) __builtin_prefetch (address)
+#else
+#define COUNTER_MAP_PREFETCH(address) ((void) (address))
+#endif
+
+/**
+ * @struct merge_range - the share of a thread in counter_map_merge_parallel.
+ * @param dst the counter map to be added to.
+ * @param srcs, count - the counter maps to add.
+ * @param unit the smallest capacity of the maps: a key lands in the buckets
+ * (hash % unit) + k * unit of every map, for some k.
+ * @param first, last - the range [first, last) of hash % unit merged by the thread.
+ * @param inserted the number of keys the thread inserted to dst.
+ * @param success 1 if the thread merged its range, 0 otherwise.
+ * @param started 1 if the range was given to a new thread.
+ */
+typedef struct merge_range {
+    counter_map *dst;
+    counter_map *const *srcs;
+    size_t count;
+    size_t unit;
+    size_t first;
+    size_t last;
+    size_t inserted;
+    int success;
+    int started;
+} merge_range;
+
+valueT count_cpy (const_valueT count);
+int count_cmp (const_valueT count1, const_valueT count2);
+void count_free (valueT *count);
+void add_count (valueT *slot, intptr_t delta);
+void *merge_buckets (void *arg);
+int merge_pair (hashmap *dst, const pair *p, size_t *inserted);
+// the lookups of hashmap.c which return the stored pair
+pair *find_or_insert_pair (hashmap *hash_map, const pair *in_pair, int *inserted);
+pair *find_or_insert_hashed (hashmap *hash_map, const pair *in_pair, size_t hashed_key,
+                             int *inserted);
+
+/**
+ * Allocates dynamically a new counter map.
+ * @param func a function which "hashes" keys.
+ * @param key_cpy, key_cmp, key_free - the functions of the keys.
+ * @return pointer to dynamically allocated counter map.
+ * @if_fail return NULL.
+ */
+counter_map *counter_map_alloc (hash_func func, pair_key_cpy key_cpy, pair_key_cmp key_cmp,
+                                pair_key_free key_free)
+{
+    if ((func == NULL) || (key_cpy == NULL) || (key_cmp == NULL) || (key_free == NULL))
+    {
+        return NULL;
+    }
+    counter_map *counters = (counter_map *) malloc (sizeof(counter_map));
+    if (counters == NULL) {return NULL;}
+    counters->map = hashmap_alloc (func);
+    if (counters->map == NULL)
+    {
+        free (counters);
+        return NULL;
+    }
+    counters->key_cpy = key_cpy;
+    counters->key_cmp = key_cmp;
+    counters->key_free = key_free;
+    return counters;
+}
+
+/**
+ * Frees a counter map and all its keys.
+ * @param p_counters pointer to dynamically allocated pointer to counter map.
+ */
+void counter_map_free (counter_map **p_counters)
+{
+    if ((p_counters != NULL) && (*p_counters != NULL))
+    {
+        hashmap_free (&((*p_counters)->map));
+        free (*p_counters);
+        *p_counters = NULL;
+    }
+}
+
+/**
+ * Adds delta to the count of the key, a missing key is inserted with count delta.
+ * The key is inserted with the count 0 (a NULL value) and incremented in its slot.
+ * @param counters a counter map.
+ * @param key the key to be counted, copied by key_cpy if it is inserted.
+ * @param delta the value added to the count.
+ * @return 1 on success, 0 otherwise.
+ */
+int counter_map_increment (counter_map *counters, const_keyT key, intptr_t delta)
+{
+    if ((counters == NULL) || (key == NULL)) {return 0;}
+    pair in_pair = {(keyT) key, NULL, counters->key_cpy, count_cpy, counters->key_cmp,
+                    count_cmp, counters->key_free, count_free, NULL, NULL};
+    pair *stored = find_or_insert_pair (counters->map, &in_pair, NULL);
+    if (stored == NULL) {return 0;}
+    add_count (&(stored->value), delta);
+    return 1;
+}
+
+/**
+ * Adds deltas[i] to the count of keys[i], for every i. Every batch of keys is
+ * hashed first and the buckets are prefetched, then the first pairs of the buckets
+ * are prefetched, so the probes find most of what they touch already in the cache.
+ * @param counters a counter map.
+ * @param keys the keys to be counted.
+ * @param deltas the values added to the counts, NULL to add 1 to each.
+ * @param count the number of keys.
+ * @return 1 on success, 0 otherwise (the keys before the failed one were counted).
+ */
+int counter_map_increment_batch (counter_map *counters, const const_keyT *keys,
+                                 const intptr_t *deltas, size_t count)
+{
+    if ((counters == NULL) || ((keys == NULL) && (count != 0))) {return 0;}
+    hashmap *map = counters->map;
+    size_t hashes[COUNTER_MAP_BATCH];
+    pair in_pair = {NULL, NULL, counters->key_cpy, count_cpy, counters->key_cmp,
+                    count_cmp, counters->key_free, count_free, NULL, NULL};
+    for (size_t first = 0; first < count; first += COUNTER_MAP_BATCH)
+    {
+        size_t batch = count - first;
+        if (batch > COUNTER_MAP_BATCH) {batch = COUNTER_MAP_BATCH;}
+        for (size_t i = 0; i < batch; ++i)
+        {
+            if (keys[first + i] == NULL) {return 0;}
+            hashes[i] = map->hash_func (keys[first + i]);
+            COUNTER_MAP_PREFETCH (&(map->buckets[hashes[i] & (map->capacity - 1)]));
+        }
+        for (size_t i = 0; i < batch; ++i)
+        {
+            const vector *bucket = &(map->buckets[hashes[i] & (map->capacity - 1)]);
+            if (bucket->size != 0) {COUNTER_MAP_PREFETCH (bucket->data[0]);}
+        }
+        for (size_t i = 0; i < batch; ++i)
+        {
+            // an insertion may resize the map, the hashes stay valid
+            in_pair.key = (keyT) keys[first + i];
+            pair *stored = find_or_insert_hashed (map, &in_pair, hashes[i], NULL);
+            if (stored == NULL) {return 0;}
+            add_count (&(stored->value), (deltas == NULL) ? 1 : deltas[first + i]);
+        }
+    }
+    return 1;
+}
+
+/**
+ * Returns the count of the key.
+ * @param counters a counter map.
+ * @param key the key to be checked.
+ * @return the count of the key, 0 if it is not in the counter map.
+ */
+intptr_t counter_map_get (const counter_map *counters, const_keyT key)
+{
+    if ((counters == NULL) || (key == NULL)) {return 0;}
+    // a missing key and a count of 0 are both a NULL value
+    return (intptr_t) hashmap_at (counters->map, key);
+}
+
+/**
+ * Calls func with every key of the counter map and its count.
+ * @param counters a counter map.
+ * @param func the function.
+ * @param ctx the context passed to func.
+ */
+void counter_map_for_each (const counter_map *counters, counter_func func, void *ctx)
+{
+    if ((counters == NULL) || (func == NULL)) {return;}
+    size_t bucket = 0, index = 0;
+    const pair *p = NULL;
+    while ((p = hashmap_next (counters->map, &bucket, &index)) != NULL)
+    {
+        func (p->key, (intptr_t) p->value, ctx);
+    }
+}
+
+/**
+ * Adds the counts of srcs to dst, the srcs are not changed. dst is reserved up front
+ * for all the keys of the srcs, so no insertion resizes it, and its buckets shared with
+ * snapshots are copied (running background resizes of all the maps are waited for).
+ * The threads write disjoint buckets: a thread merges the keys whose hash modulo the smallest capacity
+ * falls in its range, and those keys are only in the matching buckets of every map.
+ * @param dst the counter map to be added to.
+ * @param srcs the counter maps to add, e.g. thread local counts of a batch.
+ * @param count the number of srcs.
+ * @param threads the number of threads to merge with, 1 merges on the calling thread.
+ * @return 1 on success, 0 otherwise (dst is valid, with part of the counts added).
+ */
+int counter_map_merge_parallel (counter_map *dst, counter_map *const *srcs, size_t count,
+                                size_t threads)
+{
+    if ((dst == NULL) || ((srcs == NULL) && (count != 0)) || (threads == 0)) {return 0;}
+    size_t total = dst->map->size;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if ((srcs[i] == NULL) || (srcs[i] == dst)) {return 0;}
+        total += srcs[i]->map->size;
+    }
+    // the threads write the buckets of dst directly, and read those of the srcs
+    if ((hashmap_reserve (dst->map, total) == 0) || (hashmap_unshare (dst->map) == 0))
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        hashmap_resize_wait (srcs[i]->map);
+    }
+    size_t unit = dst->map->capacity;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (srcs[i]->map->capacity < unit) {unit = srcs[i]->map->capacity;}
+    }
+    if (threads > unit) {threads = unit;}
+    merge_range *ranges = (merge_range *) malloc (threads * sizeof(merge_range));
+    pthread_t *ids = (pthread_t *) malloc (threads * sizeof(pthread_t));
+    if ((ranges == NULL) || (ids == NULL))
+    {
+        free (ranges);
+        free (ids);
+        return 0;
+    }
+    for (size_t t = 0; t < threads; ++t)
+    {
+        ranges[t] = (merge_range) {dst, srcs, count, unit, unit * t / threads,
+                                   unit * (t + 1) / threads, 0, 1, 0};
+    }
+    // the calling thread merges the first range, a thread which failed to start is
+    // merged by it as well
+    for (size_t t = 1; t < threads; ++t)
+    {
+        ranges[t].started = (pthread_create (&(ids[t]), NULL, merge_buckets,
+                                             &(ranges[t])) == 0);
+    }
+    merge_buckets (&(ranges[0]));
+    int success = 1;
+    for (size_t t = 0; t < threads; ++t)
+    {
+        if (ranges[t].started == 1) {pthread_join (ids[t], NULL);}
+        else if (t != 0) {merge_buckets (&(ranges[t]));}
+        dst->map->size += ranges[t].inserted;
+        success = success && ranges[t].success;
+    }
+    free (ranges);
+    free (ids);
+    // the threads inserted around the filter, which cannot take concurrent writes
+    return hashmap_filter_rebuild (dst->map) && success;
+}
+
+/**
+ * The value_cpy of the stored pairs: the count is the value itself.
+ * @param count a count cast to valueT.
+ * @return the same count.
+ */
+valueT count_cpy (const_valueT count)
+{
+    return (valueT) count;
+}
+
+/**
+ * The value_cmp of the stored pairs.
+ * @param count1, count2 - counts cast to valueT.
+ * @return 1 if the counts are equal, 0 otherwise.
+ */
+int count_cmp (const_valueT count1, const_valueT count2)
+{
+    return count1 == count2;
+}
+
+/**
+ * The value_free of the stored pairs: a count owns nothing.
+ * @param count pointer to a count.
+ */
+void count_free (valueT *count)
+{
+    (void) count;
+}
+
+/**
+ * Adds delta to the count in a value slot, wrapping around on overflow.
+ * @param slot the value slot of a stored pair.
+ * @param delta the value added to the count.
+ */
+void add_count (valueT *slot, intptr_t delta)
+{
+    *slot = (valueT) ((uintptr_t) *slot + (uintptr_t) delta);
+}
+
+/**
+ * Merges a range of counter_map_merge_parallel, the start routine of its threads.
+ * @param arg a merge_range.
+ * @return NULL.
+ */
+void *merge_buckets (void *arg)
+{
+    merge_range *range = (merge_range *) arg;
+    hashmap *dst = range->dst->map;
+    for (size_t s = 0; s < range->count; ++s)
+    {
+        const hashmap *src = range->srcs[s]->map;
+        for (size_t base = 0; base < src->capacity; base += range->unit)
+        {
+            for (size_t i = base + range->first; i < base + range->last; ++i)
+            {
+                const vector *bucket = &(src->buckets[i]);
+                for (size_t j = 0; j < bucket->size; ++j)
+                {
+                    if (merge_pair (dst, bucket->data[j], &(range->inserted)) == 0)
+                    {
+                        range->success = 0;
+                        return NULL;
+                    }
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Adds the count of a pair to dst, without resizing dst or changing its size
+ * and counters (several threads merge into dst at once, in disjoint buckets).
+ * @param dst the hash map of the counter map to be added to.
+ * @param p a pair of a source counter map.
+ * @param inserted incremented if the key of p was inserted to dst.
+ * @return 1 on success, 0 otherwise.
+ */
+int merge_pair (hashmap *dst, const pair *p, size_t *inserted)
+{
+    vector *bucket = &(dst->buckets[dst->hash_func (p->key) & (dst->capacity - 1)]);
+    for (size_t i = 0; i < bucket->size; ++i)
+    {
+        pair *stored = bucket->data[i];
+        if (stored->key_cmp (stored->key, p->key) == 1)
+        {
+            add_count (&(stored->value), (intptr_t) p->value);
+            return 1;
+        }
+    }
+    pair *new_pair = pair_copy_ex (p, dst->allocator);
+    if (new_pair == NULL) {return 0;}
+    if (vector_emplace_back (bucket, new_pair) == 0)
+    {
+        pair_free ((void **) &new_pair);
+        return 0;
+    }
+    ++(*inserted);
+    return 1;
+}
@@ -0,0 +1,105 @@
+#ifndef COUNTER_MAP_H_
+#define COUNTER_MAP_H_
+
+#include <stdint.h>
+#include "hashmap.h"
+
+/**
+ * @def COUNTER_MAP_BATCH
+ * The number of keys counter_map_increment_batch hashes (and prefetches the
+ * buckets of) ahead of probing them.
+ */
+#define COUNTER_MAP_BATCH 16UL
+
+/**
+ * @typedef counter_func
+ * Function which is called with every key of a counter map, its count and the
+ * context given to counter_map_for_each.
+ */
+typedef void (*counter_func) (const_keyT, intptr_t, void *);
+
+/**
+ * @struct counter_map - a hash map from keys to integer counts. The count is kept
+ * inline in the value of the stored pair, so a new key costs only the pair and the
+ * copy of its key, and an increment is a single probe of the hash map.
+ * @param map the hash map, its values are counts cast to valueT.
+ * @param key_cpy, key_cmp, key_free - the functions of the keys.
+ */
+typedef struct counter_map {
+    hashmap *map;
+    pair_key_cpy key_cpy;
+    pair_key_cmp key_cmp;
+    pair_key_free key_free;
+} counter_map;
+
+/**
+ * Allocates dynamically a new counter map.
+ * @param func a function which "hashes" keys.
+ * @param key_cpy, key_cmp, key_free - the functions of the keys.
+ * @return pointer to dynamically allocated counter map.
+ * @if_fail return NULL.
+ */
+counter_map *counter_map_alloc (hash_func func, pair_key_cpy key_cpy, pair_key_cmp key_cmp,
+                                pair_key_free key_free);
+
+/**
+ * Frees a counter map and all its keys.
+ * @param p_counters pointer to dynamically allocated pointer to counter map.
+ */
+void counter_map_free (counter_map **p_counters);
+
+/**
+ * Adds delta to the count of the key, a missing key is inserted with count delta.
+ * @param counters a counter map.
+ * @param key the key to be counted, copied by key_cpy if it is inserted.
+ * @param delta the value added to the count.
+ * @return 1 on success, 0 otherwise.
+ */
+int counter_map_increment (counter_map *counters, const_keyT key, intptr_t delta);
+
+/**
+ * Adds deltas[i] to the count of keys[i], for every i. The keys are hashed a batch
+ * ahead of their probes, and the buckets of the batch are prefetched meanwhile.
+ * @param counters a counter map.
+ * @param keys the keys to be counted.
+ * @param deltas the values added to the counts, NULL to add 1 to each.
+ * @param count the number of keys.
+ * @return 1 on success, 0 otherwise (the keys before the failed one were counted).
+ */
+int counter_map_increment_batch (counter_map *counters, const const_keyT *keys,
+                                 const intptr_t *deltas, size_t count);
+
+/**
+ * Returns the count of the key.
+ * @param counters a counter map.
+ * @param key the key to be checked.
+ * @return the count of the key, 0 if it is not in the counter map.
+ */
+intptr_t counter_map_get (const counter_map *counters, const_keyT key);
+
+/**
+ * Calls func with every key of the counter map and its count (see hashmap_next),
+ * func must not change the counter map.
+ * @param counters a counter map.
+ * @param func the function.
+ * @param ctx the context passed to func.
+ */
+void counter_map_for_each (const counter_map *counters, counter_func func, void *ctx);
+
+/**
+ * Adds the counts of srcs to dst, the srcs are not changed. dst is reserved up front
+ * for all the keys of the srcs, then every thread merges a disjoint range of the
+ * buckets of dst: the keys whose hash falls in the range, from the matching buckets
+ * of every src. The counter maps must share the hash function and the key functions.
+ * A filter of dst (see hashmap_filter_enable) is rebuilt afterwards, and the snapshots
+ * of dst (see hashmap_snapshot) keep their counts.
+ * @param dst the counter map to be added to.
+ * @param srcs the counter maps to add, e.g. thread local counts of a batch.
+ * @param count the number of srcs.
+ * @param threads the number of threads to merge with, 1 merges on the calling thread.
+ * @return 1 on success, 0 otherwise (dst is valid, with part of the counts added).
+ */
+int counter_map_merge_parallel (counter_map *dst, counter_map *const *srcs, size_t count,
+                                size_t threads);
+
+#endif //COUNTER_MAP_H_
@@ -0,0 +1,956 @@
+//
+// A durable hash map: an append-only log of its inserts and erases, replayed on open.
+//
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "durable_hashmap.h"
+
+/**
+ * @def DURABLE_MAGIC
+ * The first 8 bytes of a log.
+ */
+#define DURABLE_MAGIC "HMAPWAL1"
+
+/**
+ * @def DURABLE_COMPACT_SUFFIX
+ * Appended to the path of the log to name the log written by a compaction.
+ */
+#define DURABLE_COMPACT_SUFFIX ".compact"
+
+/**
+ * @def DURABLE_PUT, DURABLE_ERASE
+ * The types of the records. A record is its type (1 byte), the size of the key
+ * encoding, the size of the value encoding (DURABLE_PUT only, both as varints:
+ * 7 bits per byte, least significant first), the key and value encodings, and a
+ * FNV-1a checksum of all of the above (32 bits, little endian).
+ */
+#define DURABLE_PUT 1
+#define DURABLE_ERASE 2
+
+/**
+ * @def DURABLE_VARINT_MAX
+ * The largest size of a varint of a size_t.
+ */
+#define DURABLE_VARINT_MAX 10UL
+
+/**
+ * @def DURABLE_CHECKSUM_SIZE
+ * The size of the checksum ending a record.
+ */
+#define DURABLE_CHECKSUM_SIZE 4UL
+
+/**
+ * @def DURABLE_MIN_RECORD_SIZE
+ * The smallest size of a DURABLE_PUT record: its type, two 1 byte varints and the
+ * checksum, with empty encodings.
+ */
+#define DURABLE_MIN_RECORD_SIZE (3UL + DURABLE_CHECKSUM_SIZE)
+
+size_t varint_put (unsigned char *buffer, size_t value);
+int varint_get (const unsigned char *data, size_t size, size_t *value, size_t *used);
+uint32_t durable_checksum (const unsigned char *data, size_t size);
+void put_u32 (unsigned char *buffer, uint32_t value);
+uint32_t get_u32 (const unsigned char *data);
+void put_u64 (unsigned char *buffer, uint64_t value);
+uint64_t get_u64 (const unsigned char *data);
+int grow_bytes (unsigned char **bytes, size_t *capacity, size_t size);
+size_t encode_record (const durable_codec *codec, unsigned char type, const_keyT key,
+                      const_valueT value, unsigned char **buffer, size_t *capacity,
+                      size_t offset, size_t *payload);
+size_t write_all (int fd, const unsigned char *data, size_t size);
+int read_all (int fd, unsigned char *data, size_t size);
+int write_header (int fd, size_t keys);
+int sync_directory (const char *path);
+int replay_record (durable_hashmap *durable, const unsigned char *data, size_t size,
+                   size_t remaining, size_t *used);
+int durable_replay (durable_hashmap *durable);
+int durable_write (durable_hashmap *durable);
+int durable_flush (durable_hashmap *durable);
+int durable_fsync (durable_hashmap *durable);
+int durable_commit (durable_hashmap *durable, size_t size, size_t payload);
+void durable_discard (durable_hashmap *durable, size_t size, int in_tail);
+void durable_maintain (durable_hashmap *durable);
+void *compact_worker (void *arg);
+int finish_compaction (durable_hashmap *durable, int install);
+void durable_release (durable_hashmap *durable);
+
+/**
+ * Writes value as a varint.
+ * @param buffer at least DURABLE_VARINT_MAX bytes.
+ * @return the number of bytes written.
+ */
+size_t varint_put (unsigned char *buffer, size_t value)
+{
+    size_t size = 0;
+    while (value >= 0x80)
+    {
+        buffer[size++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    buffer[size++] = (unsigned char) value;
+    return size;
+}
+
+/**
+ * Reads a varint.
+ * @param data, size - the bytes to read from.
+ * @param value set to the value read.
+ * @param used set to the number of bytes read.
+ * @return 1 on success, 0 if the varint does not end within size bytes, -1 if it is
+ * too long for a size_t.
+ */
+int varint_get (const unsigned char *data, size_t size, size_t *value, size_t *used)
+{
+    size_t result = 0;
+    for (size_t i = 0; i < DURABLE_VARINT_MAX; ++i)
+    {
+        if (i == size) {return 0;}
+        size_t bits = data[i] & 0x7f;
+        if ((i * 7 >= sizeof(size_t) * 8) || ((bits << (i * 7)) >> (i * 7) != bits))
+        {
+            return -1;
+        }
+        result |= bits << (i * 7);
+        if ((data[i] & 0x80) == 0)
+        {
+            *value = result;
+            *used = i + 1;
+            return 1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @return the 32 bits FNV-1a hash of the bytes.
+ */
+uint32_t durable_checksum (const unsigned char *data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Writes value in 4 bytes, little endian.
+ */
+void put_u32 (unsigned char *buffer, uint32_t value)
+{
+    for (size_t i = 0; i < 4; ++i) {buffer[i] = (unsigned char) (value >> (8 * i));}
+}
+
+/**
+ * @return the value of 4 bytes, little endian.
+ */
+uint32_t get_u32 (const unsigned char *data)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; ++i) {value |= (uint32_t) data[i] << (8 * i);}
+    return value;
+}
+
+/**
+ * Writes value in 8 bytes, little endian.
+ */
+void put_u64 (unsigned char *buffer, uint64_t value)
+{
+    for (size_t i = 0; i < 8; ++i) {buffer[i] = (unsigned char) (value >> (8 * i));}
+}
+
+/**
+ * @return the value of 8 bytes, little endian.
+ */
+uint64_t get_u64 (const unsigned char *data)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; ++i) {value |= (uint64_t) data[i] << (8 * i);}
+    return value;
+}
+
+/**
+ * Grows a byte array to at least size bytes, doubling its capacity.
+ * @return 1 on success, 0 otherwise (the array is left unchanged).
+ */
+int grow_bytes (unsigned char **bytes, size_t *capacity, size_t size)
+{
+    if (size <= *capacity) {return 1;}
+    size_t new_capacity = (*capacity == 0) ? 256 : *capacity;
+    while (new_capacity < size)
+    {
+        if (new_capacity > (size_t) -1 / 2) {new_capacity = size; break;}
+        new_capacity *= 2;
+    }
+    unsigned char *new_bytes = (unsigned char *) realloc (*bytes, new_capacity);
+    if (new_bytes == NULL) {return 0;}
+    *bytes = new_bytes;
+    *capacity = new_capacity;
+    return 1;
+}
+
+/**
+ * Encodes a record at the given offset of a buffer, which grows as needed.
+ * @param type DURABLE_PUT or DURABLE_ERASE (value is ignored).
+ * @param payload set to the size of the key and value encodings.
+ * @return the size of the record, 0 on failure.
+ */
+size_t encode_record (const durable_codec *codec, unsigned char type, const_keyT key,
+                      const_valueT value, unsigned char **buffer, size_t *capacity,
+                      size_t offset, size_t *payload)
+{
+    size_t key_size = codec->encode_key (key, NULL, 0);
+    size_t value_size = (type == DURABLE_PUT) ? codec->encode_value (value, NULL, 0) : 0;
+    size_t bound = 1 + 2 * DURABLE_VARINT_MAX + DURABLE_CHECKSUM_SIZE;
+    if ((key_size > (size_t) -1 - bound - offset)
+        || (value_size > (size_t) -1 - bound - offset - key_size))
+    {
+        return 0;
+    }
+    if (grow_bytes (buffer, capacity, offset + bound + key_size + value_size) == 0) {return 0;}
+    unsigned char *record = *buffer + offset;
+    size_t size = 0;
+    record[size++] = type;
+    size += varint_put (record + size, key_size);
+    if (type == DURABLE_PUT) {size += varint_put (record + size, value_size);}
+    if (codec->encode_key (key, record + size, key_size) != key_size) {return 0;}
+    size += key_size;
+    if (type == DURABLE_PUT)
+    {
+        if (codec->encode_value (value, record + size, value_size) != value_size) {return 0;}
+        size += value_size;
+    }
+    put_u32 (record + size, durable_checksum (record, size));
+    *payload = key_size + value_size;
+    return size + DURABLE_CHECKSUM_SIZE;
+}
+
+/**
+ * Writes size bytes to fd, retrying on interrupts and partial writes.
+ * @return the number of bytes written, less than size on failure.
+ */
+size_t write_all (int fd, const unsigned char *data, size_t size)
+{
+    size_t written = 0;
+    while (written < size)
+    {
+        ssize_t n = write (fd, data + written, size - written);
+        if (n < 0)
+        {
+            if (errno == EINTR) {continue;}
+            break;
+        }
+        written += (size_t) n;
+    }
+    return written;
+}
+
+/**
+ * Reads exactly size bytes from fd.
+ * @return 1 on success, 0 otherwise.
+ */
+int read_all (int fd, unsigned char *data, size_t size)
+{
+    size_t done = 0;
+    while (done < size)
+    {
+        ssize_t n = read (fd, data + done, size - done);
+        if ((n < 0) && (errno == EINTR)) {continue;}
+        if (n <= 0) {return 0;}
+        done += (size_t) n;
+    }
+    return 1;
+}
+
+/**
+ * Writes the header of a log at offset 0.
+ * @param keys the number of keys of the log.
+ * @return 1 on success, 0 otherwise.
+ */
+int write_header (int fd, size_t keys)
+{
+    unsigned char header[DURABLE_HEADER_SIZE];
+    memcpy (header, DURABLE_MAGIC, 8);
+    put_u64 (header + 8, keys);
+    size_t written = 0;
+    while (written < DURABLE_HEADER_SIZE)
+    {
+        ssize_t n = pwrite (fd, header + written, DURABLE_HEADER_SIZE - written,
+                            (off_t) written);
+        if ((n < 0) && (errno == EINTR)) {continue;}
+        if (n <= 0) {return 0;}
+        written += (size_t) n;
+    }
+    return 1;
+}
+
+/**
+ * Fsyncs the directory of a file, so that a rename to it is durable.
+ * @return 1 on success, 0 otherwise.
+ */
+int sync_directory (const char *path)
+{
+    const char *slash = strrchr (path, '/');
+    size_t length = (slash == NULL) ? 1 : (slash == path) ? 1 : (size_t) (slash - path);
+    char *directory = (char *) malloc (length + 1);
+    if (directory == NULL) {return 0;}
+    memcpy (directory, (slash == NULL) ? "." : path, length);
+    directory[length] = '\0';
+    int fd = open (directory, O_RDONLY);
+    free (directory);
+    if (fd < 0) {return 0;}
+    int success = (fsync (fd) == 0);
+    close (fd);
+    return success;
+}
+
+/**
+ * Replays the record at the start of data.
+ * @param data, size - the bytes of the log read so far from the record on.
+ * @param remaining the number of bytes of the log from the record on.
+ * @param used set to the size of the record.
+ * @return 1 if the record was replayed, 0 if more than size bytes are needed, -1 if
+ * the record is torn or corrupted, -2 if it could not be applied to the map.
+ */
+int replay_record (durable_hashmap *durable, const unsigned char *data, size_t size,
+                   size_t remaining, size_t *used)
+{
+    if (size == 0) {return (size < remaining) ? 0 : -1;}
+    unsigned char type = data[0];
+    if ((type != DURABLE_PUT) && (type != DURABLE_ERASE)) {return -1;}
+    size_t key_size = 0, value_size = 0, n = 0, header = 1;
+    int status = varint_get (data + header, size - header, &key_size, &n);
+    if (status <= 0) {return ((status == 0) && (size < remaining)) ? 0 : -1;}
+    header += n;
+    if (type == DURABLE_PUT)
+    {
+        status = varint_get (data + header, size - header, &value_size, &n);
+        if (status <= 0) {return ((status == 0) && (size < remaining)) ? 0 : -1;}
+        header += n;
+    }
+    if ((key_size > remaining) || (value_size > remaining)
+        || (header + key_size + value_size + DURABLE_CHECKSUM_SIZE > remaining))
+    {
+        return -1;
+    }
+    size_t total = header + key_size + value_size + DURABLE_CHECKSUM_SIZE;
+    if (total > size) {return 0;}
+    size_t body = total - DURABLE_CHECKSUM_SIZE;
+    if (durable_checksum (data, body) != get_u32 (data + body)) {return -1;}
+
+    const durable_codec *codec = &(durable->codec);
+    keyT key = codec->decode_key (data + header, key_size);
+    if (key == NULL) {return -1;}
+    if (type == DURABLE_ERASE)
+    {
+        hashmap_erase (durable->map, key);
+        codec->key_free (&key);
+        *used = total;
+        return 1;
+    }
+    valueT value = codec->decode_value (data + header + key_size, value_size);
+    if (value == NULL)
+    {
+        codec->key_free (&key);
+        return -1;
+    }
+    pair record = {key, value, codec->key_cpy, codec->value_cpy, codec->key_cmp,
+                   codec->value_cmp, codec->key_free, codec->value_free, NULL, NULL};
+    int success = hashmap_upsert (durable->map, &record);
+    codec->key_free (&key);
+    codec->value_free (&value);
+    if (success == 0) {return -2;}
+    *used = total;
+    return 1;
+}
+
+/**
+ * Replays the log of a durable map into its map, in chunks of DURABLE_REPLAY_CHUNK
+ * bytes, and truncates the log after its last valid record. An empty log gets a header.
+ * @return 1 on success, 0 otherwise.
+ */
+int durable_replay (durable_hashmap *durable)
+{
+    struct stat st;
+    if (fstat (durable->fd, &st) != 0) {return 0;}
+    size_t file_size = (size_t) st.st_size;
+    if (file_size < DURABLE_HEADER_SIZE)
+    {
+        // a new log, or one torn while it was created
+        return (ftruncate (durable->fd, 0) == 0) && write_header (durable->fd, 0)
+               && (fsync (durable->fd) == 0)
+               && (lseek (durable->fd, DURABLE_HEADER_SIZE, SEEK_SET) >= 0);
+    }
+    unsigned char header[DURABLE_HEADER_SIZE];
+    if ((read_all (durable->fd, header, DURABLE_HEADER_SIZE) == 0)
+        || (memcmp (header, DURABLE_MAGIC, 8) != 0))
+    {
+        return 0;
+    }
+    // the number of keys is not checksummed, the log cannot hold more records
+    uint64_t keys = get_u64 (header + 8);
+    uint64_t max_keys = (file_size - DURABLE_HEADER_SIZE) / DURABLE_MIN_RECORD_SIZE;
+    hashmap_reserve (durable->map, (size_t) ((keys < max_keys) ? keys : max_keys));
+
+    size_t capacity = DURABLE_REPLAY_CHUNK;
+    unsigned char *chunk = (unsigned char *) malloc (capacity);
+    if (chunk == NULL) {return 0;}
+    size_t offset = DURABLE_HEADER_SIZE, held = 0, replayed = 0;
+    int success = 1, end = 0;
+    while (!end)
+    {
+        if ((held == capacity) && (grow_bytes (&chunk, &capacity, capacity + 1) == 0))
+        {
+            success = 0;
+            break;
+        }
+        ssize_t n = read (durable->fd, chunk + held, capacity - held);
+        if (n < 0)
+        {
+            if (errno == EINTR) {continue;}
+            success = 0;
+            break;
+        }
+        held += (size_t) n;
+        size_t pos = 0;
+        while (1)
+        {
+            size_t used = 0;
+            int status = replay_record (durable, chunk + pos, held - pos,
+                                        file_size - offset - pos, &used);
+            if (status == 1)
+            {
+                pos += used;
+                ++replayed;
+                continue;
+            }
+            if (status == -2) {success = 0;}
+            // a torn or corrupted record, or the end of the log
+            if ((status != 0) || (n == 0)) {end = 1;}
+            break;
+        }
+        memmove (chunk, chunk + pos, held - pos);
+        offset += pos;
+        held -= pos;
+    }
+    free (chunk);
+    if (success == 0) {return 0;}
+    if ((offset < file_size) && (ftruncate (durable->fd, (off_t) offset) != 0)) {return 0;}
+    if (lseek (durable->fd, (off_t) offset, SEEK_SET) < 0) {return 0;}
+    durable->log_records = replayed;
+    durable->counters.replayed = replayed;
+    return 1;
+}
+
+/**
+ * Writes the buffered records of a durable map.
+ * @return 1 on success, 0 otherwise (the records not written are kept buffered).
+ */
+int durable_write (durable_hashmap *durable)
+{
+    if (durable->buffered == 0) {return 1;}
+    size_t written = write_all (durable->fd, durable->buffer, durable->buffered);
+    ++durable->counters.writes;
+    if (written < durable->buffered)
+    {
+        // the log ends with a part of the buffer: keep the rest, to continue it
+        memmove (durable->buffer, durable->buffer + written, durable->buffered - written);
+        durable->buffered -= written;
+        return 0;
+    }
+    durable->buffered = 0;
+    durable->unsynced += durable->buffered_records;
+    durable->buffered_records = 0;
+    return 1;
+}
+
+/**
+ * Writes the buffered records of a durable map, and fsyncs the log every
+ * options.sync_records records.
+ * @return 1 on success, 0 otherwise (the records not written are kept buffered).
+ */
+int durable_flush (durable_hashmap *durable)
+{
+    if (durable_write (durable) == 0) {return 0;}
+    if ((durable->options.sync_records != 0)
+        && (durable->unsynced >= durable->options.sync_records))
+    {
+        return durable_fsync (durable);
+    }
+    return 1;
+}
+
+/**
+ * Fsyncs the log of a durable map.
+ * @return 1 on success, 0 otherwise.
+ */
+int durable_fsync (durable_hashmap *durable)
+{
+    ++durable->counters.syncs;
+    if (fsync (durable->fd) != 0) {return 0;}
+    durable->unsynced = 0;
+    return 1;
+}
+
+/**
+ * Commits the record encoded at the end of the buffer, before its change is applied
+ * to the map: it is buffered (and copied to the tail of a running compaction), and
+ * written if the buffer is full. A record which could not be written is taken back,
+ * so the log never holds a change the map did not get.
+ * @param size the size of the record.
+ * @param payload the size of its key and value encodings.
+ * @return 1 on success, 0 if the record could not be written (it is not logged).
+ */
+int durable_commit (durable_hashmap *durable, size_t size, size_t payload)
+{
+    durable_compaction *compaction = durable->compaction;
+    int in_tail = 0;
+    if (compaction != NULL)
+    {
+        if (grow_bytes (&(compaction->tail), &(compaction->tail_capacity),
+                        compaction->tail_size + size))
+        {
+            memcpy (compaction->tail + compaction->tail_size,
+                    durable->buffer + durable->buffered, size);
+            compaction->tail_size += size;
+            ++compaction->tail_records;
+            in_tail = 1;
+        }
+        else
+        {
+            // the new log would miss the record
+            finish_compaction (durable, 0);
+        }
+    }
+    durable->buffered += size;
+    ++durable->buffered_records;
+    if (durable->buffered >= durable->options.buffer_bytes)
+    {
+        if (durable_write (durable) == 0)
+        {
+            durable_discard (durable, size, in_tail);
+            return 0;
+        }
+        // the record is written: a failed fsync is reported by durable_hashmap_sync
+        if ((durable->options.sync_records != 0)
+            && (durable->unsynced >= durable->options.sync_records))
+        {
+            durable_fsync (durable);
+        }
+    }
+    ++durable->log_records;
+    ++durable->counters.records;
+    durable->counters.log_bytes += size;
+    durable->counters.payload_bytes += payload;
+    return 1;
+}
+
+/**
+ * Takes back the last record committed, which could not be written: from the buffer,
+ * from the end of the log if a part of it was written, and from the tail of the
+ * running compaction.
+ * @param size the size of the record.
+ * @param in_tail 1 if the record was copied to the tail of the compaction.
+ */
+void durable_discard (durable_hashmap *durable, size_t size, int in_tail)
+{
+    if (in_tail && (durable->compaction != NULL))
+    {
+        durable->compaction->tail_size -= size;
+        --durable->compaction->tail_records;
+    }
+    --durable->buffered_records;
+    if (durable->buffered >= size)
+    {
+        durable->buffered -= size;
+        return;
+    }
+    // the log ends with a part of the record
+    off_t end = lseek (durable->fd, 0, SEEK_CUR);
+    off_t start = end - (off_t) (size - durable->buffered);
+    if ((end >= 0) && (ftruncate (durable->fd, start) == 0))
+    {
+        lseek (durable->fd, start, SEEK_SET);
+    }
+    durable->buffered = 0;
+    durable->buffered_records = 0;
+}
+
+/**
+ * Installs a finished compaction, or starts one if it is due, once the change of the
+ * last record was applied to the map.
+ */
+void durable_maintain (durable_hashmap *durable)
+{
+    durable_compaction *compaction = durable->compaction;
+    if (compaction != NULL)
+    {
+        if (__atomic_load_n (&(compaction->done), __ATOMIC_ACQUIRE))
+        {
+            finish_compaction (durable, 1);
+        }
+    }
+    else if ((durable->options.compact_ratio > 0)
+             && (durable->log_records >= DURABLE_COMPACT_MIN_RECORDS)
+             && ((double) durable->log_records
+                 > durable->options.compact_ratio * (double) durable->map->size))
+    {
+        durable_hashmap_compact (durable);
+    }
+}
+
+/**
+ * The thread of a compaction: writes a header and a DURABLE_PUT record of every pair
+ * of the snapshot to the new log, fsyncs it and frees the snapshot.
+ * @param arg the durable map.
+ */
+void *compact_worker (void *arg)
+{
+    durable_hashmap *durable = (durable_hashmap *) arg;
+    durable_compaction *compaction = durable->compaction;
+    hashmap_view *view = compaction->view;
+    size_t chunk = (durable->options.buffer_bytes == 0) ? DURABLE_BUFFER_BYTES
+                                                         : durable->options.buffer_bytes;
+    unsigned char *buffer = NULL;
+    size_t capacity = 0, used = 0, bucket = 0, index = 0;
+    int success = write_header (compaction->fd, view->size)
+                  && (lseek (compaction->fd, DURABLE_HEADER_SIZE, SEEK_SET) >= 0);
+    compaction->bytes = DURABLE_HEADER_SIZE;
+    const pair *p = NULL;
+    while (success && ((p = hashmap_view_next (view, &bucket, &index)) != NULL))
+    {
+        size_t payload = 0;
+        size_t size = encode_record (&(durable->codec), DURABLE_PUT, p->key, p->value,
+                                     &buffer, &capacity, used, &payload);
+        if (size == 0) {success = 0; break;}
+        used += size;
+        ++compaction->records;
+        if (used >= chunk)
+        {
+            success = (write_all (compaction->fd, buffer, used) == used);
+            compaction->bytes += used;
+            used = 0;
+        }
+    }
+    if (success && (used > 0))
+    {
+        success = (write_all (compaction->fd, buffer, used) == used);
+        compaction->bytes += used;
+    }
+    success = success && (fsync (compaction->fd) == 0);
+    free (buffer);
+    hashmap_view_free (&(compaction->view));
+    compaction->success = success;
+    __atomic_store_n (&(compaction->done), 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/**
+ * Waits for the running compaction, and installs its log: its tail is appended, it is
+ * fsync'ed and renamed over the log, and replaces the log and its buffer.
+ * @param install 0 to discard the new log.
+ * @return 1 if the new log was installed, 0 otherwise.
+ */
+int finish_compaction (durable_hashmap *durable, int install)
+{
+    durable_compaction *compaction = durable->compaction;
+    pthread_join (compaction->thread, NULL);
+    durable->compaction = NULL;
+    int success = install && compaction->success;
+    if (success)
+    {
+        success = (write_all (compaction->fd, compaction->tail, compaction->tail_size)
+                   == compaction->tail_size)
+                  && (fsync (compaction->fd) == 0)
+                  && (rename (compaction->path, durable->path) == 0);
+    }
+    if (success)
+    {
+        sync_directory (durable->path);
+        close (durable->fd);
+        durable->fd = compaction->fd;
+        // the records buffered are in the snapshot or the tail
+        durable->buffered = 0;
+        durable->buffered_records = 0;
+        durable->unsynced = 0;
+        durable->log_records = compaction->records + compaction->tail_records;
+        durable->counters.compacted_bytes += compaction->bytes + compaction->tail_size;
+        ++durable->counters.compactions;
+    }
+    else
+    {
+        close (compaction->fd);
+        unlink (compaction->path);
+    }
+    free (compaction->tail);
+    free (compaction->path);
+    free (compaction);
+    return success;
+}
+
+/**
+ * Closes the log of a durable map and frees it, without writing anything.
+ */
+void durable_release (durable_hashmap *durable)
+{
+    if (durable->fd >= 0) {close (durable->fd);}
+    hashmap_free (&(durable->map));
+    free (durable->buffer);
+    free (durable->path);
+    free (durable);
+}
+
+/**
+ * Opens a durable map: replays its log if the file exists (into a hash map sized
+ * by the header of the log), or creates an empty log. A torn or corrupted record
+ * ends the replay, and the log is truncated before it.
+ * @param path the path of the log.
+ * @param func a function which "hashes" keys.
+ * @param codec the codec of the keys and values.
+ * @param options the options of the log, NULL for the defaults (DURABLE_BUFFER_BYTES,
+ * fsync only on durable_hashmap_sync, DURABLE_COMPACT_RATIO).
+ * @return pointer to dynamically allocated durable map.
+ * @if_fail return NULL.
+ */
+durable_hashmap *durable_hashmap_open (const char *path, hash_func func,
+                                       const durable_codec *codec,
+                                       const durable_options *options)
+{
+    if ((path == NULL) || (func == NULL) || (codec == NULL) || (codec->encode_key == NULL)
+        || (codec->encode_value == NULL) || (codec->decode_key == NULL)
+        || (codec->decode_value == NULL) || (codec->key_cpy == NULL)
+        || (codec->value_cpy == NULL) || (codec->key_cmp == NULL)
+        || (codec->value_cmp == NULL) || (codec->key_free == NULL)
+        || (codec->value_free == NULL))
+    {
+        return NULL;
+    }
+    durable_hashmap *durable = (durable_hashmap *) malloc (sizeof(durable_hashmap));
+    if (durable == NULL) {return NULL;}
+    durable->map = hashmap_alloc (func);
+    durable->codec = *codec;
+    if (options != NULL)
+    {
+        durable->options = *options;
+    }
+    else
+    {
+        durable->options.buffer_bytes = DURABLE_BUFFER_BYTES;
+        durable->options.sync_records = 0;
+        durable->options.compact_ratio = DURABLE_COMPACT_RATIO;
+    }
+    durable->path = (char *) malloc (strlen (path) + 1);
+    durable->fd = -1;
+    durable->buffer = NULL;
+    durable->buffered = 0;
+    durable->buffer_capacity = 0;
+    durable->buffered_records = 0;
+    durable->unsynced = 0;
+    durable->log_records = 0;
+    durable->compaction = NULL;
+    memset (&(durable->counters), 0, sizeof(durable_counters));
+    if ((durable->map == NULL) || (durable->path == NULL))
+    {
+        durable_release (durable);
+        return NULL;
+    }
+    strcpy (durable->path, path);
+    durable->fd = open (path, O_RDWR | O_CREAT, 0644);
+    if ((durable->fd < 0) || (durable_replay (durable) == 0))
+    {
+        durable_release (durable);
+        return NULL;
+    }
+    return durable;
+}
+
+/**
+ * Waits for a running compaction, writes and fsyncs the buffered records, records the
+ * number of keys in the header of the log, closes it and frees the durable map.
+ * Call durable_hashmap_sync first to know whether the records were written.
+ * @param p_durable pointer to dynamically allocated pointer to durable map.
+ */
+void durable_hashmap_free (durable_hashmap **p_durable)
+{
+    if ((p_durable == NULL) || (*p_durable == NULL)) {return;}
+    durable_hashmap *durable = *p_durable;
+    if (durable->compaction != NULL) {finish_compaction (durable, 1);}
+    if (durable_flush (durable))
+    {
+        // the header is only a hint of the size, for the replay
+        write_header (durable->fd, durable->map->size);
+        fsync (durable->fd);
+    }
+    durable_release (durable);
+    *p_durable = NULL;
+}
+
+/**
+ * Inserts a copy of in_pair to the map, and logs it. The record is written before
+ * the pair is inserted.
+ * @param durable a durable map.
+ * @param in_pair the pair to be inserted.
+ * @return 1 if the pair was inserted and logged, 0 otherwise (if the key was in the
+ * map, or the record could not be written: the map is then unchanged).
+ */
+int durable_hashmap_insert (durable_hashmap *durable, const pair *in_pair)
+{
+    if ((durable == NULL) || (in_pair == NULL) || (in_pair->key == NULL)) {return 0;}
+    // the values of a durable map are never NULL, so at finds every key
+    if ((hashmap_at (durable->map, in_pair->key) != NULL)
+        || (hashmap_reserve (durable->map, durable->map->size + 1) == 0))
+    {
+        return 0;
+    }
+    size_t payload = 0;
+    size_t size = encode_record (&(durable->codec), DURABLE_PUT, in_pair->key, in_pair->value,
+                                 &(durable->buffer), &(durable->buffer_capacity),
+                                 durable->buffered, &payload);
+    if ((size == 0) || (durable_commit (durable, size, payload) == 0)) {return 0;}
+    int success = hashmap_insert (durable->map, in_pair);
+    durable_maintain (durable);
+    return success;
+}
+
+/**
+ * Inserts a copy of in_pair, or replaces the value of its key, and logs it. The
+ * record is written before the map is changed.
+ * @param durable a durable map.
+ * @param in_pair the pair to be inserted or whose value replaces the stored one.
+ * @return 1 if the pair was inserted or its value replaced, and logged, 0 otherwise
+ * (if the record could not be written, the map is unchanged).
+ */
+int durable_hashmap_upsert (durable_hashmap *durable, const pair *in_pair)
+{
+    if ((durable == NULL) || (in_pair == NULL) || (in_pair->key == NULL)) {return 0;}
+    if ((hashmap_at (durable->map, in_pair->key) == NULL)
+        && (hashmap_reserve (durable->map, durable->map->size + 1) == 0))
+    {
+        return 0;
+    }
+    size_t payload = 0;
+    size_t size = encode_record (&(durable->codec), DURABLE_PUT, in_pair->key, in_pair->value,
+                                 &(durable->buffer), &(durable->buffer_capacity),
+                                 durable->buffered, &payload);
+    if ((size == 0) || (durable_commit (durable, size, payload) == 0)) {return 0;}
+    int success = hashmap_upsert (durable->map, in_pair);
+    durable_maintain (durable);
+    return success;
+}
+
+/**
+ * Erases the pair of the key, and logs it. The record is written before the pair is
+ * erased.
+ * @param durable a durable map.
+ * @param key the key of the pair to be erased.
+ * @return 1 if the pair was erased and logged, 0 otherwise (if the key was not in the
+ * map, or the record could not be written: the map is then unchanged).
+ */
+int durable_hashmap_erase (durable_hashmap *durable, const_keyT key)
+{
+    if ((durable == NULL) || (key == NULL)) {return 0;}
+    if (hashmap_at (durable->map, key) == NULL) {return 0;}
+    size_t payload = 0;
+    size_t size = encode_record (&(durable->codec), DURABLE_ERASE, key, NULL,
+                                 &(durable->buffer), &(durable->buffer_capacity),
+                                 durable->buffered, &payload);
+    if ((size == 0) || (durable_commit (durable, size, payload) == 0)) {return 0;}
+    int success = hashmap_erase (durable->map, key);
+    durable_maintain (durable);
+    return success;
+}
+
+/**
+ * The function returns the value associated with the given key.
+ * @param durable a durable map.
+ * @param key the key to be checked.
+ * @return the value associated with key if exists, NULL otherwise.
+ */
+valueT durable_hashmap_at (const durable_hashmap *durable, const_keyT key)
+{
+    if (durable == NULL) {return NULL;}
+    return hashmap_at (durable->map, key);
+}
+
+/**
+ * Writes the buffered records and fsyncs the log.
+ * @param durable a durable map.
+ * @return 1 if all the logged records are durable, 0 otherwise.
+ */
+int durable_hashmap_sync (durable_hashmap *durable)
+{
+    if (durable == NULL) {return 0;}
+    if (durable_flush (durable) == 0) {return 0;}
+    if (durable->unsynced == 0) {return 1;}
+    return durable_fsync (durable);
+}
+
+/**
+ * Starts compacting the log in a background thread: a snapshot of the map (see
+ * hashmap_snapshot) is written to a new log, followed by the records logged in the
+ * meantime, and the new log replaces the old one. The writes to the map go on
+ * meanwhile, the new log is installed by the first of them after the thread finished.
+ * @param durable a durable map.
+ * @return 1 if a compaction is running, 0 if it could not be started.
+ */
+int durable_hashmap_compact (durable_hashmap *durable)
+{
+    if (durable == NULL) {return 0;}
+    if (durable->compaction != NULL) {return 1;}
+    durable_compaction *compaction = (durable_compaction *) malloc (sizeof(durable_compaction));
+    if (compaction == NULL) {return 0;}
+    compaction->path = (char *) malloc (strlen (durable->path) + sizeof(DURABLE_COMPACT_SUFFIX));
+    compaction->fd = -1;
+    compaction->view = NULL;
+    compaction->tail = NULL;
+    compaction->tail_size = 0;
+    compaction->tail_capacity = 0;
+    compaction->tail_records = 0;
+    compaction->records = 0;
+    compaction->bytes = 0;
+    compaction->done = 0;
+    compaction->success = 0;
+    if (compaction->path != NULL)
+    {
+        sprintf (compaction->path, "%s%s", durable->path, DURABLE_COMPACT_SUFFIX);
+        compaction->fd = open (compaction->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (compaction->fd >= 0) {compaction->view = hashmap_snapshot (durable->map);}
+    durable->compaction = compaction;
+    if ((compaction->view == NULL)
+        || (pthread_create (&(compaction->thread), NULL, compact_worker, durable) != 0))
+    {
+        durable->compaction = NULL;
+        hashmap_view_free (&(compaction->view));
+        if (compaction->fd >= 0)
+        {
+            close (compaction->fd);
+            unlink (compaction->path);
+        }
+        free (compaction->path);
+        free (compaction);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Waits for the running compaction, if any, and installs its log.
+ * @param durable a durable map.
+ * @return 1 if the log was compacted (or no compaction was running), 0 otherwise
+ * (the old log is kept).
+ */
+int durable_hashmap_compact_wait (durable_hashmap *durable)
+{
+    if (durable == NULL) {return 0;}
+    if (durable->compaction == NULL) {return 1;}
+    return finish_compaction (durable, 1);
+}
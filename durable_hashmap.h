@@ -0,0 +1,263 @@
+#ifndef DURABLE_HASHMAP_H_
+#define DURABLE_HASHMAP_H_
+
+#include <pthread.h>
+#include "hashmap.h"
+
+/**
+ * @def DURABLE_BUFFER_BYTES
+ * The default number of bytes of records batched into a single write (group commit).
+ */
+#define DURABLE_BUFFER_BYTES 65536UL
+
+/**
+ * @def DURABLE_REPLAY_CHUNK
+ * The number of bytes of the log read at once by the replay.
+ */
+#define DURABLE_REPLAY_CHUNK 1048576UL
+
+/**
+ * @def DURABLE_COMPACT_RATIO
+ * The default number of records per key in the log above which it is compacted.
+ */
+#define DURABLE_COMPACT_RATIO 4.0
+
+/**
+ * @def DURABLE_COMPACT_MIN_RECORDS
+ * A log of fewer records is never compacted automatically.
+ */
+#define DURABLE_COMPACT_MIN_RECORDS 4096UL
+
+/**
+ * @def DURABLE_HEADER_SIZE
+ * The size of the header of a log: an 8 byte magic number and the number of keys
+ * the log held when it was last closed or compacted (64 bits, little endian).
+ */
+#define DURABLE_HEADER_SIZE 16UL
+
+/**
+ * @typedef durable_encode_func
+ * Function which receives a key or a value, a buffer and its capacity, and returns
+ * the size in bytes of the encoding of the key or value. The encoding is written to
+ * the buffer only if it fits (the buffer may be NULL if the capacity is 0).
+ */
+typedef size_t (*durable_encode_func) (const void *, unsigned char *, size_t);
+
+/**
+ * @typedef durable_decode_func
+ * Function which receives an encoding and its size in bytes and returns a dynamically
+ * allocated key or value (freed by the key_free or value_free of the codec), NULL
+ * if the encoding is invalid.
+ */
+typedef void *(*durable_decode_func) (const unsigned char *, size_t);
+
+/**
+ * @struct durable_codec - the functions logging the keys and values of a durable map.
+ * @param encode_key, encode_value - encode the keys and values to the log.
+ * @param decode_key, decode_value - decode them on replay.
+ * @param key_cpy, value_cpy, key_cmp, value_cmp, key_free, value_free - the functions
+ * of the pairs replayed from the log.
+ */
+typedef struct durable_codec {
+    durable_encode_func encode_key;
+    durable_encode_func encode_value;
+    durable_decode_func decode_key;
+    durable_decode_func decode_value;
+    pair_key_cpy key_cpy;
+    pair_value_cpy value_cpy;
+    pair_key_cmp key_cmp;
+    pair_value_cmp value_cmp;
+    pair_key_free key_free;
+    pair_value_free value_free;
+} durable_codec;
+
+/**
+ * @struct durable_options
+ * @param buffer_bytes the records are written once this many bytes of them are
+ * buffered (group commit), 0 to write every record at once. The buffered records
+ * are lost on a crash.
+ * @param sync_records the log is fsync'ed once this many records were written since
+ * the last fsync, 0 to fsync only in durable_hashmap_sync and durable_hashmap_free.
+ * @param compact_ratio the log is compacted in the background once it holds more
+ * than compact_ratio records per key (and at least DURABLE_COMPACT_MIN_RECORDS),
+ * 0 to compact it only by durable_hashmap_compact.
+ */
+typedef struct durable_options {
+    size_t buffer_bytes;
+    size_t sync_records;
+    double compact_ratio;
+} durable_options;
+
+/**
+ * @struct durable_counters
+ * @param records the number of records logged.
+ * @param log_bytes the number of bytes of the records logged.
+ * @param payload_bytes the number of bytes of the encodings of their keys and values.
+ * @param compacted_bytes the number of bytes written by the compactions.
+ * @param writes the number of write calls.
+ * @param syncs the number of fsync calls.
+ * @param compactions the number of compactions which replaced the log.
+ * @param replayed the number of records replayed when the log was opened.
+ */
+typedef struct durable_counters {
+    size_t records;
+    size_t log_bytes;
+    size_t payload_bytes;
+    size_t compacted_bytes;
+    size_t writes;
+    size_t syncs;
+    size_t compactions;
+    size_t replayed;
+} durable_counters;
+
+/**
+ * @struct durable_compaction - a compaction running in a background thread, which
+ * writes the records of a snapshot of the map to a new log.
+ * @param thread the thread writing the snapshot.
+ * @param view the snapshot, freed by the thread.
+ * @param path the path of the new log, renamed over the log when it is complete.
+ * @param fd the new log.
+ * @param tail the records logged since the snapshot, appended to the new log last.
+ * @param tail_size, tail_capacity - the size and capacity of tail.
+ * @param tail_records the number of records in tail.
+ * @param records the number of records the thread wrote.
+ * @param bytes the number of bytes the thread wrote.
+ * @param done set by the thread when it finished.
+ * @param success 1 if the thread wrote the snapshot successfully, 0 otherwise.
+ */
+typedef struct durable_compaction {
+    pthread_t thread;
+    hashmap_view *view;
+    char *path;
+    int fd;
+    unsigned char *tail;
+    size_t tail_size;
+    size_t tail_capacity;
+    size_t tail_records;
+    size_t records;
+    size_t bytes;
+    int done;
+    int success;
+} durable_compaction;
+
+/**
+ * @struct durable_hashmap - a hash map whose changes are appended to a log file as
+ * compact binary records, and replayed from it when it is opened again.
+ * @param map the hash map. It may be read directly, but written only by the
+ * durable_hashmap functions.
+ * @param codec the codec of the keys and values.
+ * @param options the group commit, fsync and compaction options.
+ * @param path the path of the log.
+ * @param fd the log, opened for writing at its end.
+ * @param buffer the records not written yet.
+ * @param buffered, buffer_capacity - the size and capacity of buffer.
+ * @param buffered_records the number of records in buffer.
+ * @param unsynced the number of records written since the last fsync.
+ * @param log_records the number of records in the log (and its buffer).
+ * @param compaction the running compaction, NULL if there is none.
+ * @param counters the counts of the logging.
+ */
+typedef struct durable_hashmap {
+    hashmap *map;
+    durable_codec codec;
+    durable_options options;
+    char *path;
+    int fd;
+    unsigned char *buffer;
+    size_t buffered;
+    size_t buffer_capacity;
+    size_t buffered_records;
+    size_t unsynced;
+    size_t log_records;
+    durable_compaction *compaction;
+    durable_counters counters;
+} durable_hashmap;
+
+/**
+ * Opens a durable map: replays its log if the file exists (into a hash map sized
+ * by the header of the log), or creates an empty log. A torn or corrupted record
+ * ends the replay, and the log is truncated before it.
+ * @param path the path of the log.
+ * @param func a function which "hashes" keys.
+ * @param codec the codec of the keys and values.
+ * @param options the options of the log, NULL for the defaults (DURABLE_BUFFER_BYTES,
+ * fsync only on durable_hashmap_sync, DURABLE_COMPACT_RATIO).
+ * @return pointer to dynamically allocated durable map.
+ * @if_fail return NULL.
+ */
+durable_hashmap *durable_hashmap_open (const char *path, hash_func func,
+                                       const durable_codec *codec,
+                                       const durable_options *options);
+
+/**
+ * Waits for a running compaction, writes and fsyncs the buffered records, records the
+ * number of keys in the header of the log, closes it and frees the durable map.
+ * Call durable_hashmap_sync first to know whether the records were written.
+ * @param p_durable pointer to dynamically allocated pointer to durable map.
+ */
+void durable_hashmap_free (durable_hashmap **p_durable);
+
+/**
+ * Inserts a copy of in_pair to the map, and logs it. The record is written before
+ * the pair is inserted.
+ * @param durable a durable map.
+ * @param in_pair the pair to be inserted.
+ * @return 1 if the pair was inserted and logged, 0 otherwise (if the key was in the
+ * map, or the record could not be written: the map is then unchanged).
+ */
+int durable_hashmap_insert (durable_hashmap *durable, const pair *in_pair);
+
+/**
+ * Inserts a copy of in_pair, or replaces the value of its key, and logs it. The
+ * record is written before the map is changed.
+ * @param durable a durable map.
+ * @param in_pair the pair to be inserted or whose value replaces the stored one.
+ * @return 1 if the pair was inserted or its value replaced, and logged, 0 otherwise
+ * (if the record could not be written, the map is unchanged).
+ */
+int durable_hashmap_upsert (durable_hashmap *durable, const pair *in_pair);
+
+/**
+ * Erases the pair of the key, and logs it. The record is written before the pair is
+ * erased.
+ * @param durable a durable map.
+ * @param key the key of the pair to be erased.
+ * @return 1 if the pair was erased and logged, 0 otherwise (if the key was not in the
+ * map, or the record could not be written: the map is then unchanged).
+ */
+int durable_hashmap_erase (durable_hashmap *durable, const_keyT key);
+
+/**
+ * The function returns the value associated with the given key.
+ * @param durable a durable map.
+ * @param key the key to be checked.
+ * @return the value associated with key if exists, NULL otherwise.
+ */
+valueT durable_hashmap_at (const durable_hashmap *durable, const_keyT key);
+
+/**
+ * Writes the buffered records and fsyncs the log.
+ * @param durable a durable map.
+ * @return 1 if all the logged records are durable, 0 otherwise.
+ */
+int durable_hashmap_sync (durable_hashmap *durable);
+
+/**
+ * Starts compacting the log in a background thread: a snapshot of the map (see
+ * hashmap_snapshot) is written to a new log, followed by the records logged in the
+ * meantime, and the new log replaces the old one. The writes to the map go on
+ * meanwhile, the new log is installed by the first of them after the thread finished.
+ * @param durable a durable map.
+ * @return 1 if a compaction is running, 0 if it could not be started.
+ */
+int durable_hashmap_compact (durable_hashmap *durable);
+
+/**
+ * Waits for the running compaction, if any, and installs its log.
+ * @param durable a durable map.
+ * @return 1 if the log was compacted (or no compaction was running), 0 otherwise
+ * (the old log is kept).
+ */
+int durable_hashmap_compact_wait (durable_hashmap *durable);
+
+#endif //DURABLE_HASHMAP_H_
@@ -27,4 +27,17 @@ size_t hash_double(const void *elem){
     return hash;
 }
 
+/**
+ * Strings (null terminated) FNV-1a hash func.
+ */
+size_t hash_string(const void *elem){
+    size_t hash = 14695981039346656037UL;
+    for (const unsigned char *c = elem; *c != '\0'; ++c)
+    {
+        hash ^= *c;
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
+
 #endif // HASHFUNCS_H_
\ No newline at end of file
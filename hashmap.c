@@ -4,19 +4,83 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
 #include "hashmap.h"
 #include "vector.h"
 #include "pair.h"
 
+#if HASH_MAP_COUNTERS
+// the lookups of concurrent readers count with relaxed atomics
+#define HASH_MAP_COUNT(hash_map, counter, n) \
+    ((void) __atomic_add_fetch (&(((hashmap *) (hash_map))->counters.counter), (n), \
+                                __ATOMIC_RELAXED))
+#else
+#define HASH_MAP_COUNT(hash_map, counter, n) ((void) (hash_map))
+#endif
+
 void *vec_copy_func(const void *elem);
 int vec_cmp_func(const void *elem1, const void *elem2);
 void vec_free_func(void **elem);
-int get_all_pairs (hashmap *hash_map, pair **pair_arr);
-int check_key_appearance (hashmap *hash_map, pair **pair_arr, const_keyT key, int *flag);
-int update_elem_in_buckets (hashmap *hash_map, pair **pair_arr, int size);
+pair *find_or_insert_pair (hashmap *hash_map, const pair *in_pair, int *inserted);
+pair *find_or_insert_hashed (hashmap *hash_map, const pair *in_pair, size_t hashed_key,
+                             int *inserted);
+size_t get_bucket_index (const hashmap *hash_map, const_keyT key);
+int find_in_bucket (const hashmap *hash_map, const vector *v, const_keyT key);
+int scan_bucket (const hashmap *hash_map, const vector *v, const_keyT key);
+int pod_keys_equal (const void *key1, const void *key2, size_t key_size);
 int add_elem (hashmap *hash_map, pair *p);
-int delete_old_vectors (hashmap *hash_map);
+int resize_buckets (hashmap *hash_map, size_t new_capacity);
 int create_new_vectors (hashmap *hash_map);
+int move_pair (hashmap *hash_map, pair *p, hashmap_merge_policy policy);
+int erase_key (hashmap *hash_map, const_keyT key);
+pair *probe_or_insert (hashmap *hash_map, const pair *in_pair, size_t hashed_key,
+                       int *inserted);
+int arm_pair (hashmap *hash_map, pair *p, unsigned long long expires);
+void disarm_pair (hashmap *hash_map, pair *p);
+int pair_expired (const hashmap *hash_map, const pair *p);
+void expire_timer (timer_node *node, void *ctx);
+void minimize_buckets (hashmap *hash_map);
+void replace_value (pair *stored, const pair *in_pair, int *success);
+int filter_rejects (const hashmap *hash_map, size_t hashed_key);
+void filter_add (hashmap *hash_map, size_t hashed_key);
+void filter_note_erased (hashmap *hash_map, size_t erased);
+unsigned long long latency_start (const hashmap *hash_map);
+void latency_stop (const hashmap *hash_map, hashmap_op op, unsigned long long start,
+                   int resized);
+int unshare_bucket (const hashmap *hash_map, size_t bucket);
+int unshare_if (const hashmap *hash_map, size_t bucket, keyT_func keyT_func);
+int unshare_all (hashmap *hash_map);
+void release_bucket (vector *v, size_t *refs, const allocator *allocator);
+void move_bucket (vector *dst, const vector *src);
+void view_release (hashmap_view *view, size_t buckets);
+void *resize_worker (void *arg);
+int start_resize (hashmap *hash_map, size_t new_capacity);
+int finish_resize (hashmap *hash_map);
+void poll_resize (hashmap *hash_map);
+int replay_side (hashmap *hash_map, vector *buckets, size_t capacity, bloom_filter *filter,
+                 size_t *stale);
+void unappend_side (hashmap *hash_map, vector *buckets, size_t capacity, size_t bucket,
+                    size_t index);
+void drop_resize (hashmap *hash_map);
+void release_buckets (hashmap *hash_map, size_t budget);
+pair *resize_find (const hashmap *hash_map, const_keyT key, size_t hashed_key,
+                   int *in_side);
+pair *resize_insert (hashmap *hash_map, const pair *in_pair, size_t hashed_key,
+                     int *inserted);
+pair *side_insert (hashmap_resize *resize, const pair *in_pair, size_t hashed_key);
+int resize_erase (hashmap *hash_map, const_keyT key);
+valueT tombstone_cpy (const_valueT value);
+void tombstone_free (valueT *value);
+int side_holds (const hashmap *side, const_keyT key);
+const pair *next_pair (const hashmap *hash_map, size_t *bucket, size_t *index);
+
+/**
+ * The value of the tombstone pairs, which mark in the side hash map of a background
+ * resize the keys erased from the frozen bucket array.
+ */
+static char hashmap_tombstone;
+
 /**
  * Allocates dynamically new hash map element.
  * @param func a function which "hashes" keys.
@@ -68,42 +132,103 @@ void vec_free_func(void **elem)
  */
 hashmap *hashmap_alloc (hash_func func)
 {
-    hashmap *h = (hashmap *) malloc (sizeof(hashmap));
-    if (h == NULL) {return NULL;}
+    return hashmap_alloc_ex (func, NULL);
+}
+
+/**
+ * Allocates dynamically new hash map element, whose struct, buckets and pairs are
+ * allocated with the given allocator.
+ * @param func a function which "hashes" keys.
+ * @param allocator the allocator of the hash map, NULL for malloc. It must outlive
+ * the hash map.
+ * @return pointer to dynamically allocated hashmap.
+ * @if_fail return NULL.
+ */
+hashmap *hashmap_alloc_ex (hash_func func, const allocator *allocator)
+{
     if (func == NULL) {return NULL;}
+    hashmap *h = (hashmap *) allocator_alloc (allocator, sizeof(hashmap));
+    if (h == NULL) {return NULL;}
+    h->allocator = allocator;
     h->capacity = HASH_MAP_INITIAL_CAP;
     h->size = 0;
-    h->buckets = (vector **) malloc (sizeof(vector *) * h->capacity);
+    h->buckets = (vector *) allocator_alloc (allocator, sizeof(vector) * h->capacity);
     if (h->buckets == NULL)
     {
-        free(h);
-        h = NULL;
+        allocator_free(allocator, h, sizeof(hashmap));
         return NULL;
     }
-    for (size_t i = 0; i < h->capacity; ++i)
-    {
-        (h->buckets)[i] = vector_alloc(vec_copy_func, vec_cmp_func, vec_free_func);
-        if (h->buckets[i] == NULL) {return NULL;}
-    }
+    create_new_vectors (h);
     h->hash_func = func;
+    h->counters = (hashmap_counters) {0};
+    h->latency = NULL;
+    h->key_size = 0;
+    h->timers = NULL;
+    h->clock = hashmap_clock_ms;
+    h->filter = NULL;
+    h->filter_erased = 0;
+    h->shares = NULL;
+    h->hard_load_factor = 0;
+    h->resize = NULL;
+    h->released = NULL;
+    h->released_capacity = 0;
+    h->released_left = 0;
     return h;
 }
 
 /**
  * Frees a hash map and the elements the hash map itself allocated.
+ * The pairs of a hash map whose allocator releases all its memory at once (an
+ * arena) are not walked: the hash map is freed in O(1).
  * @param p_hash_map pointer to dynamically allocated pointer to hash_map.
  */
 void hashmap_free (hashmap **p_hash_map)
 {
     if ((p_hash_map != NULL) && (*p_hash_map != NULL))
     {
+        const allocator *allocator = (*p_hash_map)->allocator;
+        if (finish_resize (*p_hash_map) == 0) {drop_resize (*p_hash_map);}
+        release_buckets (*p_hash_map, SIZE_MAX);
+        if (allocator_releases_all (allocator))
+        {
+            timer_wheel_free(&((*p_hash_map)->timers));
+            free((*p_hash_map)->latency);
+            bloom_filter_free(&((*p_hash_map)->filter));
+            *p_hash_map = NULL;
+            return;
+        }
+        if ((*p_hash_map)->timers != NULL)
+        {
+            // the wheel goes away with the map, the timers need not be removed from it
+            for (size_t i = 0; i < (*p_hash_map)->capacity; ++i)
+            {
+                vector *v = &((*p_hash_map)->buckets[i]);
+                for (size_t j = 0; j < v->size; ++j)
+                {
+                    allocator_free(allocator, ((pair *) v->data[j])->timer,
+                                   sizeof(timer_node));
+                }
+            }
+            timer_wheel_free(&((*p_hash_map)->timers));
+        }
+        size_t **shares = (*p_hash_map)->shares;
         for (size_t i = 0; i < (*p_hash_map)->capacity; ++i)
         {
-            vector_free(&((*p_hash_map)->buckets[i]));
+            if ((shares != NULL) && (shares[i] != NULL))
+            {
+                // the snapshots sharing the bucket free it
+                release_bucket(&((*p_hash_map)->buckets[i]), shares[i], allocator);
+                continue;
+            }
+            vector_destroy(&((*p_hash_map)->buckets[i]));
         }
-        free((*p_hash_map)->buckets);
+        allocator_free(allocator, shares, sizeof(size_t *) * (*p_hash_map)->capacity);
+        allocator_free(allocator, (*p_hash_map)->buckets,
+                       sizeof(vector) * (*p_hash_map)->capacity);
         (*p_hash_map)->buckets = NULL;
-        free(*p_hash_map);
+        free((*p_hash_map)->latency);
+        bloom_filter_free(&((*p_hash_map)->filter));
+        allocator_free(allocator, *p_hash_map, sizeof(hashmap));
         *p_hash_map = NULL;
     }
 }
@@ -118,91 +243,85 @@ void hashmap_free (hashmap **p_hash_map)
  */
 int hashmap_insert (hashmap *hash_map, const pair *in_pair)
 {
-    if ((hash_map == NULL) || (in_pair == NULL)) {return 0;}
-    pair **pair_arr = malloc(sizeof(pair *) * hash_map->size);
-    if (pair_arr == NULL) {return 0;}
-    int flag = 0;
-    int result = check_key_appearance (hash_map, pair_arr, (in_pair->key), &flag);
-    if (result == -1)
-    {
-        free(pair_arr);
-        return 0;
-    }
-    else if (flag == 1)
-    {
-        // free allocated pairs in array
-        for (size_t i = 0; i <= ((size_t) result); ++i)
-        {
-            pair_free((void **) &(pair_arr[i]));
-        }
-        free(pair_arr);
-        return 0;
-    }
+    int inserted = 0;
+    if (find_or_insert_pair (hash_map, in_pair, &inserted) == NULL) {return 0;}
+    return inserted;
+}
 
-    if (hashmap_get_load_factor(hash_map) >= HASH_MAP_MAX_LOAD_FACTOR)
-    {
-        size_t resize = hash_map->capacity * HASH_MAP_GROWTH_FACTOR * sizeof(vector *);
-        vector **v_temp = malloc (resize);
-        if (v_temp == NULL)
-        {
-            // free allocated pairs in array
-            for (size_t i = 0; i < hash_map->size; ++i)
-            {
-                pair_free((void **) &(pair_arr[i]));
-            }
-            free(pair_arr);
-            return 0;
-        }
+/**
+ * Looks up the key of in_pair and inserts a copy of in_pair if the key is missing.
+ * The key is hashed once and its bucket is scanned once.
+ * @param hash_map a hash map.
+ * @param in_pair the pair whose key is looked up, its value is the initial value
+ * stored if the key is missing.
+ * @param inserted if not NULL, set to 1 if a new pair was inserted, 0 otherwise.
+ * @return pointer to the stored value slot of the key, NULL on failure.
+ */
+valueT *hashmap_find_or_insert (hashmap *hash_map, const pair *in_pair, int *inserted)
+{
+    pair *p = find_or_insert_pair (hash_map, in_pair, inserted);
+    if (p == NULL) {return NULL;}
+    return &(p->value);
+}
 
-        // free old buckets
-        if (delete_old_vectors(hash_map) == 0)
-        {
-            // free allocated pairs in array
-            for (size_t i = 0; i < hash_map->size; ++i)
-            {
-                pair_free((void **) &(pair_arr[i]));
-            }
-            free(pair_arr);
-            return 0;
-        }
-        hash_map->buckets = v_temp;
-        hash_map->capacity *= HASH_MAP_GROWTH_FACTOR;
-        if (create_new_vectors(hash_map) == 0)
-        {
-            // free allocated pairs in array
-            for (size_t i = 0; i < hash_map->size; ++i)
-            {
-                pair_free((void **) &(pair_arr[i]));
-            }
-            free(pair_arr);
-            return 0;
-        }
-        if (update_elem_in_buckets(hash_map, pair_arr, hash_map->size) == 0)
-        {
-            // free allocated pairs in array
-            for (size_t i = 0; i < hash_map->size; ++i)
-            {
-                pair_free((void **) &(pair_arr[i]));
-            }
-            free(pair_arr);
-            return 0;
-        }
-    }
-    pair *new_pair = pair_copy (in_pair);
-    if (new_pair == NULL) {return 0;}
-    add_elem (hash_map, new_pair);
-    free (new_pair->key);
-    free (new_pair->value);
-    free (new_pair);
-    // free allocated pairs in array
-    for (size_t i = 0; i < hash_map->size; ++i)
+/**
+ * Same as hashmap_find_or_insert, for a caller which already hashed the key.
+ * @param hash_map a hash map.
+ * @param in_pair the pair whose key is looked up, its value is the initial value
+ * stored if the key is missing.
+ * @param hashed_key the hash function of the map applied to the key of in_pair.
+ * @param inserted if not NULL, set to 1 if a new pair was inserted, 0 otherwise.
+ * @return pointer to the stored value slot of the key, NULL on failure.
+ */
+valueT *hashmap_find_or_insert_hashed (hashmap *hash_map, const pair *in_pair,
+                                       size_t hashed_key, int *inserted)
+{
+    if (inserted != NULL) {*inserted = 0;}
+    if ((hash_map == NULL) || (in_pair == NULL) || (in_pair->key == NULL)) {return NULL;}
+    pair *p = find_or_insert_hashed (hash_map, in_pair, hashed_key, inserted);
+    if (p == NULL) {return NULL;}
+    return &(p->value);
+}
+
+/**
+ * Inserts a copy of in_pair, or replaces in place the value of the stored pair
+ * with the same key.
+ * @param hash_map a hash map.
+ * @param in_pair the pair to be inserted or whose value replaces the stored one.
+ * @return 1 if the pair was inserted or its value replaced, 0 otherwise.
+ */
+int hashmap_upsert (hashmap *hash_map, const pair *in_pair)
+{
+    int inserted = 0;
+    pair *p = find_or_insert_pair (hash_map, in_pair, &inserted);
+    if (p == NULL) {return 0;}
+    if (inserted == 1) {return 1;}
+    int success = 1;
+    replace_value (p, in_pair, &success);
+    return success;
+}
+
+/**
+ * Replaces the value of a stored pair with a copy of the value of in_pair,
+ * and takes its value functions.
+ * @param stored a pair stored in a hash map.
+ * @param in_pair the pair whose value replaces the stored one.
+ * @param success set to 0 if the value could not be copied (the stored pair
+ * is left unchanged).
+ */
+void replace_value (pair *stored, const pair *in_pair, int *success)
+{
+    valueT new_value = in_pair->value_cpy (in_pair->value);
+    if (new_value == NULL)
     {
-        //pair *p = pair_arr[i];
-        pair_free((void **) &(pair_arr[i]));
+        *success = 0;
+        return;
     }
-    free(pair_arr);
-    ++hash_map->size;
-    return 1;
+    stored->value_free (&(stored->value));
+    stored->value = new_value;
+    stored->value_cpy = in_pair->value_cpy;
+    stored->value_cmp = in_pair->value_cmp;
+    stored->value_free = in_pair->value_free;
 }
 
 /**
@@ -215,24 +334,30 @@ int hashmap_insert (hashmap *hash_map, const pair *in_pair)
 valueT hashmap_at (const hashmap *hash_map, const_keyT key)
 {
     if ((hash_map == NULL) || (key == NULL)) {return NULL;}
-    size_t hashed_key = (hash_map->hash_func (key));
-    size_t hash_value = hashed_key & (hash_map->capacity - 1);
-    //if ((hash_value < 0) || (hash_value >= (hash_map->capacity))) {return NULL;}
-    vector *temp_v = (hash_map->buckets)[hash_value];
-//    int idx = vector_find(temp_v, key);
-//    if (idx == -1) {return NULL;}
-//    pair *p = vector_at(temp_v, (size_t) idx);
-    for (size_t i = 0; i < temp_v->size; ++i)
+    unsigned long long start = latency_start (hash_map);
+    size_t hashed_key = hash_map->hash_func (key);
+    valueT value = NULL;
+    if (filter_rejects (hash_map, hashed_key) == 0)
     {
-        pair *p = temp_v->data[i];
-        //printf("%p", p->key);
-        //printf("%p", key);
-        if (p->key_cmp(p->key, key) == 1)
+        if (hash_map->resize != NULL)
+        {
+            // an erased key has a tombstone hiding its pair in the frozen bucket array
+            pair *p = resize_find (hash_map, key, hashed_key, NULL);
+            if ((p != NULL) && (p->value != &hashmap_tombstone)) {value = p->value;}
+        }
+        else
         {
-            return p->value;
+            vector *temp_v = &((hash_map->buckets)[hashed_key & (hash_map->capacity - 1)]);
+            int idx = find_in_bucket (hash_map, temp_v, key);
+            if ((idx != -1) && (pair_expired (hash_map, temp_v->data[idx]) == 0))
+            {
+                pair *p = temp_v->data[idx];
+                value = p->value;
+            }
         }
     }
-    return NULL;
+    latency_stop (hash_map, HASH_MAP_OP_AT, start, 0);
+    return value;
 }
 
 /**
@@ -245,226 +370,341 @@ valueT hashmap_at (const hashmap *hash_map, const_keyT key)
 int hashmap_erase (hashmap *hash_map, const_keyT key)
 {
     if ((hash_map == NULL) || (key == NULL)) {return 0;}
-    if (hashmap_get_load_factor (hash_map) <= HASH_MAP_MIN_LOAD_FACTOR)
+    unsigned long long start = latency_start (hash_map);
+    size_t resizes = hash_map->counters.resizes_down;
+    int result = erase_key (hash_map, key);
+    latency_stop (hash_map, HASH_MAP_OP_ERASE, start,
+                  hash_map->counters.resizes_down != resizes);
+    return result;
+}
+
+/**
+ * Erases the pair associated with key, after minimizing the hash map if its
+ * load factor dropped to the minimum.
+ * @param hash_map a hash map.
+ * @param key a key of the pair to be erased.
+ * @return 1 if the erasing was done successfully, 0 otherwise.
+ */
+int erase_key (hashmap *hash_map, const_keyT key)
+{
+    poll_resize (hash_map);
+    // the frozen bucket array of a background resize is not minimized
+    if (hash_map->resize != NULL) {return resize_erase (hash_map, key);}
+    if ((hashmap_get_load_factor (hash_map) <= HASH_MAP_MIN_LOAD_FACTOR) &&
+        (hash_map->capacity > 1))
     {
-        pair **pair_arr = malloc(sizeof(pair *) * hash_map->size);
-        if (pair_arr == NULL) {return 0;}
-        int result = get_all_pairs(hash_map, pair_arr);
-        if (result == -1)
-        {
-            free(pair_arr);
-            return 0;
-        }
-        else if (result != -2)
-        {
-            // free allocated pairs in array
-            for (size_t i = 0; i <= ((size_t) result); ++i)
-            {
-                pair_free((void **) &(pair_arr[i]));
-            }
-            free(pair_arr);
-            return 0;
-        }
-        size_t resize = hash_map->capacity / HASH_MAP_GROWTH_FACTOR * sizeof(vector *);
-        vector **v_temp = malloc(resize);
-        if (v_temp == NULL)
-        {
-            // free allocated pairs in array
-            for (size_t i = 0; i < hash_map->size; ++i)
-            {
-                pair_free((void **) &(pair_arr[i]));
-            }
-            free(pair_arr);
-            return 0;
-        }
-        // free old buckets
-        if (delete_old_vectors(hash_map) == 0)
-        {
-            // free allocated pairs in array
-            for (size_t i = 0; i < hash_map->size; ++i)
-            {
-                pair_free((void **) &(pair_arr[i]));
-            }
-            free(pair_arr);
-            return 0;
-        }
-        hash_map->buckets = v_temp;
-        hash_map->capacity /= HASH_MAP_GROWTH_FACTOR;
-        if (create_new_vectors(hash_map) == 0)
-        {
-            // free allocated pairs in array
-            for (size_t i = 0; i < hash_map->size; ++i)
-            {
-                pair_free((void **) &(pair_arr[i]));
-            }
-            free(pair_arr);
-            return 0;
-        }
-        if (update_elem_in_buckets(hash_map, pair_arr, hash_map->size) == 0)
+        if (resize_buckets (hash_map, hash_map->capacity / HASH_MAP_GROWTH_FACTOR) == 0)
         {
-            // free allocated pairs in array
-            for (size_t i = 0; i < hash_map->size; ++i)
-            {
-                pair_free((void **) &(pair_arr[i]));
-            }
-            free(pair_arr);
             return 0;
         }
-        // free allocated pairs in array
-        for (size_t i = 0; i < hash_map->size; ++i)
-        {
-            pair_free((void **) &(pair_arr[i]));
-        }
-        free(pair_arr);
-    }
-    size_t hash_value = (hash_map->hash_func (key)) & (hash_map->capacity - 1);
-    //if ((hash_value < 0) || (hash_value >= (hash_map->capacity))) {return 0;}
-    vector *temp_v = (hash_map->buckets)[hash_value];
-    int idx = -1;
-    for (size_t i = 0; i < temp_v->size; ++i)
-    {
-        pair *p = temp_v->data[i];
-        //printf("%p", p->key);
-        //printf("%p", key);
-        if (p->key_cmp(p->key, key) == 1)
-        {
-            idx = i;
-            break;
-        }
     }
-
-    //int idx = vector_find(temp_v, key);
+    size_t hashed_key = hash_map->hash_func (key);
+    if (filter_rejects (hash_map, hashed_key) == 1) {return 0;}
+    vector *temp_v = &((hash_map->buckets)[hashed_key & (hash_map->capacity - 1)]);
+    int idx = find_in_bucket (hash_map, temp_v, key);
     if (idx == -1) {return 0;}
-    if (vector_erase(temp_v, (size_t) idx) == 0) {return 0;}
+    // a copied bucket keeps the order of its pairs
+    if (unshare_bucket (hash_map, hashed_key & (hash_map->capacity - 1)) == 0) {return 0;}
+    // an expired pair is reclaimed, but was not in the map as far as the caller knows
+    int expired = pair_expired (hash_map, temp_v->data[idx]);
+    disarm_pair (hash_map, temp_v->data[idx]);
+    // the order of the pairs in a bucket does not matter
+    if (vector_erase_unordered(temp_v, (size_t) idx) == 0) {return 0;}
     --hash_map->size;
-    return 1;
+    filter_note_erased (hash_map, 1);
+    return !expired;
 }
 
 /**
- * The function erases the pair associated with key.
+ * Finds the pair with the given key, or inserts a copy of in_pair if there is none.
+ * Grows the hash map before inserting if its load factor reached the maximum.
  * @param hash_map a hash map.
- * @param key a key of the pair to be erased.
- * @return 1 if the erasing was done successfully, 0 otherwise. (if key not in map,
- * considered fail).
+ * @param in_pair the pair to look up and insert.
+ * @param inserted if not NULL, set to 1 if a new pair was inserted, 0 otherwise.
+ * @return the stored pair (not a copy of it), NULL on failure.
  */
-int get_all_pairs (hashmap *hash_map, pair **pair_arr)
+pair *find_or_insert_pair (hashmap *hash_map, const pair *in_pair, int *inserted)
 {
-    if ((pair_arr == NULL) || (hash_map == NULL)) {return -1;}
-    int size = 0;
-    for (size_t i = 0; i < hash_map->capacity; ++i)
+    if (inserted != NULL) {*inserted = 0;}
+    if ((hash_map == NULL) || (in_pair == NULL) || (in_pair->key == NULL)) {return NULL;}
+    return find_or_insert_hashed (hash_map, in_pair, hash_map->hash_func (in_pair->key),
+                                  inserted);
+}
+
+/**
+ * Finds the pair with the given key, or inserts a copy of in_pair if there is none,
+ * given the hash of the key.
+ * @param hash_map a hash map.
+ * @param in_pair the pair to look up and insert, with a non NULL key.
+ * @param hashed_key the hash of the key of in_pair.
+ * @param inserted if not NULL, set to 1 if a new pair was inserted, 0 otherwise.
+ * @return the stored pair (not a copy of it), NULL on failure.
+ */
+pair *find_or_insert_hashed (hashmap *hash_map, const pair *in_pair, size_t hashed_key,
+                             int *inserted)
+{
+    if (hash_map->timers != NULL)
     {
-        vector *v = (hash_map->buckets)[i];
-        for (size_t j = 0; j < v->size; ++j)
-        {
-            pair *temp_p = pair_copy(v->data[j]);
-            if (temp_p == NULL)
-            {
-                return size - 1;
-            }
-            pair_arr[size] = temp_p;
-            ++size;
-        }
+        hashmap_expire (hash_map, hash_map->clock (), HASH_MAP_EXPIRE_BUDGET);
     }
-    return -2;
+    unsigned long long start = latency_start (hash_map);
+    size_t resizes = hash_map->counters.resizes_up;
+    pair *p = probe_or_insert (hash_map, in_pair, hashed_key, inserted);
+    latency_stop (hash_map, HASH_MAP_OP_INSERT, start,
+                  hash_map->counters.resizes_up != resizes);
+    return p;
 }
 
-int check_key_appearance (hashmap *hash_map, pair **pair_arr, const_keyT key, int *flag)
+/**
+ * Scans the bucket of the key of in_pair once and inserts a copy of in_pair
+ * into it if the key is missing, extending the hash map first if needed (or
+ * starting its background resize, and inserting into the side hash map of it).
+ * @param hash_map a hash map.
+ * @param in_pair the pair to look up and insert.
+ * @param hashed_key the hash of the key of in_pair.
+ * @param inserted if not NULL, set to 1 if a new pair was inserted.
+ * @return the stored pair (not a copy of it), NULL on failure.
+ */
+pair *probe_or_insert (hashmap *hash_map, const pair *in_pair, size_t hashed_key,
+                       int *inserted)
 {
-    if ((pair_arr == NULL) || (hash_map == NULL) || (key == NULL)) {return -1;}
-    int size = 0;
-    for (size_t i = 0; i < hash_map->capacity; ++i)
+    poll_resize (hash_map);
+    // a background resize which fell too far behind is waited for, and one which
+    // cannot be published yet takes the insertion into its side hash map
+    if ((hash_map->resize != NULL) &&
+        ((hashmap_get_load_factor (hash_map) < hash_map->hard_load_factor) ||
+         (finish_resize (hash_map) == 0)))
     {
-        vector *v = (hash_map->buckets)[i];
-        for (size_t j = 0; j < v->size; ++j)
+        return resize_insert (hash_map, in_pair, hashed_key, inserted);
+    }
+    // the stored pair is returned writable, so a shared bucket is copied even on a hit
+    if (unshare_bucket (hash_map, hashed_key & (hash_map->capacity - 1)) == 0) {return NULL;}
+    vector *temp_v = &((hash_map->buckets)[hashed_key & (hash_map->capacity - 1)]);
+    int idx = -1;
+    if (filter_rejects (hash_map, hashed_key) == 0)
+    {
+        idx = find_in_bucket (hash_map, temp_v, in_pair->key);
+    }
+    if (idx != -1)
+    {
+        if (pair_expired (hash_map, temp_v->data[idx]) == 0) {return temp_v->data[idx];}
+        // the key expired, it is inserted again
+        disarm_pair (hash_map, temp_v->data[idx]);
+        vector_erase_unordered (temp_v, (size_t) idx);
+        --hash_map->size;
+    }
+
+    if (hashmap_get_load_factor (hash_map) >= HASH_MAP_MAX_LOAD_FACTOR)
+    {
+        if (start_resize (hash_map, hash_map->capacity * HASH_MAP_GROWTH_FACTOR) == 1)
         {
-            pair *temp_p = pair_copy(v->data[j]);
-            if (temp_p == NULL)
-            {
-                *flag = 1;
-                return size - 1;
-            }
-            pair_arr[size] = temp_p;
-            if ((temp_p->key_cmp) (key, (temp_p->key)) == 1)
-            {
-                *flag = 1;
-                return size;
-            }
-            ++size;
+            return resize_insert (hash_map, in_pair, hashed_key, inserted);
+        }
+        if (resize_buckets (hash_map, hash_map->capacity * HASH_MAP_GROWTH_FACTOR) == 0)
+        {
+            return NULL;
         }
+        temp_v = &((hash_map->buckets)[hashed_key & (hash_map->capacity - 1)]);
     }
-    return 1;
+    pair *new_pair = pair_copy_ex (in_pair, hash_map->allocator);
+    if (new_pair == NULL) {return NULL;}
+    if (vector_emplace_back (temp_v, new_pair) == 0)
+    {
+        pair_free ((void **) &new_pair);
+        return NULL;
+    }
+    ++hash_map->size;
+    filter_add (hash_map, hashed_key);
+    if (inserted != NULL) {*inserted = 1;}
+    return new_pair;
 }
 
 /**
- * The function erases the pair associated with key.
+ * Returns the index of the bucket the given key belongs to.
  * @param hash_map a hash map.
- * @param key a key of the pair to be erased.
- * @return 1 if the erasing was done successfully, 0 otherwise. (if key not in map,
- * considered fail).
+ * @param key a key.
+ * @return the bucket index of the key.
+ */
+size_t get_bucket_index (const hashmap *hash_map, const_keyT key)
+{
+    return (hash_map->hash_func (key)) & (hash_map->capacity - 1);
+}
+
+/**
+ * Scans a bucket for the pair with the given key.
+ * @param hash_map the hash map the bucket belongs to (its lookups are counted).
+ * @param v a bucket of the hash map.
+ * @param key the key to look for.
+ * @return the index of the pair in the bucket, -1 if the key is not in it.
  */
-int update_elem_in_buckets (hashmap *hash_map, pair **pair_arr, int size)
+int find_in_bucket (const hashmap *hash_map, const vector *v, const_keyT key)
 {
-    if ((hash_map == NULL) || (pair_arr == NULL) || (size < 0)) {return 0;}
-    for (int i = 0; i < size; ++i)
+    int idx = scan_bucket (hash_map, v, key);
+    if (idx != -1)
     {
-        if (add_elem (hash_map, pair_arr[i]) == 0) {return 0;}
+        HASH_MAP_COUNT(hash_map, key_cmp_calls, (size_t) idx + 1);
+        HASH_MAP_COUNT(hash_map, lookup_hits, 1);
+        return idx;
     }
-    return 1;
+    HASH_MAP_COUNT(hash_map, key_cmp_calls, v->size);
+    HASH_MAP_COUNT(hash_map, lookup_misses, 1);
+    return -1;
 }
 
 /**
- * The function erases the pair associated with key.
+ * Finds the index of a key in a bucket, without counting it as a lookup.
+ * @param hash_map the hash map of the bucket.
+ * @param v a bucket.
+ * @param key the key to look for.
+ * @return the index of the pair in the bucket, -1 if the key is not in it.
+ */
+int scan_bucket (const hashmap *hash_map, const vector *v, const_keyT key)
+{
+    size_t key_size = hash_map->key_size;
+    for (size_t i = 0; i < v->size; ++i)
+    {
+        pair *p = v->data[i];
+        int equal = (key_size != 0) ? pod_keys_equal (p->key, key, key_size)
+                                    : p->key_cmp (p->key, key);
+        if (equal == 1) {return (int) i;}
+    }
+    return -1;
+}
+
+/**
+ * Moves the stored pair into its bucket, without copying it.
  * @param hash_map a hash map.
- * @param key a key of the pair to be erased.
- * @return 1 if the erasing was done successfully, 0 otherwise. (if key not in map,
- * considered fail).
+ * @param p a pair owned by the hash map.
+ * @return 1 if the pair was added successfully, 0 otherwise.
  */
 int add_elem (hashmap *hash_map, pair *p)
 {
-    //char c = *(char *) (p->key);
-    size_t hash_value = (hash_map->hash_func (p->key)) & (hash_map->capacity - 1);
-    //if ((hash_value < 0) || (hash_value >= (hash_map->capacity))) {return 0;}
-    vector *vector_in_bucket = (hash_map->buckets)[hash_value];
-    if ((vector_push_back(vector_in_bucket, p)) == 0) {return 0;}
+    vector *vector_in_bucket = &((hash_map->buckets)[get_bucket_index (hash_map, p->key)]);
+    if ((vector_emplace_back(vector_in_bucket, p)) == 0) {return 0;}
     return 1;
 }
 
 /**
- * The function erases the pair associated with key.
+ * Compares two plain data keys byte by byte. Keys of 1, 2, 4 or 8 bytes are
+ * compared as a single integer.
+ * @param key1, key2 - the keys.
+ * @param key_size the size of the keys in bytes.
+ * @return 1 if the keys are equal, 0 otherwise.
+ */
+int pod_keys_equal (const void *key1, const void *key2, size_t key_size)
+{
+    switch (key_size)
+    {
+        case sizeof(uint8_t):
+            return *(const uint8_t *) key1 == *(const uint8_t *) key2;
+        case sizeof(uint16_t):
+        {
+            uint16_t a, b;
+            memcpy (&a, key1, sizeof(a));
+            memcpy (&b, key2, sizeof(b));
+            return a == b;
+        }
+        case sizeof(uint32_t):
+        {
+            uint32_t a, b;
+            memcpy (&a, key1, sizeof(a));
+            memcpy (&b, key2, sizeof(b));
+            return a == b;
+        }
+        case sizeof(uint64_t):
+        {
+            uint64_t a, b;
+            memcpy (&a, key1, sizeof(a));
+            memcpy (&b, key2, sizeof(b));
+            return a == b;
+        }
+        default:
+            return memcmp (key1, key2, key_size) == 0;
+    }
+}
+
+/**
+ * Rebuilds the hash map with new_capacity buckets. The stored pairs are moved
+ * to their new buckets, not copied. On failure the hash map is left unchanged.
  * @param hash_map a hash map.
- * @param key a key of the pair to be erased.
- * @return 1 if the erasing was done successfully, 0 otherwise. (if key not in map,
- * considered fail).
+ * @param new_capacity the new number of buckets (a power of 2).
+ * @return 1 if the resize was done successfully, 0 otherwise.
  */
-int delete_old_vectors (hashmap *hash_map)
+int resize_buckets (hashmap *hash_map, size_t new_capacity)
 {
-    if (hash_map == NULL) {return 0;}
-    for (size_t i = 0; i < hash_map->capacity; ++i)
+    if ((hash_map == NULL) || (new_capacity == 0) ||
+        (new_capacity > SIZE_MAX / sizeof(vector)))
     {
-        vector_free(&((hash_map->buckets)[i]));
+        return 0;
     }
-    free(hash_map->buckets);
-    hash_map->buckets = NULL;
-    return 1;
+    // the pairs are moved to other buckets, so the shared ones are copied first
+    if (unshare_all (hash_map) == 0) {return 0;}
+    unsigned long long start = latency_start (hash_map);
+    vector *old_buckets = hash_map->buckets;
+    size_t old_capacity = hash_map->capacity;
+    hash_map->buckets = allocator_alloc (hash_map->allocator, sizeof(vector) * new_capacity);
+    if (hash_map->buckets == NULL)
+    {
+        hash_map->buckets = old_buckets;
+        return 0;
+    }
+    hash_map->capacity = new_capacity;
+    int success = create_new_vectors (hash_map);
+    for (size_t i = 0; (success == 1) && (i < old_capacity); ++i)
+    {
+        vector *v = &(old_buckets[i]);
+        for (size_t j = 0; (success == 1) && (j < v->size); ++j)
+        {
+            success = add_elem (hash_map, v->data[j]);
+        }
+    }
+
+    // the pairs now belong to one bucket array, detach them from the other one
+    vector *released = old_buckets;
+    size_t released_capacity = old_capacity;
+    if (success == 0)
+    {
+        released = hash_map->buckets;
+        released_capacity = hash_map->capacity;
+        hash_map->buckets = old_buckets;
+        hash_map->capacity = old_capacity;
+    }
+    if (success == 1)
+    {
+        if (new_capacity > old_capacity) {++(hash_map->counters.resizes_up);}
+        else {++(hash_map->counters.resizes_down);}
+    }
+    for (size_t i = 0; i < released_capacity; ++i)
+    {
+        released[i].size = 0;
+        vector_destroy (&(released[i]));
+    }
+    allocator_free (hash_map->allocator, released, sizeof(vector) * released_capacity);
+    if (success == 1)
+    {
+        // the filter is sized for the capacity, and forgets the erased keys on the way
+        hashmap_filter_rebuild (hash_map);
+    }
+    latency_stop (hash_map, HASH_MAP_OP_RESIZE, start, 0);
+    return success;
 }
 
 /**
- * The function erases the pair associated with key.
+ * Initializes an empty inline vector in every bucket of the hash map.
+ * The buckets need no allocation until they outgrow VECTOR_INLINE_CAP pairs.
  * @param hash_map a hash map.
- * @param key a key of the pair to be erased.
- * @return 1 if the erasing was done successfully, 0 otherwise. (if key not in map,
- * considered fail).
+ * @return 1 if all the vectors were initialized successfully, 0 otherwise.
  */
 int create_new_vectors (hashmap *hash_map)
 {
     if (hash_map == NULL) {return 0;}
+    int success = 1;
     for (size_t i = 0; i < hash_map->capacity; ++i)
     {
-        hash_map->buckets[i] = vector_alloc
-                (vec_copy_func, vec_cmp_func, vec_free_func);
-        if (hash_map->buckets[i] == NULL) {return 0;}
+        success &= vector_init_inline_ex (&(hash_map->buckets[i]), vec_copy_func,
+                                          vec_cmp_func, vec_free_func, hash_map->allocator);
     }
-    return 1;
+    return success;
 }
 
 /**
@@ -489,19 +729,36 @@ double hashmap_get_load_factor (const hashmap *hash_map)
  * @param hash_map a hashmap
  * @param keyT_func a function that checks a condition on keyT and return 1 if true, 0 else
  * @param valT_func a function that modifies valueT, in-place
- * @return number of changed values
+ * @return number of changed values, -1 if the function failed (a bucket shared with a
+ * snapshot could not be copied, the values of the buckets before it were changed).
  */
 int hashmap_apply_if (const hashmap *hash_map, keyT_func keyT_func, valueT_func valT_func)
 {
     if ((hash_map == NULL) || (keyT_func == NULL) || (valT_func == NULL)) {return -1;}
     int changes_counter = 0;
+    if (hash_map->resize != NULL)
+    {
+        // the thread of a background resize reads only the keys of the pairs
+        size_t bucket = 0, index = 0;
+        const pair *p = NULL;
+        while ((p = next_pair (hash_map, &bucket, &index)) != NULL)
+        {
+            if (keyT_func(p->key) == 1)
+            {
+                valT_func(p->value);
+                ++changes_counter;
+            }
+        }
+        return changes_counter;
+    }
     for (size_t i = 0; i < hash_map->capacity; ++i)
     {
-        vector *v = (hash_map->buckets)[i];
+        if (unshare_if (hash_map, i, keyT_func) == 0) {return -1;}
+        vector *v = &((hash_map->buckets)[i]);
         for (size_t j = 0; j < v->size; ++j)
         {
             pair *p = v->data[j];
-            if (keyT_func(p->key) == 1)
+            if ((pair_expired (hash_map, p) == 0) && (keyT_func(p->key) == 1))
             {
                 valT_func(p->value);
                 ++changes_counter;
@@ -510,3 +767,1580 @@ int hashmap_apply_if (const hashmap *hash_map, keyT_func keyT_func, valueT_func
     }
     return changes_counter;
 }
+
+/**
+ * Iterates the live pairs of the hash map, see hashmap.h.
+ * @param hash_map a hash map.
+ * @param bucket, index the position of the iteration.
+ * @return the next pair, NULL after the last one.
+ */
+const pair *hashmap_next (const hashmap *hash_map, size_t *bucket, size_t *index)
+{
+    if ((hash_map == NULL) || (bucket == NULL) || (index == NULL)) {return NULL;}
+    const pair *p = next_pair (hash_map, bucket, index);
+    while ((p != NULL) && (pair_expired (hash_map, p) == 1))
+    {
+        p = next_pair (hash_map, bucket, index);
+    }
+    return p;
+}
+
+/**
+ * This function erases all the pairs whose keys meet the condition of keyT_func.
+ * Each bucket is compacted in a single pass, and the hash map is minimized at most
+ * once, after all the pairs were erased.
+ * @param hash_map a hashmap
+ * @param keyT_func a function that checks a condition on keyT and return 1 if true, 0 else
+ * @return number of erased pairs, -1 if the function failed (a bucket shared with a
+ * snapshot could not be copied, the pairs of the buckets before it were erased).
+ */
+int hashmap_erase_if (hashmap *hash_map, keyT_func keyT_func)
+{
+    if ((hash_map == NULL) || (keyT_func == NULL) || (finish_resize (hash_map) == 0))
+    {
+        return -1;
+    }
+    int erased_counter = 0;
+    int success = 1;
+    for (size_t i = 0; i < hash_map->capacity; ++i)
+    {
+        if (unshare_if (hash_map, i, keyT_func) == 0)
+        {
+            success = 0;
+            break;
+        }
+        vector *v = &((hash_map->buckets)[i]);
+        size_t kept = 0;
+        for (size_t j = 0; j < v->size; ++j)
+        {
+            pair *p = v->data[j];
+            // an expired pair is left to its timer, like hashmap_erase does
+            if ((pair_expired (hash_map, p) == 0) && (keyT_func(p->key) == 1))
+            {
+                disarm_pair (hash_map, p);
+                v->elem_free_func(&(v->data[j]));
+                ++erased_counter;
+            }
+            else
+            {
+                v->data[kept] = p;
+                ++kept;
+            }
+        }
+        v->size = kept;
+    }
+    hash_map->size -= erased_counter;
+    size_t resizes = hash_map->counters.resizes_down;
+    minimize_buckets (hash_map);
+    // a minimization rebuilt the filter already
+    if (hash_map->counters.resizes_down == resizes)
+    {
+        filter_note_erased (hash_map, (size_t) erased_counter);
+    }
+    return (success == 1) ? erased_counter : -1;
+}
+
+/**
+ * Minimizes the hash map, in a single resize, as long as its load factor is
+ * at the minimum. A failed minimization leaves a valid (only sparser) hash map.
+ * @param hash_map a hash map.
+ */
+void minimize_buckets (hashmap *hash_map)
+{
+    size_t new_capacity = hash_map->capacity;
+    while ((new_capacity > 1) &&
+           ((double) hash_map->size / (double) new_capacity <= HASH_MAP_MIN_LOAD_FACTOR))
+    {
+        new_capacity /= HASH_MAP_GROWTH_FACTOR;
+    }
+    if (new_capacity != hash_map->capacity)
+    {
+        resize_buckets (hash_map, new_capacity);
+    }
+}
+
+/**
+ * Extends the hash map (if needed) so it can hold num_elements pairs without
+ * being extended again. The hash map is never minimized by this function.
+ * @param hash_map a hash map.
+ * @param num_elements the number of pairs the hash map should hold.
+ * @return 1 if the hash map can hold num_elements pairs, 0 otherwise.
+ */
+int hashmap_reserve (hashmap *hash_map, size_t num_elements)
+{
+    if ((hash_map == NULL) || (finish_resize (hash_map) == 0)) {return 0;}
+    size_t new_capacity = hash_map->capacity;
+    // the hash map is extended when an insertion finds it at the maximal load factor
+    while ((num_elements > 0) &&
+           ((double) (num_elements - 1) / (double) new_capacity >= HASH_MAP_MAX_LOAD_FACTOR))
+    {
+        // no number of buckets can hold that many pairs
+        if (new_capacity > SIZE_MAX / HASH_MAP_GROWTH_FACTOR) {return 0;}
+        new_capacity *= HASH_MAP_GROWTH_FACTOR;
+    }
+    if (new_capacity == hash_map->capacity) {return 1;}
+    return resize_buckets (hash_map, new_capacity);
+}
+
+/**
+ * Inserts copies of all the pairs of src to dst. dst is extended once,
+ * before any pair is inserted.
+ * @param dst the hash map to be inserted with the pairs of src.
+ * @param src the hash map to be merged, it is not changed.
+ * @param policy which value is kept for keys that are in both hash maps.
+ * @return number of pairs of src inserted to dst or replacing a value in it,
+ * -1 if the function failed.
+ */
+int hashmap_merge (hashmap *dst, const hashmap *src, hashmap_merge_policy policy)
+{
+    if ((dst == NULL) || (src == NULL) || (dst == src)) {return -1;}
+    if (hashmap_reserve (dst, dst->size + src->size) == 0) {return -1;}
+    int merged_counter = 0;
+    // src is only read, also while a background resize of it runs
+    size_t bucket = 0, index = 0;
+    const pair *p = NULL;
+    while ((p = next_pair (src, &bucket, &index)) != NULL)
+    {
+        if (pair_expired (src, p) == 1) {continue;}
+        int inserted = 0;
+        int success = 1;
+        pair *stored = find_or_insert_pair (dst, p, &inserted);
+        if (stored == NULL) {return -1;}
+        if (inserted == 1)
+        {
+            if (p->timer != NULL) {success = arm_pair (dst, stored, p->timer->expires);}
+            ++merged_counter;
+        }
+        else if (policy == HASH_MAP_KEEP_SRC)
+        {
+            replace_value (stored, p, &success);
+            ++merged_counter;
+        }
+        if (success == 0) {return -1;}
+    }
+    return merged_counter;
+}
+
+/**
+ * Moves all the pairs of *p_src to dst, without copying them, and frees *p_src.
+ * dst is extended once, before any pair is moved.
+ * The pairs of *p_src that are not kept (by the policy) are freed.
+ * @param dst the hash map to be inserted with the pairs of *p_src.
+ * @param p_src pointer to dynamically allocated pointer to the hash map to be consumed.
+ * @param policy which value is kept for keys that are in both hash maps.
+ * @return number of pairs of *p_src moved to dst, -1 if the function failed
+ * (in this case *p_src is not freed, but may have been partially moved).
+ */
+int hashmap_merge_move (hashmap *dst, hashmap **p_src, hashmap_merge_policy policy)
+{
+    if ((dst == NULL) || (p_src == NULL) || (*p_src == NULL) || (dst == *p_src)) {return -1;}
+    hashmap *src = *p_src;
+    if (finish_resize (src) == 0) {return -1;}
+    if (hashmap_reserve (dst, dst->size + src->size) == 0) {return -1;}
+    int moved_counter = 0;
+    for (size_t i = 0; i < src->capacity; ++i)
+    {
+        if (unshare_bucket (src, i) == 0) {return -1;}
+        vector *v = &((src->buckets)[i]);
+        while (v->size > 0)
+        {
+            pair *p = v->data[v->size - 1];
+            int expired = pair_expired (src, p);
+            int has_timer = (p->timer != NULL);
+            unsigned long long expires = has_timer ? p->timer->expires : 0;
+            disarm_pair (src, p);
+            int result = 0;
+            if (expired == 1)
+            {
+                pair_free ((void **) &p);
+            }
+            else
+            {
+                if (p->allocator != dst->allocator)
+                {
+                    // the pair is copied into the memory of dst, the original is freed
+                    pair *copy = pair_copy_ex (p, dst->allocator);
+                    if (copy == NULL) {return -1;}
+                    pair_free ((void **) &p);
+                    v->data[v->size - 1] = copy;
+                    p = copy;
+                }
+                result = move_pair (dst, p, policy);
+                if (result == -1) {return -1;}
+                if ((result == 1) && has_timer && (arm_pair (dst, p, expires) == 0))
+                {
+                    return -1;
+                }
+            }
+            --(v->size);
+            --(src->size);
+            moved_counter += result;
+        }
+    }
+    hashmap_free (p_src);
+    return moved_counter;
+}
+
+/**
+ * Creates a copy of the hash map with the same buckets: every pair is copied
+ * straight into the bucket it is stored in, without hashing its key again.
+ * @param hash_map the hash map to be copied.
+ * @return pointer to dynamically allocated hashmap, NULL if the function failed.
+ */
+hashmap *hashmap_clone (const hashmap *hash_map)
+{
+    if (hash_map == NULL) {return NULL;}
+    hashmap *h = (hashmap *) allocator_alloc (hash_map->allocator, sizeof(hashmap));
+    if (h == NULL) {return NULL;}
+    h->allocator = hash_map->allocator;
+    h->capacity = hash_map->capacity;
+    h->size = 0;
+    h->hash_func = hash_map->hash_func;
+    h->counters = (hashmap_counters) {0};
+    h->latency = NULL;
+    h->key_size = hash_map->key_size;
+    h->timers = NULL;
+    h->clock = hash_map->clock;
+    h->filter = NULL;
+    h->filter_erased = 0;
+    h->shares = NULL;
+    h->hard_load_factor = 0;
+    h->resize = NULL;
+    h->released = NULL;
+    h->released_capacity = 0;
+    h->released_left = 0;
+    h->buckets = (vector *) allocator_alloc (h->allocator, sizeof(vector) * h->capacity);
+    if (h->buckets == NULL)
+    {
+        allocator_free(h->allocator, h, sizeof(hashmap));
+        return NULL;
+    }
+    int success = create_new_vectors (h);
+    // a running background resize is only read: the side hash map hides some pairs
+    const hashmap *side = (hash_map->resize != NULL) ? hash_map->resize->side : NULL;
+    for (size_t i = 0; (success == 1) && (i < h->capacity); ++i)
+    {
+        vector *v = &((hash_map->buckets)[i]);
+        for (size_t j = 0; (success == 1) && (j < v->size); ++j)
+        {
+            pair *p = v->data[j];
+            if (side_holds (side, p->key) == 1) {continue;}
+            success = vector_push_back (&(h->buckets[i]), p);
+            h->size += success;
+            if ((success == 1) && (p->timer != NULL))
+            {
+                vector *bucket = &(h->buckets[i]);
+                success = arm_pair (h, bucket->data[bucket->size - 1], p->timer->expires);
+            }
+        }
+    }
+    for (size_t i = 0; (success == 1) && (side != NULL) && (i < side->capacity); ++i)
+    {
+        vector *v = &(side->buckets[i]);
+        for (size_t j = 0; (success == 1) && (j < v->size); ++j)
+        {
+            pair *p = v->data[j];
+            if (p->value != &hashmap_tombstone) {success = hashmap_insert (h, p);}
+        }
+    }
+    h->hard_load_factor = hash_map->hard_load_factor;
+    if ((success == 1) && (hash_map->filter != NULL))
+    {
+        success = hashmap_filter_enable (h, hash_map->filter->fp_rate,
+                                         hash_map->filter->max_bytes);
+    }
+    if (success == 0)
+    {
+        hashmap_free (&h);
+    }
+    return h;
+}
+
+/**
+ * Moves a pair (not a copy of it) into the hash map. If its key is already in
+ * the hash map, either the pair or the stored one is freed, by the policy.
+ * @param hash_map a hash map.
+ * @param p a dynamically allocated pair, owned by the caller.
+ * @param policy which pair is kept if the key is already in the hash map.
+ * @return 1 if the pair was moved into the hash map, 0 if it was freed,
+ * -1 if the function failed (the pair is still owned by the caller).
+ */
+int move_pair (hashmap *hash_map, pair *p, hashmap_merge_policy policy)
+{
+    size_t hashed_key = hash_map->hash_func (p->key);
+    if (unshare_bucket (hash_map, hashed_key & (hash_map->capacity - 1)) == 0) {return -1;}
+    vector *temp_v = &((hash_map->buckets)[hashed_key & (hash_map->capacity - 1)]);
+    int idx = find_in_bucket (hash_map, temp_v, p->key);
+    if (idx != -1)
+    {
+        if ((policy == HASH_MAP_KEEP_SRC) || (pair_expired (hash_map, temp_v->data[idx]) == 1))
+        {
+            disarm_pair (hash_map, temp_v->data[idx]);
+            temp_v->elem_free_func (&(temp_v->data[idx]));
+            temp_v->data[idx] = p;
+            return 1;
+        }
+        pair_free ((void **) &p);
+        return 0;
+    }
+    if (hashmap_get_load_factor (hash_map) >= HASH_MAP_MAX_LOAD_FACTOR)
+    {
+        if (resize_buckets (hash_map, hash_map->capacity * HASH_MAP_GROWTH_FACTOR) == 0)
+        {
+            return -1;
+        }
+        temp_v = &((hash_map->buckets)[hashed_key & (hash_map->capacity - 1)]);
+    }
+    if (vector_emplace_back (temp_v, p) == 0) {return -1;}
+    ++hash_map->size;
+    filter_add (hash_map, hashed_key);
+    return 1;
+}
+
+/**
+ * Fills out with the statistics of the hash map: the bucket length distribution,
+ * the memory the hash map allocated and its counters.
+ * @param hash_map a hash map.
+ * @param out the statistics to be filled.
+ * @return 1 if the statistics were filled successfully, 0 otherwise.
+ */
+int hashmap_stats (const hashmap *hash_map, hashmap_statistics *out)
+{
+    if ((hash_map == NULL) || (out == NULL)) {return 0;}
+    *out = (hashmap_statistics) {0};
+    out->size = hash_map->size;
+    out->capacity = hash_map->capacity;
+    out->load_factor = hashmap_get_load_factor (hash_map);
+    out->bucket_bytes = sizeof(vector) * hash_map->capacity;
+    size_t non_empty = 0;
+    size_t stored = 0;
+    const pair *first = NULL;
+    for (size_t i = 0; i < hash_map->capacity; ++i)
+    {
+        vector *v = &((hash_map->buckets)[i]);
+        if ((first == NULL) && (v->size > 0)) {first = v->data[0];}
+        stored += v->size;
+        size_t length = v->size;
+        if (length >= HASH_MAP_STATS_HISTOGRAM_SIZE)
+        {
+            length = HASH_MAP_STATS_HISTOGRAM_SIZE - 1;
+        }
+        ++(out->bucket_length_histogram[length]);
+        if (v->size > out->max_bucket_length) {out->max_bucket_length = v->size;}
+        if (v->size > 0) {++non_empty;}
+        if (v->data != v->inline_data)
+        {
+            out->vector_data_bytes += sizeof(void *) * v->capacity;
+        }
+    }
+    if (non_empty > 0)
+    {
+        out->mean_bucket_length = (double) stored / (double) non_empty;
+    }
+    if (hash_map->resize != NULL)
+    {
+        // the new bucket array, and the side hash map, of a running background resize
+        out->bucket_bytes += sizeof(vector) * hash_map->resize->capacity;
+        const hashmap *side = hash_map->resize->side;
+        if (side != NULL)
+        {
+            out->bucket_bytes += sizeof(vector) * side->capacity;
+            stored += side->size;
+        }
+    }
+    out->empty_bucket_ratio = (double) (hash_map->capacity - non_empty) /
+                              (double) hash_map->capacity;
+    out->pair_bytes = sizeof(pair) * stored;
+    out->filter_bytes = bloom_filter_bytes (hash_map->filter);
+    out->total_bytes = sizeof(hashmap) + out->bucket_bytes +
+                       out->vector_data_bytes + out->pair_bytes + out->filter_bytes;
+    out->bucket_backing = allocator_backing_of (hash_map->allocator, hash_map->buckets,
+                                                out->bucket_bytes);
+    out->pair_backing = allocator_backing_of (hash_map->allocator, first, sizeof(pair));
+    out->counters = hash_map->counters;
+    return 1;
+}
+
+/**
+ * Resets the counters of the hash map to 0.
+ * @param hash_map a hash map.
+ */
+void hashmap_reset_counters (hashmap *hash_map)
+{
+    if (hash_map == NULL) {return;}
+    hash_map->counters = (hashmap_counters) {0};
+}
+
+/**
+ * Starts measuring the latencies of the hash map operations.
+ * @param hash_map a hash map.
+ * @return 1 if the latencies are measured, 0 otherwise.
+ */
+int hashmap_latency_enable (hashmap *hash_map)
+{
+    if (hash_map == NULL) {return 0;}
+    if (hash_map->latency == NULL)
+    {
+        hash_map->latency = calloc (HASH_MAP_OPS, sizeof(latency_histogram));
+        if (hash_map->latency == NULL) {return 0;}
+    }
+    return 1;
+}
+
+/**
+ * Stops measuring the latencies of the hash map operations, and deletes
+ * the recorded latencies.
+ * @param hash_map a hash map.
+ */
+void hashmap_latency_disable (hashmap *hash_map)
+{
+    if (hash_map == NULL) {return;}
+    free (hash_map->latency);
+    hash_map->latency = NULL;
+}
+
+/**
+ * Returns the latency histogram of a hash map operation.
+ * @param hash_map a hash map.
+ * @param op the operation.
+ * @return the histogram of the operation, in nanoseconds, NULL if the latencies
+ * are not measured.
+ */
+const latency_histogram *hashmap_latency (const hashmap *hash_map, hashmap_op op)
+{
+    if ((hash_map == NULL) || (hash_map->latency == NULL) ||
+        (op < 0) || (op >= HASH_MAP_OPS))
+    {
+        return NULL;
+    }
+    return &(hash_map->latency[op]);
+}
+
+/**
+ * Prints a summary line of the latency histogram of every operation.
+ * @param hash_map a hash map.
+ * @param out the stream to print to.
+ */
+void hashmap_latency_print (const hashmap *hash_map, FILE *out)
+{
+    static const char *names[HASH_MAP_OPS] = {"insert", "at", "erase", "resize",
+                                              "insert+resize", "erase+resize"};
+    if ((hash_map == NULL) || (hash_map->latency == NULL) || (out == NULL)) {return;}
+    for (int op = 0; op < HASH_MAP_OPS; ++op)
+    {
+        latency_histogram_print (&(hash_map->latency[op]), names[op], out);
+    }
+}
+
+/**
+ * Reads the clock if the latencies of the hash map are measured.
+ * @param hash_map a hash map.
+ * @return the current time in nanoseconds, 0 if the latencies are not measured.
+ */
+unsigned long long latency_start (const hashmap *hash_map)
+{
+    if (hash_map->latency == NULL) {return 0;}
+    return latency_now_ns ();
+}
+
+/**
+ * Records the latency of an operation that started at start, if the latencies
+ * of the hash map are measured.
+ * @param hash_map a hash map.
+ * @param op the operation.
+ * @param start the value latency_start returned when the operation started.
+ * @param resized 1 if the operation resized the hash map (recorded under the
+ * "+resize" variant of insert and erase), 0 otherwise.
+ */
+void latency_stop (const hashmap *hash_map, hashmap_op op, unsigned long long start,
+                   int resized)
+{
+    if (hash_map->latency == NULL) {return;}
+    unsigned long long elapsed = latency_now_ns () - start;
+    if (resized && (op == HASH_MAP_OP_INSERT)) {op = HASH_MAP_OP_INSERT_RESIZE;}
+    if (resized && (op == HASH_MAP_OP_ERASE)) {op = HASH_MAP_OP_ERASE_RESIZE;}
+    latency_histogram_record (&(hash_map->latency[op]), elapsed);
+}
+
+/**
+ * Declares the keys of the hash map plain data of key_size bytes, compared
+ * byte by byte instead of by key_cmp.
+ * @param hash_map a hash map.
+ * @param key_size the size of the keys in bytes, 0 to compare them by key_cmp again.
+ * @return 1 if the key size was set successfully, 0 otherwise.
+ */
+int hashmap_set_key_size (hashmap *hash_map, size_t key_size)
+{
+    if (hash_map == NULL) {return 0;}
+    hash_map->key_size = key_size;
+    return 1;
+}
+
+/**
+ * Inserts a copy of in_pair that expires ttl clock units from now.
+ * @param hash_map the hash map to be inserted with new element.
+ * @param in_pair a pair the hash map would contain.
+ * @param ttl the time to live of the pair.
+ * @return 1 for successful insertion, 0 otherwise (also if the key is in the map).
+ */
+int hashmap_insert_ttl (hashmap *hash_map, const pair *in_pair, unsigned long long ttl)
+{
+    if (hash_map == NULL) {return 0;}
+    // a background resize cannot follow the expirations, from the first pair with a
+    // timer on the hash map is resized inline (see start_resize)
+    if (finish_resize (hash_map) == 0) {return 0;}
+    if (hash_map->timers == NULL)
+    {
+        hash_map->timers = timer_wheel_alloc (hash_map->clock ());
+        if (hash_map->timers == NULL) {return 0;}
+    }
+    int inserted = 0;
+    pair *p = find_or_insert_pair (hash_map, in_pair, &inserted);
+    if ((p == NULL) || (inserted == 0)) {return 0;}
+    if (arm_pair (hash_map, p, hash_map->clock () + ttl) == 0)
+    {
+        // the key is compared before the pair it belongs to is freed
+        erase_key (hash_map, p->key);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Reclaims the pairs that expired by the time now.
+ * @param hash_map a hash map.
+ * @param now the current time, by the clock of the hash map.
+ * @param budget the maximal number of pairs to reclaim, 0 for no limit.
+ * @return the number of pairs reclaimed.
+ */
+size_t hashmap_expire (hashmap *hash_map, unsigned long long now, size_t budget)
+{
+    if ((hash_map == NULL) || (hash_map->timers == NULL)) {return 0;}
+    // the timers of the pairs which could not be erased yet are not counted
+    size_t size = hash_map->size;
+    timer_wheel_advance (hash_map->timers, now, budget, expire_timer, hash_map);
+    size_t expired = size - hash_map->size;
+    if (expired > 0)
+    {
+        hash_map->counters.expirations += expired;
+        size_t resizes = hash_map->counters.resizes_down;
+        minimize_buckets (hash_map);
+        if (hash_map->counters.resizes_down == resizes)
+        {
+            filter_note_erased (hash_map, expired);
+        }
+    }
+    return expired;
+}
+
+/**
+ * Sets the clock the TTLs of the hash map are measured by.
+ * @param hash_map a hash map without expiring pairs.
+ * @param clock the clock.
+ * @return 1 if the clock was set successfully, 0 otherwise.
+ */
+int hashmap_set_clock (hashmap *hash_map, hashmap_clock_func clock)
+{
+    if ((hash_map == NULL) || (clock == NULL) || (hash_map->timers != NULL)) {return 0;}
+    hash_map->clock = clock;
+    return 1;
+}
+
+/**
+ * The default clock of the hash maps.
+ * @return the time of a monotonic clock in milliseconds.
+ */
+unsigned long long hashmap_clock_ms (void)
+{
+    return latency_now_ns () / 1000000ULL;
+}
+
+/**
+ * Sets an expiration timer for a pair stored in the hash map, creating the timer
+ * wheel of the hash map on first use.
+ * @param hash_map a hash map.
+ * @param p a pair stored in the hash map, without a timer.
+ * @param expires the time the pair expires at.
+ * @return 1 if the timer was set successfully, 0 otherwise.
+ */
+int arm_pair (hashmap *hash_map, pair *p, unsigned long long expires)
+{
+    if (hash_map->timers == NULL)
+    {
+        hash_map->timers = timer_wheel_alloc (hash_map->clock ());
+        if (hash_map->timers == NULL) {return 0;}
+    }
+    timer_node *node = (timer_node *) allocator_alloc (hash_map->allocator,
+                                                       sizeof(timer_node));
+    if (node == NULL) {return 0;}
+    node->expires = expires;
+    node->data = p;
+    timer_wheel_add (hash_map->timers, node);
+    p->timer = node;
+    return 1;
+}
+
+/**
+ * Removes the expiration timer of a pair, if it has one.
+ * @param hash_map the hash map the pair is stored in.
+ * @param p the pair.
+ */
+void disarm_pair (hashmap *hash_map, pair *p)
+{
+    if (p->timer == NULL) {return;}
+    timer_wheel_remove (hash_map->timers, p->timer);
+    allocator_free (hash_map->allocator, p->timer, sizeof(timer_node));
+    p->timer = NULL;
+}
+
+/**
+ * Checks whether a pair expired, by the clock of the hash map.
+ * @param hash_map the hash map the pair is stored in.
+ * @param p the pair.
+ * @return 1 if the pair has a timer which expired, 0 otherwise.
+ */
+int pair_expired (const hashmap *hash_map, const pair *p)
+{
+    return (p->timer != NULL) && (p->timer->expires <= hash_map->clock ());
+}
+
+/**
+ * Called by the timer wheel of the hash map with the timer of an expired pair:
+ * erases the pair, without minimizing the hash map.
+ * @param node the timer, already removed from the wheel.
+ * @param ctx the hash map.
+ */
+void expire_timer (timer_node *node, void *ctx)
+{
+    hashmap *hash_map = ctx;
+    size_t bucket = get_bucket_index (hash_map, ((pair *) node->data)->key);
+    // copying a shared bucket moves the timer to the copy of the pair
+    if (unshare_bucket (hash_map, bucket) == 0)
+    {
+        // out of memory, the pair stays expired (hidden from the lookups) and its
+        // timer is retried on the next tick
+        timer_wheel_defer (hash_map->timers, node);
+        return;
+    }
+    pair *p = node->data;
+    allocator_free (hash_map->allocator, node, sizeof(timer_node));
+    p->timer = NULL;
+    vector *v = &((hash_map->buckets)[bucket]);
+    for (size_t i = 0; i < v->size; ++i)
+    {
+        if (v->data[i] == p)
+        {
+            vector_erase_unordered (v, i);
+            --hash_map->size;
+            return;
+        }
+    }
+}
+
+/**
+ * Attaches a blocked Bloom filter of the keys to the hash map, sized for the
+ * pairs the hash map holds before it grows again.
+ * @param hash_map a hash map, an existing filter is replaced.
+ * @param fp_rate the false positive rate, between 0 and 1 (exclusive).
+ * @param max_bytes the maximal size of the filter, 0 for no limit.
+ * @return 1 if the filter was attached successfully, 0 otherwise.
+ */
+int hashmap_filter_enable (hashmap *hash_map, double fp_rate, size_t max_bytes)
+{
+    if ((hash_map == NULL) || (finish_resize (hash_map) == 0)) {return 0;}
+    size_t expected = (size_t) ((double) hash_map->capacity * HASH_MAP_MAX_LOAD_FACTOR) + 1;
+    if (hash_map->size > expected) {expected = hash_map->size;}
+    bloom_filter *filter = bloom_filter_alloc (expected, fp_rate, max_bytes);
+    if (filter == NULL) {return 0;}
+    for (size_t i = 0; i < hash_map->capacity; ++i)
+    {
+        vector *v = &((hash_map->buckets)[i]);
+        for (size_t j = 0; j < v->size; ++j)
+        {
+            pair *p = v->data[j];
+            bloom_filter_add (filter, hash_map->hash_func (p->key));
+        }
+    }
+    bloom_filter_free (&(hash_map->filter));
+    hash_map->filter = filter;
+    hash_map->filter_erased = 0;
+    return 1;
+}
+
+/**
+ * Detaches and frees the filter of the hash map.
+ * @param hash_map a hash map.
+ */
+void hashmap_filter_disable (hashmap *hash_map)
+{
+    if (hash_map == NULL) {return;}
+    bloom_filter_free (&(hash_map->filter));
+    hash_map->filter_erased = 0;
+}
+
+/**
+ * Rebuilds the filter of the hash map from its keys, for its current capacity,
+ * with the false positive rate and the size limit it was enabled with.
+ * @param hash_map a hash map.
+ * @return 1 if the filter was rebuilt (or there is none), 0 if it was dropped.
+ */
+int hashmap_filter_rebuild (hashmap *hash_map)
+{
+    if ((hash_map == NULL) || (hash_map->filter == NULL)) {return 1;}
+    if (hashmap_filter_enable (hash_map, hash_map->filter->fp_rate,
+                               hash_map->filter->max_bytes) == 1)
+    {
+        return 1;
+    }
+    // a filter missing keys would hide them, no filter only costs the bucket scans
+    hashmap_filter_disable (hash_map);
+    return 0;
+}
+
+/**
+ * Checks the filter of the hash map for a key, counting a negative answer
+ * as a lookup miss.
+ * @param hash_map a hash map.
+ * @param hashed_key the hash of the key.
+ * @return 1 if the key is surely not in the hash map, 0 otherwise (also if
+ * there is no filter).
+ */
+int filter_rejects (const hashmap *hash_map, size_t hashed_key)
+{
+    if ((hash_map->filter == NULL) ||
+        (bloom_filter_may_contain (hash_map->filter, hashed_key) == 1))
+    {
+        return 0;
+    }
+    HASH_MAP_COUNT(hash_map, filter_negatives, 1);
+    HASH_MAP_COUNT(hash_map, lookup_misses, 1);
+    return 1;
+}
+
+/**
+ * Adds the hash of an inserted key to the filter of the hash map, if it has one.
+ * @param hash_map a hash map.
+ * @param hashed_key the hash of the key.
+ */
+void filter_add (hashmap *hash_map, size_t hashed_key)
+{
+    if (hash_map->filter != NULL) {bloom_filter_add (hash_map->filter, hashed_key);}
+}
+
+/**
+ * Counts erased keys against the filter of the hash map, and rebuilds it once
+ * more than HASH_MAP_FILTER_MAX_STALE of its hashes belong to erased keys.
+ * @param hash_map a hash map.
+ * @param erased the number of keys just erased.
+ */
+void filter_note_erased (hashmap *hash_map, size_t erased)
+{
+    if (hash_map->filter == NULL) {return;}
+    hash_map->filter_erased += erased;
+    // a background resize publishes the filter its thread built
+    if ((hash_map->resize == NULL) &&
+        ((double) hash_map->filter_erased >
+         (double) hash_map->filter->items * HASH_MAP_FILTER_MAX_STALE))
+    {
+        hashmap_filter_rebuild (hash_map);
+    }
+}
+
+/**
+ * Copies a bucket the hash map shares with snapshots, with copies of its pairs, and
+ * drops the reference of the hash map to the shared one. The timers of the pairs
+ * are moved to the copies. Only the bucket array and the shares of the hash map are
+ * changed, which a const hash map (see hashmap_apply_if) points to as well.
+ * @param hash_map a hash map.
+ * @param bucket the index of the bucket.
+ * @return 1 if the hash map owns the bucket alone (it is not shared or was copied),
+ * 0 if the copy failed (the bucket is left shared).
+ */
+int unshare_bucket (const hashmap *hash_map, size_t bucket)
+{
+    if ((hash_map->shares == NULL) || (hash_map->shares[bucket] == NULL)) {return 1;}
+    size_t *refs = hash_map->shares[bucket];
+    vector *v = &((hash_map->buckets)[bucket]);
+    // only the snapshots release their references, so a count of 1 stays 1
+    if (__atomic_load_n (refs, __ATOMIC_ACQUIRE) == 1)
+    {
+        allocator_free (hash_map->allocator, refs, sizeof(size_t));
+        hash_map->shares[bucket] = NULL;
+        return 1;
+    }
+    vector copy;
+    if ((vector_init_inline_ex (&copy, vec_copy_func, vec_cmp_func, vec_free_func,
+                                hash_map->allocator) == 0) ||
+        (vector_reserve (&copy, v->size) == 0))
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < v->size; ++i)
+    {
+        pair *p = pair_copy_ex (v->data[i], hash_map->allocator);
+        if ((p == NULL) || (vector_emplace_back (&copy, p) == 0))
+        {
+            pair_free ((void **) &p);
+            vector_destroy (&copy);
+            return 0;
+        }
+    }
+    for (size_t i = 0; i < v->size; ++i)
+    {
+        pair *p = v->data[i];
+        if (p->timer == NULL) {continue;}
+        pair *new_pair = copy.data[i];
+        new_pair->timer = p->timer;
+        new_pair->timer->data = new_pair;
+        p->timer = NULL;
+    }
+    HASH_MAP_COUNT(hash_map, bucket_copies, 1);
+    release_bucket (v, refs, hash_map->allocator);
+    move_bucket (v, &copy);
+    hash_map->shares[bucket] = NULL;
+    return 1;
+}
+
+/**
+ * Copies a bucket the hash map shares with snapshots if any of its keys meets the
+ * condition of keyT_func, see unshare_bucket.
+ * @param hash_map a hash map.
+ * @param bucket the index of the bucket.
+ * @param keyT_func a function that checks a condition on keyT and return 1 if true, 0 else
+ * @return 1 on success, 0 if the copy failed.
+ */
+int unshare_if (const hashmap *hash_map, size_t bucket, keyT_func keyT_func)
+{
+    if ((hash_map->shares == NULL) || (hash_map->shares[bucket] == NULL)) {return 1;}
+    const vector *v = &((hash_map->buckets)[bucket]);
+    for (size_t i = 0; i < v->size; ++i)
+    {
+        if (keyT_func (((pair *) v->data[i])->key) == 1)
+        {
+            return unshare_bucket (hash_map, bucket);
+        }
+    }
+    return 1;
+}
+
+/**
+ * Copies all the buckets the hash map shares with snapshots, and frees its shares.
+ * @param hash_map a hash map.
+ * @return 1 on success, 0 if a copy failed (the buckets before it were copied).
+ */
+int unshare_all (hashmap *hash_map)
+{
+    if (hash_map->shares == NULL) {return 1;}
+    for (size_t i = 0; i < hash_map->capacity; ++i)
+    {
+        if (unshare_bucket (hash_map, i) == 0) {return 0;}
+    }
+    allocator_free (hash_map->allocator, hash_map->shares,
+                    sizeof(size_t *) * hash_map->capacity);
+    hash_map->shares = NULL;
+    return 1;
+}
+
+/**
+ * Drops a reference to a shared bucket. The last reference frees the bucket, with
+ * its pairs, and the reference count.
+ * @param v the bucket, as the hash map or the snapshot dropping it holds it.
+ * @param refs the reference count of the bucket.
+ * @param allocator the allocator of the hash map.
+ */
+void release_bucket (vector *v, size_t *refs, const allocator *allocator)
+{
+    if (__atomic_sub_fetch (refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        vector_destroy (v);
+        allocator_free (allocator, refs, sizeof(size_t));
+    }
+}
+
+/**
+ * Moves the struct of an inline vector (see vector_init_inline), which points into
+ * itself while its data is inline.
+ * @param dst the vector to be overwritten.
+ * @param src the vector to be moved, its elements now belong to dst too.
+ */
+void move_bucket (vector *dst, const vector *src)
+{
+    *dst = *src;
+    if (src->data == src->inline_data) {dst->data = dst->inline_data;}
+}
+
+/**
+ * Takes a consistent, read-only snapshot of the hash map in O(capacity), sharing
+ * its non empty buckets by reference counts.
+ * @param hash_map a hash map.
+ * @return pointer to dynamically allocated snapshot, NULL if the function failed.
+ */
+hashmap_view *hashmap_snapshot (hashmap *hash_map)
+{
+    if (hash_map == NULL) {return NULL;}
+    // a snapshot shares the buckets, which a background resize freezes
+    if (finish_resize (hash_map) == 0) {return NULL;}
+    const allocator *allocator = hash_map->allocator;
+    size_t capacity = hash_map->capacity;
+    if (hash_map->shares == NULL)
+    {
+        hash_map->shares = allocator_alloc (allocator, sizeof(size_t *) * capacity);
+        if (hash_map->shares == NULL) {return NULL;}
+        for (size_t i = 0; i < capacity; ++i) {hash_map->shares[i] = NULL;}
+    }
+    hashmap_view *view = allocator_alloc (allocator, sizeof(hashmap_view));
+    if (view == NULL) {return NULL;}
+    view->buckets = allocator_alloc (allocator, sizeof(vector) * capacity);
+    view->shares = allocator_alloc (allocator, sizeof(size_t *) * capacity);
+    view->size = hash_map->size;
+    view->capacity = capacity;
+    view->hash_func = hash_map->hash_func;
+    view->key_size = hash_map->key_size;
+    view->allocator = allocator;
+    if ((view->buckets == NULL) || (view->shares == NULL))
+    {
+        view_release (view, 0);
+        return NULL;
+    }
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        vector *v = &((hash_map->buckets)[i]);
+        view->shares[i] = NULL;
+        if (v->size == 0)
+        {
+            // an empty bucket may still have spilled data, which the hash map keeps
+            vector_init_inline_ex (&(view->buckets[i]), vec_copy_func, vec_cmp_func,
+                                   vec_free_func, allocator);
+            continue;
+        }
+        if (hash_map->shares[i] == NULL)
+        {
+            hash_map->shares[i] = allocator_alloc (allocator, sizeof(size_t));
+            if (hash_map->shares[i] == NULL)
+            {
+                view_release (view, i);
+                return NULL;
+            }
+            *(hash_map->shares[i]) = 1;
+        }
+        __atomic_add_fetch (hash_map->shares[i], 1, __ATOMIC_RELAXED);
+        view->shares[i] = hash_map->shares[i];
+        move_bucket (&(view->buckets[i]), v);
+    }
+    return view;
+}
+
+/**
+ * Frees a snapshot, and the buckets no hash map or other snapshot shares with it.
+ * @param p_view pointer to dynamically allocated pointer to snapshot.
+ */
+void hashmap_view_free (hashmap_view **p_view)
+{
+    if ((p_view == NULL) || (*p_view == NULL)) {return;}
+    view_release (*p_view, (*p_view)->capacity);
+    *p_view = NULL;
+}
+
+/**
+ * Releases the first buckets of a snapshot, and frees the snapshot.
+ * @param view a snapshot, its buckets and shares may be NULL.
+ * @param buckets the number of buckets of the snapshot which were filled.
+ */
+void view_release (hashmap_view *view, size_t buckets)
+{
+    for (size_t i = 0; i < buckets; ++i)
+    {
+        if (view->shares[i] == NULL)
+        {
+            vector_destroy (&(view->buckets[i]));
+        }
+        else
+        {
+            release_bucket (&(view->buckets[i]), view->shares[i], view->allocator);
+        }
+    }
+    allocator_free (view->allocator, view->buckets, sizeof(vector) * view->capacity);
+    allocator_free (view->allocator, view->shares, sizeof(size_t *) * view->capacity);
+    allocator_free (view->allocator, view, sizeof(hashmap_view));
+}
+
+/**
+ * The function returns the value associated with the given key in the snapshot.
+ * @param view a snapshot.
+ * @param key the key to be checked.
+ * @return the value associated with key when the snapshot was taken, NULL if
+ * there was none (the value itself, not a copy of it).
+ */
+valueT hashmap_view_at (const hashmap_view *view, const_keyT key)
+{
+    if ((view == NULL) || (key == NULL)) {return NULL;}
+    const vector *v = &((view->buckets)[view->hash_func (key) & (view->capacity - 1)]);
+    for (size_t i = 0; i < v->size; ++i)
+    {
+        pair *p = v->data[i];
+        int equal = (view->key_size != 0) ? pod_keys_equal (p->key, key, view->key_size)
+                                          : p->key_cmp (p->key, key);
+        if (equal == 1) {return p->value;}
+    }
+    return NULL;
+}
+
+/**
+ * Iterates the pairs of the snapshot, bucket by bucket.
+ * @param view a snapshot.
+ * @param bucket, index the position of the iteration, advanced past the returned pair.
+ * @return the next pair (not a copy of it), NULL after the last one.
+ */
+const pair *hashmap_view_next (const hashmap_view *view, size_t *bucket, size_t *index)
+{
+    if ((view == NULL) || (bucket == NULL) || (index == NULL)) {return NULL;}
+    while (*bucket < view->capacity)
+    {
+        const vector *v = &((view->buckets)[*bucket]);
+        if (*index < v->size) {return v->data[(*index)++];}
+        ++(*bucket);
+        *index = 0;
+    }
+    return NULL;
+}
+
+/**
+ * Waits for a running background resize, and copies the shared buckets.
+ * @param hash_map a hash map.
+ * @return 1 if the hash map owns all its buckets, 0 otherwise.
+ */
+int hashmap_unshare (hashmap *hash_map)
+{
+    if ((hash_map == NULL) || (finish_resize (hash_map) == 0)) {return 0;}
+    return unshare_all (hash_map);
+}
+
+/**
+ * Extends the hash map in a background thread from now on, see hashmap.h.
+ * @param hash_map a hash map, whose allocator does not release all its memory at once.
+ * @param hard_load_factor the load factor at which an insertion waits for the
+ * thread, 0 for HASH_MAP_HARD_LOAD_FACTOR.
+ * @return 1 on success, 0 otherwise.
+ */
+int hashmap_background_resize_enable (hashmap *hash_map, double hard_load_factor)
+{
+    if (hard_load_factor == 0) {hard_load_factor = HASH_MAP_HARD_LOAD_FACTOR;}
+    // the side hash map of an arena would never give back its pairs
+    if ((hash_map == NULL) || (hard_load_factor <= HASH_MAP_MAX_LOAD_FACTOR) ||
+        (allocator_releases_all (hash_map->allocator)))
+    {
+        return 0;
+    }
+    hash_map->hard_load_factor = hard_load_factor;
+    return 1;
+}
+
+/**
+ * Waits for a running background resize and resizes the hash map inline from now on.
+ * @param hash_map a hash map.
+ */
+void hashmap_background_resize_disable (hashmap *hash_map)
+{
+    if (hash_map == NULL) {return;}
+    if (finish_resize (hash_map) == 1) {hash_map->hard_load_factor = 0;}
+}
+
+/**
+ * Waits for the running background resize of the hash map, if any, and publishes
+ * its bucket array.
+ * @param hash_map a hash map.
+ * @return 1 if the hash map was extended (or no resize was running), 0 otherwise.
+ */
+int hashmap_resize_wait (hashmap *hash_map)
+{
+    if (hash_map == NULL) {return 0;}
+    size_t capacity = hash_map->capacity;
+    int running = (hash_map->resize != NULL);
+    if (finish_resize (hash_map) == 0) {return 0;}
+    return (running == 0) || (hash_map->capacity != capacity);
+}
+
+/**
+ * Starts extending the hash map in a background thread, if it is enabled, the hash
+ * map is large enough, and it has no snapshots or pairs inserted with a TTL: their
+ * buckets are changed by the operations a resize freezes.
+ * @param hash_map a hash map with no running resize.
+ * @param new_capacity the new number of buckets (a power of 2).
+ * @return 1 if the thread was started, 0 if the hash map should be resized inline.
+ */
+int start_resize (hashmap *hash_map, size_t new_capacity)
+{
+    if ((hash_map->hard_load_factor == 0) || (hash_map->shares != NULL) ||
+        (hash_map->timers != NULL) || (hash_map->capacity < HASH_MAP_BACKGROUND_MIN_CAP))
+    {
+        return 0;
+    }
+    hashmap_resize *resize = (hashmap_resize *) malloc (sizeof(hashmap_resize));
+    if (resize == NULL) {return 0;}
+    resize->old_buckets = hash_map->buckets;
+    resize->old_capacity = hash_map->capacity;
+    resize->buckets = NULL;
+    resize->capacity = new_capacity;
+    resize->hash_func = hash_map->hash_func;
+    resize->allocator = hash_map->allocator;
+    resize->fp_rate = (hash_map->filter != NULL) ? hash_map->filter->fp_rate : 0;
+    resize->max_bytes = (hash_map->filter != NULL) ? hash_map->filter->max_bytes : 0;
+    resize->filter = NULL;
+    resize->side = NULL;
+    resize->done = 0;
+    resize->joined = 0;
+    resize->success = 0;
+    if (pthread_create (&(resize->thread), NULL, resize_worker, resize) != 0)
+    {
+        free (resize);
+        return 0;
+    }
+    hash_map->resize = resize;
+    return 1;
+}
+
+/**
+ * The thread of a background resize: moves the pairs of the frozen bucket array to
+ * a new one, and adds their keys to a new filter if the hash map has one. Only the
+ * keys of the pairs are read, and nothing else is written.
+ * @param arg the resize.
+ * @return NULL.
+ */
+void *resize_worker (void *arg)
+{
+    hashmap_resize *resize = (hashmap_resize *) arg;
+    int success = 0;
+    resize->buckets = allocator_alloc (resize->allocator, sizeof(vector) * resize->capacity);
+    if (resize->buckets != NULL)
+    {
+        success = 1;
+        for (size_t i = 0; i < resize->capacity; ++i)
+        {
+            success &= vector_init_inline_ex (&(resize->buckets[i]), vec_copy_func,
+                                              vec_cmp_func, vec_free_func, resize->allocator);
+        }
+    }
+    if ((success == 1) && (resize->fp_rate != 0))
+    {
+        // sized as hashmap_filter_enable sizes it for the new capacity
+        size_t expected = (size_t) ((double) resize->capacity *
+                                    HASH_MAP_MAX_LOAD_FACTOR) + 1;
+        resize->filter = bloom_filter_alloc (expected, resize->fp_rate, resize->max_bytes);
+        success = (resize->filter != NULL);
+    }
+    for (size_t i = 0; (success == 1) && (i < resize->old_capacity); ++i)
+    {
+        const vector *v = &(resize->old_buckets[i]);
+        for (size_t j = 0; (success == 1) && (j < v->size); ++j)
+        {
+            pair *p = v->data[j];
+            size_t hashed_key = resize->hash_func (p->key);
+            vector *bucket = &(resize->buckets[hashed_key & (resize->capacity - 1)]);
+            success = vector_emplace_back (bucket, p);
+            if (resize->filter != NULL) {bloom_filter_add (resize->filter, hashed_key);}
+        }
+    }
+    resize->success = success;
+    __atomic_store_n (&(resize->done), 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/**
+ * Publishes the background resize of the hash map if its thread finished, and
+ * releases the next buckets of the bucket array the last one replaced.
+ * @param hash_map a hash map.
+ */
+void poll_resize (hashmap *hash_map)
+{
+    if ((hash_map->resize != NULL) &&
+        (__atomic_load_n (&(hash_map->resize->done), __ATOMIC_ACQUIRE) == 1))
+    {
+        // a resize which cannot be published yet keeps every pair, and is retried
+        finish_resize (hash_map);
+    }
+    release_buckets (hash_map, HASH_MAP_RELEASE_BUDGET);
+}
+
+/**
+ * Waits for the thread of the background resize of the hash map, if any, and
+ * publishes its bucket array and filter (or keeps the frozen ones if the thread
+ * failed). The pairs and tombstones of the side hash map are replayed into the
+ * published buckets first, and the other bucket array is left to release_buckets.
+ * @param hash_map a hash map.
+ * @return 1 if no resize is left running, 0 if the side hash map could not be
+ * replayed: the resize is left running, with all its pairs.
+ */
+int finish_resize (hashmap *hash_map)
+{
+    hashmap_resize *resize = hash_map->resize;
+    if (resize == NULL) {return 1;}
+    unsigned long long start = latency_start (hash_map);
+    if (resize->joined == 0)
+    {
+        pthread_join (resize->thread, NULL);
+        resize->joined = 1;
+    }
+    // the buckets the previous resize replaced are long released by now, as a rule
+    release_buckets (hash_map, SIZE_MAX);
+    size_t stale = 0;
+    if (resize->success == 1)
+    {
+        if (replay_side (hash_map, resize->buckets, resize->capacity, resize->filter,
+                         &stale) == 0)
+        {
+            return 0;
+        }
+        hash_map->released = hash_map->buckets;
+        hash_map->released_capacity = hash_map->capacity;
+        hash_map->buckets = resize->buckets;
+        hash_map->capacity = resize->capacity;
+        ++(hash_map->counters.resizes_up);
+        if (hash_map->filter != NULL)
+        {
+            // the new filter holds the keys the tombstones erased, and no others
+            bloom_filter_free (&(hash_map->filter));
+            hash_map->filter = resize->filter;
+            resize->filter = NULL;
+            hash_map->filter_erased = stale;
+        }
+    }
+    else
+    {
+        // the filter of the hash map got the keys of the side hash map already
+        if (replay_side (hash_map, hash_map->buckets, hash_map->capacity, NULL,
+                         &stale) == 0)
+        {
+            return 0;
+        }
+        hash_map->released = resize->buckets;
+        hash_map->released_capacity = (resize->buckets != NULL) ? resize->capacity : 0;
+    }
+    hash_map->released_left = hash_map->released_capacity;
+    bloom_filter_free (&(resize->filter));
+    hash_map->resize = NULL;
+    free (resize);
+    latency_stop (hash_map, HASH_MAP_OP_RESIZE, start, 0);
+    return 1;
+}
+
+/**
+ * Moves the pairs of the side hash map of the background resize of the hash map
+ * into a bucket array, replacing the pairs of their keys, and frees the side hash
+ * map. The tombstones erase the pairs of their keys. The pairs of the keys missing
+ * from the bucket array are appended first, so a failed append is undone and leaves
+ * the bucket array and the side hash map as they were.
+ * @param hash_map a hash map with a running resize.
+ * @param buckets, capacity - the bucket array.
+ * @param filter the filter the keys of the moved pairs are added to, NULL for none.
+ * @param stale set to the number of pairs of the bucket array the tombstones erased.
+ * @return 1 on success, 0 if a pair could not be appended (nothing was changed).
+ */
+int replay_side (hashmap *hash_map, vector *buckets, size_t capacity, bloom_filter *filter,
+                 size_t *stale)
+{
+    hashmap *side = hash_map->resize->side;
+    *stale = 0;
+    if (side == NULL) {return 1;}
+    for (size_t i = 0; i < side->capacity; ++i)
+    {
+        const vector *v = &(side->buckets[i]);
+        for (size_t j = 0; j < v->size; ++j)
+        {
+            pair *p = v->data[j];
+            if (p->value == &hashmap_tombstone) {continue;}
+            vector *bucket = &(buckets[hash_map->hash_func (p->key) & (capacity - 1)]);
+            if ((scan_bucket (hash_map, bucket, p->key) == -1) &&
+                (vector_emplace_back (bucket, p) == 0))
+            {
+                unappend_side (hash_map, buckets, capacity, i, j);
+                return 0;
+            }
+        }
+    }
+    // nothing below allocates
+    for (size_t i = 0; i < side->capacity; ++i)
+    {
+        vector *v = &(side->buckets[i]);
+        for (size_t j = 0; j < v->size; ++j)
+        {
+            pair *p = v->data[j];
+            size_t hashed_key = hash_map->hash_func (p->key);
+            vector *bucket = &(buckets[hashed_key & (capacity - 1)]);
+            int idx = scan_bucket (hash_map, bucket, p->key);
+            if (p->value == &hashmap_tombstone)
+            {
+                if (idx != -1)
+                {
+                    vector_erase_unordered (bucket, (size_t) idx);
+                    ++(*stale);
+                }
+                pair_free ((void **) &p);
+                continue;
+            }
+            if (filter != NULL) {bloom_filter_add (filter, hashed_key);}
+            if (bucket->data[idx] != p)
+            {
+                pair_free (&(bucket->data[idx]));
+                bucket->data[idx] = p;
+            }
+        }
+        v->size = 0;
+    }
+    hashmap_free (&(hash_map->resize->side));
+    return 1;
+}
+
+/**
+ * Undoes the appends of replay_side before a failed one: removes the pairs of the
+ * side hash map before the given position from the bucket array, without freeing them.
+ * @param hash_map a hash map with a running resize.
+ * @param buckets, capacity - the bucket array.
+ * @param bucket, index - the position in the side hash map of the failed append.
+ */
+void unappend_side (hashmap *hash_map, vector *buckets, size_t capacity, size_t bucket,
+                    size_t index)
+{
+    const hashmap *side = hash_map->resize->side;
+    for (size_t i = 0; i <= bucket; ++i)
+    {
+        const vector *v = &(side->buckets[i]);
+        for (size_t j = 0; j < ((i == bucket) ? index : v->size); ++j)
+        {
+            pair *p = v->data[j];
+            if (p->value == &hashmap_tombstone) {continue;}
+            vector *target = &(buckets[hash_map->hash_func (p->key) & (capacity - 1)]);
+            int idx = scan_bucket (hash_map, target, p->key);
+            if ((idx != -1) && (target->data[idx] == p))
+            {
+                // the order of the pairs in a bucket does not matter
+                target->data[idx] = target->data[target->size - 1];
+                --(target->size);
+            }
+        }
+    }
+}
+
+/**
+ * Drops the background resize of a hash map about to be freed, whose side hash map
+ * could not be replayed: the pairs of the frozen bucket array stay in the hash map,
+ * and those of the side hash map are freed with it.
+ * @param hash_map a hash map with a running resize, whose thread was joined.
+ */
+void drop_resize (hashmap *hash_map)
+{
+    hashmap_resize *resize = hash_map->resize;
+    for (size_t i = 0; (resize->buckets != NULL) && (i < resize->capacity); ++i)
+    {
+        resize->buckets[i].size = 0;
+        vector_destroy (&(resize->buckets[i]));
+    }
+    allocator_free (hash_map->allocator, resize->buckets, sizeof(vector) * resize->capacity);
+    bloom_filter_free (&(resize->filter));
+    hashmap_free (&(resize->side));
+    hash_map->resize = NULL;
+    free (resize);
+}
+
+/**
+ * Releases up to budget buckets of the bucket array the last background resize
+ * replaced (their pairs belong to the published bucket array), and the array itself
+ * with the last of them.
+ * @param hash_map a hash map.
+ * @param budget the maximal number of buckets to release.
+ */
+void release_buckets (hashmap *hash_map, size_t budget)
+{
+    if (hash_map->released == NULL) {return;}
+    for (; (budget > 0) && (hash_map->released_left > 0); --budget)
+    {
+        vector *v = &(hash_map->released[--(hash_map->released_left)]);
+        v->size = 0;
+        vector_destroy (v);
+    }
+    if (hash_map->released_left == 0)
+    {
+        allocator_free (hash_map->allocator, hash_map->released,
+                        sizeof(vector) * hash_map->released_capacity);
+        hash_map->released = NULL;
+        hash_map->released_capacity = 0;
+    }
+}
+
+/**
+ * Looks up a key while a background resize runs: in the side hash map first, then
+ * in the frozen bucket array.
+ * @param hash_map a hash map with a running resize.
+ * @param key the key to look for.
+ * @param hashed_key the hash of the key.
+ * @param in_side if not NULL, set to 1 if the pair is in the side hash map, 0 otherwise.
+ * @return the pair of the key (a tombstone if it was erased), NULL if there is none.
+ */
+pair *resize_find (const hashmap *hash_map, const_keyT key, size_t hashed_key,
+                   int *in_side)
+{
+    if (in_side != NULL) {*in_side = 1;}
+    const hashmap *side = hash_map->resize->side;
+    if (side != NULL)
+    {
+        const vector *v = &((side->buckets)[hashed_key & (side->capacity - 1)]);
+        int idx = find_in_bucket (side, v, key);
+        if (idx != -1) {return v->data[idx];}
+    }
+    if (in_side != NULL) {*in_side = 0;}
+    const vector *v = &((hash_map->buckets)[hashed_key & (hash_map->capacity - 1)]);
+    int idx = find_in_bucket (hash_map, v, key);
+    return (idx == -1) ? NULL : v->data[idx];
+}
+
+/**
+ * Finds the pair with the given key while a background resize runs, or inserts a
+ * copy of in_pair into the side hash map if there is none. The value of a pair of
+ * the frozen bucket array may be replaced in place, the thread reads only the keys.
+ * @param hash_map a hash map with a running resize.
+ * @param in_pair the pair to look up and insert.
+ * @param hashed_key the hash of the key of in_pair.
+ * @param inserted if not NULL, set to 1 if a new pair was inserted.
+ * @return the stored pair (not a copy of it), NULL on failure.
+ */
+pair *resize_insert (hashmap *hash_map, const pair *in_pair, size_t hashed_key,
+                     int *inserted)
+{
+    pair *p = NULL;
+    if (filter_rejects (hash_map, hashed_key) == 0)
+    {
+        p = resize_find (hash_map, in_pair->key, hashed_key, NULL);
+    }
+    if ((p != NULL) && (p->value != &hashmap_tombstone)) {return p;}
+    p = side_insert (hash_map->resize, in_pair, hashed_key);
+    if (p == NULL) {return NULL;}
+    ++hash_map->size;
+    filter_add (hash_map, hashed_key);
+    if (inserted != NULL) {*inserted = 1;}
+    return p;
+}
+
+/**
+ * Inserts a copy of in_pair into the side hash map of a background resize, which is
+ * allocated by the first insertion. The value of in_pair replaces a tombstone of
+ * its key.
+ * @param resize a running resize of a hash map.
+ * @param in_pair the pair to be inserted, whose key has no pair in the side hash map.
+ * @param hashed_key the hash of the key of in_pair.
+ * @return the stored pair (not a copy of it), NULL on failure.
+ */
+pair *side_insert (hashmap_resize *resize, const pair *in_pair, size_t hashed_key)
+{
+    if (resize->side == NULL)
+    {
+        resize->side = hashmap_alloc_ex (resize->hash_func, resize->allocator);
+        if (resize->side == NULL) {return NULL;}
+    }
+    int inserted = 0;
+    pair *p = probe_or_insert (resize->side, in_pair, hashed_key, &inserted);
+    if ((p != NULL) && (inserted == 0))
+    {
+        // the tombstone of an erased key becomes its pair again
+        int success = 1;
+        replace_value (p, in_pair, &success);
+        if (success == 0) {return NULL;}
+    }
+    return p;
+}
+
+/**
+ * Erases the pair associated with key while a background resize runs: its pair in
+ * the side hash map, or the pair of the frozen bucket array, becomes a tombstone.
+ * @param hash_map a hash map with a running resize.
+ * @param key a key of the pair to be erased.
+ * @return 1 if the erasing was done successfully, 0 otherwise.
+ */
+int resize_erase (hashmap *hash_map, const_keyT key)
+{
+    size_t hashed_key = hash_map->hash_func (key);
+    if (filter_rejects (hash_map, hashed_key) == 1) {return 0;}
+    int in_side = 0;
+    pair *p = resize_find (hash_map, key, hashed_key, &in_side);
+    if ((p == NULL) || (p->value == &hashmap_tombstone)) {return 0;}
+    if (in_side == 1)
+    {
+        // a pair of the frozen bucket array may still be hidden by it
+        p->value_free (&(p->value));
+        p->value = &hashmap_tombstone;
+        p->value_cpy = tombstone_cpy;
+        p->value_free = tombstone_free;
+    }
+    else
+    {
+        pair tombstone = {(keyT) key, &hashmap_tombstone, p->key_cpy, tombstone_cpy,
+                          p->key_cmp, p->value_cmp, p->key_free, tombstone_free,
+                          NULL, NULL};
+        if (side_insert (hash_map->resize, &tombstone, hashed_key) == NULL) {return 0;}
+    }
+    --hash_map->size;
+    filter_note_erased (hash_map, 1);
+    return 1;
+}
+
+/**
+ * The value_cpy of the tombstones: the tombstone value is never copied.
+ */
+valueT tombstone_cpy (const_valueT value)
+{
+    (void) value;
+    return &hashmap_tombstone;
+}
+
+/**
+ * The value_free of the tombstones: the tombstone value is static.
+ */
+void tombstone_free (valueT *value)
+{
+    *value = NULL;
+}
+
+/**
+ * Checks whether the side hash map of a background resize has a pair (or a tombstone)
+ * of a key, which then hides the pair of the key in the frozen bucket array.
+ * @param side the side hash map, NULL if there is none.
+ * @param key a key.
+ * @return 1 if it does, 0 otherwise.
+ */
+int side_holds (const hashmap *side, const_keyT key)
+{
+    if (side == NULL) {return 0;}
+    const vector *v = &((side->buckets)[side->hash_func (key) & (side->capacity - 1)]);
+    return scan_bucket (side, v, key) != -1;
+}
+
+/**
+ * Iterates the pairs of the hash map, bucket by bucket, without writing anything.
+ * While a background resize runs, the pairs of the frozen bucket array which the side
+ * hash map hides are skipped, and the pairs of the side hash map (other than the
+ * tombstones) follow, at the buckets after the last one of the hash map.
+ * @param hash_map a hash map.
+ * @param bucket, index the position of the iteration, advanced past the returned pair.
+ * @return the next pair (not a copy of it), NULL after the last one.
+ */
+const pair *next_pair (const hashmap *hash_map, size_t *bucket, size_t *index)
+{
+    const hashmap *side = (hash_map->resize != NULL) ? hash_map->resize->side : NULL;
+    size_t buckets = hash_map->capacity + ((side != NULL) ? side->capacity : 0);
+    while (*bucket < buckets)
+    {
+        int in_side = (*bucket >= hash_map->capacity);
+        const vector *v = (in_side == 1) ? &((side->buckets)[*bucket - hash_map->capacity])
+                                         : &((hash_map->buckets)[*bucket]);
+        while (*index < v->size)
+        {
+            const pair *p = v->data[(*index)++];
+            if ((in_side == 1) ? (p->value != &hashmap_tombstone)
+                               : (side_holds (side, p->key) == 0))
+            {
+                return p;
+            }
+        }
+        ++(*bucket);
+        *index = 0;
+    }
+    return NULL;
+}
@@ -2,8 +2,12 @@
 #define HASHMAP_H_
 
 #include <stdlib.h>
+#include <pthread.h>
 #include "vector.h"
 #include "pair.h"
+#include "latency_histogram.h"
+#include "timer_wheel.h"
+#include "bloom_filter.h"
 
 /**
  * @def HASH_MAP_INITIAL_CAP
@@ -41,6 +45,60 @@
  */
 #define HASH_MAP_MAX_LOAD_FACTOR 0.75
 
+/**
+ * @def HASH_MAP_COUNTERS
+ * When 1, the hash map counts its lookups and key comparisons (see hashmap_stats).
+ * The lookups then write to the hash map, with relaxed atomic additions so that
+ * concurrent readers stay safe. 0 by default: the lookup path only reads the hash
+ * map. Resizes are always counted.
+ */
+#ifndef HASH_MAP_COUNTERS
+#define HASH_MAP_COUNTERS 0
+#endif
+
+/**
+ * @def HASH_MAP_STATS_HISTOGRAM_SIZE
+ * The number of entries in the bucket length histogram of hashmap_statistics.
+ * The last entry counts all the buckets at least that long.
+ */
+#define HASH_MAP_STATS_HISTOGRAM_SIZE 8UL
+
+/**
+ * @def HASH_MAP_EXPIRE_BUDGET
+ * The number of expired pairs every insertion to a hash map with expiring pairs
+ * reclaims on its way (see hashmap_insert_ttl).
+ */
+#define HASH_MAP_EXPIRE_BUDGET 4UL
+
+/**
+ * @def HASH_MAP_FILTER_MAX_STALE
+ * The fraction of the hashes in the filter of a hash map (see hashmap_filter_enable)
+ * that may belong to erased keys before the filter is rebuilt: a Bloom filter
+ * cannot forget a key, so erased keys only raise its false positive rate.
+ */
+#define HASH_MAP_FILTER_MAX_STALE 0.5
+
+/**
+ * @def HASH_MAP_HARD_LOAD_FACTOR
+ * The default load factor at which an insertion waits for the background resize of
+ * the hash map instead of going on without it (see hashmap_background_resize_enable).
+ */
+#define HASH_MAP_HARD_LOAD_FACTOR 2.0
+
+/**
+ * @def HASH_MAP_BACKGROUND_MIN_CAP
+ * A hash map of fewer buckets is extended inline even if its background resize is
+ * enabled: starting a thread costs about as much as rehashing it.
+ */
+#define HASH_MAP_BACKGROUND_MIN_CAP 8192UL
+
+/**
+ * @def HASH_MAP_RELEASE_BUDGET
+ * The number of buckets of the bucket array a background resize replaced that every
+ * insertion and erasure releases on its way, so no single one of them walks it all.
+ */
+#define HASH_MAP_RELEASE_BUDGET 64UL
+
 /**
  * @typedef hash_func
  * This type of function receives a keyT and returns
@@ -64,20 +122,208 @@ typedef int (*keyT_func) (const_keyT);
  */
 typedef void (*valueT_func) (valueT);
 
+/**
+ * @typedef hashmap_clock_func
+ * A function that returns the current time, in the units of the TTLs of the
+ * hash map (see hashmap_set_clock).
+ */
+typedef unsigned long long (*hashmap_clock_func) (void);
+
+/**
+ * @enum hashmap_merge_policy
+ * Decides which value is kept when a key of the merged hash map is already
+ * in the destination hash map.
+ * @param HASH_MAP_KEEP_DST the destination keeps its own value.
+ * @param HASH_MAP_KEEP_SRC the value of the merged hash map replaces it.
+ */
+typedef enum hashmap_merge_policy {
+    HASH_MAP_KEEP_DST,
+    HASH_MAP_KEEP_SRC
+} hashmap_merge_policy;
+
+/**
+ * @enum hashmap_op
+ * The hash map operations whose latencies are measured (see hashmap_latency_enable).
+ * Insertions (hashmap_insert, hashmap_find_or_insert, hashmap_upsert) and erasures
+ * that resized the hash map are recorded separately, under the "_RESIZE" variants.
+ */
+typedef enum hashmap_op {
+    HASH_MAP_OP_INSERT,
+    HASH_MAP_OP_AT,
+    HASH_MAP_OP_ERASE,
+    HASH_MAP_OP_RESIZE,
+    HASH_MAP_OP_INSERT_RESIZE,
+    HASH_MAP_OP_ERASE_RESIZE,
+    HASH_MAP_OPS
+} hashmap_op;
+
+/**
+ * @struct hashmap_counters
+ * @param resizes_up the number of times the hash map was extended.
+ * @param resizes_down the number of times the hash map was minimized.
+ * @param lookup_hits the number of key lookups that found the key.
+ * @param lookup_misses the number of key lookups that did not find the key.
+ * @param key_cmp_calls the number of key_cmp calls made by key lookups.
+ * @param expirations the number of expired pairs reclaimed.
+ * @param filter_negatives the number of key lookups the filter answered, without
+ * scanning a bucket (they are counted as misses too).
+ * @param bucket_copies the number of buckets shared with a snapshot that a write
+ * copied (see hashmap_snapshot).
+ */
+typedef struct hashmap_counters {
+    size_t resizes_up;
+    size_t resizes_down;
+    size_t lookup_hits;
+    size_t lookup_misses;
+    size_t key_cmp_calls;
+    size_t expirations;
+    size_t filter_negatives;
+    size_t bucket_copies;
+} hashmap_counters;
+
+/**
+ * @struct hashmap_resize - an extension of a hash map running in a background thread.
+ * The bucket array of the hash map is frozen while it runs: the thread moves its
+ * pairs to a new bucket array, the pairs inserted in the meantime go to a side hash
+ * map, the erased ones get a tombstone in it, and the values are replaced in place.
+ * @param thread the thread building the new bucket array.
+ * @param old_buckets, old_capacity - the frozen bucket array.
+ * @param buckets, capacity - the new bucket array.
+ * @param hash_func, allocator - as in the hash map.
+ * @param fp_rate, max_bytes - as in the filter of the hash map, fp_rate is 0 if it
+ * has none.
+ * @param filter the filter of the keys of the new bucket array, built by the thread.
+ * @param side the pairs inserted and the tombstones of the keys erased since the
+ * resize started, NULL until the first of them.
+ * @param done set by the thread when it finished.
+ * @param joined 1 once the thread was joined.
+ * @param success 1 if the thread built the new bucket array (and filter), 0 otherwise.
+ */
+typedef struct hashmap_resize {
+    pthread_t thread;
+    vector *old_buckets;
+    size_t old_capacity;
+    vector *buckets;
+    size_t capacity;
+    hash_func hash_func;
+    const allocator *allocator;
+    double fp_rate;
+    size_t max_bytes;
+    bloom_filter *filter;
+    struct hashmap *side;
+    int done;
+    int joined;
+    int success;
+} hashmap_resize;
+
 /**
  * @struct hashmap
- * @param buckets dynamic array of vectors which stores the values.
+ * @param buckets dynamic array of inline vectors (see vector_init_inline) which
+ * stores the values, so a bucket of up to VECTOR_INLINE_CAP pairs needs no allocation.
  * @param size the number of elements (pairs) stored in the hash map.
  * @param capacity the number of buckets in the hash map.
  * @param hash_func a function which "hashes" keys.
+ * @param counters counts of the resizes and lookups done by the hash map.
+ * @param latency latency histogram of every hashmap_op, NULL if the latencies
+ * are not measured.
+ * @param key_size the size of the keys in bytes when they are compared as plain
+ * data (see hashmap_set_key_size), 0 when they are compared by the pairs' key_cmp.
+ * @param timers the expiration timers of the pairs inserted with a TTL, NULL until
+ * the first one is.
+ * @param clock the clock the TTLs are measured by.
+ * @param filter the membership filter of the keys, NULL if there is none.
+ * @param filter_erased the number of keys erased since the filter was built.
+ * @param allocator the allocator of the struct, the bucket array and its vectors, the
+ * pairs and their timers, NULL for malloc (see hashmap_alloc_ex).
+ * @param shares the reference count of every bucket the hash map shares with its
+ * snapshots, NULL for the buckets it owns alone. NULL until the first snapshot, and
+ * after a resize.
+ * @param hard_load_factor the load factor at which an insertion waits for a
+ * background resize, 0 if the hash map is resized inline.
+ * @param resize the running background resize, NULL if there is none.
+ * @param released the bucket array the last background resize replaced, whose
+ * buckets are released HASH_MAP_RELEASE_BUDGET at a time, NULL once they all were.
+ * @param released_capacity, released_left - its number of buckets, and the number
+ * of them not released yet.
  */
 typedef struct hashmap {
-    vector **buckets;
+    vector *buckets;
     size_t size;
     size_t capacity; // num of buckets
     hash_func hash_func;
+    hashmap_counters counters;
+    latency_histogram *latency;
+    size_t key_size;
+    timer_wheel *timers;
+    hashmap_clock_func clock;
+    bloom_filter *filter;
+    size_t filter_erased;
+    const allocator *allocator;
+    size_t **shares;
+    double hard_load_factor;
+    struct hashmap_resize *resize;
+    vector *released;
+    size_t released_capacity;
+    size_t released_left;
 } hashmap;
 
+/**
+ * @struct hashmap_view - a read-only snapshot of a hash map (see hashmap_snapshot).
+ * @param buckets the buckets of the hash map when the snapshot was taken, their
+ * pairs (and spilled data arrays) shared with the hash map and the other snapshots.
+ * @param shares the reference count of every non empty bucket, NULL for the empty ones.
+ * @param size, capacity, hash_func, key_size - as in the hash map.
+ * @param allocator the allocator of the hash map.
+ */
+typedef struct hashmap_view {
+    vector *buckets;
+    size_t **shares;
+    size_t size;
+    size_t capacity;
+    hash_func hash_func;
+    size_t key_size;
+    const allocator *allocator;
+} hashmap_view;
+
+/**
+ * @struct hashmap_statistics
+ * @param size, capacity, load_factor - as in the hash map.
+ * @param bucket_length_histogram entry i is the number of buckets holding i pairs,
+ * the last entry is the number of buckets holding at least that many.
+ * @param max_bucket_length the number of pairs in the longest bucket.
+ * @param mean_bucket_length the mean number of pairs in the non-empty buckets.
+ * @param empty_bucket_ratio the fraction of the buckets that hold no pairs.
+ * @param bucket_bytes bytes allocated for the bucket array and its vector structs.
+ * @param vector_data_bytes bytes allocated for the data arrays of the vectors
+ * that outgrew their inline storage.
+ * @param pair_bytes bytes allocated for the pair structs (keys and values are
+ * allocated by the pairs' copy functions and are not counted).
+ * @param filter_bytes bytes of the blocks of the filter, 0 if there is none.
+ * @param total_bytes the sum of all the bytes above and of the hashmap struct.
+ * @param bucket_backing the pages the allocator obtained for the bucket array (see
+ * page_pool).
+ * @param pair_backing the pages the allocator obtained for the first pair stored,
+ * ALLOCATOR_BACKING_HEAP if there is none.
+ * @param counters the counters of the hash map.
+ */
+typedef struct hashmap_statistics {
+    size_t size;
+    size_t capacity;
+    double load_factor;
+    size_t bucket_length_histogram[HASH_MAP_STATS_HISTOGRAM_SIZE];
+    size_t max_bucket_length;
+    double mean_bucket_length;
+    double empty_bucket_ratio;
+    size_t bucket_bytes;
+    size_t vector_data_bytes;
+    size_t pair_bytes;
+    size_t filter_bytes;
+    size_t total_bytes;
+    allocator_backing bucket_backing;
+    allocator_backing pair_backing;
+    hashmap_counters counters;
+} hashmap_statistics;
+
 /**
  * Allocates dynamically new hash map element.
  * @param func a function which "hashes" keys.
@@ -86,6 +332,22 @@ typedef struct hashmap {
  */
 hashmap *hashmap_alloc (hash_func func);
 
+/**
+ * Allocates dynamically new hash map element, whose struct, bucket array, pairs and
+ * timers are allocated with the given allocator (the keys and values are still
+ * allocated by the copy functions of the pairs). The filter, the timer wheel and the
+ * latency histograms are allocated with malloc.
+ * If the allocator releases all its memory at once (its free is NULL, e.g. an
+ * arena), hashmap_free is O(1): it frees neither the pairs nor their keys and
+ * values, so these should need no freeing beyond the arena.
+ * @param func a function which "hashes" keys.
+ * @param allocator the allocator of the hash map, NULL for malloc. It must outlive
+ * the hash map.
+ * @return pointer to dynamically allocated hashmap.
+ * @if_fail return NULL.
+ */
+hashmap *hashmap_alloc_ex (hash_func func, const allocator *allocator);
+
 /**
  * Frees a hash map and the elements the hash map itself allocated.
  * @param p_hash_map pointer to dynamically allocated pointer to hash_map.
@@ -102,6 +364,44 @@ void hashmap_free (hashmap **p_hash_map);
  */
 int hashmap_insert (hashmap *hash_map, const pair *in_pair);
 
+/**
+ * Looks up the key of in_pair and inserts a copy of in_pair if the key is missing,
+ * hashing the key once and scanning its bucket once.
+ * Example: counting with int values, (*(int *) *hashmap_find_or_insert(map, p, NULL))++;
+ * where p holds the key and the initial count 0.
+ * @param hash_map a hash map.
+ * @param in_pair the pair whose key is looked up, its value is the initial value
+ * stored if the key is missing.
+ * @param inserted if not NULL, set to 1 if a new pair was inserted, 0 otherwise.
+ * @return pointer to the stored value slot of the key (valid until the key is erased),
+ * NULL on failure.
+ */
+valueT *hashmap_find_or_insert (hashmap *hash_map, const pair *in_pair, int *inserted);
+
+/**
+ * Same as hashmap_find_or_insert, for a caller which already hashed the key
+ * (e.g. to prefetch its bucket ahead of a batch).
+ * @param hash_map a hash map.
+ * @param in_pair the pair whose key is looked up, its value is the initial value
+ * stored if the key is missing.
+ * @param hashed_key the hash function of the map applied to the key of in_pair,
+ * a different value breaks the hash map.
+ * @param inserted if not NULL, set to 1 if a new pair was inserted, 0 otherwise.
+ * @return pointer to the stored value slot of the key (valid until the key is erased),
+ * NULL on failure.
+ */
+valueT *hashmap_find_or_insert_hashed (hashmap *hash_map, const pair *in_pair,
+                                       size_t hashed_key, int *inserted);
+
+/**
+ * Inserts a copy of in_pair, or replaces in place the value of the stored pair
+ * with the same key (the old value is freed).
+ * @param hash_map a hash map.
+ * @param in_pair the pair to be inserted or whose value replaces the stored one.
+ * @return 1 if the pair was inserted or its value replaced, 0 otherwise.
+ */
+int hashmap_upsert (hashmap *hash_map, const pair *in_pair);
+
 /**
  * The function returns the value associated with the given key.
  * @param hash_map a hash map.
@@ -127,6 +427,18 @@ int hashmap_erase (hashmap *hash_map, const_keyT key);
  */
 double hashmap_get_load_factor (const hashmap *hash_map);
 
+/**
+ * Iterates the pairs of the hash map without changing it, skipping the expired ones.
+ * A running background resize is read as it is. The hash map must not be changed
+ * during the iteration. Start with *bucket = *index = 0, and call until NULL is returned.
+ * Example: size_t bucket = 0, index = 0; const pair *p;
+ *          while ((p = hashmap_next (map, &bucket, &index)) != NULL) {...}
+ * @param hash_map a hash map.
+ * @param bucket, index the position of the iteration, advanced past the returned pair.
+ * @return the next pair (not a copy of it), NULL after the last one.
+ */
+const pair *hashmap_next (const hashmap *hash_map, size_t *bucket, size_t *index);
+
 /**
  * This function receives a hashmap and 2 functions, the first checks a condition on the keys,
  * and the seconds apply some modification on the values. The function should apply the modification
@@ -141,4 +453,285 @@ double hashmap_get_load_factor (const hashmap *hash_map);
  * @return number of changed values
  */
 int hashmap_apply_if (const hashmap *hash_map, keyT_func keyT_func, valueT_func valT_func);//const
+
+/**
+ * This function erases all the pairs whose keys meet the condition of keyT_func.
+ * Each bucket is compacted in a single pass, and the hash map is minimized at most
+ * once, after all the pairs were erased. The expired pairs are neither checked nor
+ * erased, they are reclaimed by hashmap_expire.
+ *
+ * Example: if the hashmap maps char->int and keyT_func checks if the char is a digit,
+ * hashmap_erase_if will change the map: {('1',2),('#',3),('7',5)}, to: {('#',3)},
+ * and the return value will be 2.
+ * @param hash_map a hashmap
+ * @param keyT_func a function that checks a condition on keyT and return 1 if true, 0 else
+ * @return number of erased pairs, -1 if the function failed.
+ */
+int hashmap_erase_if (hashmap *hash_map, keyT_func keyT_func);
+
+/**
+ * Extends the hash map (if needed) so it can hold num_elements pairs without
+ * being extended again. The hash map is never minimized by this function.
+ * @param hash_map a hash map.
+ * @param num_elements the number of pairs the hash map should hold.
+ * @return 1 if the hash map can hold num_elements pairs, 0 otherwise.
+ */
+int hashmap_reserve (hashmap *hash_map, size_t num_elements);
+
+/**
+ * Inserts copies of all the pairs of src to dst. dst is extended once,
+ * before any pair is inserted.
+ * @param dst the hash map to be inserted with the pairs of src.
+ * @param src the hash map to be merged, it is not changed.
+ * @param policy which value is kept for keys that are in both hash maps.
+ * @return number of pairs of src inserted to dst or replacing a value in it,
+ * -1 if the function failed.
+ */
+int hashmap_merge (hashmap *dst, const hashmap *src, hashmap_merge_policy policy);
+
+/**
+ * Moves all the pairs of *p_src to dst, without copying them, and frees *p_src.
+ * dst is extended once, before any pair is moved.
+ * The pairs of *p_src that are not kept (by the policy) are freed.
+ * @param dst the hash map to be inserted with the pairs of *p_src.
+ * @param p_src pointer to dynamically allocated pointer to the hash map to be consumed.
+ * @param policy which value is kept for keys that are in both hash maps.
+ * @return number of pairs of *p_src moved to dst, -1 if the function failed
+ * (in this case *p_src is not freed, but may have been partially moved).
+ */
+int hashmap_merge_move (hashmap *dst, hashmap **p_src, hashmap_merge_policy policy);
+
+/**
+ * Creates a copy of the hash map with the same buckets: every pair is copied
+ * straight into the bucket it is stored in, without hashing its key again.
+ * @param hash_map the hash map to be copied.
+ * @return pointer to dynamically allocated hashmap, NULL if the function failed.
+ */
+hashmap *hashmap_clone (const hashmap *hash_map);
+
+/**
+ * Fills out with the statistics of the hash map: the bucket length distribution,
+ * the memory the hash map allocated and its counters.
+ * @param hash_map a hash map.
+ * @param out the statistics to be filled.
+ * @return 1 if the statistics were filled successfully, 0 otherwise.
+ */
+int hashmap_stats (const hashmap *hash_map, hashmap_statistics *out);
+
+/**
+ * Resets the counters of the hash map to 0.
+ * @param hash_map a hash map.
+ */
+void hashmap_reset_counters (hashmap *hash_map);
+
+/**
+ * Starts measuring the latencies of the hash map operations.
+ * Until then, the operations do not read the clock.
+ * @param hash_map a hash map.
+ * @return 1 if the latencies are measured, 0 otherwise.
+ */
+int hashmap_latency_enable (hashmap *hash_map);
+
+/**
+ * Stops measuring the latencies of the hash map operations, and deletes
+ * the recorded latencies.
+ * @param hash_map a hash map.
+ */
+void hashmap_latency_disable (hashmap *hash_map);
+
+/**
+ * Returns the latency histogram of a hash map operation.
+ * @param hash_map a hash map.
+ * @param op the operation.
+ * @return the histogram of the operation, in nanoseconds, NULL if the latencies
+ * are not measured.
+ */
+const latency_histogram *hashmap_latency (const hashmap *hash_map, hashmap_op op);
+
+/**
+ * Prints a summary line of the latency histogram of every operation.
+ * @param hash_map a hash map.
+ * @param out the stream to print to.
+ */
+void hashmap_latency_print (const hashmap *hash_map, FILE *out);
+
+/**
+ * Declares the keys of the hash map plain data of key_size bytes, equal exactly
+ * when their bytes are (e.g. integers). The buckets are then scanned with inline
+ * fixed-width compares instead of a call to key_cmp for every pair.
+ * @param hash_map a hash map.
+ * @param key_size the size of the keys in bytes, 0 to compare them by key_cmp again.
+ * @return 1 if the key size was set successfully, 0 otherwise.
+ */
+int hashmap_set_key_size (hashmap *hash_map, size_t key_size);
+
+/**
+ * Inserts a copy of in_pair that expires ttl clock units from now (by default,
+ * milliseconds). An expired pair is invisible to hashmap_at (and to the other
+ * lookups) at once, and is reclaimed later: by hashmap_expire, or a few at a
+ * time (HASH_MAP_EXPIRE_BUDGET) by every insertion. Until then it still counts
+ * in the size of the hash map.
+ * Copies of the pair (hashmap_clone, hashmap_merge) expire at the same time,
+ * a value replaced by hashmap_upsert keeps the expiry time of its key.
+ * @param hash_map the hash map to be inserted with new element.
+ * @param in_pair a pair the hash map would contain.
+ * @param ttl the time to live of the pair.
+ * @return 1 for successful insertion, 0 otherwise (also if the key is in the map).
+ */
+int hashmap_insert_ttl (hashmap *hash_map, const pair *in_pair, unsigned long long ttl);
+
+/**
+ * Reclaims the pairs that expired by the time now, advancing the timer wheel
+ * of the hash map. The work is proportional to the time passed and the number
+ * of reclaimed pairs, not to the size of the hash map. The hash map is minimized
+ * at most once, afterwards.
+ * @param hash_map a hash map.
+ * @param now the current time, by the clock of the hash map.
+ * @param budget the maximal number of pairs to reclaim, 0 for no limit.
+ * @return the number of pairs reclaimed.
+ */
+size_t hashmap_expire (hashmap *hash_map, unsigned long long now, size_t budget);
+
+/**
+ * Sets the clock the TTLs of the hash map are measured by, instead of the
+ * default monotonic milliseconds clock (hashmap_clock_ms).
+ * @param hash_map a hash map without expiring pairs.
+ * @param clock the clock.
+ * @return 1 if the clock was set successfully, 0 otherwise.
+ */
+int hashmap_set_clock (hashmap *hash_map, hashmap_clock_func clock);
+
+/**
+ * The default clock of the hash maps.
+ * @return the time of a monotonic clock in milliseconds.
+ */
+unsigned long long hashmap_clock_ms (void);
+
+/**
+ * Attaches a blocked Bloom filter of the keys to the hash map, so most lookups
+ * of missing keys (hashmap_at, hashmap_erase, and the insertions of new keys)
+ * read a single cache line of the filter instead of scanning a bucket.
+ * The filter reuses the hash of the key, is kept up to date by the insertions,
+ * is rebuilt for the new capacity when the hash map is resized, and after
+ * HASH_MAP_FILTER_MAX_STALE of its keys were erased. A filter that cannot be
+ * rebuilt (out of memory) is dropped, the hash map then works without one.
+ * @param hash_map a hash map, an existing filter is replaced.
+ * @param fp_rate the false positive rate, between 0 and 1 (exclusive), e.g. 0.01.
+ * @param max_bytes the maximal size of the filter, 0 for no limit. A smaller
+ * filter than fp_rate needs has a higher false positive rate.
+ * @return 1 if the filter was attached successfully, 0 otherwise.
+ */
+int hashmap_filter_enable (hashmap *hash_map, double fp_rate, size_t max_bytes);
+
+/**
+ * Detaches and frees the filter of the hash map.
+ * @param hash_map a hash map.
+ */
+void hashmap_filter_disable (hashmap *hash_map);
+
+/**
+ * Rebuilds the filter of the hash map from its keys, for its current capacity.
+ * Needed only after the buckets were changed directly (see counter_map).
+ * @param hash_map a hash map.
+ * @return 1 if the filter was rebuilt (or there is none), 0 if it was dropped.
+ */
+int hashmap_filter_rebuild (hashmap *hash_map);
+
+/**
+ * Takes a consistent, read-only snapshot of the hash map in O(capacity): the
+ * buckets are shared with the hash map by reference counts, and a write to the hash
+ * map copies a shared bucket (and its pairs) the first time it changes it. The
+ * memory of the snapshots grows with the changes, not with the size of the hash map.
+ * A resize copies all the shared buckets, reserve the hash map to avoid it.
+ * The snapshot may be read and freed by another thread while the hash map is
+ * written, as long as the values returned by hashmap_at are not changed in place.
+ * Snapshots are taken by the thread writing the hash map. The pairs inserted with a
+ * TTL do not expire in a snapshot.
+ * @param hash_map a hash map.
+ * @return pointer to dynamically allocated snapshot, NULL if the function failed.
+ */
+hashmap_view *hashmap_snapshot (hashmap *hash_map);
+
+/**
+ * Frees a snapshot, and the buckets no hash map or other snapshot shares with it.
+ * It may outlive its hash map (but not the allocator of the hash map).
+ * @param p_view pointer to dynamically allocated pointer to snapshot.
+ */
+void hashmap_view_free (hashmap_view **p_view);
+
+/**
+ * Waits for a running background resize, and copies every bucket the hash map
+ * shares with snapshots. Needed only before the buckets are changed directly
+ * (see counter_map), which would change the snapshots as well.
+ * @param hash_map a hash map.
+ * @return 1 if the hash map owns all its buckets, 0 if a copy failed (the buckets
+ * before it were copied).
+ */
+int hashmap_unshare (hashmap *hash_map);
+
+/**
+ * The function returns the value associated with the given key in the snapshot.
+ * @param view a snapshot.
+ * @param key the key to be checked.
+ * @return the value associated with key when the snapshot was taken, NULL if
+ * there was none (the value itself, not a copy of it).
+ */
+valueT hashmap_view_at (const hashmap_view *view, const_keyT key);
+
+/**
+ * Iterates the pairs of the snapshot. Start with *bucket = *index = 0, and call
+ * until NULL is returned.
+ * Example: size_t bucket = 0, index = 0; const pair *p;
+ *          while ((p = hashmap_view_next (view, &bucket, &index)) != NULL) {...}
+ * @param view a snapshot.
+ * @param bucket, index the position of the iteration, advanced past the returned pair.
+ * @return the next pair (not a copy of it), NULL after the last one.
+ */
+const pair *hashmap_view_next (const hashmap_view *view, size_t *bucket, size_t *index);
+
+/**
+ * Extends the hash map in a background thread from now on: the insertion which finds
+ * it at HASH_MAP_MAX_LOAD_FACTOR starts a thread building the new bucket array, and
+ * goes on without waiting for it. Until the new bucket array is published (by the
+ * first insertion or erasure after the thread finished) the pairs inserted meanwhile
+ * are kept in a small side hash map, so no operation rehashes the whole hash map.
+ * The thread also builds the filter of the keys (see hashmap_filter_enable) for the
+ * new bucket array, so publishing it only replays the side hash map, and the replaced
+ * bucket array is released HASH_MAP_RELEASE_BUDGET buckets at a time afterwards.
+ * If the side hash map cannot be replayed (out of memory) the resize is left running,
+ * nothing is lost, and the functions which wait for it fail.
+ * Only an insertion finding the hash map at hard_load_factor waits for the thread.
+ * Minimizations, and the extensions of a hash map with snapshots, with pairs inserted
+ * with a TTL, or of fewer than HASH_MAP_BACKGROUND_MIN_CAP buckets, are still done
+ * inline. hashmap_apply_if, hashmap_clone, hashmap_stats and the source hash map of
+ * hashmap_merge read a running resize as it is (the side hash map hides the pairs of
+ * the frozen bucket array whose keys it holds), and leave it running. The functions
+ * that rebuild the buckets (hashmap_reserve, hashmap_erase_if, hashmap_snapshot, ...)
+ * wait for it first, and the buckets may be read directly only after
+ * hashmap_resize_wait. The hash function and the allocator of the hash map must be
+ * safe to call from two threads.
+ * @param hash_map a hash map, whose allocator does not release all its memory at
+ * once (not an arena).
+ * @param hard_load_factor the load factor at which an insertion waits for the
+ * thread, above HASH_MAP_MAX_LOAD_FACTOR, 0 for HASH_MAP_HARD_LOAD_FACTOR.
+ * @return 1 on success, 0 otherwise.
+ */
+int hashmap_background_resize_enable (hashmap *hash_map, double hard_load_factor);
+
+/**
+ * Waits for a running background resize and resizes the hash map inline from now on
+ * (unless the resize could not be published, see hashmap_resize_wait).
+ * @param hash_map a hash map.
+ */
+void hashmap_background_resize_disable (hashmap *hash_map);
+
+/**
+ * Waits for the running background resize of the hash map, if any, and publishes its
+ * bucket array.
+ * @param hash_map a hash map.
+ * @return 1 if the hash map was extended (or no resize was running), 0 otherwise:
+ * the thread failed (the hash map keeps its bucket array), or the side hash map could
+ * not be replayed (the resize is left running). No pair is lost either way.
+ */
+int hashmap_resize_wait (hashmap *hash_map);
 #endif //HASHMAP_H_
@@ -0,0 +1,737 @@
+//
+// C++ front-end of the hashmap library: a class template with the buckets, load
+// factors and resizes of hashmap, storing the pairs in place.
+//
+#ifndef HASHMAP_HPP_
+#define HASHMAP_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace hashmap_library {
+
+// the resize policy of hashmap.h (HASH_MAP_INITIAL_CAP, HASH_MAP_GROWTH_FACTOR,
+// HASH_MAP_MIN_LOAD_FACTOR, HASH_MAP_MAX_LOAD_FACTOR), whose declarations are C only
+constexpr std::size_t initial_capacity = 16;
+constexpr std::size_t growth_factor = 2;
+constexpr double min_load = 0.25;
+constexpr double max_load = 0.75;
+
+/**
+ * @struct string_hash - a transparent hash of strings: std::string, std::string_view
+ * and const char * keys hash alike, so a map with std::string keys can be searched
+ * with the others without constructing a temporary std::string. Use it with
+ * std::equal_to<> (see string_hashmap).
+ */
+struct string_hash {
+    using is_transparent = void;
+
+    std::size_t operator() (std::string_view key) const noexcept
+    {
+        return std::hash<std::string_view>{} (key);
+    }
+};
+
+/**
+ * @class hashmap - a hash map from keys of type K to values of type V. The buckets
+ * are arrays of pairs, stored in place; the bucket of a key is its hash modulo the
+ * number of buckets (a power of 2). As hashmap, the map grows by growth_factor
+ * before an insertion at max_load, and shrinks after an erasure (by key)
+ * at min_load. The map allocates its buckets on the first insertion.
+ * An insertion or an erasure by key invalidates the iterators and the references
+ * to the pairs; erase(iterator) invalidates those to the erased pair and the last
+ * pair of its bucket.
+ * @tparam K, V - the key and value types, V may be move only.
+ * @tparam Hash, KeyEqual - hash and equality of keys. If both define is_transparent,
+ * find, contains, count and at accept any type they accept, e.g. std::string_view.
+ * @tparam Allocator an allocator of std::pair<const K, V>.
+ */
+template <class K, class V, class Hash = std::hash<K>, class KeyEqual = std::equal_to<K>,
+          class Allocator = std::allocator<std::pair<const K, V>>>
+class hashmap {
+ public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+
+ private:
+    /**
+     * @struct bucket - the pairs of a bucket, in an array of capacity slots.
+     */
+    struct bucket {
+        value_type *slots;
+        size_type size;
+        size_type capacity;
+    };
+
+    using slot_allocator =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<value_type>;
+    using slot_traits = std::allocator_traits<slot_allocator>;
+    using bucket_allocator = typename slot_traits::template rebind_alloc<bucket>;
+    using bucket_traits = std::allocator_traits<bucket_allocator>;
+
+    // pairs are moved to their new slots only if it cannot throw (or they cannot be
+    // copied), otherwise a failed resize leaves the map unchanged
+    static constexpr bool relocate_by_move =
+        (std::is_nothrow_move_constructible<K>::value
+         && std::is_nothrow_move_constructible<V>::value)
+        || !std::is_copy_constructible<value_type>::value;
+
+    template <class T, class = void>
+    struct has_transparent : std::false_type {};
+
+    template <class T>
+    struct has_transparent<T, std::void_t<typename T::is_transparent>> : std::true_type {};
+
+    static constexpr bool transparent =
+        has_transparent<Hash>::value && has_transparent<KeyEqual>::value;
+
+    // enables the lookups by other key types, T defaults to transparent
+    template <bool T>
+    using if_transparent = std::enable_if_t<T, int>;
+
+    template <bool Const>
+    class basic_iterator {
+        friend class hashmap;
+        template <bool> friend class basic_iterator;
+        using bucket_pointer = std::conditional_t<Const, const bucket *, bucket *>;
+
+        bucket_pointer buckets_ = nullptr;
+        size_type bucket_count_ = 0;
+        size_type bucket_ = 0;
+        size_type slot_ = 0;
+
+        basic_iterator (bucket_pointer buckets, size_type bucket_count, size_type bucket_index,
+                        size_type slot)
+            : buckets_ (buckets), bucket_count_ (bucket_count), bucket_ (bucket_index),
+              slot_ (slot) {}
+
+        // moves past the ends of the buckets, to the next pair or the end
+        void skip_ends ()
+        {
+            while ((bucket_ < bucket_count_) && (slot_ == buckets_[bucket_].size))
+            {
+                ++bucket_;
+                slot_ = 0;
+            }
+        }
+
+     public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename hashmap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const value_type *, value_type *>;
+        using reference = std::conditional_t<Const, const value_type &, value_type &>;
+
+        basic_iterator () = default;
+
+        template <bool C = Const, std::enable_if_t<C, int> = 0>
+        basic_iterator (const basic_iterator<false> &other)
+            : buckets_ (other.buckets_), bucket_count_ (other.bucket_count_),
+              bucket_ (other.bucket_), slot_ (other.slot_) {}
+
+        reference operator* () const {return buckets_[bucket_].slots[slot_];}
+        pointer operator-> () const {return &(buckets_[bucket_].slots[slot_]);}
+
+        basic_iterator &operator++ ()
+        {
+            ++slot_;
+            skip_ends ();
+            return *this;
+        }
+
+        basic_iterator operator++ (int)
+        {
+            basic_iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        friend bool operator== (const basic_iterator &a, const basic_iterator &b)
+        {
+            return (a.bucket_ == b.bucket_) && (a.slot_ == b.slot_);
+        }
+
+        friend bool operator!= (const basic_iterator &a, const basic_iterator &b)
+        {
+            return !(a == b);
+        }
+    };
+
+ public:
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    hashmap () : hashmap (0) {}
+
+    /**
+     * Constructs an empty map.
+     * @param bucket_count the initial number of buckets (rounded up to a power of 2),
+     * 0 allocates initial_capacity buckets on the first insertion.
+     */
+    explicit hashmap (size_type bucket_count, const Hash &hash = Hash (),
+                      const KeyEqual &equal = KeyEqual (), const Allocator &alloc = Allocator ())
+        : hash_ (hash), equal_ (equal), alloc_ (alloc)
+    {
+        if (bucket_count > 0) {rehash_to (round_up (bucket_count));}
+    }
+
+    hashmap (std::initializer_list<value_type> pairs) : hashmap (0) {insert (pairs);}
+
+    hashmap (const hashmap &other)
+        : hashmap (other.capacity_, other.hash_, other.equal_,
+                   Allocator (slot_traits::select_on_container_copy_construction (other.alloc_)))
+    {
+        for (const value_type &p : other) {emplace_unique (p.first, p);}
+    }
+
+    hashmap (hashmap &&other) noexcept
+        : buckets_ (other.buckets_), capacity_ (other.capacity_), size_ (other.size_),
+          slab_ (other.slab_), slab_size_ (other.slab_size_),
+          hash_ (std::move (other.hash_)), equal_ (std::move (other.equal_)),
+          alloc_ (std::move (other.alloc_))
+    {
+        other.buckets_ = nullptr;
+        other.capacity_ = 0;
+        other.size_ = 0;
+        other.slab_ = nullptr;
+        other.slab_size_ = 0;
+    }
+
+    hashmap &operator= (const hashmap &other)
+    {
+        if (this != &other)
+        {
+            hashmap copy (other);
+            swap (copy);
+        }
+        return *this;
+    }
+
+    hashmap &operator= (hashmap &&other)
+    {
+        if (this == &other) {return *this;}
+        if (slot_traits::propagate_on_container_move_assignment::value
+            || (alloc_ == other.alloc_))
+        {
+            release (buckets_, capacity_, slab_, slab_size_);
+            buckets_ = std::exchange (other.buckets_, nullptr);
+            capacity_ = std::exchange (other.capacity_, 0);
+            size_ = std::exchange (other.size_, 0);
+            slab_ = std::exchange (other.slab_, nullptr);
+            slab_size_ = std::exchange (other.slab_size_, 0);
+            hash_ = std::move (other.hash_);
+            equal_ = std::move (other.equal_);
+            if constexpr (slot_traits::propagate_on_container_move_assignment::value)
+            {
+                alloc_ = std::move (other.alloc_);
+            }
+        }
+        else
+        {
+            // the memory of other cannot be taken, the pairs are moved one by one
+            clear ();
+            for (value_type &p : other) {emplace_unique (p.first, std::move (p));}
+            other.clear ();
+        }
+        return *this;
+    }
+
+    ~hashmap () {release (buckets_, capacity_, slab_, slab_size_);}
+
+    iterator begin () noexcept
+    {
+        iterator it (buckets_, capacity_, 0, 0);
+        it.skip_ends ();
+        return it;
+    }
+
+    const_iterator begin () const noexcept
+    {
+        const_iterator it (buckets_, capacity_, 0, 0);
+        it.skip_ends ();
+        return it;
+    }
+
+    const_iterator cbegin () const noexcept {return begin ();}
+    iterator end () noexcept {return iterator (buckets_, capacity_, capacity_, 0);}
+
+    const_iterator end () const noexcept
+    {
+        return const_iterator (buckets_, capacity_, capacity_, 0);
+    }
+
+    const_iterator cend () const noexcept {return end ();}
+
+    bool empty () const noexcept {return size_ == 0;}
+    size_type size () const noexcept {return size_;}
+    size_type bucket_count () const noexcept {return capacity_;}
+
+    double load_factor () const noexcept
+    {
+        return (capacity_ == 0) ? 0 : (double) size_ / (double) capacity_;
+    }
+
+    double max_load_factor () const noexcept {return max_load;}
+    hasher hash_function () const {return hash_;}
+    key_equal key_eq () const {return equal_;}
+    allocator_type get_allocator () const {return allocator_type (alloc_);}
+
+    /**
+     * Inserts a pair constructed from args, if its key is not in the map. The pair is
+     * constructed before the lookup, prefer try_emplace when the key is at hand.
+     * args must not refer to pairs of the map.
+     * @return the iterator of the pair of the key, and whether it was inserted.
+     */
+    template <class... Args>
+    std::pair<iterator, bool> emplace (Args &&...args)
+    {
+        value_type p (std::forward<Args> (args)...);
+        return emplace_unique (p.first, std::piecewise_construct,
+                               std::forward_as_tuple (std::move (const_cast<K &> (p.first))),
+                               std::forward_as_tuple (std::move (p.second)));
+    }
+
+    /**
+     * Inserts a pair of the key and a value constructed from args, if the key is not in
+     * the map. Otherwise nothing is constructed, and args are not moved from.
+     * args must not refer to pairs of the map.
+     * @return the iterator of the pair of the key, and whether it was inserted.
+     */
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace (const K &key, Args &&...args)
+    {
+        return emplace_unique (key, std::piecewise_construct, std::forward_as_tuple (key),
+                               std::forward_as_tuple (std::forward<Args> (args)...));
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace (K &&key, Args &&...args)
+    {
+        return emplace_unique (key, std::piecewise_construct,
+                               std::forward_as_tuple (std::move (key)),
+                               std::forward_as_tuple (std::forward<Args> (args)...));
+    }
+
+    std::pair<iterator, bool> insert (const value_type &p) {return emplace_unique (p.first, p);}
+
+    std::pair<iterator, bool> insert (value_type &&p)
+    {
+        return emplace_unique (p.first, std::move (p));
+    }
+
+    template <class InputIt>
+    void insert (InputIt first, InputIt last)
+    {
+        for (; first != last; ++first) {emplace (*first);}
+    }
+
+    void insert (std::initializer_list<value_type> pairs) {insert (pairs.begin (), pairs.end ());}
+
+    /**
+     * Inserts a pair of the key and value, or assigns value to the value of the key.
+     * @return the iterator of the pair of the key, and whether it was inserted.
+     */
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign (const K &key, M &&value)
+    {
+        std::pair<iterator, bool> result = try_emplace (key, std::forward<M> (value));
+        if (!result.second) {result.first->second = std::forward<M> (value);}
+        return result;
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign (K &&key, M &&value)
+    {
+        std::pair<iterator, bool> result = try_emplace (std::move (key), std::forward<M> (value));
+        if (!result.second) {result.first->second = std::forward<M> (value);}
+        return result;
+    }
+
+    V &operator[] (const K &key) {return try_emplace (key).first->second;}
+    V &operator[] (K &&key) {return try_emplace (std::move (key)).first->second;}
+
+    /**
+     * Erases the pair of the key, and shrinks the map if its load factor dropped to
+     * min_load (if the shrinking fails, the map keeps its buckets).
+     * @return the number of pairs erased, 1 or 0.
+     */
+    size_type erase (const K &key)
+    {
+        std::pair<size_type, size_type> found = locate (key, hash_ (key));
+        if (found.first == capacity_) {return 0;}
+        erase_slot (buckets_[found.first], found.second);
+        if ((capacity_ > initial_capacity) && (load_factor () <= min_load))
+        {
+            try
+            {
+                rehash_to (capacity_ / growth_factor);
+            }
+            catch (...) {}
+        }
+        return 1;
+    }
+
+    /**
+     * Erases the pair at pos. The map is not shrunk, so the erasures of an iteration
+     * keep the other iterators valid.
+     * @return the iterator of the pair after the erased one.
+     */
+    iterator erase (const_iterator pos)
+    {
+        erase_slot (buckets_[pos.bucket_], pos.slot_);
+        iterator next (buckets_, capacity_, pos.bucket_, pos.slot_);
+        next.skip_ends ();
+        return next;
+    }
+
+    iterator erase (iterator pos) {return erase (const_iterator (pos));}
+
+    /**
+     * Destroys all the pairs, the buckets are kept.
+     */
+    void clear () noexcept
+    {
+        for (size_type i = 0; i < capacity_; ++i)
+        {
+            bucket &b = buckets_[i];
+            for (size_type j = 0; j < b.size; ++j) {slot_traits::destroy (alloc_, &(b.slots[j]));}
+            b.size = 0;
+        }
+        size_ = 0;
+    }
+
+    void swap (hashmap &other) noexcept
+    {
+        using std::swap;
+        swap (buckets_, other.buckets_);
+        swap (capacity_, other.capacity_);
+        swap (size_, other.size_);
+        swap (slab_, other.slab_);
+        swap (slab_size_, other.slab_size_);
+        swap (hash_, other.hash_);
+        swap (equal_, other.equal_);
+        if constexpr (slot_traits::propagate_on_container_swap::value)
+        {
+            swap (alloc_, other.alloc_);
+        }
+    }
+
+    /**
+     * Grows the map so count pairs can be inserted without a resize.
+     * @throw std::length_error if no number of buckets can hold count pairs.
+     */
+    void reserve (size_type count)
+    {
+        size_type capacity = (capacity_ == 0) ? initial_capacity : capacity_;
+        while ((count > 0)
+               && ((double) (count - 1) / (double) capacity >= max_load))
+        {
+            capacity = grow (capacity);
+        }
+        if (capacity != capacity_) {rehash_to (capacity);}
+    }
+
+    /**
+     * Resizes the map to at least bucket_count buckets, and at least the buckets its
+     * pairs need (so rehash (0) shrinks the map to fit).
+     * @throw std::length_error if bucket_count is above the largest power of 2.
+     */
+    void rehash (size_type bucket_count)
+    {
+        size_type capacity = initial_capacity;
+        while ((size_ > 0)
+               && ((double) (size_ - 1) / (double) capacity >= max_load))
+        {
+            capacity = grow (capacity);
+        }
+        if (bucket_count > capacity) {capacity = round_up (bucket_count);}
+        if (capacity != capacity_) {rehash_to (capacity);}
+    }
+
+    iterator find (const K &key) {return make_iterator (locate (key, hash_ (key)));}
+
+    const_iterator find (const K &key) const
+    {
+        return make_const_iterator (locate (key, hash_ (key)));
+    }
+
+    template <class Q, bool T = transparent, if_transparent<T> = 0>
+    iterator find (const Q &key) {return make_iterator (locate (key, hash_ (key)));}
+
+    template <class Q, bool T = transparent, if_transparent<T> = 0>
+    const_iterator find (const Q &key) const
+    {
+        return make_const_iterator (locate (key, hash_ (key)));
+    }
+
+    bool contains (const K &key) const {return find (key) != end ();}
+
+    template <class Q, bool T = transparent, if_transparent<T> = 0>
+    bool contains (const Q &key) const {return find (key) != end ();}
+
+    size_type count (const K &key) const {return contains (key) ? 1 : 0;}
+
+    template <class Q, bool T = transparent, if_transparent<T> = 0>
+    size_type count (const Q &key) const {return contains (key) ? 1 : 0;}
+
+    /**
+     * @return the value of the key.
+     * @throw std::out_of_range if the key is not in the map.
+     */
+    V &at (const K &key) {return value_at (find (key));}
+    const V &at (const K &key) const {return value_at (find (key));}
+
+    template <class Q, bool T = transparent, if_transparent<T> = 0>
+    V &at (const Q &key) {return value_at (find (key));}
+
+    template <class Q, bool T = transparent, if_transparent<T> = 0>
+    const V &at (const Q &key) const {return value_at (find (key));}
+
+ private:
+    bucket *buckets_ = nullptr;
+    size_type capacity_ = 0;
+    size_type size_ = 0;
+    value_type *slab_ = nullptr;
+    size_type slab_size_ = 0;
+    Hash hash_;
+    KeyEqual equal_;
+    slot_allocator alloc_;
+
+    static size_type round_up (size_type count)
+    {
+        size_type capacity = 1;
+        while (capacity < count) {capacity = grow (capacity);}
+        return capacity;
+    }
+
+    // the next capacity, before it would overflow
+    static size_type grow (size_type capacity)
+    {
+        if (capacity > std::numeric_limits<size_type>::max () / growth_factor)
+        {
+            throw std::length_error ("hashmap: too many buckets");
+        }
+        return capacity * growth_factor;
+    }
+
+    template <class It>
+    It value_check (It it) const
+    {
+        if (it == It (buckets_, capacity_, capacity_, 0))
+        {
+            throw std::out_of_range ("hashmap::at: the key is not in the map");
+        }
+        return it;
+    }
+
+    V &value_at (iterator it) {return value_check (it)->second;}
+    const V &value_at (const_iterator it) const {return value_check (it)->second;}
+
+    iterator make_iterator (std::pair<size_type, size_type> position)
+    {
+        return iterator (buckets_, capacity_, position.first, position.second);
+    }
+
+    const_iterator make_const_iterator (std::pair<size_type, size_type> position) const
+    {
+        return const_iterator (buckets_, capacity_, position.first, position.second);
+    }
+
+    // the bucket and slot of the key, (capacity_, 0) if it is not in the map
+    template <class Q>
+    std::pair<size_type, size_type> locate (const Q &key, std::size_t hash) const
+    {
+        if (size_ == 0) {return {capacity_, 0};}
+        size_type index = hash & (capacity_ - 1);
+        const bucket &b = buckets_[index];
+        for (size_type i = 0; i < b.size; ++i)
+        {
+            if (equal_ (b.slots[i].first, key)) {return {index, i};}
+        }
+        return {capacity_, 0};
+    }
+
+    template <class Q, class... Args>
+    std::pair<iterator, bool> emplace_unique (const Q &key, Args &&...args)
+    {
+        std::size_t hash = hash_ (key);
+        std::pair<size_type, size_type> found = locate (key, hash);
+        if (found.first != capacity_) {return {make_iterator (found), false};}
+        if (capacity_ == 0)
+        {
+            rehash_to (initial_capacity);
+        }
+        else if (load_factor () >= max_load)
+        {
+            rehash_to (capacity_ * growth_factor);
+        }
+        size_type index = hash & (capacity_ - 1);
+        bucket &b = buckets_[index];
+        if (b.size == b.capacity) {grow_bucket (b);}
+        slot_traits::construct (alloc_, &(b.slots[b.size]), std::forward<Args> (args)...);
+        ++(b.size);
+        ++size_;
+        return {iterator (buckets_, capacity_, index, b.size - 1), true};
+    }
+
+    // constructs the pair at dst from src, which is destroyed afterwards
+    void relocate_construct (value_type *dst, value_type &src)
+    {
+        if constexpr (relocate_by_move)
+        {
+            // as with the node handles of the standard containers, the key is moved out
+            // of a pair which is destroyed next
+            slot_traits::construct (alloc_, dst, std::piecewise_construct,
+                                    std::forward_as_tuple (std::move (const_cast<K &> (src.first))),
+                                    std::forward_as_tuple (std::move (src.second)));
+        }
+        else
+        {
+            slot_traits::construct (alloc_, dst, std::as_const (src));
+        }
+    }
+
+    static bool in_slab (const value_type *slots, const value_type *slab, size_type slab_size)
+    {
+        std::less<const value_type *> less;
+        return (slab != nullptr) && !less (slots, slab) && less (slots, slab + slab_size);
+    }
+
+    // frees the slots of a bucket, unless they are part of the slab
+    void deallocate_slots (bucket &b, const value_type *slab, size_type slab_size) noexcept
+    {
+        if ((b.slots != nullptr) && !in_slab (b.slots, slab, slab_size))
+        {
+            slot_traits::deallocate (alloc_, b.slots, b.capacity);
+        }
+    }
+
+    // destroys the pairs of the buckets and frees them, with their slab
+    void release (bucket *buckets, size_type count, value_type *slab, size_type slab_size) noexcept
+    {
+        if (buckets == nullptr) {return;}
+        for (size_type i = 0; i < count; ++i)
+        {
+            bucket &b = buckets[i];
+            for (size_type j = 0; j < b.size; ++j) {slot_traits::destroy (alloc_, &(b.slots[j]));}
+            deallocate_slots (b, slab, slab_size);
+        }
+        if (slab != nullptr) {slot_traits::deallocate (alloc_, slab, slab_size);}
+        bucket_allocator bucket_alloc (alloc_);
+        bucket_traits::deallocate (bucket_alloc, buckets, count);
+    }
+
+    // moves the pairs to new_capacity buckets, whose slots are consecutive ranges of a
+    // single allocation (the slab), sized by counting the pairs of every bucket first
+    void rehash_to (size_type new_capacity)
+    {
+        bucket_allocator bucket_alloc (alloc_);
+        bucket *buckets = bucket_traits::allocate (bucket_alloc, new_capacity);
+        for (size_type i = 0; i < new_capacity; ++i) {buckets[i] = bucket {nullptr, 0, 0};}
+        value_type *slab = nullptr;
+        try
+        {
+            if (size_ > 0) {slab = slot_traits::allocate (alloc_, size_);}
+            for (const value_type &p : *this)
+            {
+                ++(buckets[hash_ (p.first) & (new_capacity - 1)].capacity);
+            }
+            value_type *slots = slab;
+            for (size_type i = 0; i < new_capacity; ++i)
+            {
+                if (buckets[i].capacity > 0) {buckets[i].slots = slots;}
+                slots += buckets[i].capacity;
+            }
+            for (value_type &p : *this)
+            {
+                bucket &b = buckets[hash_ (p.first) & (new_capacity - 1)];
+                relocate_construct (&(b.slots[b.size]), p);
+                ++(b.size);
+            }
+        }
+        catch (...)
+        {
+            release (buckets, new_capacity, slab, size_);
+            throw;
+        }
+        release (buckets_, capacity_, slab_, slab_size_);
+        buckets_ = buckets;
+        capacity_ = new_capacity;
+        slab_ = slab;
+        slab_size_ = size_;
+    }
+
+    void grow_bucket (bucket &b)
+    {
+        size_type capacity = (b.capacity == 0) ? 1 : b.capacity * 2;
+        value_type *slots = slot_traits::allocate (alloc_, capacity);
+        size_type moved = 0;
+        try
+        {
+            for (; moved < b.size; ++moved) {relocate_construct (&(slots[moved]), b.slots[moved]);}
+        }
+        catch (...)
+        {
+            for (size_type i = 0; i < moved; ++i) {slot_traits::destroy (alloc_, &(slots[i]));}
+            slot_traits::deallocate (alloc_, slots, capacity);
+            throw;
+        }
+        for (size_type i = 0; i < b.size; ++i) {slot_traits::destroy (alloc_, &(b.slots[i]));}
+        deallocate_slots (b, slab_, slab_size_);
+        b.slots = slots;
+        b.capacity = capacity;
+    }
+
+    // the order of the pairs in a bucket does not matter, the last one fills the slot
+    void erase_slot (bucket &b, size_type slot)
+    {
+        slot_traits::destroy (alloc_, &(b.slots[slot]));
+        --(b.size);
+        --size_;
+        if (slot != b.size)
+        {
+            value_type &last = b.slots[b.size];
+            K &key = const_cast<K &> (last.first);
+            slot_traits::construct (alloc_, &(b.slots[slot]), std::piecewise_construct,
+                                    std::forward_as_tuple (std::move (key)),
+                                    std::forward_as_tuple (std::move (last.second)));
+            slot_traits::destroy (alloc_, &last);
+        }
+    }
+};
+
+template <class K, class V, class Hash, class KeyEqual, class Allocator>
+void swap (hashmap<K, V, Hash, KeyEqual, Allocator> &a,
+           hashmap<K, V, Hash, KeyEqual, Allocator> &b) noexcept
+{
+    a.swap (b);
+}
+
+/**
+ * @typedef string_hashmap - a hashmap with std::string keys which can be searched
+ * with std::string_view and const char * keys.
+ */
+template <class V>
+using string_hashmap = hashmap<std::string, V, string_hash, std::equal_to<>>;
+
+}  // namespace hashmap_library
+
+#endif //HASHMAP_HPP_
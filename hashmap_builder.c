@@ -0,0 +1,467 @@
+//
+// A bulk loader of hash maps: records from arrays, callbacks or files, built at once.
+//
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "hashmap_builder.h"
+
+/**
+ * @def HASHMAP_BUILDER_MIN_RECORDS
+ * The initial capacity of the records of a builder.
+ */
+#define HASHMAP_BUILDER_MIN_RECORDS 64UL
+
+int builder_push (hashmap_builder *builder, size_t hash, keyT key, valueT value);
+void builder_drop (const hashmap_builder *builder, hashmap_builder_record *record);
+int add_decoded (hashmap_builder *builder, const hashmap_builder_format *format,
+                 const char *key, size_t key_size, const char *value, size_t value_size);
+int parse_text (hashmap_builder *builder, const hashmap_builder_format *format,
+                const char *data, size_t size, int end, size_t *used);
+int parse_binary (hashmap_builder *builder, const hashmap_builder_format *format,
+                  const char *data, size_t size, int end, size_t *used);
+size_t read_u32 (const char *data);
+size_t file_size (FILE *file);
+int place_record (hashmap *map, const hashmap_builder *builder, vector *bucket,
+                  hashmap_builder_record *record);
+
+/**
+ * Allocates dynamically an empty builder of a hash map.
+ * @param func a function which "hashes" keys.
+ * @param functions a pair whose copy, compare and free functions the pairs of the
+ * hash map get (its key and value are ignored).
+ * @param policy how the keys added more than once are resolved.
+ * @return pointer to dynamically allocated builder.
+ * @if_fail return NULL.
+ */
+hashmap_builder *hashmap_builder_alloc (hash_func func, const pair *functions,
+                                        hashmap_builder_policy policy)
+{
+    return hashmap_builder_alloc_ex (func, functions, policy, NULL);
+}
+
+/**
+ * Allocates dynamically an empty builder of a hash map which is allocated with
+ * the given allocator (see hashmap_alloc_ex).
+ * @param func a function which "hashes" keys.
+ * @param functions a pair whose copy, compare and free functions the pairs of the
+ * hash map get (its key and value are ignored).
+ * @param policy how the keys added more than once are resolved.
+ * @param allocator the allocator of the hash map, NULL for malloc.
+ * @return pointer to dynamically allocated builder.
+ * @if_fail return NULL.
+ */
+hashmap_builder *hashmap_builder_alloc_ex (hash_func func, const pair *functions,
+                                           hashmap_builder_policy policy,
+                                           const allocator *allocator)
+{
+    if ((func == NULL) || (functions == NULL) || (functions->key_cpy == NULL)
+        || (functions->value_cpy == NULL) || (functions->key_cmp == NULL)
+        || (functions->key_free == NULL) || (functions->value_free == NULL))
+    {
+        return NULL;
+    }
+    hashmap_builder *builder = (hashmap_builder *) malloc (sizeof(hashmap_builder));
+    if (builder == NULL) {return NULL;}
+    builder->func = func;
+    builder->functions = *functions;
+    builder->functions.key = NULL;
+    builder->functions.value = NULL;
+    builder->functions.timer = NULL;
+    builder->functions.allocator = allocator;
+    builder->policy = policy;
+    builder->allocator = allocator;
+    builder->records = NULL;
+    builder->size = 0;
+    builder->capacity = 0;
+    return builder;
+}
+
+/**
+ * Frees a builder and the records added to it.
+ * @param p_builder pointer to dynamically allocated pointer to builder.
+ */
+void hashmap_builder_free (hashmap_builder **p_builder)
+{
+    if ((p_builder == NULL) || (*p_builder == NULL)) {return;}
+    hashmap_builder *builder = *p_builder;
+    for (size_t i = 0; i < builder->size; ++i)
+    {
+        // the records built into the hash map have no key anymore
+        if (builder->records[i].key != NULL) {builder_drop (builder, &(builder->records[i]));}
+    }
+    free (builder->records);
+    free (builder);
+    *p_builder = NULL;
+}
+
+/**
+ * Extends the records of the builder, if needed, so that count more records can be
+ * added without reallocating them.
+ * @param builder a builder.
+ * @param count the number of records to be added.
+ * @return 1 on success, 0 otherwise.
+ */
+int hashmap_builder_reserve (hashmap_builder *builder, size_t count)
+{
+    if (builder == NULL) {return 0;}
+    if (count <= builder->capacity - builder->size) {return 1;}
+    if (count > (size_t) -1 / sizeof(hashmap_builder_record) - builder->size) {return 0;}
+    size_t capacity = builder->size + count;
+    hashmap_builder_record *records = (hashmap_builder_record *) realloc (
+        builder->records, capacity * sizeof(hashmap_builder_record));
+    if (records == NULL) {return 0;}
+    builder->records = records;
+    builder->capacity = capacity;
+    return 1;
+}
+
+/**
+ * Appends a record, the capacity of the records doubles when they are full.
+ * The builder takes the ownership of the key and value, they are freed on failure.
+ * @return 1 on success, 0 otherwise.
+ */
+int builder_push (hashmap_builder *builder, size_t hash, keyT key, valueT value)
+{
+    hashmap_builder_record record = {hash, key, value};
+    if (builder->size == builder->capacity)
+    {
+        size_t grow = (builder->capacity < HASHMAP_BUILDER_MIN_RECORDS)
+                      ? HASHMAP_BUILDER_MIN_RECORDS : builder->capacity;
+        if (hashmap_builder_reserve (builder, grow) == 0)
+        {
+            builder_drop (builder, &record);
+            return 0;
+        }
+    }
+    builder->records[builder->size] = record;
+    ++builder->size;
+    return 1;
+}
+
+/**
+ * Frees the key and value of a record which is not built into the hash map.
+ */
+void builder_drop (const hashmap_builder *builder, hashmap_builder_record *record)
+{
+    builder->functions.key_free (&(record->key));
+    builder->functions.value_free (&(record->value));
+    record->key = NULL;
+    record->value = NULL;
+}
+
+/**
+ * Adds a copy of a record.
+ * @param builder a builder.
+ * @param key, value - copied by the key_cpy and value_cpy of the builder.
+ * @return 1 on success, 0 otherwise.
+ */
+int hashmap_builder_add (hashmap_builder *builder, const_keyT key, const_valueT value)
+{
+    if ((builder == NULL) || (key == NULL)) {return 0;}
+    keyT key_copy = builder->functions.key_cpy (key);
+    valueT value_copy = builder->functions.value_cpy (value);
+    if ((key_copy == NULL) || (value_copy == NULL))
+    {
+        builder->functions.key_free (&key_copy);
+        builder->functions.value_free (&value_copy);
+        return 0;
+    }
+    return builder_push (builder, builder->func (key), key_copy, value_copy);
+}
+
+/**
+ * Adds copies of count records, reserved at once.
+ * @param builder a builder.
+ * @param keys, values - the keys and values of the records.
+ * @param count the number of records.
+ * @return 1 on success, 0 otherwise (the records before the failed one were added).
+ */
+int hashmap_builder_add_array (hashmap_builder *builder, const const_keyT *keys,
+                               const const_valueT *values, size_t count)
+{
+    if ((builder == NULL) || (keys == NULL) || (values == NULL)) {return 0;}
+    if (hashmap_builder_reserve (builder, count) == 0) {return 0;}
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (hashmap_builder_add (builder, keys[i], values[i]) == 0) {return 0;}
+    }
+    return 1;
+}
+
+/**
+ * Adds copies of the records returned by next, until it returns 0.
+ * @param builder a builder.
+ * @param next returns the records.
+ * @param context passed to next.
+ * @return 1 on success, 0 otherwise (the records before the failed one were added).
+ */
+int hashmap_builder_add_stream (hashmap_builder *builder, hashmap_builder_next next,
+                                void *context)
+{
+    if ((builder == NULL) || (next == NULL)) {return 0;}
+    const_keyT key = NULL;
+    const_valueT value = NULL;
+    while (next (context, &key, &value) == 1)
+    {
+        if (hashmap_builder_add (builder, key, value) == 0) {return 0;}
+    }
+    return 1;
+}
+
+/**
+ * Decodes the fields of a record of a file and adds it, without copying them again.
+ * @return 1 on success, 0 otherwise.
+ */
+int add_decoded (hashmap_builder *builder, const hashmap_builder_format *format,
+                 const char *key, size_t key_size, const char *value, size_t value_size)
+{
+    keyT key_decoded = format->decode_key (key, key_size);
+    if (key_decoded == NULL) {return 0;}
+    valueT value_decoded = format->decode_value (value, value_size);
+    if (value_decoded == NULL)
+    {
+        builder->functions.key_free (&key_decoded);
+        return 0;
+    }
+    return builder_push (builder, builder->func (key_decoded), key_decoded, value_decoded);
+}
+
+/**
+ * Adds the complete text lines of a chunk of a file.
+ * @param data, size - the chunk.
+ * @param end 1 if the chunk ends the file (its last line needs no '\n').
+ * @param used set to the number of bytes of the lines added.
+ * @return 1 on success, 0 if a line is invalid.
+ */
+int parse_text (hashmap_builder *builder, const hashmap_builder_format *format,
+                const char *data, size_t size, int end, size_t *used)
+{
+    size_t pos = 0;
+    int success = 1;
+    while ((success == 1) && (pos < size))
+    {
+        const char *line = data + pos;
+        const char *newline = memchr (line, '\n', size - pos);
+        if ((newline == NULL) && (end == 0)) {break;}
+        size_t length = (newline == NULL) ? size - pos : (size_t) (newline - line);
+        size_t next = pos + length + (newline != NULL);
+        if ((length > 0) && (line[length - 1] == '\r')) {--length;}
+        if (length > 0)
+        {
+            const char *delimiter = memchr (line, format->delimiter, length);
+            size_t key_size = (delimiter == NULL) ? 0 : (size_t) (delimiter - line);
+            success = (delimiter != NULL)
+                      && add_decoded (builder, format, line, key_size, delimiter + 1,
+                                      length - key_size - 1);
+        }
+        if (success == 1) {pos = next;}
+    }
+    *used = pos;
+    return success;
+}
+
+/**
+ * @return the value of 4 bytes, little endian.
+ */
+size_t read_u32 (const char *data)
+{
+    const unsigned char *bytes = (const unsigned char *) data;
+    return (size_t) bytes[0] | ((size_t) bytes[1] << 8) | ((size_t) bytes[2] << 16)
+           | ((size_t) bytes[3] << 24);
+}
+
+/**
+ * Adds the complete length prefixed records of a chunk of a file.
+ * @param data, size - the chunk.
+ * @param end 1 if the chunk ends the file (a record left incomplete is truncated).
+ * @param used set to the number of bytes of the records added.
+ * @return 1 on success, 0 if a record is invalid or truncated.
+ */
+int parse_binary (hashmap_builder *builder, const hashmap_builder_format *format,
+                  const char *data, size_t size, int end, size_t *used)
+{
+    size_t pos = 0;
+    int success = 1;
+    while ((success == 1) && (size - pos >= 4))
+    {
+        size_t key_size = read_u32 (data + pos);
+        if (size - pos - 4 < key_size + 4) {break;}
+        size_t value_size = read_u32 (data + pos + 4 + key_size);
+        if (size - pos - 8 - key_size < value_size) {break;}
+        success = add_decoded (builder, format, data + pos + 4, key_size,
+                               data + pos + 8 + key_size, value_size);
+        if (success == 1) {pos += 8 + key_size + value_size;}
+    }
+    *used = pos;
+    return success && ((end == 0) || (pos == size));
+}
+
+/**
+ * @return the size of a file opened for reading, 0 if it is unknown.
+ */
+size_t file_size (FILE *file)
+{
+    if (fseek (file, 0, SEEK_END) != 0) {return 0;}
+    long size = ftell (file);
+    if ((fseek (file, 0, SEEK_SET) != 0) || (size < 0)) {return 0;}
+    return (size_t) size;
+}
+
+/**
+ * Adds the records of a file, read in chunks of HASHMAP_BUILDER_CHUNK bytes. The
+ * records are reserved once, for the number estimated from the size of the file and
+ * the records of the first chunk. The decoded keys and values are not copied again.
+ * @param builder a builder.
+ * @param path the path of the file.
+ * @param format the format of the records.
+ * @return 1 on success, 0 otherwise (a record is invalid or truncated, or the file
+ * could not be read; the records before it were added).
+ */
+int hashmap_builder_add_file (hashmap_builder *builder, const char *path,
+                              const hashmap_builder_format *format)
+{
+    if ((builder == NULL) || (path == NULL) || (format == NULL)
+        || (format->decode_key == NULL) || (format->decode_value == NULL))
+    {
+        return 0;
+    }
+    FILE *file = fopen (path, "rb");
+    if (file == NULL) {return 0;}
+    size_t total = file_size (file);
+    size_t capacity = HASHMAP_BUILDER_CHUNK;
+    char *chunk = (char *) malloc (capacity);
+    size_t held = 0, offset = 0;
+    int success = (chunk != NULL), end = 0, estimated = 0;
+    while ((success == 1) && (end == 0))
+    {
+        if (held == capacity)
+        {
+            // a record longer than the chunk
+            char *larger = (capacity <= (size_t) -1 / 2) ? realloc (chunk, capacity * 2) : NULL;
+            if (larger == NULL) {success = 0; break;}
+            chunk = larger;
+            capacity *= 2;
+        }
+        size_t n = fread (chunk + held, 1, capacity - held, file);
+        if (n < capacity - held)
+        {
+            if (ferror (file)) {success = 0; break;}
+            end = 1;
+        }
+        held += n;
+        size_t used = 0, before = builder->size;
+        success = (format->binary ? parse_binary : parse_text) (builder, format, chunk, held,
+                                                                end, &used);
+        offset += used;
+        if ((estimated == 0) && (used > 0) && (total > offset))
+        {
+            // the rest of the file holds about as many records per byte
+            estimated = 1;
+            double per_byte = (double) (builder->size - before) / (double) used;
+            hashmap_builder_reserve (builder, (size_t) (per_byte * (double) (total - offset)));
+        }
+        memmove (chunk, chunk + used, held - used);
+        held -= used;
+    }
+    free (chunk);
+    fclose (file);
+    return success;
+}
+
+/**
+ * Places a record into its bucket, as a new pair or by the policy of the builder if
+ * the bucket holds its key already. The key and value of the record are moved to
+ * the hash map, or freed.
+ * @return 1 on success, 0 otherwise.
+ */
+int place_record (hashmap *map, const hashmap_builder *builder, vector *bucket,
+                  hashmap_builder_record *record)
+{
+    if (builder->policy != HASH_MAP_BUILD_UNIQUE)
+    {
+        for (size_t i = 0; i < bucket->size; ++i)
+        {
+            pair *stored = bucket->data[i];
+            if (stored->key_cmp (stored->key, record->key) != 1) {continue;}
+            if (builder->policy == HASH_MAP_BUILD_REJECT) {return 0;}
+            if (builder->policy == HASH_MAP_BUILD_KEEP_LAST)
+            {
+                valueT value = stored->value;
+                stored->value = record->value;
+                record->value = value;
+            }
+            builder_drop (builder, record);
+            return 1;
+        }
+    }
+    pair *p = (pair *) allocator_alloc (map->allocator, sizeof(pair));
+    if (p == NULL) {return 0;}
+    *p = builder->functions;
+    p->key = record->key;
+    p->value = record->value;
+    if (vector_emplace_back (bucket, p) == 0)
+    {
+        allocator_free (map->allocator, p, sizeof(pair));
+        return 0;
+    }
+    record->key = NULL;
+    record->value = NULL;
+    ++map->size;
+    return 1;
+}
+
+/**
+ * Builds the hash map of the records and frees the builder. The bucket array is
+ * allocated once, for all the records, the records are partitioned by their bucket
+ * (a counting sort, stable), and every bucket is filled at once. The keys are
+ * compared only with those of their own bucket, and not at all by
+ * HASH_MAP_BUILD_UNIQUE.
+ * @param p_builder pointer to dynamically allocated pointer to builder, set to NULL.
+ * @return pointer to dynamically allocated hashmap.
+ * @if_fail return NULL (a key was added twice with HASH_MAP_BUILD_REJECT, or an
+ * allocation failed).
+ */
+hashmap *hashmap_builder_build (hashmap_builder **p_builder)
+{
+    if ((p_builder == NULL) || (*p_builder == NULL)) {return NULL;}
+    hashmap_builder *builder = *p_builder;
+    *p_builder = NULL;
+    size_t n = builder->size;
+    hashmap *map = hashmap_alloc_ex (builder->func, builder->allocator);
+    size_t *ends = NULL, *order = NULL;
+    int success = (map != NULL) && hashmap_reserve (map, n);
+    if (success == 1)
+    {
+        ends = (size_t *) calloc (map->capacity + 1, sizeof(size_t));
+        order = (size_t *) malloc (((n > 0) ? n : 1) * sizeof(size_t));
+        success = (ends != NULL) && (order != NULL);
+    }
+    if (success == 1)
+    {
+        size_t mask = map->capacity - 1;
+        for (size_t i = 0; i < n; ++i) {++ends[(builder->records[i].hash & mask) + 1];}
+        for (size_t b = 1; b <= map->capacity; ++b) {ends[b] += ends[b - 1];}
+        // ends[b] moves from the first index of bucket b to its end
+        for (size_t i = 0; i < n; ++i) {order[ends[builder->records[i].hash & mask]++] = i;}
+        size_t first = 0;
+        for (size_t b = 0; (success == 1) && (b < map->capacity); ++b)
+        {
+            vector *bucket = &(map->buckets[b]);
+            if (ends[b] - first > VECTOR_INLINE_CAP)
+            {
+                success = vector_reserve (bucket, ends[b] - first);
+            }
+            for (size_t i = first; (success == 1) && (i < ends[b]); ++i)
+            {
+                success = place_record (map, builder, bucket, &(builder->records[order[i]]));
+            }
+            first = ends[b];
+        }
+    }
+    free (ends);
+    free (order);
+    if (success == 0) {hashmap_free (&map);}
+    hashmap_builder_free (&builder);
+    return map;
+}
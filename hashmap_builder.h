@@ -0,0 +1,187 @@
+#ifndef HASHMAP_BUILDER_H_
+#define HASHMAP_BUILDER_H_
+
+#include "hashmap.h"
+
+/**
+ * @def HASHMAP_BUILDER_CHUNK
+ * The number of bytes of a file read at once by hashmap_builder_add_file.
+ */
+#define HASHMAP_BUILDER_CHUNK 1048576UL
+
+/**
+ * @enum hashmap_builder_policy
+ * Decides what is built when a key was added more than once.
+ * @param HASH_MAP_BUILD_KEEP_FIRST the value added first is kept.
+ * @param HASH_MAP_BUILD_KEEP_LAST the value added last is kept.
+ * @param HASH_MAP_BUILD_REJECT the build fails.
+ * @param HASH_MAP_BUILD_UNIQUE the keys are known to be distinct and are not
+ * compared at all (a duplicate key is stored twice).
+ */
+typedef enum hashmap_builder_policy {
+    HASH_MAP_BUILD_KEEP_FIRST,
+    HASH_MAP_BUILD_KEEP_LAST,
+    HASH_MAP_BUILD_REJECT,
+    HASH_MAP_BUILD_UNIQUE
+} hashmap_builder_policy;
+
+/**
+ * @typedef hashmap_builder_next
+ * Function which receives the context given to hashmap_builder_add_stream, sets the
+ * key and value of the next record (copied by the builder) and returns 1, or returns
+ * 0 at the end of the records.
+ */
+typedef int (*hashmap_builder_next) (void *, const_keyT *, const_valueT *);
+
+/**
+ * @typedef hashmap_builder_decode
+ * Function which receives the bytes of a key or value field of a file and their
+ * number, and returns a dynamically allocated key or value (freed by the key_free
+ * or value_free of the builder), NULL if the field is invalid.
+ */
+typedef void *(*hashmap_builder_decode) (const char *, size_t);
+
+/**
+ * @struct hashmap_builder_format - the format of the records of a file.
+ * @param binary 0 for text lines "key<delimiter>value" (empty lines are skipped, a
+ * '\r' before the '\n' is dropped), 1 for length prefixed fields: the size of the key
+ * (32 bits, little endian), the key, the size of the value and the value.
+ * @param delimiter the separator of the key and the value of a text line.
+ * @param decode_key, decode_value - decode the fields.
+ */
+typedef struct hashmap_builder_format {
+    int binary;
+    char delimiter;
+    hashmap_builder_decode decode_key;
+    hashmap_builder_decode decode_value;
+} hashmap_builder_format;
+
+/**
+ * @struct hashmap_builder_record - a key and value added to a builder.
+ * @param hash the hash of the key.
+ * @param key, value - owned by the builder until they are built into the hash map.
+ */
+typedef struct hashmap_builder_record {
+    size_t hash;
+    keyT key;
+    valueT value;
+} hashmap_builder_record;
+
+/**
+ * @struct hashmap_builder - collects the records of a hash map and builds it at once:
+ * the bucket array is allocated for all of them and the pairs are placed bucket by
+ * bucket, without the load checks, resizes and pair copies of hashmap_insert.
+ * @param func the hash function of the hash map.
+ * @param functions the copy, compare and free functions of the pairs.
+ * @param policy how the duplicate keys are resolved.
+ * @param allocator the allocator of the hash map (see hashmap_alloc_ex).
+ * @param records the records added so far, in their order.
+ * @param size, capacity - the size and capacity of records.
+ */
+typedef struct hashmap_builder {
+    hash_func func;
+    pair functions;
+    hashmap_builder_policy policy;
+    const allocator *allocator;
+    hashmap_builder_record *records;
+    size_t size;
+    size_t capacity;
+} hashmap_builder;
+
+/**
+ * Allocates dynamically an empty builder of a hash map.
+ * @param func a function which "hashes" keys.
+ * @param functions a pair whose copy, compare and free functions the pairs of the
+ * hash map get (its key and value are ignored).
+ * @param policy how the keys added more than once are resolved.
+ * @return pointer to dynamically allocated builder.
+ * @if_fail return NULL.
+ */
+hashmap_builder *hashmap_builder_alloc (hash_func func, const pair *functions,
+                                        hashmap_builder_policy policy);
+
+/**
+ * Allocates dynamically an empty builder of a hash map which is allocated with
+ * the given allocator (see hashmap_alloc_ex).
+ * @param func a function which "hashes" keys.
+ * @param functions a pair whose copy, compare and free functions the pairs of the
+ * hash map get (its key and value are ignored).
+ * @param policy how the keys added more than once are resolved.
+ * @param allocator the allocator of the hash map, NULL for malloc.
+ * @return pointer to dynamically allocated builder.
+ * @if_fail return NULL.
+ */
+hashmap_builder *hashmap_builder_alloc_ex (hash_func func, const pair *functions,
+                                           hashmap_builder_policy policy,
+                                           const allocator *allocator);
+
+/**
+ * Frees a builder and the records added to it.
+ * @param p_builder pointer to dynamically allocated pointer to builder.
+ */
+void hashmap_builder_free (hashmap_builder **p_builder);
+
+/**
+ * Extends the records of the builder, if needed, so that count more records can be
+ * added without reallocating them.
+ * @param builder a builder.
+ * @param count the number of records to be added.
+ * @return 1 on success, 0 otherwise.
+ */
+int hashmap_builder_reserve (hashmap_builder *builder, size_t count);
+
+/**
+ * Adds a copy of a record.
+ * @param builder a builder.
+ * @param key, value - copied by the key_cpy and value_cpy of the builder.
+ * @return 1 on success, 0 otherwise.
+ */
+int hashmap_builder_add (hashmap_builder *builder, const_keyT key, const_valueT value);
+
+/**
+ * Adds copies of count records, reserved at once.
+ * @param builder a builder.
+ * @param keys, values - the keys and values of the records.
+ * @param count the number of records.
+ * @return 1 on success, 0 otherwise (the records before the failed one were added).
+ */
+int hashmap_builder_add_array (hashmap_builder *builder, const const_keyT *keys,
+                               const const_valueT *values, size_t count);
+
+/**
+ * Adds copies of the records returned by next, until it returns 0.
+ * @param builder a builder.
+ * @param next returns the records.
+ * @param context passed to next.
+ * @return 1 on success, 0 otherwise (the records before the failed one were added).
+ */
+int hashmap_builder_add_stream (hashmap_builder *builder, hashmap_builder_next next,
+                                void *context);
+
+/**
+ * Adds the records of a file, read in chunks of HASHMAP_BUILDER_CHUNK bytes. The
+ * records are reserved once, for the number estimated from the size of the file and
+ * the records of the first chunk. The decoded keys and values are not copied again.
+ * @param builder a builder.
+ * @param path the path of the file.
+ * @param format the format of the records.
+ * @return 1 on success, 0 otherwise (a record is invalid or truncated, or the file
+ * could not be read; the records before it were added).
+ */
+int hashmap_builder_add_file (hashmap_builder *builder, const char *path,
+                              const hashmap_builder_format *format);
+
+/**
+ * Builds the hash map of the records and frees the builder. The bucket array is
+ * allocated once, for all the records, the records are partitioned by their bucket
+ * (a counting sort, stable), and every bucket is filled at once. The keys are
+ * compared only with those of their own bucket, and not at all by
+ * HASH_MAP_BUILD_UNIQUE.
+ * @param p_builder pointer to dynamically allocated pointer to builder, set to NULL.
+ * @return pointer to dynamically allocated hashmap.
+ * @if_fail return NULL (a key was added twice with HASH_MAP_BUILD_REJECT, or an
+ * allocation failed).
+ */
+hashmap *hashmap_builder_build (hashmap_builder **p_builder);
+
+#endif //HASHMAP_BUILDER_H_
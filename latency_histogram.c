@@ -0,0 +1,133 @@
+//
+// log-bucketed latency histograms for the hashmap library.
+//
+#define _POSIX_C_SOURCE 199309L
+
+#include <time.h>
+#include "latency_histogram.h"
+
+size_t value_to_bucket (unsigned long long value);
+unsigned long long bucket_upper_bound (size_t bucket);
+
+/**
+ * Returns the current time of a monotonic clock.
+ * @return the time in nanoseconds.
+ */
+unsigned long long latency_now_ns (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000ULL + (unsigned long long) ts.tv_nsec;
+}
+
+/**
+ * Records a value in the histogram.
+ * @param histogram a histogram.
+ * @param value the value to be recorded (usually nanoseconds).
+ */
+void latency_histogram_record (latency_histogram *histogram, unsigned long long value)
+{
+    if (histogram == NULL) {return;}
+    if ((histogram->count == 0) || (value < histogram->min)) {histogram->min = value;}
+    if (value > histogram->max) {histogram->max = value;}
+    histogram->total += value;
+    ++(histogram->count);
+    ++(histogram->buckets[value_to_bucket (value)]);
+}
+
+/**
+ * Returns the value at the given percentile of the recorded values, by nearest rank.
+ * @param histogram a histogram.
+ * @param percentile the percentile, in [0, 100].
+ * @return the upper bound of the bucket holding the percentile
+ * (clipped to the largest recorded value), 0 if nothing was recorded.
+ */
+unsigned long long latency_histogram_percentile (const latency_histogram *histogram,
+                                                 double percentile)
+{
+    if ((histogram == NULL) || (histogram->count == 0)) {return 0;}
+    if (percentile < 0) {percentile = 0;}
+    if (percentile > 100) {percentile = 100;}
+    // the nearest rank, ceil (percentile / 100 * count) in [1, count]
+    double exact = percentile / 100.0 * (double) histogram->count;
+    size_t rank = (size_t) exact;
+    if ((double) rank < exact) {++rank;}
+    if (rank == 0) {rank = 1;}
+    if (rank > histogram->count) {rank = histogram->count;}
+    size_t seen = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i)
+    {
+        seen += histogram->buckets[i];
+        if (seen >= rank)
+        {
+            unsigned long long bound = bucket_upper_bound (i);
+            return bound < histogram->max ? bound : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+/**
+ * Deletes all the recorded values of the histogram.
+ * @param histogram a histogram.
+ */
+void latency_histogram_clear (latency_histogram *histogram)
+{
+    if (histogram == NULL) {return;}
+    *histogram = (latency_histogram) {0};
+}
+
+/**
+ * Prints one line summary of the histogram: count, mean, min, p50, p90, p99,
+ * p99.9 and max.
+ * @param histogram a histogram.
+ * @param name the name printed at the beginning of the line.
+ * @param out the stream to print to.
+ */
+void latency_histogram_print (const latency_histogram *histogram, const char *name,
+                              FILE *out)
+{
+    if ((histogram == NULL) || (name == NULL) || (out == NULL)) {return;}
+    double mean = 0;
+    if (histogram->count > 0)
+    {
+        mean = (double) histogram->total / (double) histogram->count;
+    }
+    fprintf (out, "%-14s count=%zu mean=%.1f min=%llu p50=%llu p90=%llu p99=%llu "
+                  "p99.9=%llu max=%llu\n",
+             name, histogram->count, mean, histogram->min,
+             latency_histogram_percentile (histogram, 50),
+             latency_histogram_percentile (histogram, 90),
+             latency_histogram_percentile (histogram, 99),
+             latency_histogram_percentile (histogram, 99.9),
+             histogram->max);
+}
+
+/**
+ * Returns the bucket of a value: values below SUB_BUCKETS get a bucket each,
+ * every higher power of 2 is split into SUB_BUCKETS equal buckets.
+ * @param value a value.
+ * @return the index of the bucket of the value.
+ */
+size_t value_to_bucket (unsigned long long value)
+{
+    if (value < LATENCY_HISTOGRAM_SUB_BUCKETS) {return (size_t) value;}
+    size_t msb = 63 - (size_t) __builtin_clzll (value);
+    size_t shift = msb - LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+    size_t sub_bucket = (size_t) (value >> shift) & (LATENCY_HISTOGRAM_SUB_BUCKETS - 1);
+    return (shift + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS + sub_bucket;
+}
+
+/**
+ * Returns the largest value that belongs to the given bucket.
+ * @param bucket an index of a bucket.
+ * @return the upper bound of the bucket.
+ */
+unsigned long long bucket_upper_bound (size_t bucket)
+{
+    if (bucket < LATENCY_HISTOGRAM_SUB_BUCKETS) {return bucket;}
+    size_t shift = bucket / LATENCY_HISTOGRAM_SUB_BUCKETS - 1;
+    unsigned long long sub_bucket = (bucket % LATENCY_HISTOGRAM_SUB_BUCKETS) +
+                                    LATENCY_HISTOGRAM_SUB_BUCKETS;
+    return ((sub_bucket + 1) << shift) - 1;
+}
@@ -0,0 +1,81 @@
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @def LATENCY_HISTOGRAM_SUB_BUCKETS
+ * The number of linear sub-buckets every power of 2 is split into.
+ * Recorded values are kept with a relative error of at most 1 / SUB_BUCKETS.
+ */
+#define LATENCY_HISTOGRAM_SUB_BUCKETS 8UL
+
+/**
+ * @def LATENCY_HISTOGRAM_SUB_BUCKET_BITS
+ * log2 of LATENCY_HISTOGRAM_SUB_BUCKETS.
+ */
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS 3UL
+
+/**
+ * @def LATENCY_HISTOGRAM_BUCKETS
+ * The number of buckets of the histogram, enough for any 64 bit value.
+ */
+#define LATENCY_HISTOGRAM_BUCKETS (64UL * LATENCY_HISTOGRAM_SUB_BUCKETS)
+
+/**
+ * @struct latency_histogram - a log-bucketed (HDR style) histogram of latencies.
+ * @param count the number of recorded values.
+ * @param min, max - the smallest and largest recorded values.
+ * @param total the sum of the recorded values.
+ * @param buckets the number of recorded values in every bucket.
+ */
+typedef struct latency_histogram {
+    size_t count;
+    unsigned long long min;
+    unsigned long long max;
+    unsigned long long total;
+    size_t buckets[LATENCY_HISTOGRAM_BUCKETS];
+} latency_histogram;
+
+/**
+ * Returns the current time of a monotonic clock.
+ * @return the time in nanoseconds.
+ */
+unsigned long long latency_now_ns (void);
+
+/**
+ * Records a value in the histogram.
+ * @param histogram a histogram.
+ * @param value the value to be recorded (usually nanoseconds).
+ */
+void latency_histogram_record (latency_histogram *histogram, unsigned long long value);
+
+/**
+ * Returns the value at the given percentile of the recorded values, by nearest rank:
+ * the ceil (percentile / 100 * count)-th smallest value, at least the smallest one.
+ * @param histogram a histogram.
+ * @param percentile the percentile, in [0, 100].
+ * @return the upper bound of the bucket holding the percentile
+ * (clipped to the largest recorded value), 0 if nothing was recorded.
+ */
+unsigned long long latency_histogram_percentile (const latency_histogram *histogram,
+                                                 double percentile);
+
+/**
+ * Deletes all the recorded values of the histogram.
+ * @param histogram a histogram.
+ */
+void latency_histogram_clear (latency_histogram *histogram);
+
+/**
+ * Prints one line summary of the histogram: count, mean, min, p50, p90, p99,
+ * p99.9 and max.
+ * @param histogram a histogram.
+ * @param name the name printed at the beginning of the line.
+ * @param out the stream to print to.
+ */
+void latency_histogram_print (const latency_histogram *histogram, const char *name,
+                              FILE *out);
+
+#endif //LATENCY_HISTOGRAM_H_
@@ -0,0 +1,308 @@
+//
+// A bounded least recently used cache, built on the hashmap library.
+//
+#include "lru_hashmap.h"
+
+valueT lru_entry_identity (const_valueT entry);
+int lru_entry_cmp (const_valueT entry1, const_valueT entry2);
+void lru_entry_free (valueT *entry);
+void lru_entry_keep (valueT *entry);
+void lru_unlink (lru_hashmap *lru, lru_entry *entry);
+void lru_push_front (lru_hashmap *lru, lru_entry *entry);
+int lru_over_limits (const lru_hashmap *lru);
+void lru_evict_tail (lru_hashmap *lru);
+// the lookup of hashmap.c which returns the stored pair
+pair *find_or_insert_pair (hashmap *hash_map, const pair *in_pair, int *inserted);
+
+/**
+ * Allocates dynamically a new cache.
+ * @param func a function which "hashes" keys.
+ * @param max_entries the maximal number of entries, 0 for no limit.
+ * @param max_bytes the maximal sum of the sizes of the entries, 0 for no limit.
+ * @param size_func the size function of the entries, may be NULL if max_bytes is 0.
+ * @return pointer to dynamically allocated cache.
+ * @if_fail return NULL.
+ */
+lru_hashmap *lru_hashmap_alloc (hash_func func, size_t max_entries, size_t max_bytes,
+                                lru_size_func size_func)
+{
+    if ((func == NULL) || ((max_bytes != 0) && (size_func == NULL))) {return NULL;}
+    lru_hashmap *lru = (lru_hashmap *) malloc (sizeof(lru_hashmap));
+    if (lru == NULL) {return NULL;}
+    lru->map = hashmap_alloc (func);
+    if (lru->map == NULL)
+    {
+        free (lru);
+        return NULL;
+    }
+    lru->head = NULL;
+    lru->tail = NULL;
+    lru->max_entries = max_entries;
+    lru->max_bytes = max_bytes;
+    lru->bytes = 0;
+    lru->size_func = size_func;
+    lru->evict_func = NULL;
+    lru->evict_ctx = NULL;
+    lru->counters = (lru_counters) {0};
+    return lru;
+}
+
+/**
+ * Frees a cache and all its entries. The evict function is not called.
+ * @param p_lru pointer to dynamically allocated pointer to cache.
+ */
+void lru_hashmap_free (lru_hashmap **p_lru)
+{
+    if ((p_lru != NULL) && (*p_lru != NULL))
+    {
+        hashmap_free (&((*p_lru)->map));
+        free (*p_lru);
+        *p_lru = NULL;
+    }
+}
+
+/**
+ * Sets the function called for every entry the cache evicts.
+ * @param lru a cache.
+ * @param evict_func the function, NULL for none.
+ * @param ctx the context passed to evict_func.
+ */
+void lru_hashmap_set_evict_func (lru_hashmap *lru, lru_evict_func evict_func, void *ctx)
+{
+    if (lru == NULL) {return;}
+    lru->evict_func = evict_func;
+    lru->evict_ctx = ctx;
+}
+
+/**
+ * Inserts a copy of in_pair to the cache, or replaces the value of its key,
+ * and makes it the most recently used entry. Then the least recently used
+ * entries are evicted until the cache is within its limits.
+ * The hash map stores a pair whose value is the lru_entry itself: its value_cpy
+ * returns the entry as is, so inserting the pair moves the entry into the map.
+ * Its value_free becomes lru_entry_free once the insertion succeeded, so a failed
+ * insertion leaves the entry to be freed here.
+ * @param lru a cache.
+ * @param in_pair the pair to be inserted, copied by its key_cpy and value_cpy.
+ * @return 1 if the pair was inserted or its value replaced, 0 otherwise
+ * (also if the pair alone is larger than the byte budget).
+ */
+int lru_hashmap_upsert (lru_hashmap *lru, const pair *in_pair)
+{
+    if ((lru == NULL) || (in_pair == NULL)) {return 0;}
+    size_t bytes = 0;
+    if (lru->size_func != NULL)
+    {
+        bytes = lru->size_func (in_pair->key, in_pair->value);
+    }
+    if ((lru->max_bytes != 0) && (bytes > lru->max_bytes)) {return 0;}
+    lru_entry *entry = (lru_entry *) malloc (sizeof(lru_entry));
+    if (entry == NULL) {return 0;}
+    entry->value = in_pair->value_cpy (in_pair->value);
+    if (entry->value == NULL)
+    {
+        free (entry);
+        return 0;
+    }
+    entry->value_free = in_pair->value_free;
+    entry->bytes = bytes;
+    entry->prev = NULL;
+    entry->next = NULL;
+
+    pair entry_pair = {(keyT) in_pair->key, entry, in_pair->key_cpy, lru_entry_identity,
+                       in_pair->key_cmp, lru_entry_cmp, in_pair->key_free, lru_entry_keep,
+                       NULL, NULL};
+    int inserted = 0;
+    pair *stored_pair = find_or_insert_pair (lru->map, &entry_pair, &inserted);
+    if (stored_pair == NULL)
+    {
+        valueT unused = entry;
+        lru_entry_free (&unused);
+        return 0;
+    }
+    if (inserted == 1)
+    {
+        // the key of the entry is the key of the pair the map stores
+        stored_pair->value_free = lru_entry_free;
+        entry->key = stored_pair->key;
+    }
+    else
+    {
+        // the stored entry keeps its place in the map, and takes the new value
+        lru_entry *stored = stored_pair->value;
+        lru_unlink (lru, stored);
+        stored->value_free (&(stored->value));
+        stored->value = entry->value;
+        stored->value_free = entry->value_free;
+        stored->bytes = entry->bytes;
+        free (entry);
+        entry = stored;
+    }
+    lru_push_front (lru, entry);
+    while (lru_over_limits (lru))
+    {
+        lru_evict_tail (lru);
+    }
+    return 1;
+}
+
+/**
+ * Returns the value of the key and makes it the most recently used entry.
+ * @param lru a cache.
+ * @param key the key to be checked.
+ * @return the value of the key if exists, NULL otherwise.
+ */
+valueT lru_hashmap_at (lru_hashmap *lru, const_keyT key)
+{
+    if ((lru == NULL) || (key == NULL)) {return NULL;}
+    lru_entry *entry = hashmap_at (lru->map, key);
+    if (entry == NULL)
+    {
+        ++(lru->counters.misses);
+        return NULL;
+    }
+    ++(lru->counters.hits);
+    if (entry != lru->head)
+    {
+        lru_unlink (lru, entry);
+        lru_push_front (lru, entry);
+    }
+    return entry->value;
+}
+
+/**
+ * Returns the value of the key, without changing its recency or the counters.
+ * @param lru a cache.
+ * @param key the key to be checked.
+ * @return the value of the key if exists, NULL otherwise.
+ */
+valueT lru_hashmap_peek (const lru_hashmap *lru, const_keyT key)
+{
+    if ((lru == NULL) || (key == NULL)) {return NULL;}
+    lru_entry *entry = hashmap_at (lru->map, key);
+    if (entry == NULL) {return NULL;}
+    return entry->value;
+}
+
+/**
+ * Erases the entry of the key from the cache. The evict function is not called.
+ * @param lru a cache.
+ * @param key the key to be erased.
+ * @return 1 if the erasing was done successfully, 0 otherwise.
+ */
+int lru_hashmap_erase (lru_hashmap *lru, const_keyT key)
+{
+    if ((lru == NULL) || (key == NULL)) {return 0;}
+    lru_entry *entry = hashmap_at (lru->map, key);
+    if (entry == NULL) {return 0;}
+    lru_unlink (lru, entry);
+    return hashmap_erase (lru->map, key);
+}
+
+/**
+ * The value_cpy of the pairs stored in the hash map: the entry is moved, not copied.
+ * @param entry an lru_entry.
+ * @return the same entry.
+ */
+valueT lru_entry_identity (const_valueT entry)
+{
+    return (valueT) entry;
+}
+
+/**
+ * The value_cmp of the pairs stored in the hash map.
+ * @param entry1, entry2 - lru entries.
+ * @return 1 if they are the same entry, 0 otherwise.
+ */
+int lru_entry_cmp (const_valueT entry1, const_valueT entry2)
+{
+    return entry1 == entry2;
+}
+
+/**
+ * The value_free of the pairs stored in the hash map: frees the user's value
+ * and the entry. The entry must already be unlinked from the recency list
+ * (or the whole cache freed).
+ * @param entry pointer to an lru_entry.
+ */
+void lru_entry_free (valueT *entry)
+{
+    if ((entry == NULL) || (*entry == NULL)) {return;}
+    lru_entry *e = *entry;
+    if (e->value != NULL)
+    {
+        e->value_free (&(e->value));
+    }
+    free (e);
+    *entry = NULL;
+}
+
+/**
+ * The value_free of a pair not yet stored in the hash map: the entry stays
+ * owned by lru_hashmap_upsert.
+ * @param entry pointer to an lru_entry.
+ */
+void lru_entry_keep (valueT *entry)
+{
+    (void) entry;
+}
+
+/**
+ * Removes an entry from the recency list (and from the byte count).
+ * @param lru a cache.
+ * @param entry an entry of the cache.
+ */
+void lru_unlink (lru_hashmap *lru, lru_entry *entry)
+{
+    if (entry->prev != NULL) {entry->prev->next = entry->next;}
+    else {lru->head = entry->next;}
+    if (entry->next != NULL) {entry->next->prev = entry->prev;}
+    else {lru->tail = entry->prev;}
+    entry->prev = NULL;
+    entry->next = NULL;
+    lru->bytes -= entry->bytes;
+}
+
+/**
+ * Adds an entry to the front (most recently used end) of the recency list.
+ * @param lru a cache.
+ * @param entry an entry of the cache, not in the list.
+ */
+void lru_push_front (lru_hashmap *lru, lru_entry *entry)
+{
+    entry->prev = NULL;
+    entry->next = lru->head;
+    if (lru->head != NULL) {lru->head->prev = entry;}
+    lru->head = entry;
+    if (lru->tail == NULL) {lru->tail = entry;}
+    lru->bytes += entry->bytes;
+}
+
+/**
+ * Checks whether the cache holds more entries or bytes than its limits.
+ * @param lru a cache.
+ * @return 1 if an entry should be evicted, 0 otherwise.
+ */
+int lru_over_limits (const lru_hashmap *lru)
+{
+    if (lru->tail == NULL) {return 0;}
+    if ((lru->max_entries != 0) && (lru->map->size > lru->max_entries)) {return 1;}
+    return (lru->max_bytes != 0) && (lru->bytes > lru->max_bytes);
+}
+
+/**
+ * Evicts the least recently used entry: calls the evict function and erases it.
+ * @param lru a non-empty cache.
+ */
+void lru_evict_tail (lru_hashmap *lru)
+{
+    lru_entry *entry = lru->tail;
+    if (lru->evict_func != NULL)
+    {
+        lru->evict_func (entry->key, entry->value, lru->evict_ctx);
+    }
+    lru_unlink (lru, entry);
+    ++(lru->counters.evictions);
+    // the key belongs to the pair being erased, which is only compared before it is freed
+    hashmap_erase (lru->map, entry->key);
+}
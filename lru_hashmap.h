@@ -0,0 +1,136 @@
+#ifndef LRU_HASHMAP_H_
+#define LRU_HASHMAP_H_
+
+#include "hashmap.h"
+
+/**
+ * @typedef lru_size_func
+ * Function which receives a key and a value stored in the cache and returns
+ * the number of bytes they are charged against the byte budget.
+ */
+typedef size_t (*lru_size_func) (const_keyT, const_valueT);
+
+/**
+ * @typedef lru_evict_func
+ * Function which is called with the key and value of an entry just before the
+ * cache evicts (and frees) it, and with the context given to lru_hashmap_set_evict_func.
+ */
+typedef void (*lru_evict_func) (const_keyT, valueT, void *);
+
+/**
+ * @struct lru_entry - the value stored in the hash map of an lru_hashmap.
+ * @param prev, next - the neighbours of the entry in the recency list,
+ * prev is more recently used.
+ * @param key the key of the entry (owned by the pair stored in the hash map).
+ * @param value the value of the entry, a copy made by the pair's value_cpy.
+ * @param value_free the function which frees value.
+ * @param bytes the size of the entry, by the size function of the cache.
+ */
+typedef struct lru_entry {
+    struct lru_entry *prev;
+    struct lru_entry *next;
+    keyT key;
+    valueT value;
+    pair_value_free value_free;
+    size_t bytes;
+} lru_entry;
+
+/**
+ * @struct lru_counters
+ * @param hits the number of lru_hashmap_at calls which found their key.
+ * @param misses the number of lru_hashmap_at calls which did not.
+ * @param evictions the number of entries evicted to keep the cache within its limits.
+ */
+typedef struct lru_counters {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+} lru_counters;
+
+/**
+ * @struct lru_hashmap - a bounded cache which evicts its least recently used entries.
+ * @param map the hash map from the keys to their lru_entry.
+ * @param head, tail - the most and the least recently used entries.
+ * @param max_entries the maximal number of entries, 0 for no limit.
+ * @param max_bytes the maximal sum of the sizes of the entries, 0 for no limit.
+ * @param bytes the sum of the sizes of the entries.
+ * @param size_func the size function of the entries, NULL if every entry is 0 bytes.
+ * @param evict_func called for every evicted entry, NULL if none.
+ * @param evict_ctx the context passed to evict_func.
+ * @param counters the hit, miss and eviction counts of the cache.
+ */
+typedef struct lru_hashmap {
+    hashmap *map;
+    lru_entry *head;
+    lru_entry *tail;
+    size_t max_entries;
+    size_t max_bytes;
+    size_t bytes;
+    lru_size_func size_func;
+    lru_evict_func evict_func;
+    void *evict_ctx;
+    lru_counters counters;
+} lru_hashmap;
+
+/**
+ * Allocates dynamically a new cache.
+ * @param func a function which "hashes" keys.
+ * @param max_entries the maximal number of entries, 0 for no limit.
+ * @param max_bytes the maximal sum of the sizes of the entries, 0 for no limit.
+ * @param size_func the size function of the entries, may be NULL if max_bytes is 0.
+ * @return pointer to dynamically allocated cache.
+ * @if_fail return NULL.
+ */
+lru_hashmap *lru_hashmap_alloc (hash_func func, size_t max_entries, size_t max_bytes,
+                                lru_size_func size_func);
+
+/**
+ * Frees a cache and all its entries. The evict function is not called.
+ * @param p_lru pointer to dynamically allocated pointer to cache.
+ */
+void lru_hashmap_free (lru_hashmap **p_lru);
+
+/**
+ * Sets the function called for every entry the cache evicts.
+ * @param lru a cache.
+ * @param evict_func the function, NULL for none.
+ * @param ctx the context passed to evict_func.
+ */
+void lru_hashmap_set_evict_func (lru_hashmap *lru, lru_evict_func evict_func, void *ctx);
+
+/**
+ * Inserts a copy of in_pair to the cache, or replaces the value of its key,
+ * and makes it the most recently used entry. Then the least recently used
+ * entries are evicted until the cache is within its limits.
+ * @param lru a cache.
+ * @param in_pair the pair to be inserted, copied by its key_cpy and value_cpy.
+ * @return 1 if the pair was inserted or its value replaced, 0 otherwise
+ * (also if the pair alone is larger than the byte budget).
+ */
+int lru_hashmap_upsert (lru_hashmap *lru, const pair *in_pair);
+
+/**
+ * Returns the value of the key and makes it the most recently used entry.
+ * @param lru a cache.
+ * @param key the key to be checked.
+ * @return the value of the key if exists, NULL otherwise.
+ */
+valueT lru_hashmap_at (lru_hashmap *lru, const_keyT key);
+
+/**
+ * Returns the value of the key, without changing its recency or the counters.
+ * @param lru a cache.
+ * @param key the key to be checked.
+ * @return the value of the key if exists, NULL otherwise.
+ */
+valueT lru_hashmap_peek (const lru_hashmap *lru, const_keyT key);
+
+/**
+ * Erases the entry of the key from the cache. The evict function is not called.
+ * @param lru a cache.
+ * @param key the key to be erased.
+ * @return 1 if the erasing was done successfully, 0 otherwise.
+ */
+int lru_hashmap_erase (lru_hashmap *lru, const_keyT key);
+
+#endif //LRU_HASHMAP_H_
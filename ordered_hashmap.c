@@ -0,0 +1,398 @@
+//
+// An insertion ordered hash map: a dense array of entries and a sparse index table.
+//
+#include <stdint.h>
+#include "ordered_hashmap.h"
+
+/**
+ * @def INDEX_EMPTY, INDEX_DELETED
+ * The marks of the index table: a slot never used (probes stop at it), and a slot
+ * whose entry was erased (probes go on past it). Any other slot holds the position
+ * of its entry plus 2, so a zeroed table is empty.
+ */
+#define INDEX_EMPTY 0UL
+#define INDEX_DELETED 1UL
+#define INDEX_OFFSET 2UL
+
+/**
+ * @def ENTRY_NONE
+ * The entry position find_slot reports for a missing key.
+ */
+#define ENTRY_NONE ((size_t) -1)
+
+/**
+ * @def PERTURB_SHIFT
+ * The probe sequence of the index table mixes in PERTURB_SHIFT more bits of the
+ * hash at every step, so keys whose hashes differ only in their high bits part.
+ */
+#define PERTURB_SHIFT 5U
+
+size_t index_width_for (size_t index_capacity);
+size_t index_get (const ordered_hashmap *map, size_t slot);
+void index_set (ordered_hashmap *map, size_t slot, size_t value);
+size_t find_slot (const ordered_hashmap *map, const_keyT key, size_t hash, size_t *entry);
+size_t capacity_for (size_t entries);
+int rebuild (ordered_hashmap *map, size_t index_capacity);
+int ordered_find_or_insert (ordered_hashmap *map, const pair *in_pair, int *inserted,
+                            pair **stored);
+
+/**
+ * Allocates dynamically a new, empty ordered hash map.
+ * @param func a function which "hashes" keys.
+ * @return pointer to dynamically allocated ordered hash map.
+ * @if_fail return NULL.
+ */
+ordered_hashmap *ordered_hashmap_alloc (hash_func func)
+{
+    if (func == NULL) {return NULL;}
+    ordered_hashmap *map = (ordered_hashmap *) malloc (sizeof(ordered_hashmap));
+    if (map == NULL) {return NULL;}
+    map->index = NULL;
+    map->index_capacity = 0;
+    map->index_width = 0;
+    map->entries = NULL;
+    map->entries_used = 0;
+    map->size = 0;
+    map->hash_func = func;
+    if (rebuild (map, ORDERED_HASH_MAP_INITIAL_CAP) == 0)
+    {
+        free (map);
+        return NULL;
+    }
+    return map;
+}
+
+/**
+ * Frees an ordered hash map and all its pairs.
+ * @param p_map pointer to dynamically allocated pointer to ordered hash map.
+ */
+void ordered_hashmap_free (ordered_hashmap **p_map)
+{
+    if ((p_map != NULL) && (*p_map != NULL))
+    {
+        ordered_hashmap *map = *p_map;
+        for (size_t i = 0; i < map->entries_used; ++i)
+        {
+            pair_free ((void **) &(map->entries[i].p));
+        }
+        free (map->entries);
+        free (map->index);
+        free (map);
+        *p_map = NULL;
+    }
+}
+
+/**
+ * Appends a copy of in_pair to the hash map, if its key is not in it.
+ * @param map an ordered hash map.
+ * @param in_pair the pair to be inserted.
+ * @return 1 if the pair was inserted, 0 otherwise (also if the key exists).
+ */
+int ordered_hashmap_insert (ordered_hashmap *map, const pair *in_pair)
+{
+    int inserted = 0;
+    pair *stored = NULL;
+    if (ordered_find_or_insert (map, in_pair, &inserted, &stored) == 0) {return 0;}
+    return inserted;
+}
+
+/**
+ * Appends a copy of in_pair, or replaces in place the value of the stored pair
+ * with the same key (the pair keeps its position in the order).
+ * @param map an ordered hash map.
+ * @param in_pair the pair to be inserted or whose value replaces the stored one.
+ * @return 1 if the pair was inserted or its value replaced, 0 otherwise.
+ */
+int ordered_hashmap_upsert (ordered_hashmap *map, const pair *in_pair)
+{
+    int inserted = 0;
+    pair *stored = NULL;
+    if (ordered_find_or_insert (map, in_pair, &inserted, &stored) == 0) {return 0;}
+    if (inserted == 1) {return 1;}
+    valueT new_value = in_pair->value_cpy (in_pair->value);
+    if (new_value == NULL) {return 0;}
+    stored->value_free (&(stored->value));
+    stored->value = new_value;
+    stored->value_cpy = in_pair->value_cpy;
+    stored->value_cmp = in_pair->value_cmp;
+    stored->value_free = in_pair->value_free;
+    return 1;
+}
+
+/**
+ * Returns the value associated with the given key.
+ * @param map an ordered hash map.
+ * @param key the key to be checked.
+ * @return the value of the key if exists, NULL otherwise (the value itself,
+ * not a copy of it).
+ */
+valueT ordered_hashmap_at (const ordered_hashmap *map, const_keyT key)
+{
+    if ((map == NULL) || (key == NULL)) {return NULL;}
+    size_t entry = ENTRY_NONE;
+    find_slot (map, key, map->hash_func (key), &entry);
+    if (entry == ENTRY_NONE) {return NULL;}
+    return map->entries[entry].p->value;
+}
+
+/**
+ * Erases the pair of the key, leaving a hole in the entries. The holes are
+ * compacted away once they outnumber the pairs.
+ * @param map an ordered hash map.
+ * @param key the key of the pair to be erased.
+ * @return 1 if the erasing was done successfully, 0 otherwise.
+ */
+int ordered_hashmap_erase (ordered_hashmap *map, const_keyT key)
+{
+    if ((map == NULL) || (key == NULL)) {return 0;}
+    size_t entry = ENTRY_NONE;
+    size_t slot = find_slot (map, key, map->hash_func (key), &entry);
+    if (entry == ENTRY_NONE) {return 0;}
+    index_set (map, slot, INDEX_DELETED);
+    pair_free ((void **) &(map->entries[entry].p));
+    --(map->size);
+    if ((map->entries_used - map->size > map->size) &&
+        (map->index_capacity > ORDERED_HASH_MAP_INITIAL_CAP))
+    {
+        // a failed compaction leaves the holes, to be compacted by the next one
+        ordered_hashmap_compact (map);
+    }
+    return 1;
+}
+
+/**
+ * Iterates the pairs in insertion order, skipping the holes.
+ * @param map an ordered hash map.
+ * @param cursor the position of the iteration, advanced past the returned pair.
+ * @return the next pair (not a copy of it), NULL after the last one.
+ */
+pair *ordered_hashmap_next (const ordered_hashmap *map, size_t *cursor)
+{
+    if ((map == NULL) || (cursor == NULL)) {return NULL;}
+    while (*cursor < map->entries_used)
+    {
+        pair *p = map->entries[*cursor].p;
+        ++(*cursor);
+        if (p != NULL) {return p;}
+    }
+    return NULL;
+}
+
+/**
+ * Removes the holes from the entries and rebuilds the index table, with room
+ * for as many insertions as there are pairs.
+ * @param map an ordered hash map.
+ * @return 1 if the compaction was done successfully, 0 otherwise.
+ */
+int ordered_hashmap_compact (ordered_hashmap *map)
+{
+    if (map == NULL) {return 0;}
+    return rebuild (map, capacity_for (map->size * 2));
+}
+
+/**
+ * Returns the smallest width of the slots of an index table of index_capacity
+ * slots that can hold the position of every addressable entry, and the marks.
+ * @param index_capacity the number of slots of the index table.
+ * @return 1, 2, 4 or 8.
+ */
+size_t index_width_for (size_t index_capacity)
+{
+    size_t largest = ORDERED_HASH_MAP_USABLE(index_capacity) - 1 + INDEX_OFFSET;
+    size_t width = 1;
+    while ((width < sizeof(uint64_t)) && (largest > (1ULL << (8 * width)) - 1))
+    {
+        width *= 2;
+    }
+    return width;
+}
+
+/**
+ * Reads a slot of the index table.
+ * @param map an ordered hash map.
+ * @param slot the slot.
+ * @return the content of the slot: a mark or an entry position plus INDEX_OFFSET.
+ */
+size_t index_get (const ordered_hashmap *map, size_t slot)
+{
+    switch (map->index_width)
+    {
+        case sizeof(uint8_t):
+            return ((const uint8_t *) map->index)[slot];
+        case sizeof(uint16_t):
+            return ((const uint16_t *) map->index)[slot];
+        case sizeof(uint32_t):
+            return ((const uint32_t *) map->index)[slot];
+        default:
+            return (size_t) ((const uint64_t *) map->index)[slot];
+    }
+}
+
+/**
+ * Writes a slot of the index table.
+ * @param map an ordered hash map.
+ * @param slot the slot.
+ * @param value a mark or an entry position plus INDEX_OFFSET.
+ */
+void index_set (ordered_hashmap *map, size_t slot, size_t value)
+{
+    switch (map->index_width)
+    {
+        case sizeof(uint8_t):
+            ((uint8_t *) map->index)[slot] = (uint8_t) value;
+            break;
+        case sizeof(uint16_t):
+            ((uint16_t *) map->index)[slot] = (uint16_t) value;
+            break;
+        case sizeof(uint32_t):
+            ((uint32_t *) map->index)[slot] = (uint32_t) value;
+            break;
+        default:
+            ((uint64_t *) map->index)[slot] = (uint64_t) value;
+    }
+}
+
+/**
+ * Probes the index table for a key. The entries store the hashes of their keys,
+ * so key_cmp is only called for equal hashes.
+ * @param map an ordered hash map.
+ * @param key the key.
+ * @param hash the hash of the key.
+ * @param entry set to the position of the entry of the key, ENTRY_NONE if the key
+ * is not in the hash map.
+ * @return the slot of the key, or the empty slot that ended the probe.
+ */
+size_t find_slot (const ordered_hashmap *map, const_keyT key, size_t hash, size_t *entry)
+{
+    size_t mask = map->index_capacity - 1;
+    size_t perturb = hash;
+    size_t slot = hash & mask;
+    while (1)
+    {
+        size_t value = index_get (map, slot);
+        if (value == INDEX_EMPTY)
+        {
+            *entry = ENTRY_NONE;
+            return slot;
+        }
+        if (value != INDEX_DELETED)
+        {
+            const ordered_entry *e = &(map->entries[value - INDEX_OFFSET]);
+            if ((e->hash == hash) && (e->p->key_cmp (e->p->key, key) == 1))
+            {
+                *entry = value - INDEX_OFFSET;
+                return slot;
+            }
+        }
+        perturb >>= PERTURB_SHIFT;
+        slot = (slot * 5 + perturb + 1) & mask;
+    }
+}
+
+/**
+ * Returns the number of slots of the smallest index table that can address
+ * the given number of entries.
+ * @param entries the number of entries.
+ * @return the number of slots (a power of 2).
+ */
+size_t capacity_for (size_t entries)
+{
+    size_t index_capacity = ORDERED_HASH_MAP_INITIAL_CAP;
+    while (ORDERED_HASH_MAP_USABLE(index_capacity) < entries)
+    {
+        index_capacity *= 2;
+    }
+    return index_capacity;
+}
+
+/**
+ * Moves the pairs, in order and without the holes, to new entries addressed by
+ * a new index table of index_capacity slots. On failure the hash map is unchanged.
+ * @param map an ordered hash map.
+ * @param index_capacity the number of slots of the new index table (a power of 2
+ * whose usable entries are at least the size of the hash map).
+ * @return 1 if the rebuild was done successfully, 0 otherwise.
+ */
+int rebuild (ordered_hashmap *map, size_t index_capacity)
+{
+    size_t width = index_width_for (index_capacity);
+    void *index = calloc (index_capacity, width);
+    ordered_entry *entries = (ordered_entry *) malloc (
+        sizeof(ordered_entry) * ORDERED_HASH_MAP_USABLE(index_capacity));
+    if ((index == NULL) || (entries == NULL))
+    {
+        free (index);
+        free (entries);
+        return 0;
+    }
+    size_t used = 0;
+    for (size_t i = 0; i < map->entries_used; ++i)
+    {
+        if (map->entries[i].p != NULL)
+        {
+            entries[used] = map->entries[i];
+            ++used;
+        }
+    }
+    free (map->index);
+    free (map->entries);
+    map->index = index;
+    map->index_capacity = index_capacity;
+    map->index_width = width;
+    map->entries = entries;
+    map->entries_used = used;
+    for (size_t i = 0; i < used; ++i)
+    {
+        // the keys are distinct, only an empty slot is looked for
+        size_t mask = index_capacity - 1;
+        size_t perturb = entries[i].hash;
+        size_t slot = perturb & mask;
+        while (index_get (map, slot) != INDEX_EMPTY)
+        {
+            perturb >>= PERTURB_SHIFT;
+            slot = (slot * 5 + perturb + 1) & mask;
+        }
+        index_set (map, slot, i + INDEX_OFFSET);
+    }
+    return 1;
+}
+
+/**
+ * Finds the pair with the key of in_pair, or appends a copy of in_pair if there
+ * is none. When the entries are used up they are compacted, into a table with
+ * room for as many insertions as there are pairs.
+ * @param map an ordered hash map.
+ * @param in_pair the pair to look up and insert.
+ * @param inserted set to 1 if a new pair was appended, 0 otherwise.
+ * @param stored set to the stored pair of the key.
+ * @return 1 on success, 0 otherwise.
+ */
+int ordered_find_or_insert (ordered_hashmap *map, const pair *in_pair, int *inserted,
+                            pair **stored)
+{
+    *inserted = 0;
+    if ((map == NULL) || (in_pair == NULL) || (in_pair->key == NULL)) {return 0;}
+    size_t hash = map->hash_func (in_pair->key);
+    size_t entry = ENTRY_NONE;
+    size_t slot = find_slot (map, in_pair->key, hash, &entry);
+    if (entry != ENTRY_NONE)
+    {
+        *stored = map->entries[entry].p;
+        return 1;
+    }
+    if (map->entries_used == ORDERED_HASH_MAP_USABLE(map->index_capacity))
+    {
+        if (rebuild (map, capacity_for ((map->size + 1) * 2)) == 0) {return 0;}
+        slot = find_slot (map, in_pair->key, hash, &entry);
+    }
+    pair *new_pair = pair_copy (in_pair);
+    if (new_pair == NULL) {return 0;}
+    map->entries[map->entries_used].hash = hash;
+    map->entries[map->entries_used].p = new_pair;
+    index_set (map, slot, map->entries_used + INDEX_OFFSET);
+    ++(map->entries_used);
+    ++(map->size);
+    *inserted = 1;
+    *stored = new_pair;
+    return 1;
+}
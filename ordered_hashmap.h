@@ -0,0 +1,123 @@
+#ifndef ORDERED_HASHMAP_H_
+#define ORDERED_HASHMAP_H_
+
+#include "hashmap.h"
+
+/**
+ * @def ORDERED_HASH_MAP_INITIAL_CAP
+ * The initial number of slots of the index table.
+ */
+#define ORDERED_HASH_MAP_INITIAL_CAP 8UL
+
+/**
+ * @def ORDERED_HASH_MAP_USABLE(index_capacity)
+ * The number of entries an index table of index_capacity slots can address:
+ * 2/3 of the slots, so a probe always reaches an empty slot soon.
+ */
+#define ORDERED_HASH_MAP_USABLE(index_capacity) ((index_capacity) * 2 / 3)
+
+/**
+ * @struct ordered_entry - an entry of the dense array of an ordered_hashmap.
+ * @param hash the hash of the key.
+ * @param p the stored pair, NULL for the hole an erased pair left.
+ */
+typedef struct ordered_entry {
+    size_t hash;
+    pair *p;
+} ordered_entry;
+
+/**
+ * @struct ordered_hashmap - a hash map which keeps its pairs in insertion order
+ * (compact dict layout). The pairs are appended to a dense array of entries, and
+ * a sparse open addressing index table maps hashes to positions in that array.
+ * The index holds integers of 1, 2, 4 or 8 bytes, the smallest width that can
+ * address the entries. Iteration is a linear scan of the entries; an erased pair
+ * leaves a hole, and the holes are compacted away when the entries run out or
+ * outnumber the pairs.
+ * @param index the index table: positions in entries, or the empty/deleted marks.
+ * @param index_capacity the number of slots of the index table (a power of 2).
+ * @param index_width the width of a slot of the index table, in bytes.
+ * @param entries the dense array of entries, in insertion order.
+ * @param entries_used the number of entries appended, holes included.
+ * @param size the number of pairs stored in the hash map.
+ * @param hash_func a function which "hashes" keys.
+ */
+typedef struct ordered_hashmap {
+    void *index;
+    size_t index_capacity;
+    size_t index_width;
+    ordered_entry *entries;
+    size_t entries_used;
+    size_t size;
+    hash_func hash_func;
+} ordered_hashmap;
+
+/**
+ * Allocates dynamically a new, empty ordered hash map.
+ * @param func a function which "hashes" keys.
+ * @return pointer to dynamically allocated ordered hash map.
+ * @if_fail return NULL.
+ */
+ordered_hashmap *ordered_hashmap_alloc (hash_func func);
+
+/**
+ * Frees an ordered hash map and all its pairs.
+ * @param p_map pointer to dynamically allocated pointer to ordered hash map.
+ */
+void ordered_hashmap_free (ordered_hashmap **p_map);
+
+/**
+ * Appends a copy of in_pair to the hash map, if its key is not in it.
+ * @param map an ordered hash map.
+ * @param in_pair the pair to be inserted.
+ * @return 1 if the pair was inserted, 0 otherwise (also if the key exists).
+ */
+int ordered_hashmap_insert (ordered_hashmap *map, const pair *in_pair);
+
+/**
+ * Appends a copy of in_pair, or replaces in place the value of the stored pair
+ * with the same key (the pair keeps its position in the order).
+ * @param map an ordered hash map.
+ * @param in_pair the pair to be inserted or whose value replaces the stored one.
+ * @return 1 if the pair was inserted or its value replaced, 0 otherwise.
+ */
+int ordered_hashmap_upsert (ordered_hashmap *map, const pair *in_pair);
+
+/**
+ * Returns the value associated with the given key.
+ * @param map an ordered hash map.
+ * @param key the key to be checked.
+ * @return the value of the key if exists, NULL otherwise (the value itself,
+ * not a copy of it).
+ */
+valueT ordered_hashmap_at (const ordered_hashmap *map, const_keyT key);
+
+/**
+ * Erases the pair of the key, leaving a hole in the entries.
+ * @param map an ordered hash map.
+ * @param key the key of the pair to be erased.
+ * @return 1 if the erasing was done successfully, 0 otherwise.
+ */
+int ordered_hashmap_erase (ordered_hashmap *map, const_keyT key);
+
+/**
+ * Iterates the pairs in insertion order. Start with *cursor = 0, and call
+ * until NULL is returned. An insertion or erasure invalidates the cursor.
+ * Example: size_t cursor = 0; pair *p;
+ *          while ((p = ordered_hashmap_next (map, &cursor)) != NULL) {...}
+ * @param map an ordered hash map.
+ * @param cursor the position of the iteration, advanced past the returned pair.
+ * @return the next pair (not a copy of it), NULL after the last one.
+ */
+pair *ordered_hashmap_next (const ordered_hashmap *map, size_t *cursor);
+
+/**
+ * Removes the holes from the entries and rebuilds the index table, sized for
+ * the pairs stored. The order of the pairs is kept.
+ * @param map an ordered hash map.
+ * @return 1 if the compaction was done successfully, 0 otherwise (the hash map
+ * is left unchanged).
+ */
+int ordered_hashmap_compact (ordered_hashmap *map);
+
+#endif //ORDERED_HASHMAP_H_
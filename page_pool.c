@@ -0,0 +1,506 @@
+//
+// A thread safe allocator backing large hash maps with huge pages, and with an
+// optional NUMA interleave of its mappings.
+//
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#ifdef PAGE_POOL_LIBNUMA
+#include <numa.h>
+#include <numaif.h>
+#endif
+#include "page_pool.h"
+
+/**
+ * @struct smaps_vma - a mapping of the process, as /proc/self/smaps reports it.
+ * @param start, end - the addresses of the mapping.
+ * @param transparent the bytes of the mapping backed by transparent huge pages.
+ */
+typedef struct smaps_vma {
+    uintptr_t start;
+    uintptr_t end;
+    size_t transparent;
+} smaps_vma;
+
+void *page_pool_take (void *context, size_t size);
+void *page_pool_grow (void *context, void *ptr, size_t old_size, size_t new_size);
+void page_pool_release (void *context, void *ptr, size_t size);
+allocator_backing page_pool_backing (void *context, const void *ptr, size_t size);
+void *take_locked (page_pool *pool, size_t size);
+void release_locked (page_pool *pool, void *ptr, size_t size);
+page_region *map_region (page_pool *pool, size_t size);
+unsigned char *map_aligned (size_t size, int huge);
+void unmap_regions (page_region *regions);
+void interleave_region (page_region *region);
+size_t class_of (size_t size);
+page_region *find_region (page_region *regions, const void *ptr);
+smaps_vma *smaps_read (size_t *count);
+size_t smaps_transparent (const smaps_vma *vmas, size_t count, const page_region *region);
+
+/**
+ * Allocates dynamically an empty page pool.
+ * @param huge the huge pages requested for its mappings.
+ * @param numa the NUMA placement of its mappings.
+ * @return pointer to dynamically allocated page pool.
+ * @if_fail return NULL.
+ */
+page_pool *page_pool_alloc (page_pool_huge huge, page_pool_numa numa)
+{
+    page_pool *pool = (page_pool *) malloc (sizeof(page_pool));
+    if (pool == NULL) {return NULL;}
+    if (pthread_mutex_init (&(pool->lock), NULL) != 0)
+    {
+        free (pool);
+        return NULL;
+    }
+    pool->allocator.alloc = page_pool_take;
+    pool->allocator.realloc = page_pool_grow;
+    pool->allocator.free = page_pool_release;
+    pool->allocator.context = pool;
+    pool->allocator.backing = page_pool_backing;
+    pool->huge = huge;
+    pool->numa = numa;
+    pool->large = NULL;
+    pool->slabs = NULL;
+    pool->slab_used = 0;
+    for (size_t i = 0; i < PAGE_POOL_CLASSES; ++i) {pool->free_blocks[i] = NULL;}
+    pool->heap_bytes = 0;
+    return pool;
+}
+
+/**
+ * Frees a page pool and unmaps all its memory.
+ * @param p_pool pointer to dynamically allocated pointer to page pool.
+ */
+void page_pool_free (page_pool **p_pool)
+{
+    if ((p_pool == NULL) || (*p_pool == NULL)) {return;}
+    unmap_regions ((*p_pool)->large);
+    unmap_regions ((*p_pool)->slabs);
+    pthread_mutex_destroy (&((*p_pool)->lock));
+    free (*p_pool);
+    *p_pool = NULL;
+}
+
+/**
+ * Returns the allocator of the page pool, e.g. for hashmap_alloc_ex.
+ * @param pool a page pool.
+ * @return the allocator of the page pool, NULL if pool is NULL.
+ */
+const allocator *page_pool_allocator (page_pool *pool)
+{
+    if (pool == NULL) {return NULL;}
+    return &(pool->allocator);
+}
+
+/**
+ * Reports the mappings of the page pool, and the huge pages actually obtained.
+ * @param pool a page pool.
+ * @param out the statistics.
+ * @return 1 on success, 0 otherwise.
+ */
+int page_pool_stats_get (page_pool *pool, page_pool_stats *out)
+{
+    if ((pool == NULL) || (out == NULL)) {return 0;}
+    *out = (page_pool_stats) {0};
+    size_t count = 0;
+    smaps_vma *vmas = smaps_read (&count);
+    pthread_mutex_lock (&(pool->lock));
+    page_region *lists[2] = {pool->large, pool->slabs};
+    for (size_t i = 0; i < 2; ++i)
+    {
+        for (page_region *region = lists[i]; region != NULL; region = region->next)
+        {
+            if (i == 0)
+            {
+                ++(out->large_regions);
+                out->large_bytes += region->size;
+            }
+            else
+            {
+                ++(out->slabs);
+                out->slab_bytes += region->size;
+            }
+            if (region->hugetlb == 1) {out->hugetlb_bytes += region->size;}
+            else {out->transparent_bytes += smaps_transparent (vmas, count, region);}
+            if (region->interleaved == 1) {out->interleaved_bytes += region->size;}
+        }
+    }
+    out->heap_bytes = pool->heap_bytes;
+    pthread_mutex_unlock (&(pool->lock));
+    free (vmas);
+    return 1;
+}
+
+/**
+ * The alloc function of a page pool.
+ * @param context the page pool.
+ */
+void *page_pool_take (void *context, size_t size)
+{
+    page_pool *pool = (page_pool *) context;
+    pthread_mutex_lock (&(pool->lock));
+    void *block = take_locked (pool, size);
+    pthread_mutex_unlock (&(pool->lock));
+    return block;
+}
+
+/**
+ * The realloc function of a page pool: a block which keeps its size class is
+ * returned as is, any other block is copied to a new one.
+ * @param context the page pool.
+ */
+void *page_pool_grow (void *context, void *ptr, size_t old_size, size_t new_size)
+{
+    page_pool *pool = (page_pool *) context;
+    if (ptr == NULL) {return page_pool_take (pool, new_size);}
+    size_t small = PAGE_POOL_CLASSES * PAGE_POOL_CLASS_SIZE;
+    if ((old_size <= small) && (new_size <= small) &&
+        (class_of (old_size) == class_of (new_size)))
+    {
+        return ptr;
+    }
+    pthread_mutex_lock (&(pool->lock));
+    void *block = NULL;
+    if ((old_size > small) && (old_size < PAGE_POOL_HUGE_PAGE) &&
+        (new_size > small) && (new_size < PAGE_POOL_HUGE_PAGE))
+    {
+        block = realloc (ptr, new_size);
+        if (block != NULL) {pool->heap_bytes += new_size - old_size;}
+    }
+    else
+    {
+        block = take_locked (pool, new_size);
+        if (block != NULL)
+        {
+            memcpy (block, ptr, (old_size < new_size) ? old_size : new_size);
+            release_locked (pool, ptr, old_size);
+        }
+    }
+    pthread_mutex_unlock (&(pool->lock));
+    return block;
+}
+
+/**
+ * The free function of a page pool: a large block is unmapped, a small one is kept
+ * for the next block of its size class.
+ * @param context the page pool.
+ */
+void page_pool_release (void *context, void *ptr, size_t size)
+{
+    page_pool *pool = (page_pool *) context;
+    pthread_mutex_lock (&(pool->lock));
+    release_locked (pool, ptr, size);
+    pthread_mutex_unlock (&(pool->lock));
+}
+
+/**
+ * The backing function of a page pool: the mapping of the block is looked up, and
+ * /proc/self/smaps tells whether the kernel backed it with transparent huge pages.
+ * @param context the page pool.
+ */
+allocator_backing page_pool_backing (void *context, const void *ptr, size_t size)
+{
+    page_pool *pool = (page_pool *) context;
+    if ((size > PAGE_POOL_CLASSES * PAGE_POOL_CLASS_SIZE) && (size < PAGE_POOL_HUGE_PAGE))
+    {
+        return ALLOCATOR_BACKING_HEAP;
+    }
+    size_t count = 0;
+    smaps_vma *vmas = smaps_read (&count);
+    pthread_mutex_lock (&(pool->lock));
+    page_region *region = find_region ((size >= PAGE_POOL_HUGE_PAGE) ? pool->large
+                                                                      : pool->slabs, ptr);
+    allocator_backing backing = ALLOCATOR_BACKING_HEAP;
+    if (region != NULL)
+    {
+        backing = ALLOCATOR_BACKING_PAGES;
+        if (region->hugetlb == 1) {backing = ALLOCATOR_BACKING_HUGETLB;}
+        else if (smaps_transparent (vmas, count, region) > 0)
+        {
+            backing = ALLOCATOR_BACKING_TRANSPARENT;
+        }
+    }
+    pthread_mutex_unlock (&(pool->lock));
+    free (vmas);
+    return backing;
+}
+
+/**
+ * Hands out a block: a large one is mapped on its own, a medium one is taken from
+ * malloc, a small one is reused from its size class or carved from the current slab.
+ * @param pool a locked page pool.
+ * @param size the number of bytes.
+ * @return the block, NULL on failure.
+ */
+void *take_locked (page_pool *pool, size_t size)
+{
+    if (size >= PAGE_POOL_HUGE_PAGE)
+    {
+        page_region *region = map_region (pool, size);
+        if (region == NULL) {return NULL;}
+        region->next = pool->large;
+        pool->large = region;
+        return region->base;
+    }
+    if (size > PAGE_POOL_CLASSES * PAGE_POOL_CLASS_SIZE)
+    {
+        void *block = malloc (size);
+        if (block != NULL) {pool->heap_bytes += size;}
+        return block;
+    }
+    size_t class = class_of (size);
+    void *block = pool->free_blocks[class];
+    if (block != NULL)
+    {
+        memcpy (&(pool->free_blocks[class]), block, sizeof(void *));
+        return block;
+    }
+    size_t block_size = (class + 1) * PAGE_POOL_CLASS_SIZE;
+    if ((pool->slabs == NULL) || (pool->slabs->size - pool->slab_used < block_size))
+    {
+        page_region *slab = map_region (pool, PAGE_POOL_SLAB_SIZE);
+        if (slab == NULL) {return NULL;}
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        pool->slab_used = 0;
+    }
+    block = pool->slabs->base + pool->slab_used;
+    pool->slab_used += block_size;
+    return block;
+}
+
+/**
+ * Takes back a block handed out by take_locked.
+ * @param pool a locked page pool.
+ * @param ptr the block, nothing is done if it is NULL.
+ * @param size the size the block was allocated with.
+ */
+void release_locked (page_pool *pool, void *ptr, size_t size)
+{
+    if (ptr == NULL) {return;}
+    if (size >= PAGE_POOL_HUGE_PAGE)
+    {
+        for (page_region **link = &(pool->large); *link != NULL; link = &((*link)->next))
+        {
+            if ((*link)->base == ptr)
+            {
+                page_region *region = *link;
+                *link = region->next;
+                region->next = NULL;
+                unmap_regions (region);
+                return;
+            }
+        }
+        return;
+    }
+    if (size > PAGE_POOL_CLASSES * PAGE_POOL_CLASS_SIZE)
+    {
+        free (ptr);
+        pool->heap_bytes -= size;
+        return;
+    }
+    size_t class = class_of (size);
+    memcpy (ptr, &(pool->free_blocks[class]), sizeof(void *));
+    pool->free_blocks[class] = ptr;
+}
+
+/**
+ * Maps a region of at least size bytes, rounded up to PAGE_POOL_HUGE_PAGE, with the
+ * huge pages and the NUMA placement of the page pool. Explicit huge pages fall back
+ * to transparent ones, which the kernel may or may not provide.
+ * @param pool a page pool.
+ * @param size the number of bytes.
+ * @return the region, NULL on failure.
+ */
+page_region *map_region (page_pool *pool, size_t size)
+{
+    if (size > (size_t) -1 - PAGE_POOL_HUGE_PAGE) {return NULL;}
+    size = (size + PAGE_POOL_HUGE_PAGE - 1) & ~(PAGE_POOL_HUGE_PAGE - 1);
+    page_region *region = (page_region *) malloc (sizeof(page_region));
+    if (region == NULL) {return NULL;}
+    region->next = NULL;
+    region->size = size;
+    region->hugetlb = 0;
+    region->interleaved = 0;
+    region->base = NULL;
+#ifdef MAP_HUGETLB
+    if (pool->huge == PAGE_POOL_HUGE_HUGETLB)
+    {
+        void *base = mmap (NULL, size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base != MAP_FAILED)
+        {
+            region->base = (unsigned char *) base;
+            region->hugetlb = 1;
+        }
+    }
+#endif
+    if (region->base == NULL)
+    {
+        region->base = map_aligned (size, pool->huge != PAGE_POOL_HUGE_NONE);
+        if (region->base == NULL)
+        {
+            free (region);
+            return NULL;
+        }
+    }
+    // the placement is set before the pages are touched
+    if (pool->numa == PAGE_POOL_NUMA_INTERLEAVE) {interleave_region (region);}
+    return region;
+}
+
+/**
+ * Maps size bytes of regular pages aligned to PAGE_POOL_HUGE_PAGE, so that the
+ * kernel can back all of them with transparent huge pages.
+ * @param size a multiple of PAGE_POOL_HUGE_PAGE.
+ * @param huge 1 to request transparent huge pages, 0 otherwise.
+ * @return the mapping, NULL on failure.
+ */
+unsigned char *map_aligned (size_t size, int huge)
+{
+    size_t mapped = size + PAGE_POOL_HUGE_PAGE;
+    void *base = mmap (NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                       -1, 0);
+    if (base == MAP_FAILED) {return NULL;}
+    uintptr_t start = (uintptr_t) base;
+    uintptr_t mask = (uintptr_t) PAGE_POOL_HUGE_PAGE - 1;
+    uintptr_t aligned = (start + mask) & ~mask;
+    // the unaligned head and tail are given back
+    if (aligned > start) {munmap (base, aligned - start);}
+    size_t tail = (start + mapped) - (aligned + size);
+    if (tail > 0) {munmap ((void *) (aligned + size), tail);}
+#ifdef MADV_HUGEPAGE
+    // a kernel without transparent huge pages keeps the regular ones
+    if (huge == 1) {madvise ((void *) aligned, size, MADV_HUGEPAGE);}
+#else
+    (void) huge;
+#endif
+    return (unsigned char *) aligned;
+}
+
+/**
+ * Unmaps a list of regions and frees their structs.
+ * @param regions the first region of the list.
+ */
+void unmap_regions (page_region *regions)
+{
+    while (regions != NULL)
+    {
+        page_region *next = regions->next;
+        munmap (regions->base, regions->size);
+        free (regions);
+        regions = next;
+    }
+}
+
+/**
+ * Interleaves the pages of a region across the NUMA nodes the process may use.
+ * Without libnuma the region keeps the first touch placement.
+ * @param region a region none of whose pages were touched.
+ */
+void interleave_region (page_region *region)
+{
+#ifdef PAGE_POOL_LIBNUMA
+    if (numa_available () < 0) {return;}
+    struct bitmask *nodes = numa_get_mems_allowed ();
+    if (nodes == NULL) {return;}
+    region->interleaved = (mbind (region->base, region->size, MPOL_INTERLEAVE,
+                                  nodes->maskp, nodes->size + 1, 0) == 0);
+    numa_bitmask_free (nodes);
+#else
+    (void) region;
+#endif
+}
+
+/**
+ * @param size the size of a small block, up to PAGE_POOL_CLASSES * PAGE_POOL_CLASS_SIZE.
+ * @return the index of its size class.
+ */
+size_t class_of (size_t size)
+{
+    return (size == 0) ? 0 : (size - 1) / PAGE_POOL_CLASS_SIZE;
+}
+
+/**
+ * Finds the region of a list which a block belongs to.
+ * @param regions the first region of the list.
+ * @param ptr the block.
+ * @return the region, NULL if the block is in none of them.
+ */
+page_region *find_region (page_region *regions, const void *ptr)
+{
+    uintptr_t address = (uintptr_t) ptr;
+    for (page_region *region = regions; region != NULL; region = region->next)
+    {
+        uintptr_t base = (uintptr_t) region->base;
+        if ((address >= base) && (address - base < region->size)) {return region;}
+    }
+    return NULL;
+}
+
+/**
+ * Reads the mappings of the process, and the transparent huge pages backing them,
+ * from /proc/self/smaps.
+ * @param count set to the number of mappings read.
+ * @return dynamically allocated array of mappings, NULL if none could be read.
+ */
+smaps_vma *smaps_read (size_t *count)
+{
+    *count = 0;
+    FILE *smaps = fopen ("/proc/self/smaps", "r");
+    if (smaps == NULL) {return NULL;}
+    smaps_vma *vmas = NULL;
+    size_t capacity = 0;
+    char line[512];
+    while (fgets (line, sizeof(line), smaps) != NULL)
+    {
+        unsigned long start = 0, end = 0, kb = 0;
+        if (sscanf (line, "%lx-%lx ", &start, &end) == 2)
+        {
+            if (*count == capacity)
+            {
+                size_t new_capacity = (capacity == 0) ? 64 : capacity * 2;
+                smaps_vma *grown = realloc (vmas, sizeof(smaps_vma) * new_capacity);
+                if (grown == NULL) {break;}
+                vmas = grown;
+                capacity = new_capacity;
+            }
+            vmas[*count] = (smaps_vma) {start, end, 0};
+            ++(*count);
+        }
+        else if ((*count > 0) && (sscanf (line, "AnonHugePages: %lu kB", &kb) == 1))
+        {
+            vmas[*count - 1].transparent = (size_t) kb * 1024;
+        }
+    }
+    fclose (smaps);
+    return vmas;
+}
+
+/**
+ * Counts the bytes of a region backed by transparent huge pages. The kernel may merge
+ * adjacent regions into a single mapping, whose huge pages are then counted for each
+ * of them, up to the size of the region.
+ * @param vmas, count - the mappings of the process (see smaps_read).
+ * @param region a region of a page pool.
+ * @return the number of bytes.
+ */
+size_t smaps_transparent (const smaps_vma *vmas, size_t count, const page_region *region)
+{
+    uintptr_t base = (uintptr_t) region->base;
+    uintptr_t end = base + region->size;
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if ((vmas[i].end <= base) || (vmas[i].start >= end)) {continue;}
+        uintptr_t overlap_start = (vmas[i].start > base) ? vmas[i].start : base;
+        uintptr_t overlap_end = (vmas[i].end < end) ? vmas[i].end : end;
+        size_t overlap = overlap_end - overlap_start;
+        bytes += (vmas[i].transparent < overlap) ? vmas[i].transparent : overlap;
+    }
+    return bytes;
+}
@@ -0,0 +1,161 @@
+#ifndef PAGE_POOL_H_
+#define PAGE_POOL_H_
+
+#include <stddef.h>
+#include <pthread.h>
+#include "allocator.h"
+
+/**
+ * @def PAGE_POOL_HUGE_PAGE
+ * The size of a huge page. The blocks of at least this size (the bucket arrays of
+ * large hash maps) get a mapping of their own, aligned to it.
+ */
+#define PAGE_POOL_HUGE_PAGE 2097152UL
+
+/**
+ * @def PAGE_POOL_SLAB_SIZE
+ * The size of the mappings the small blocks (the pairs, and the data arrays of the
+ * short vectors) are carved from.
+ */
+#define PAGE_POOL_SLAB_SIZE PAGE_POOL_HUGE_PAGE
+
+/**
+ * @def PAGE_POOL_CLASS_SIZE
+ * The granularity of the sizes of the small blocks.
+ */
+#define PAGE_POOL_CLASS_SIZE 16UL
+
+/**
+ * @def PAGE_POOL_CLASSES
+ * The number of size classes of the small blocks: the blocks of up to
+ * PAGE_POOL_CLASSES * PAGE_POOL_CLASS_SIZE bytes are carved from the slabs, the
+ * blocks between that and PAGE_POOL_HUGE_PAGE bytes are taken from malloc.
+ */
+#define PAGE_POOL_CLASSES 16UL
+
+/**
+ * @enum page_pool_huge
+ * The huge pages requested for the mappings of a page pool.
+ * @param PAGE_POOL_HUGE_NONE regular pages.
+ * @param PAGE_POOL_HUGE_TRANSPARENT transparent huge pages, requested by
+ * madvise(MADV_HUGEPAGE): the kernel backs the mapping with them when it can.
+ * @param PAGE_POOL_HUGE_HUGETLB explicit huge pages (MAP_HUGETLB, reserved in
+ * hugetlbfs), falling back to transparent huge pages when none are left.
+ */
+typedef enum page_pool_huge {
+    PAGE_POOL_HUGE_NONE,
+    PAGE_POOL_HUGE_TRANSPARENT,
+    PAGE_POOL_HUGE_HUGETLB
+} page_pool_huge;
+
+/**
+ * @enum page_pool_numa
+ * The NUMA placement of the mappings of a page pool.
+ * @param PAGE_POOL_NUMA_FIRST_TOUCH a page goes to the node of the thread that
+ * first touches it (the default policy of the kernel).
+ * @param PAGE_POOL_NUMA_INTERLEAVE the pages are interleaved across the nodes the
+ * process may use, by mbind. Needs libnuma (build with make NUMA=1), the mappings
+ * are placed by first touch otherwise.
+ */
+typedef enum page_pool_numa {
+    PAGE_POOL_NUMA_FIRST_TOUCH,
+    PAGE_POOL_NUMA_INTERLEAVE
+} page_pool_numa;
+
+/**
+ * @struct page_region - a mapping of a page pool.
+ * @param next the mapping made before this one.
+ * @param base, size - the mapping.
+ * @param hugetlb 1 if the mapping has explicit huge pages, 0 otherwise.
+ * @param interleaved 1 if the pages of the mapping are interleaved across the NUMA
+ * nodes, 0 otherwise.
+ */
+typedef struct page_region {
+    struct page_region *next;
+    unsigned char *base;
+    size_t size;
+    int hugetlb;
+    int interleaved;
+} page_region;
+
+/**
+ * @struct page_pool_stats
+ * @param large_regions, large_bytes - the mappings of the large blocks, and their size.
+ * @param slabs, slab_bytes - the slabs of the small blocks, and their size.
+ * @param hugetlb_bytes the bytes of the mappings with explicit huge pages.
+ * @param transparent_bytes the bytes of the other mappings which the kernel backs
+ * with transparent huge pages now (read from /proc/self/smaps, 0 where it cannot be).
+ * @param interleaved_bytes the bytes of the mappings interleaved across NUMA nodes.
+ * @param heap_bytes the bytes of the medium blocks, taken from malloc.
+ */
+typedef struct page_pool_stats {
+    size_t large_regions;
+    size_t large_bytes;
+    size_t slabs;
+    size_t slab_bytes;
+    size_t hugetlb_bytes;
+    size_t transparent_bytes;
+    size_t interleaved_bytes;
+    size_t heap_bytes;
+} page_pool_stats;
+
+/**
+ * @struct page_pool - an allocator backing the large blocks and the slabs of the
+ * small blocks with mmap regions of huge pages, so the bucket array and the pairs of
+ * a large hash map take fewer TLB entries. Thread safe (see
+ * hashmap_background_resize_enable).
+ * @param allocator the allocator handing out the memory of the pool.
+ * @param huge, numa - the requested backing of the mappings.
+ * @param lock serializes the functions of the allocator.
+ * @param large the mappings of the large blocks.
+ * @param slabs the slabs, the current one first.
+ * @param slab_used the number of bytes of the current slab handed out.
+ * @param free_blocks the freed small blocks of every size class, linked through
+ * their first bytes.
+ * @param heap_bytes the bytes of the medium blocks taken from malloc.
+ */
+typedef struct page_pool {
+    allocator allocator;
+    page_pool_huge huge;
+    page_pool_numa numa;
+    pthread_mutex_t lock;
+    page_region *large;
+    page_region *slabs;
+    size_t slab_used;
+    void *free_blocks[PAGE_POOL_CLASSES];
+    size_t heap_bytes;
+} page_pool;
+
+/**
+ * Allocates dynamically an empty page pool.
+ * @param huge the huge pages requested for its mappings.
+ * @param numa the NUMA placement of its mappings.
+ * @return pointer to dynamically allocated page pool.
+ * @if_fail return NULL.
+ */
+page_pool *page_pool_alloc (page_pool_huge huge, page_pool_numa numa);
+
+/**
+ * Frees a page pool and unmaps all its memory. The hash maps allocated from it must
+ * be freed first.
+ * @param p_pool pointer to dynamically allocated pointer to page pool.
+ */
+void page_pool_free (page_pool **p_pool);
+
+/**
+ * Returns the allocator of the page pool, e.g. for hashmap_alloc_ex. It is valid
+ * until the page pool is freed.
+ * @param pool a page pool.
+ * @return the allocator of the page pool, NULL if pool is NULL.
+ */
+const allocator *page_pool_allocator (page_pool *pool);
+
+/**
+ * Reports the mappings of the page pool, and the huge pages actually obtained.
+ * @param pool a page pool.
+ * @param out the statistics.
+ * @return 1 on success, 0 otherwise.
+ */
+int page_pool_stats_get (page_pool *pool, page_pool_stats *out);
+
+#endif //PAGE_POOL_H_
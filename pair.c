@@ -14,7 +14,31 @@ pair *pair_alloc (
     const pair_key_cmp key_cmp, const pair_value_cmp value_cmp,
     const pair_key_free key_free, const pair_value_free value_free)
 {
-  pair *p = malloc (sizeof (pair));
+  return pair_alloc_ex (key, value, key_cpy, value_cpy, key_cmp, value_cmp,
+                        key_free, value_free, NULL);
+}
+
+/**
+ * Allocates a new pair with the given allocator, as pair_alloc.
+ * @param key, value - the key and value.
+ * @param key_cpy, value_cpy - copy functions for key and value.
+ * @param key_cmp, value_cmp - compare functions for key and value.
+ * @param key_free, value_free - free functions for key and value.
+ * @param allocator the allocator of the pair, NULL for malloc.
+ * @return the new pair, NULL on failure.
+ */
+pair *pair_alloc_ex (
+    const_keyT key, const_valueT value,
+    const pair_key_cpy key_cpy, const pair_value_cpy value_cpy,
+    const pair_key_cmp key_cmp, const pair_value_cmp value_cmp,
+    const pair_key_free key_free, const pair_value_free value_free,
+    const allocator *allocator)
+{
+  pair *p = allocator_alloc (allocator, sizeof (pair));
+  if (!p)
+    {
+      return NULL;
+    }
   p->key = key_cpy (key);
   p->value = value_cpy (value);
   p->key_cpy = key_cpy;
@@ -23,11 +47,14 @@ pair *pair_alloc (
   p->value_cmp = value_cmp;
   p->key_free = key_free;
   p->value_free = value_free;
+  p->timer = NULL;
+  p->allocator = allocator;
   return p;
 }
 
 /**
- * Creates a new (dynamically allocated) copy of the given old_pair.
+ * Creates a new (dynamically allocated) copy of the given old_pair, with the
+ * allocator of old_pair.
  * @param old_pair old_pair to be copied.
  * @return new dynamically allocated old_pair if succeeded, NULL otherwise.
  */
@@ -38,11 +65,24 @@ void *pair_copy (const void *p)
       return NULL;
     }
   const pair *old_pair = (const pair *) p;
-  pair *new_pair = pair_alloc (old_pair->key, old_pair->value,
-                               old_pair->key_cpy, old_pair->value_cpy,
-                               old_pair->key_cmp, old_pair->value_cmp,
-                               old_pair->key_free, old_pair->value_free);
-  return new_pair;
+  return pair_copy_ex (old_pair, old_pair->allocator);
+}
+
+/**
+ * Creates a copy of the given pair with the given allocator.
+ * @param p the pair to be copied.
+ * @param allocator the allocator of the copy, NULL for malloc.
+ * @return the copy if succeeded, NULL otherwise.
+ */
+pair *pair_copy_ex (const pair *p, const allocator *allocator)
+{
+  if (!p)
+    {
+      return NULL;
+    }
+  return pair_alloc_ex (p->key, p->value, p->key_cpy, p->value_cpy,
+                        p->key_cmp, p->value_cmp, p->key_free, p->value_free,
+                        allocator);
 }
 
 
@@ -74,6 +114,6 @@ void pair_free (void ** p)
   pair **p_pair = (pair **) p;
   (*p_pair)->key_free (&(*p_pair)->key);
   (*p_pair)->value_free (&(*p_pair)->value);
-  free (*p_pair);
+  allocator_free ((*p_pair)->allocator, *p_pair, sizeof (pair));
   *p_pair = NULL;
 }
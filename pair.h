@@ -2,6 +2,7 @@
 #define PAIR_H_
 
 #include <stdlib.h>
+#include "allocator.h"
 
 /**
  * @typedef keyT, valueT, const_keyT, const_valueT
@@ -39,6 +40,10 @@ typedef void (*pair_value_free) (valueT *);
  * @param key_cpy, value_cpy - copy functions for key and value.
  * @param key_cmp, value_cmp - compare functions for key and value.
  * @param key_free, value_free - free functions for key and value.
+ * @param timer the expiration timer of the pair in a hash map (see
+ * hashmap_insert_ttl), NULL if the pair does not expire.
+ * @param allocator the allocator of the pair struct (not of its key and value,
+ * which key_cpy and value_cpy allocate), NULL for malloc.
  */
 typedef struct pair {
     keyT key;
@@ -49,6 +54,8 @@ typedef struct pair {
     pair_value_cmp value_cmp;
     pair_key_free key_free;
     pair_value_free value_free;
+    struct timer_node *timer;
+    const allocator *allocator;
 } pair;
 
 /**
@@ -66,12 +73,39 @@ pair *pair_alloc (
     pair_key_free key_free, pair_value_free value_free);
 
 /**
- * Creates a new (dynamically allocated) copy of the given old_pair.
+ * Allocates a new pair with the given allocator, as pair_alloc.
+ * @param key, value - the key and value.
+ * @param key_cpy, value_cpy - copy functions for key and value.
+ * @param key_cmp, value_cmp - compare functions for key and value.
+ * @param key_free, value_free - free functions for key and value.
+ * @param allocator the allocator of the pair, NULL for malloc. It must outlive the pair.
+ * @return the new pair, NULL on failure.
+ */
+pair *pair_alloc_ex (
+    const_keyT key, const_valueT value,
+    pair_key_cpy key_cpy, pair_value_cpy value_cpy,
+    pair_key_cmp key_cmp, pair_value_cmp value_cmp,
+    pair_key_free key_free, pair_value_free value_free,
+    const allocator *allocator);
+
+/**
+ * Creates a new (dynamically allocated) copy of the given old_pair, with the
+ * allocator of old_pair.
+ * The copy has no expiration timer.
  * @param old_pair old_pair to be copied.
  * @return new dynamically allocated old_pair if succeeded, NULL otherwise.
  */
 void *pair_copy (const void *p);
 
+/**
+ * Creates a copy of the given pair with the given allocator.
+ * The copy has no expiration timer.
+ * @param p the pair to be copied.
+ * @param allocator the allocator of the copy, NULL for malloc.
+ * @return the copy if succeeded, NULL otherwise.
+ */
+pair *pair_copy_ex (const pair *p, const allocator *allocator);
+
 /**
  * Compares two pairs
  * @param pair1 first pair
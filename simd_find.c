@@ -0,0 +1,146 @@
+//
+// Vectorized linear search over arrays of fixed width integers.
+//
+#include <string.h>
+#include "simd_find.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SIMD_FIND_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_FIND_X86 0
+#endif
+
+/**
+ * @def SIMD_FIND_SCALAR
+ * Defines find_u<bits>_scalar, which scans elements [start, count) one by one.
+ * The elements are loaded with memcpy, so the array may hold any type of that width.
+ */
+#define SIMD_FIND_SCALAR(bits) \
+    static size_t find_u##bits##_scalar(const uint##bits##_t *elements, size_t start, \
+                                        size_t count, uint##bits##_t target) \
+    { \
+        for (size_t i = start; i < count; ++i) \
+        { \
+            uint##bits##_t item; \
+            memcpy(&item, elements + i, sizeof(item)); \
+            if (item == target) {return i;} \
+        } \
+        return count; \
+    }
+
+SIMD_FIND_SCALAR(8)
+SIMD_FIND_SCALAR(16)
+SIMD_FIND_SCALAR(32)
+SIMD_FIND_SCALAR(64)
+
+#if SIMD_FIND_X86
+
+/**
+ * SSE2 has no 64 bit compare: two 64 bit lanes are equal if both their 32 bit
+ * halves are.
+ */
+static __m128i sse2_cmpeq_epi64(__m128i a, __m128i b)
+{
+    __m128i halves = _mm_cmpeq_epi32(a, b);
+    return _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+/**
+ * @def SIMD_FIND_KERNELS
+ * Defines find_u<bits>_sse2 and find_u<bits>_avx2: every block of lanes is compared
+ * with the broadcast target at once, and the byte mask of the comparison gives the
+ * index of the first equal lane. The elements left after the last block are
+ * scanned by the scalar loop.
+ */
+#define SIMD_FIND_KERNELS(bits, set1_type, sse2_set1, sse2_cmpeq, avx2_set1, avx2_cmpeq) \
+    static size_t find_u##bits##_sse2(const uint##bits##_t *elements, size_t count, \
+                                      uint##bits##_t target) \
+    { \
+        const size_t lanes = sizeof(__m128i) / sizeof(uint##bits##_t); \
+        __m128i needle = sse2_set1((set1_type) target); \
+        size_t i = 0; \
+        for (; i + lanes <= count; i += lanes) \
+        { \
+            __m128i block = _mm_loadu_si128((const __m128i *) (elements + i)); \
+            unsigned int mask = (unsigned int) _mm_movemask_epi8(sse2_cmpeq(block, needle)); \
+            if (mask != 0) {return i + __builtin_ctz(mask) / sizeof(uint##bits##_t);} \
+        } \
+        return find_u##bits##_scalar(elements, i, count, target); \
+    } \
+    __attribute__((target("avx2"))) \
+    static size_t find_u##bits##_avx2(const uint##bits##_t *elements, size_t count, \
+                                      uint##bits##_t target) \
+    { \
+        const size_t lanes = sizeof(__m256i) / sizeof(uint##bits##_t); \
+        __m256i needle = avx2_set1((set1_type) target); \
+        size_t i = 0; \
+        for (; i + lanes <= count; i += lanes) \
+        { \
+            __m256i block = _mm256_loadu_si256((const __m256i *) (elements + i)); \
+            unsigned int mask = (unsigned int) _mm256_movemask_epi8(avx2_cmpeq(block, needle)); \
+            if (mask != 0) {return i + __builtin_ctz(mask) / sizeof(uint##bits##_t);} \
+        } \
+        return find_u##bits##_scalar(elements, i, count, target); \
+    }
+
+SIMD_FIND_KERNELS(8, char, _mm_set1_epi8, _mm_cmpeq_epi8,
+                  _mm256_set1_epi8, _mm256_cmpeq_epi8)
+SIMD_FIND_KERNELS(16, short, _mm_set1_epi16, _mm_cmpeq_epi16,
+                  _mm256_set1_epi16, _mm256_cmpeq_epi16)
+SIMD_FIND_KERNELS(32, int, _mm_set1_epi32, _mm_cmpeq_epi32,
+                  _mm256_set1_epi32, _mm256_cmpeq_epi32)
+SIMD_FIND_KERNELS(64, long long, _mm_set1_epi64x, sse2_cmpeq_epi64,
+                  _mm256_set1_epi64x, _mm256_cmpeq_epi64)
+
+/**
+ * @def SIMD_FIND_DISPATCH
+ * Defines simd_find_u<bits>, which picks the widest kernel the CPU supports.
+ * Arrays shorter than an SSE2 block go straight to the scalar loop.
+ */
+#define SIMD_FIND_DISPATCH(bits) \
+    size_t simd_find_u##bits(const uint##bits##_t *elements, size_t count, \
+                             uint##bits##_t target) \
+    { \
+        if ((elements == NULL) || (count == 0)) {return count;} \
+        if (count < sizeof(__m128i) / sizeof(uint##bits##_t)) \
+        { \
+            return find_u##bits##_scalar(elements, 0, count, target); \
+        } \
+        if (__builtin_cpu_supports("avx2")) \
+        { \
+            return find_u##bits##_avx2(elements, count, target); \
+        } \
+        return find_u##bits##_sse2(elements, count, target); \
+    }
+
+#else
+
+#define SIMD_FIND_DISPATCH(bits) \
+    size_t simd_find_u##bits(const uint##bits##_t *elements, size_t count, \
+                             uint##bits##_t target) \
+    { \
+        if (elements == NULL) {return count;} \
+        return find_u##bits##_scalar(elements, 0, count, target); \
+    }
+
+#endif
+
+SIMD_FIND_DISPATCH(8)
+SIMD_FIND_DISPATCH(16)
+SIMD_FIND_DISPATCH(32)
+SIMD_FIND_DISPATCH(64)
+
+/**
+ * Returns the instruction set the simd_find functions use on this machine.
+ * @return "avx2", "sse2" or "scalar".
+ */
+const char *simd_find_isa(void)
+{
+#if SIMD_FIND_X86
+    if (__builtin_cpu_supports("avx2")) {return "avx2";}
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
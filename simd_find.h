@@ -0,0 +1,28 @@
+#ifndef SIMD_FIND_H_
+#define SIMD_FIND_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/**
+ * Finds the first element of a contiguous array of 8/16/32/64 bit integers equal
+ * to target. On x86-64 the array is scanned with AVX2 compares (32 bytes at a time)
+ * when the CPU supports them, with SSE2 compares (16 bytes at a time) otherwise;
+ * other machines use a scalar loop. The elements need not be aligned.
+ * @param elements the array to scan.
+ * @param count the number of elements in the array.
+ * @param target the value to look for.
+ * @return the index of the first element equal to target, count if there is none.
+ */
+size_t simd_find_u8(const uint8_t *elements, size_t count, uint8_t target);
+size_t simd_find_u16(const uint16_t *elements, size_t count, uint16_t target);
+size_t simd_find_u32(const uint32_t *elements, size_t count, uint32_t target);
+size_t simd_find_u64(const uint64_t *elements, size_t count, uint64_t target);
+
+/**
+ * Returns the instruction set the simd_find functions use on this machine.
+ * @return "avx2", "sse2" or "scalar".
+ */
+const char *simd_find_isa(void);
+
+#endif //SIMD_FIND_H_
@@ -0,0 +1,144 @@
+//
+// Tests of the C++ front-end of the hashmap library (hashmap.hpp).
+//
+#include "hashmap.hpp"
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using hashmap_library::hashmap;
+using hashmap_library::string_hashmap;
+
+/**
+ * This function checks the insertion functions of the hashmap class template.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_cpp_hashmap_insert ()
+{
+    hashmap<int, int> map;
+    assert (map.empty () && (map.bucket_count () == 0));
+    for (int i = 0; i < 100; ++i)
+    {
+        assert (map.try_emplace (i, i * 10).second);
+        assert (!map.try_emplace (i, 0).second);
+    }
+    assert ((map.size () == 100) && (map.bucket_count () == 256));
+    assert (map.at (7) == 70);
+    assert (map.emplace (7, 0).first->second == 70);
+    assert (map.insert ({100, 1000}).second);
+    assert (!map.insert_or_assign (100, 5).second);
+    assert (map.at (100) == 5);
+    ++map[101];
+    assert (map.at (101) == 1);
+
+    // move only values are constructed in place, and moved on resizes
+    hashmap<int, std::unique_ptr<int>> owners;
+    for (int i = 0; i < 100; ++i)
+    {
+        assert (owners.try_emplace (i, std::make_unique<int> (i)).second);
+    }
+    std::unique_ptr<int> kept = std::make_unique<int> (-1);
+    assert (!owners.try_emplace (5, std::move (kept)).second);
+    assert ((kept != nullptr) && (*owners.at (5) == 5));
+    owners.emplace (200, std::move (kept));
+    assert ((kept == nullptr) && (*owners.at (200) == -1));
+}
+
+/**
+ * This function checks the lookups of the hashmap class template, with std::string
+ * keys searched by std::string_view.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_cpp_hashmap_lookup ()
+{
+    string_hashmap<int> map {{"one", 1}, {"two", 2}, {"three", 3}};
+    std::string_view two = "two";
+    assert (map.find (two)->second == 2);
+    assert (map.at ("three") == 3);
+    assert (map.contains (std::string ("one")));
+    assert (map.count (std::string_view ("four")) == 0);
+    assert (map.find ("four") == map.end ());
+    bool thrown = false;
+    try
+    {
+        map.at ("four");
+    }
+    catch (const std::out_of_range &)
+    {
+        thrown = true;
+    }
+    assert (thrown);
+
+    const string_hashmap<int> &view = map;
+    assert (view.find (two) != view.end ());
+    assert (view.at (two) == 2);
+}
+
+/**
+ * This function checks the iterators, erasures, copies and moves of the hashmap class
+ * template.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_cpp_hashmap_iterate ()
+{
+    hashmap<std::string, int> map;
+    std::unordered_map<std::string, int> expected;
+    for (int i = 0; i < 1000; ++i)
+    {
+        map.try_emplace (std::to_string (i), i);
+        expected.try_emplace (std::to_string (i), i);
+    }
+    size_t visited = 0;
+    for (const auto &p : map)
+    {
+        assert (expected.at (p.first) == p.second);
+        ++visited;
+    }
+    assert (visited == 1000);
+
+    // erasing by iterator keeps iterating the rest
+    for (auto it = map.begin (); it != map.end ();)
+    {
+        if (it->second % 2 == 0) {it = map.erase (it);}
+        else {++it;}
+    }
+    assert ((map.size () == 500) && (map.bucket_count () == 2048));
+    hashmap<std::string, int> copy = map;
+    for (int i = 0; i < 1000; i += 2)
+    {
+        assert (!map.contains (std::to_string (i)));
+        assert (map.erase (std::to_string (i + 1)) == 1);
+    }
+    assert (map.empty () && (map.bucket_count () == hashmap_library::initial_capacity));
+    assert ((copy.size () == 500) && (copy.at ("999") == 999));
+
+    hashmap<std::string, int> moved = std::move (copy);
+    assert ((moved.size () == 500) && copy.empty ());
+    copy = moved;
+    copy.rehash (0);
+    assert ((copy.bucket_count () == 1024) && (copy.at ("1") == 1));
+    bool thrown = false;
+    try
+    {
+        copy.reserve (std::numeric_limits<size_t>::max () / 2);
+    }
+    catch (const std::length_error &)
+    {
+        thrown = true;
+    }
+    assert (thrown && (copy.bucket_count () == 1024));
+    copy.clear ();
+    assert (copy.empty () && (copy.find ("1") == copy.end ()));
+    copy["1"] = 1;
+    assert (copy.at ("1") == 1);
+}
+
+//int main ()
+//{
+//    test_cpp_hashmap_insert ();
+//    test_cpp_hashmap_lookup ();
+//    test_cpp_hashmap_iterate ();
+//}
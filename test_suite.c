@@ -5,8 +5,17 @@
 #include "test_pairs.h"
 #include "hash_funcs.h"
 #include "hashmap.h"
+#include "simd_find.h"
+#include "lru_hashmap.h"
+#include "counter_map.h"
+#include "ordered_hashmap.h"
+#include "typed_hashmap.h"
+#include "durable_hashmap.h"
+#include "hashmap_builder.h"
+#include "page_pool.h"
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
 
 /**
  * This function checks the hashmap_insert function of the hashmap library.
@@ -268,6 +277,2394 @@ void test_hash_map_apply_if()
     assert (map == NULL);
 }
 
+/**
+ * This function checks the hashmap_find_or_insert function of the hashmap library.
+ * If hashmap_find_or_insert fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_find_or_insert(void)
+{
+    hashmap *map = hashmap_alloc (hash_char);
+
+    int zero = 0;
+    char key0 = 'A';
+    pair *p0 = pair_alloc(&key0, &zero, char_key_cpy, int_value_cpy,
+                          char_key_cmp, int_value_cmp,
+                          char_key_free, int_value_free);
+    int inserted = -1;
+    assert (hashmap_find_or_insert(NULL, p0, &inserted) == NULL);
+    assert (inserted == 0);
+    assert (hashmap_find_or_insert(map, NULL, &inserted) == NULL);
+    pair_free((void **) &p0);
+
+    // count the letters of a word, each key is hashed and probed once per letter.
+    const char *word = "MISSISSIPPI";
+    for (size_t i = 0; word[i] != '\0'; ++i)
+    {
+        char key = word[i];
+        pair *p = pair_alloc(&key, &zero, char_key_cpy, int_value_cpy,
+                             char_key_cmp, int_value_cmp,
+                             char_key_free, int_value_free);
+        valueT *slot = hashmap_find_or_insert(map, p, &inserted);
+        assert (slot != NULL);
+        // check that a copy of the element was inserted.
+        assert (*slot != p->value);
+        if (i < 3)
+        {
+            // 'M', 'I', 'S' are seen for the first time.
+            assert (inserted == 1);
+        }
+        ++(*(int *) *slot);
+        pair_free((void **) &p);
+    }
+    char k1 = 'S';
+    char k2 = 'P';
+    assert (map->size == 4);
+    assert (*(int *) hashmap_at(map, &k1) == 4);
+    assert (*(int *) hashmap_at(map, &k2) == 2);
+
+    // check that the returned slots stay valid across a resize.
+    char key1 = 'M';
+    pair *p1 = pair_alloc(&key1, &zero, char_key_cpy, int_value_cpy,
+                          char_key_cmp, int_value_cmp,
+                          char_key_free, int_value_free);
+    valueT *slot = hashmap_find_or_insert(map, p1, NULL);
+    for (size_t i = 0; i < 20; ++i)
+    {
+        char key = (char) ('a' + i);
+        pair *p = pair_alloc(&key, &zero, char_key_cpy, int_value_cpy,
+                             char_key_cmp, int_value_cmp,
+                             char_key_free, int_value_free);
+        assert (hashmap_find_or_insert(map, p, &inserted) != NULL);
+        assert (inserted == 1);
+        pair_free((void **) &p);
+    }
+    assert (map->capacity == 32);
+    assert (*slot == hashmap_at(map, &key1));
+    assert (*(int *) *slot == 1);
+    pair_free((void **) &p1);
+
+    hashmap_free(&map);
+    assert (map == NULL);
+}
+
+/**
+ * This function checks the hashmap_upsert function of the hashmap library.
+ * If hashmap_upsert fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_upsert(void)
+{
+    hashmap *map = hashmap_alloc (hash_char);
+    assert (hashmap_upsert(map, NULL) == 0);
+    assert (hashmap_upsert(NULL, NULL) == 0);
+
+    for (size_t i = 0; i < 10; ++i)
+    {
+        char key = (char) ('A' + i);
+        pair *p = pair_alloc(&key, &i, char_key_cpy, int_value_cpy,
+                             char_key_cmp, int_value_cmp,
+                             char_key_free, int_value_free);
+        assert (hashmap_upsert(map, p) == 1);
+        assert (*(int *) hashmap_at(map, &key) == (int) i);
+        pair_free((void **) &p);
+    }
+    assert (map->size == 10);
+
+    for (size_t i = 0; i < 10; ++i)
+    {
+        char key = (char) ('A' + i);
+        size_t value = i * 10;
+        pair *p = pair_alloc(&key, &value, char_key_cpy, int_value_cpy,
+                             char_key_cmp, int_value_cmp,
+                             char_key_free, int_value_free);
+        assert (hashmap_upsert(map, p) == 1);
+        // check that the value was replaced and not inserted again.
+        assert (*(int *) hashmap_at(map, &key) == (int) value);
+        assert (map->size == 10);
+        pair_free((void **) &p);
+    }
+    hashmap_free(&map);
+    assert (map == NULL);
+}
+
+/**
+ * This function checks the hashmap_erase_if function of the hashmap library.
+ * If hashmap_erase_if fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_erase_if(void)
+{
+    hashmap *map = hashmap_alloc (hash_char);
+
+    assert(hashmap_erase_if (NULL, NULL) == -1);
+    assert(hashmap_erase_if (NULL, is_digit) == -1);
+    assert(hashmap_erase_if (map, NULL) == -1);
+    assert(hashmap_erase_if (map, is_digit) == 0);
+
+    // 10 digits and 15 capital letters.
+    for (size_t i = 0; i < 25; ++i)
+    {
+        char key = (char) (i < 10 ? '0' + i : 'A' + i - 10);
+        pair *p = pair_alloc(&key, &i, char_key_cpy, int_value_cpy,
+                             char_key_cmp, int_value_cmp,
+                             char_key_free, int_value_free);
+        assert (hashmap_insert(map, p) == 1);
+        pair_free((void **) &p);
+    }
+    assert (map->capacity == 64);
+
+    assert(hashmap_erase_if(map, is_digit) == 10);
+    assert (map->size == 15);
+    // 15 / 64 is below the minimal load factor, minimized once to 32.
+    assert (map->capacity == 32);
+    assert(hashmap_erase_if(map, is_digit) == 0);
+
+    char k1 = '5';
+    char k2 = 'C';
+    assert (hashmap_at(map, &k1) == NULL);
+    assert (*(int *) hashmap_at(map, &k2) == 12);
+
+    hashmap_free(&map);
+    assert (map == NULL);
+}
+
+/**
+ * Allocates a hash map of char->int with the keys ['first', 'last') (in ascii order),
+ * every key is mapped to value.
+ */
+hashmap *alloc_char_int_map (char first, char last, int value)
+{
+    hashmap *map = hashmap_alloc (hash_char);
+    for (char key = first; key < last; ++key)
+    {
+        pair *p = pair_alloc(&key, &value, char_key_cpy, int_value_cpy,
+                             char_key_cmp, int_value_cmp,
+                             char_key_free, int_value_free);
+        hashmap_insert(map, p);
+        pair_free((void **) &p);
+    }
+    return map;
+}
+
+/**
+ * This function checks the hashmap_reserve function of the hashmap library.
+ * If hashmap_reserve fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_reserve(void)
+{
+    hashmap *map = alloc_char_int_map ('A', 'E', 1);
+    assert (hashmap_reserve(NULL, 10) == 0);
+    assert (hashmap_reserve(map, 0) == 1);
+    assert (map->capacity == 16);
+
+    // 12 pairs still fit in 16 buckets, the 13th would extend the map.
+    assert (hashmap_reserve(map, 12) == 1);
+    assert (map->capacity == 16);
+    assert (hashmap_reserve(map, 13) == 1);
+    assert (map->capacity == 32);
+    assert (hashmap_reserve(map, 100) == 1);
+    assert (map->capacity == 256);
+    assert (map->size == 4);
+
+    // no number of buckets can hold that many pairs, the map is left unchanged.
+    assert (hashmap_reserve(map, (size_t) -1 / 2) == 0);
+    assert (hashmap_reserve(map, (size_t) -1) == 0);
+    assert (map->capacity == 256);
+
+    char key = 'C';
+    assert (*(int *) hashmap_at(map, &key) == 1);
+    hashmap_free(&map);
+    assert (map == NULL);
+}
+
+/**
+ * This function checks the hashmap_merge function of the hashmap library.
+ * If hashmap_merge fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_merge(void)
+{
+    // dst: A..O -> 1, src: K..Z -> 2.
+    hashmap *dst = alloc_char_int_map ('A', 'P', 1);
+    hashmap *src = alloc_char_int_map ('K', '[', 2);
+    assert (hashmap_merge(NULL, src, HASH_MAP_KEEP_DST) == -1);
+    assert (hashmap_merge(dst, NULL, HASH_MAP_KEEP_DST) == -1);
+    assert (hashmap_merge(dst, dst, HASH_MAP_KEEP_DST) == -1);
+
+    assert (hashmap_merge(dst, src, HASH_MAP_KEEP_DST) == 11);
+    assert (dst->size == 26);
+    assert (dst->capacity == 64);
+    assert (src->size == 16);
+    char k1 = 'K';
+    char k2 = 'Z';
+    assert (*(int *) hashmap_at(dst, &k1) == 1);
+    assert (*(int *) hashmap_at(dst, &k2) == 2);
+    // check that copies of the pairs were inserted.
+    assert (hashmap_at(dst, &k2) != hashmap_at(src, &k2));
+
+    hashmap *dst2 = alloc_char_int_map ('A', 'P', 1);
+    assert (hashmap_merge(dst2, src, HASH_MAP_KEEP_SRC) == 16);
+    assert (dst2->size == 26);
+    assert (*(int *) hashmap_at(dst2, &k1) == 2);
+
+    hashmap_free(&dst);
+    hashmap_free(&dst2);
+    hashmap_free(&src);
+}
+
+/**
+ * This function checks the hashmap_merge_move function of the hashmap library.
+ * If hashmap_merge_move fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_merge_move(void)
+{
+    hashmap *dst = alloc_char_int_map ('A', 'P', 1);
+    hashmap *src = alloc_char_int_map ('K', '[', 2);
+    assert (hashmap_merge_move(dst, NULL, HASH_MAP_KEEP_DST) == -1);
+    assert (hashmap_merge_move(NULL, &src, HASH_MAP_KEEP_DST) == -1);
+    assert (hashmap_merge_move(dst, &dst, HASH_MAP_KEEP_DST) == -1);
+
+    char k1 = 'K';
+    char k2 = 'Z';
+    valueT moved_value = hashmap_at(src, &k2);
+    assert (hashmap_merge_move(dst, &src, HASH_MAP_KEEP_DST) == 11);
+    assert (src == NULL);
+    assert (dst->size == 26);
+    assert (*(int *) hashmap_at(dst, &k1) == 1);
+    // check that the pair itself was moved.
+    assert (hashmap_at(dst, &k2) == moved_value);
+
+    hashmap *src2 = alloc_char_int_map ('0', ':', 3);
+    char k3 = '0';
+    assert (hashmap_merge_move(dst, &src2, HASH_MAP_KEEP_SRC) == 10);
+    assert (src2 == NULL);
+    assert (dst->size == 36);
+    assert (*(int *) hashmap_at(dst, &k3) == 3);
+
+    hashmap *src3 = alloc_char_int_map ('A', 'C', 4);
+    assert (hashmap_merge_move(dst, &src3, HASH_MAP_KEEP_SRC) == 2);
+    assert (dst->size == 36);
+    char k4 = 'B';
+    assert (*(int *) hashmap_at(dst, &k4) == 4);
+
+    hashmap_free(&dst);
+}
+
+/**
+ * This function checks the hashmap_clone function of the hashmap library.
+ * If hashmap_clone fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_clone(void)
+{
+    assert (hashmap_clone(NULL) == NULL);
+    hashmap *map = alloc_char_int_map ('A', '[', 5);
+    hashmap *copy = hashmap_clone(map);
+    assert (copy != NULL);
+    assert (copy->size == map->size);
+    assert (copy->capacity == map->capacity);
+    for (char key = 'A'; key < '['; ++key)
+    {
+        assert (*(int *) hashmap_at(copy, &key) == 5);
+        // check that the pairs were copied.
+        assert (hashmap_at(copy, &key) != hashmap_at(map, &key));
+    }
+
+    // check that the copies are independent.
+    char key = 'Q';
+    assert (hashmap_erase(map, &key) == 1);
+    assert (*(int *) hashmap_at(copy, &key) == 5);
+    hashmap_free(&map);
+    assert (copy->size == 26);
+    hashmap_free(&copy);
+}
+
+/**
+ * This function checks the hashmap_stats function of the hashmap library.
+ * If hashmap_stats fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_stats(void)
+{
+    hashmap *map = hashmap_alloc (hash_char);
+    hashmap_statistics stats;
+    assert (hashmap_stats(NULL, &stats) == 0);
+    assert (hashmap_stats(map, NULL) == 0);
+
+    // 'A', 'Q' and 'a' are all hashed to bucket 1 of 16.
+    const char *keys = "AQa";
+    for (size_t i = 0; i < 3; ++i)
+    {
+        pair *p = pair_alloc(&keys[i], &i, char_key_cpy, int_value_cpy,
+                             char_key_cmp, int_value_cmp,
+                             char_key_free, int_value_free);
+        hashmap_insert(map, p);
+        pair_free((void **) &p);
+    }
+    hashmap_reset_counters(map);
+    char k1 = 'A';
+    char k2 = 'q';
+    assert (hashmap_at(map, &k1) != NULL);
+    assert (hashmap_at(map, &k2) == NULL);
+
+    assert (hashmap_stats(map, &stats) == 1);
+    assert (stats.size == 3);
+    assert (stats.capacity == 16);
+    assert (stats.bucket_length_histogram[0] == 15);
+    assert (stats.bucket_length_histogram[3] == 1);
+    assert (stats.max_bucket_length == 3);
+    assert (stats.mean_bucket_length == 3);
+    assert (stats.empty_bucket_ratio == 15.0 / 16.0);
+    assert (stats.pair_bytes == 3 * sizeof(pair));
+    assert (stats.total_bytes > stats.bucket_bytes + stats.vector_data_bytes);
+#if HASH_MAP_COUNTERS
+    assert (stats.counters.lookup_hits == 1);
+    assert (stats.counters.lookup_misses == 1);
+    assert (stats.counters.key_cmp_calls == 4);
+#endif
+
+    // 10 more pairs extend the map once, erasing them all minimizes it.
+    for (size_t i = 0; i < 10; ++i)
+    {
+        char key = (char) ('0' + i);
+        pair *p = pair_alloc(&key, &i, char_key_cpy, int_value_cpy,
+                             char_key_cmp, int_value_cmp,
+                             char_key_free, int_value_free);
+        hashmap_insert(map, p);
+        pair_free((void **) &p);
+    }
+    assert (hashmap_erase_if(map, is_digit) == 10);
+    assert (hashmap_stats(map, &stats) == 1);
+    assert (stats.counters.resizes_up == 1);
+    assert (stats.counters.resizes_down == 1);
+
+    hashmap_free(&map);
+}
+
+/**
+ * This function checks the latency measurement functions of the hashmap library.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_latency(void)
+{
+    hashmap *map = hashmap_alloc (hash_char);
+    assert (hashmap_latency_enable(NULL) == 0);
+    assert (hashmap_latency(map, HASH_MAP_OP_INSERT) == NULL);
+
+    assert (hashmap_latency_enable(map) == 1);
+    for (size_t i = 0; i < 13; ++i)
+    {
+        char key = (char) ('A' + i);
+        pair *p = pair_alloc(&key, &i, char_key_cpy, int_value_cpy,
+                             char_key_cmp, int_value_cmp,
+                             char_key_free, int_value_free);
+        hashmap_insert(map, p);
+        hashmap_at(map, &key);
+        pair_free((void **) &p);
+    }
+    char key = 'A';
+    hashmap_erase(map, &key);
+
+    // the 13th insertion extended the map, it is recorded separately.
+    assert (hashmap_latency(map, HASH_MAP_OP_INSERT)->count == 12);
+    assert (hashmap_latency(map, HASH_MAP_OP_INSERT_RESIZE)->count == 1);
+    assert (hashmap_latency(map, HASH_MAP_OP_RESIZE)->count == 1);
+    assert (hashmap_latency(map, HASH_MAP_OP_AT)->count == 13);
+    assert (hashmap_latency(map, HASH_MAP_OP_ERASE)->count == 1);
+    assert (hashmap_latency(map, HASH_MAP_OPS) == NULL);
+
+    const latency_histogram *h = hashmap_latency(map, HASH_MAP_OP_AT);
+    assert (h->min <= latency_histogram_percentile(h, 50));
+    assert (latency_histogram_percentile(h, 50) <= latency_histogram_percentile(h, 99));
+    assert (latency_histogram_percentile(h, 100) == h->max);
+
+    hashmap_latency_disable(map);
+    assert (hashmap_latency(map, HASH_MAP_OP_AT) == NULL);
+    hashmap_free(&map);
+
+    // recorded values are kept within 1 / LATENCY_HISTOGRAM_SUB_BUCKETS.
+    latency_histogram histogram = {0};
+    for (unsigned long long value = 1; value <= 1000; ++value)
+    {
+        latency_histogram_record(&histogram, value * 1000);
+    }
+    assert (histogram.count == 1000);
+    unsigned long long p50 = latency_histogram_percentile(&histogram, 50);
+    assert ((p50 >= 500000) && (p50 <= 500000 + 500000 / LATENCY_HISTOGRAM_SUB_BUCKETS));
+    assert (latency_histogram_percentile(&histogram, 100) == 1000000);
+    latency_histogram_clear(&histogram);
+    assert (latency_histogram_percentile(&histogram, 50) == 0);
+
+    // the nearest rank: p99 of 50 values is the 50th one, p98 the 49th.
+    for (int i = 0; i < 48; ++i)
+    {
+        latency_histogram_record(&histogram, 1);
+    }
+    latency_histogram_record(&histogram, 1000);
+    latency_histogram_record(&histogram, 1000000);
+    assert (latency_histogram_percentile(&histogram, 99) == 1000000);
+    unsigned long long p98 = latency_histogram_percentile(&histogram, 98);
+    assert ((p98 >= 1000) && (p98 <= 1000 + 1000 / LATENCY_HISTOGRAM_SUB_BUCKETS));
+    assert (latency_histogram_percentile(&histogram, 50) == 1);
+    assert (latency_histogram_percentile(&histogram, 0) == 1);
+}
+
+/**
+ * This function checks the vector_erase and vector_clear functions of the vector library.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_vector_erase_clear(void)
+{
+    vector *v = vector_alloc (char_key_cpy, char_key_cmp, char_key_free);
+    for (size_t i = 0; i < 40; ++i)
+    {
+        char c = (char) ('A' + i);
+        assert (vector_push_back(v, &c) == 1);
+    }
+    assert (v->size == 40);
+    assert (v->capacity == 64);
+
+    // erasing keeps the order of the remaining elements.
+    assert (vector_erase(v, 0) == 1);
+    assert (vector_erase(v, 40) == 0);
+    assert (*(char *) vector_at(v, 0) == 'B');
+    assert (*(char *) vector_at(v, 38) == 'A' + 39);
+    char c = 'K';
+    assert (vector_find(v, &c) == 9);
+
+    // 16 / 64 reaches the minimal load factor, the vector is minimized to 32.
+    while (v->size > 16)
+    {
+        assert (vector_erase(v, v->size / 2) == 1);
+    }
+    assert (v->capacity == 32);
+    while (v->size > 0)
+    {
+        assert (vector_erase(v, v->size - 1) == 1);
+    }
+    // a vector is never minimized below its initial capacity.
+    assert (v->capacity == VECTOR_INITIAL_CAP);
+
+    for (size_t i = 0; i < 40; ++i)
+    {
+        c = (char) ('a' + i);
+        assert (vector_push_back(v, &c) == 1);
+    }
+    vector_clear(v);
+    assert (v->size == 0);
+    assert (v->capacity == VECTOR_INITIAL_CAP);
+    assert (vector_push_back(v, &c) == 1);
+    assert (*(char *) vector_at(v, 0) == c);
+    vector_free(&v);
+    assert (v == NULL);
+}
+
+/**
+ * This function checks the vector_erase_unordered function of the vector library.
+ * If vector_erase_unordered fails at some points, the functions exits with exit code 1.
+ */
+void test_vector_erase_unordered(void)
+{
+    vector *v = vector_alloc (char_key_cpy, char_key_cmp, char_key_free);
+    assert (vector_erase_unordered(NULL, 0) == 0);
+    assert (vector_erase_unordered(v, 0) == 0);
+    for (size_t i = 0; i < 5; ++i)
+    {
+        char c = (char) ('A' + i);
+        assert (vector_push_back(v, &c) == 1);
+    }
+    // the last element takes the place of the erased one.
+    assert (vector_erase_unordered(v, 1) == 1);
+    assert (v->size == 4);
+    assert (*(char *) vector_at(v, 1) == 'E');
+    assert (*(char *) vector_at(v, 3) == 'D');
+    assert (vector_erase_unordered(v, 3) == 1);
+    assert (vector_erase_unordered(v, 3) == 0);
+    char c = 'B';
+    assert (vector_find(v, &c) == -1);
+    assert (v->size == 3);
+    vector_free(&v);
+    assert (v == NULL);
+}
+
+/**
+ * This function checks the vector_init_inline and vector_destroy functions of the vector library.
+ * If it fails at some points, the functions exits with exit code 1.
+ */
+void test_vector_inline(void)
+{
+    vector v;
+    assert (vector_init_inline(&v, NULL, char_key_cmp, char_key_free) == 0);
+    assert (vector_init_inline(&v, char_key_cpy, char_key_cmp, char_key_free) == 1);
+    assert (v.data == v.inline_data);
+    assert (v.capacity == VECTOR_INLINE_CAP);
+    char c = 'A';
+    assert (vector_push_back(&v, &c) == 1);
+    assert (v.data == v.inline_data);
+    // outgrowing the inline storage moves the elements to the heap.
+    for (size_t i = 1; i < 10; ++i)
+    {
+        c = (char) ('A' + i);
+        assert (vector_push_back(&v, &c) == 1);
+    }
+    assert (v.data != v.inline_data);
+    assert (v.size == 10);
+    for (size_t i = 0; i < 10; ++i)
+    {
+        assert (*(char *) vector_at(&v, i) == (char) ('A' + i));
+    }
+    c = 'J';
+    assert (vector_find(&v, &c) == 9);
+    assert (vector_erase(&v, 0) == 1);
+    assert (*(char *) vector_at(&v, 0) == 'B');
+    vector_destroy(&v);
+    assert (v.size == 0);
+    assert (v.data == v.inline_data);
+    // a destroyed vector can be reused as an empty one.
+    assert (vector_push_back(&v, &c) == 1);
+    vector_destroy(&v);
+}
+
+/**
+ * This function checks the element-size vector functions (vector_alloc_elem, vector_reserve,
+ * vector_append_range and vector_data) of the vector library.
+ * If it fails at some points, the functions exits with exit code 1.
+ */
+void test_vector_elem(void)
+{
+    assert (vector_alloc_elem(0) == NULL);
+    vector *v = vector_alloc_elem(sizeof(int));
+    assert (v != NULL);
+    for (int i = 0; i < 20; ++i)
+    {
+        assert (vector_push_back(v, &i) == 1);
+    }
+    assert (v->size == 20);
+    assert (*(int *) vector_at(v, 7) == 7);
+    assert ((int *) vector_data(v) + 7 == vector_at(v, 7));
+    int value = 13;
+    assert (vector_find(v, &value) == 13);
+    value = 20;
+    assert (vector_find(v, &value) == -1);
+    int *p = &value;
+    assert (vector_emplace_back(v, p) == 0);
+
+    int range[5] = {100, 101, 102, 103, 104};
+    assert (vector_append_range(v, range, 5) == 1);
+    assert (v->size == 25);
+    assert (*(int *) vector_at(v, 24) == 104);
+    // appending the vector's own elements survives the reallocation.
+    assert (vector_append_range(v, vector_data(v), v->size) == 1);
+    assert (v->size == 50);
+    assert (*(int *) vector_at(v, 45) == 100);
+
+    assert (vector_erase(v, 0) == 1);
+    assert (*(int *) vector_at(v, 0) == 1);
+    assert (vector_erase_unordered(v, 0) == 1);
+    assert (*(int *) vector_at(v, 0) == 104);
+    assert (v->size == 48);
+    vector_clear(v);
+    assert (v->size == 0);
+    assert (v->capacity == VECTOR_INITIAL_CAP);
+    // the initial capacity holds 12 elements, the 13th reaches 3/4 of it.
+    assert ((vector_reserve(v, 12) == 1) && (v->capacity == VECTOR_INITIAL_CAP));
+    assert ((vector_reserve(v, 13) == 1) && (v->capacity == 2 * VECTOR_INITIAL_CAP));
+
+    assert (vector_reserve(v, 1000) == 1);
+    size_t capacity = v->capacity;
+    for (int i = 0; i < 1000; ++i)
+    {
+        assert (vector_push_back(v, &i) == 1);
+    }
+    assert (v->capacity == capacity);
+    // no data array can hold that many elements, the vector is left unchanged.
+    assert (vector_reserve(v, SIZE_MAX) == 0);
+    assert (vector_append_range(v, range, SIZE_MAX) == 0);
+    assert ((v->capacity == capacity) && (v->size == 1000));
+    vector_free(&v);
+    char block[16] = {0};
+    v = vector_alloc_elem(sizeof(block));
+    assert (vector_reserve(v, SIZE_MAX / sizeof(block) + 2) == 0);
+    assert ((v->capacity == VECTOR_INITIAL_CAP) && (vector_push_back(v, block) == 1));
+    vector_free(&v);
+
+    // elements that are not 1, 2, 4 or 8 bytes long are compared with memcmp.
+    char triples[3][3] = {{'a', 'b', 'c'}, {'d', 'e', 'f'}, {'g', 'h', 'i'}};
+    v = vector_alloc_elem(3);
+    assert (vector_append_range(v, triples, 3) == 1);
+    assert (vector_find(v, triples[2]) == 2);
+    vector_free(&v);
+    assert (v == NULL);
+
+    // pointer vectors take an array of pointers to the elements to be copied.
+    v = vector_alloc (char_key_cpy, char_key_cmp, char_key_free);
+    char a = 'A', b = 'B';
+    const void *chars[2] = {&a, &b};
+    assert (vector_append_range(v, chars, 2) == 1);
+    assert (*(char *) vector_at(v, 1) == 'B');
+    assert (vector_at(v, 1) != &b);
+    vector_free(&v);
+}
+
+/**
+ * This function checks the simd_find functions, and vector_find of element-size vectors.
+ * If it fails at some points, the functions exits with exit code 1.
+ */
+void test_simd_find(void)
+{
+    uint8_t u8[70];
+    uint16_t u16[70];
+    uint32_t u32[70];
+    uint64_t u64[70];
+    for (size_t i = 0; i < 70; ++i)
+    {
+        u8[i] = (uint8_t) i;
+        u16[i] = (uint16_t) (i * 1000);
+        u32[i] = (uint32_t) (i * 100000);
+        // the values differ only in their upper half.
+        u64[i] = (uint64_t) i << 32;
+    }
+    // every position of every block and of the scalar tail, for every length.
+    for (size_t count = 0; count <= 70; ++count)
+    {
+        for (size_t i = 0; i < 70; ++i)
+        {
+            size_t expected = (i < count) ? i : count;
+            assert (simd_find_u8(u8, count, (uint8_t) i) == expected);
+            assert (simd_find_u16(u16, count, (uint16_t) (i * 1000)) == expected);
+            assert (simd_find_u32(u32, count, (uint32_t) (i * 100000)) == expected);
+            assert (simd_find_u64(u64, count, (uint64_t) i << 32) == expected);
+        }
+        assert (simd_find_u8(u8, count, 200) == count);
+        assert (simd_find_u64(u64, count, 1) == count);
+    }
+    // unaligned arrays and repeated values.
+    u32[40] = u32[10];
+    assert (simd_find_u32(u32 + 1, 69, u32[10]) == 9);
+    assert (simd_find_u32(NULL, 0, 0) == 0);
+    assert (simd_find_isa() != NULL);
+
+    vector *v = vector_alloc_elem(sizeof(uint64_t));
+    assert (vector_append_range(v, u64, 70) == 1);
+    uint64_t value = (uint64_t) 69 << 32;
+    assert (vector_find(v, &value) == 69);
+    value = 69;
+    assert (vector_find(v, &value) == -1);
+    vector_free(&v);
+}
+
+/**
+ * This function checks the hashmap_set_key_size function of the hashmap library.
+ * If it fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_key_size(void)
+{
+    hashmap *map = alloc_char_int_map('A', 'Z', 1);
+    assert (hashmap_set_key_size(NULL, sizeof(char)) == 0);
+    assert (hashmap_set_key_size(map, sizeof(char)) == 1);
+    hashmap_reset_counters(map);
+    char key = 'Q';
+    assert (*(int *) hashmap_at(map, &key) == 1);
+#if HASH_MAP_COUNTERS
+    assert (map->counters.lookup_hits == 1);
+#endif
+    key = 'q';
+    assert (hashmap_at(map, &key) == NULL);
+    key = 'Q';
+    assert (hashmap_erase(map, &key) == 1);
+    assert (hashmap_at(map, &key) == NULL);
+    hashmap *copy = hashmap_clone(map);
+    assert (copy->key_size == sizeof(char));
+    key = 'R';
+    assert (*(int *) hashmap_at(copy, &key) == 1);
+    assert (hashmap_set_key_size(map, 0) == 1);
+    assert (*(int *) hashmap_at(map, &key) == 1);
+    hashmap_free(&copy);
+    hashmap_free(&map);
+}
+
+/**
+ * Charges every entry of the cache its int value in bytes.
+ */
+size_t int_value_bytes (const_keyT key, const_valueT value)
+{
+    (void) key;
+    return (size_t) *(int *) value;
+}
+
+/**
+ * Counts the evictions into the int context and records the last evicted key.
+ */
+void count_eviction (const_keyT key, valueT value, void *ctx)
+{
+    (void) value;
+    int *evicted = ctx;
+    ++evicted[0];
+    evicted[1] = *(char *) key;
+}
+
+/**
+ * Upserts the pair (key, value) with char keys and int values to the cache.
+ */
+int lru_put (lru_hashmap *lru, char key, int value)
+{
+    pair *p = pair_alloc(&key, &value, char_key_cpy, int_value_cpy,
+                         char_key_cmp, int_value_cmp, char_key_free, int_value_free);
+    int result = lru_hashmap_upsert(lru, p);
+    pair_free((void **) &p);
+    return result;
+}
+
+/**
+ * This function checks the lru_hashmap functions.
+ * If it fails at some points, the functions exits with exit code 1.
+ */
+void test_lru_hashmap(void)
+{
+    assert (lru_hashmap_alloc(NULL, 3, 0, NULL) == NULL);
+    assert (lru_hashmap_alloc(hash_char, 3, 10, NULL) == NULL);
+
+    // a limit of 3 entries.
+    lru_hashmap *lru = lru_hashmap_alloc(hash_char, 3, 0, NULL);
+    int evicted[2] = {0, 0};
+    lru_hashmap_set_evict_func(lru, count_eviction, evicted);
+    assert (lru_put(lru, 'A', 1) == 1);
+    assert (lru_put(lru, 'B', 2) == 1);
+    assert (lru_put(lru, 'C', 3) == 1);
+    char key = 'A';
+    // 'A' is promoted, so 'B' is the least recently used.
+    assert (*(int *) lru_hashmap_at(lru, &key) == 1);
+    assert (lru_put(lru, 'D', 4) == 1);
+    assert (evicted[0] == 1 && evicted[1] == 'B');
+    key = 'B';
+    assert (lru_hashmap_at(lru, &key) == NULL);
+    assert (lru->map->size == 3);
+    // replacing a value promotes it too, without evicting.
+    assert (lru_put(lru, 'C', 30) == 1);
+    key = 'C';
+    assert (*(int *) lru_hashmap_peek(lru, &key) == 30);
+    assert (lru_put(lru, 'E', 5) == 1);
+    assert (evicted[0] == 2 && evicted[1] == 'A');
+    // peek does not promote: 'D' is still the least recently used.
+    key = 'D';
+    assert (*(int *) lru_hashmap_peek(lru, &key) == 4);
+    assert (lru_put(lru, 'F', 6) == 1);
+    assert (evicted[1] == 'D');
+    assert (lru->counters.hits == 1);
+    assert (lru->counters.misses == 1);
+    assert (lru->counters.evictions == 3);
+    key = 'E';
+    assert (lru_hashmap_erase(lru, &key) == 1);
+    assert (lru_hashmap_erase(lru, &key) == 0);
+    assert (lru->map->size == 2);
+    assert (lru->head != NULL && *(char *) lru->head->key == 'F');
+    assert (*(char *) lru->tail->key == 'C');
+    lru_hashmap_free(&lru);
+    assert (lru == NULL);
+
+    // a budget of 10 bytes, an entry is charged its value.
+    lru = lru_hashmap_alloc(hash_char, 0, 10, int_value_bytes);
+    assert (lru_put(lru, 'A', 11) == 0);
+    assert (lru_put(lru, 'A', 4) == 1);
+    assert (lru_put(lru, 'B', 4) == 1);
+    assert (lru->bytes == 8);
+    // 'A' and 'B' are both evicted to make room for 'C'.
+    assert (lru_put(lru, 'C', 9) == 1);
+    assert (lru->bytes == 9);
+    assert (lru->map->size == 1);
+    assert (lru->counters.evictions == 2);
+    assert (lru_put(lru, 'C', 1) == 1);
+    assert (lru->bytes == 1);
+    lru_hashmap_free(&lru);
+}
+
+unsigned long long timer_test_now = 0;
+
+/**
+ * Checks the timer expired on time (by timer_test_now), marks it expired by
+ * pointing its data to itself, and counts it into the int context.
+ */
+void record_expiry (timer_node *node, void *ctx)
+{
+    assert (node->expires <= timer_test_now);
+    node->data = node;
+    ++*(int *) ctx;
+}
+
+/**
+ * This function checks the timer_wheel functions.
+ * If it fails at some points, the functions exits with exit code 1.
+ */
+void test_timer_wheel(void)
+{
+    timer_wheel *wheel = timer_wheel_alloc(100);
+    // delays within every level, across level boundaries and beyond the last level.
+    unsigned long long delays[12] = {0, 1, 63, 64, 65, 4095, 4096, 300000,
+                                     (1ULL << 18) + 7, (1ULL << 24) - 1, (1ULL << 24) + 5,
+                                     (1ULL << 26) + 3};
+    timer_node nodes[12];
+    for (size_t i = 0; i < 12; ++i)
+    {
+        nodes[i].expires = 100 + delays[i];
+        nodes[i].data = NULL;
+        timer_wheel_add(wheel, &nodes[i]);
+    }
+    assert (wheel->count == 12);
+    // a removed timer never expires.
+    timer_wheel_remove(wheel, &nodes[4]);
+    assert (wheel->count == 11);
+
+    int expired = 0;
+    // advance in uneven steps, every timer must expire exactly when it is due.
+    unsigned long long steps[4] = {1, 63, 4097, 1000003};
+    size_t step = 0;
+    while (wheel->count > 0)
+    {
+        unsigned long long target = wheel->now + steps[step % 4];
+        ++step;
+        timer_test_now = target;
+        timer_wheel_advance(wheel, target, 0, record_expiry, &expired);
+        for (size_t i = 0; i < 12; ++i)
+        {
+            if ((i != 4) && (nodes[i].expires <= target))
+            {
+                assert (nodes[i].data == &nodes[i]);
+            }
+            if (nodes[i].expires > target)
+            {
+                assert (nodes[i].data == NULL);
+            }
+        }
+    }
+    assert (expired == 11);
+    assert (nodes[4].data == NULL);
+
+    // the budget stops the wheel, and the next call resumes where it stopped.
+    unsigned long long base = wheel->now;
+    for (size_t i = 0; i < 12; ++i)
+    {
+        nodes[i].expires = base + 10;
+        nodes[i].data = NULL;
+        timer_wheel_add(wheel, &nodes[i]);
+    }
+    expired = 0;
+    timer_test_now = base + 20;
+    assert (timer_wheel_advance(wheel, base + 20, 5, record_expiry, &expired) == 5);
+    assert (timer_wheel_advance(wheel, base + 20, 5, record_expiry, &expired) == 5);
+    assert (timer_wheel_advance(wheel, base + 20, 0, record_expiry, &expired) == 2);
+    assert (wheel->count == 0);
+    assert (wheel->now == base + 20);
+
+    // a deferred timer keeps its expires, and expires again on the next tick.
+    nodes[0].expires = base + 10;
+    nodes[0].data = NULL;
+    timer_wheel_defer(wheel, &nodes[0]);
+    assert (wheel->count == 1);
+    assert (timer_wheel_advance(wheel, base + 20, 0, record_expiry, &expired) == 0);
+    timer_test_now = base + 21;
+    assert (timer_wheel_advance(wheel, base + 21, 0, record_expiry, &expired) == 1);
+    assert ((nodes[0].data == &nodes[0]) && (nodes[0].expires == base + 10));
+    assert (wheel->count == 0);
+    timer_wheel_free(&wheel);
+    assert (wheel == NULL);
+}
+
+unsigned long long ttl_test_now = 1000;
+
+/**
+ * The clock of the hash maps of test_hash_map_ttl.
+ */
+unsigned long long ttl_test_clock (void)
+{
+    return ttl_test_now;
+}
+
+/**
+ * Checks whether a key is one of 'a' to 'd', the keyT_func of test_hash_map_ttl.
+ */
+int ttl_key_early(const_keyT key)
+{
+    char c = *(const char *) key;
+    return (c >= 'a') && (c <= 'd');
+}
+
+/**
+ * This function checks the hashmap_insert_ttl and hashmap_expire functions of
+ * the hashmap library.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_ttl(void)
+{
+    hashmap *map = alloc_char_int_map('A', 'E', 1);
+    assert (hashmap_set_clock(map, ttl_test_clock) == 1);
+    int value = 2;
+    for (char key = 'a'; key < 'k'; ++key)
+    {
+        pair *p = pair_alloc(&key, &value, char_key_cpy, int_value_cpy,
+                             char_key_cmp, int_value_cmp, char_key_free, int_value_free);
+        // 'a' lives 1 tick, 'b' 2 ticks and so on.
+        assert (hashmap_insert_ttl(map, p, (unsigned long long) (key - 'a' + 1)) == 1);
+        assert (hashmap_insert_ttl(map, p, 100) == 0);
+        pair_free((void **) &p);
+    }
+    assert (hashmap_set_clock(map, ttl_test_clock) == 0);
+    assert (map->size == 14);
+    char key = 'c';
+    assert (*(int *) hashmap_at(map, &key) == 2);
+
+    // 'a', 'b' and 'c' expired: invisible at once, reclaimed by hashmap_expire.
+    ttl_test_now = 1003;
+    assert (hashmap_at(map, &key) == NULL);
+    size_t bucket = 0, index = 0, live = 0;
+    const pair *next = NULL;
+    while ((next = hashmap_next(map, &bucket, &index)) != NULL)
+    {
+        char next_key = *(const char *) next->key;
+        assert ((next_key < 'a') || (next_key > 'c'));
+        ++live;
+    }
+    assert ((live == 11) && (map->size == 14));
+    // the expired pairs are not erased again by hashmap_erase_if.
+    hashmap *early = hashmap_clone(map);
+    assert (hashmap_erase_if(early, ttl_key_early) == 1);
+    assert ((early->size == 13) && (hashmap_expire(early, ttl_test_now, 0) == 3));
+    hashmap_free(&early);
+    hashmap *copy = hashmap_clone(map);
+    assert (hashmap_expire(map, ttl_test_now, 2) == 2);
+    assert (map->size == 12);
+    assert (hashmap_expire(map, ttl_test_now, 0) == 1);
+    assert (map->size == 11);
+    assert (map->counters.expirations == 3);
+    key = 'd';
+    assert (*(int *) hashmap_at(map, &key) == 2);
+    // an erased pair never expires, erasing an expired one fails.
+    assert (hashmap_erase(map, &key) == 1);
+    ttl_test_now = 1005;
+    key = 'e';
+    assert (hashmap_erase(map, &key) == 0);
+    assert (map->size == 9);
+    // an expired key can be inserted again.
+    key = 'e';
+    pair *p = pair_alloc(&key, &value, char_key_cpy, int_value_cpy,
+                         char_key_cmp, int_value_cmp, char_key_free, int_value_free);
+    assert (hashmap_insert(map, p) == 1);
+    pair_free((void **) &p);
+
+    // the copy expires its pairs at the same times.
+    assert (copy->size == 14);
+    assert (hashmap_expire(copy, ttl_test_now, 0) == 5);
+    assert (copy->size == 9);
+    key = 'f';
+    assert (*(int *) hashmap_at(copy, &key) == 2);
+
+    // only the pairs without a TTL are left.
+    ttl_test_now = 2000;
+    assert (hashmap_expire(map, ttl_test_now, 0) == 5);
+    assert (map->size == 5);
+    key = 'A';
+    assert (*(int *) hashmap_at(map, &key) == 1);
+    assert (hashmap_expire(NULL, ttl_test_now, 0) == 0);
+    hashmap_free(&copy);
+    hashmap_free(&map);
+}
+
+/**
+ * Sums the counts of a counter map, the counter_func of test_counter_map.
+ */
+void sum_counts (const_keyT key, intptr_t count, void *ctx)
+{
+    (void) key;
+    *(intptr_t *) ctx += count;
+}
+
+/**
+ * This function checks the counter_map functions.
+ * If it fails at some points, the functions exits with exit code 1.
+ */
+void test_counter_map(void)
+{
+    counter_map *words = counter_map_alloc(hash_char, char_key_cpy, char_key_cmp,
+                                           char_key_free);
+    assert (words != NULL);
+    const char *text = "abracadabra";
+    for (size_t i = 0; text[i] != '\0'; ++i)
+    {
+        assert (counter_map_increment(words, &text[i], 1) == 1);
+    }
+    char key = 'a';
+    assert (counter_map_get(words, &key) == 5);
+    key = 'r';
+    assert (counter_map_get(words, &key) == 2);
+    key = 'z';
+    assert (counter_map_get(words, &key) == 0);
+    assert (counter_map_increment(words, &key, -3) == 1);
+    assert (counter_map_get(words, &key) == -3);
+    assert (words->map->size == 6);
+    assert (counter_map_increment(words, NULL, 1) == 0);
+
+    // batches longer than COUNTER_MAP_BATCH, with and without deltas.
+    const_keyT keys[40];
+    intptr_t deltas[40];
+    char letters[40];
+    for (size_t i = 0; i < 40; ++i)
+    {
+        letters[i] = (char) ('A' + i % 20);
+        keys[i] = &letters[i];
+        deltas[i] = (intptr_t) i;
+    }
+    assert (counter_map_increment_batch(words, keys, NULL, 40) == 1);
+    key = 'T';
+    assert (counter_map_get(words, &key) == 2);
+    assert (counter_map_increment_batch(words, keys, deltas, 40) == 1);
+    assert (counter_map_get(words, &key) == 2 + 19 + 39);
+    assert (words->map->size == 26);
+    intptr_t sum = 0;
+    counter_map_for_each(words, sum_counts, &sum);
+    assert (sum == 11 - 3 + 40 + 39 * 40 / 2);
+
+    // thread local counts, merged on one thread and on several.
+    counter_map *locals[3];
+    for (size_t t = 0; t < 3; ++t)
+    {
+        locals[t] = counter_map_alloc(hash_char, char_key_cpy, char_key_cmp,
+                                      char_key_free);
+        for (size_t i = t; i < 40; i += 3)
+        {
+            assert (counter_map_increment(locals[t], &letters[i], 1) == 1);
+        }
+    }
+    counter_map *single = counter_map_alloc(hash_char, char_key_cpy, char_key_cmp,
+                                            char_key_free);
+    assert (counter_map_merge_parallel(single, locals, 3, 1) == 1);
+    // reserved, so the merge changes the buckets the snapshot shares.
+    assert (hashmap_reserve(words->map, 100) == 1);
+    hashmap_view *view = hashmap_snapshot(words->map);
+    assert (counter_map_merge_parallel(words, locals, 3, 4) == 1);
+    key = 'A';
+    assert ((intptr_t) hashmap_view_at(view, &key) == 2 + 20);
+    hashmap_view_free(&view);
+    assert (counter_map_merge_parallel(words, locals, 3, 0) == 0);
+    assert (counter_map_merge_parallel(words, &words, 1, 2) == 0);
+    assert (single->map->size == 20);
+    assert (words->map->size == 26);
+    key = 'A';
+    assert (counter_map_get(single, &key) == 2);
+    assert (counter_map_get(words, &key) == 2 + 20 + 2);
+    sum = 0;
+    counter_map_for_each(words, sum_counts, &sum);
+    assert (sum == 11 - 3 + 80 + 39 * 40 / 2);
+    key = 'z';
+    assert (counter_map_increment(words, &key, 1) == 1);
+    assert (counter_map_get(words, &key) == -2);
+    for (size_t t = 0; t < 3; ++t)
+    {
+        assert (locals[t]->map->size > 0);
+        counter_map_free(&locals[t]);
+    }
+    counter_map_free(&single);
+    counter_map_free(&words);
+    assert (words == NULL);
+}
+
+/**
+ * This function checks the bloom_filter functions.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_bloom_filter(void)
+{
+    assert (bloom_filter_alloc(100, 0, 0) == NULL);
+    assert (bloom_filter_alloc(100, 1, 0) == NULL);
+    bloom_filter *filter = bloom_filter_alloc(1000, 0.01, 0);
+    assert (filter != NULL);
+    // blocks are cache lines, and their number is a power of 2.
+    assert (((size_t) filter->blocks % 64) == 0);
+    assert ((filter->block_count & (filter->block_count - 1)) == 0);
+    assert (bloom_filter_bytes(filter) >= 1000 * 9 / 8);
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        bloom_filter_add(filter, i);
+    }
+    assert (filter->items == 1000);
+    size_t false_positives = 0;
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        assert (bloom_filter_may_contain(filter, i % 1000) == 1);
+        false_positives += bloom_filter_may_contain(filter, 1000 + i);
+    }
+    assert (false_positives < 3000);
+    bloom_filter_free(&filter);
+    assert (filter == NULL);
+
+    // a size limit trades memory for false positives.
+    filter = bloom_filter_alloc(1000, 0.01, 256);
+    assert (bloom_filter_bytes(filter) == 256);
+    bloom_filter_free(&filter);
+    assert (bloom_filter_bytes(NULL) == 0);
+    assert (bloom_filter_may_contain(NULL, 1) == 1);
+}
+
+/**
+ * This function checks the hashmap_filter_enable, hashmap_filter_disable and
+ * hashmap_filter_rebuild functions of the hashmap library.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_filter(void)
+{
+    hashmap *map = alloc_char_int_map('A', '[', 1);
+    assert (hashmap_filter_enable(map, 2, 0) == 0);
+    assert (map->filter == NULL);
+    assert (hashmap_filter_enable(map, 0.01, 0) == 1);
+    hashmap_statistics stats;
+    assert (hashmap_stats(map, &stats) == 1);
+    assert (stats.filter_bytes == bloom_filter_bytes(map->filter));
+    hashmap_reset_counters(map);
+    for (char key = 'A'; key <= 'Z'; ++key)
+    {
+        assert (*(int *) hashmap_at(map, &key) == 1);
+    }
+    size_t misses = 0;
+    for (char key = 'a'; key <= 'z'; ++key)
+    {
+        assert (hashmap_at(map, &key) == NULL);
+        ++misses;
+    }
+#if HASH_MAP_COUNTERS
+    assert (map->counters.filter_negatives > misses / 2);
+    assert (map->counters.lookup_misses == misses);
+    // the keys the filter rejected were never compared.
+    assert (map->counters.key_cmp_calls < 26 + misses);
+#endif
+
+    // insertions keep the filter up to date, also through the resizes.
+    int value = 2;
+    for (char key = 'a'; key <= 'z'; ++key)
+    {
+        pair *p = pair_alloc(&key, &value, char_key_cpy, int_value_cpy,
+                             char_key_cmp, int_value_cmp, char_key_free, int_value_free);
+        assert (hashmap_insert(map, p) == 1);
+        pair_free((void **) &p);
+    }
+    assert (map->size == 52);
+    hashmap *copy = hashmap_clone(map);
+    assert (copy->filter != NULL);
+    for (char key = 'a'; key <= 'z'; ++key)
+    {
+        assert (*(int *) hashmap_at(map, &key) == 2);
+        assert (*(int *) hashmap_at(copy, &key) == 2);
+    }
+
+    // heavy erasure rebuilds the filter.
+    char key = '0';
+    assert (hashmap_erase(map, &key) == 0);
+    for (key = 'a'; key < 'x'; ++key)
+    {
+        assert (hashmap_erase(map, &key) == 1);
+    }
+    assert (map->filter != NULL);
+    assert (map->filter_erased < map->filter->items);
+    for (key = 'A'; key <= 'Z'; ++key)
+    {
+        assert (*(int *) hashmap_at(map, &key) == 1);
+    }
+    key = 'y';
+    assert (*(int *) hashmap_at(map, &key) == 2);
+    key = 'b';
+    assert (hashmap_at(map, &key) == NULL);
+
+    assert (hashmap_filter_rebuild(map) == 1);
+    hashmap_filter_disable(map);
+    assert (map->filter == NULL);
+    assert (hashmap_filter_rebuild(map) == 1);
+    key = 'C';
+    assert (*(int *) hashmap_at(map, &key) == 1);
+    hashmap_free(&copy);
+    hashmap_free(&map);
+}
+
+/**
+ * Checks that the keys of a char->int ordered hash map are iterated in the
+ * order of keys (a string).
+ */
+int ordered_keys_equal (const ordered_hashmap *map, const char *keys)
+{
+    size_t cursor = 0;
+    size_t i = 0;
+    pair *p;
+    while ((p = ordered_hashmap_next(map, &cursor)) != NULL)
+    {
+        if ((keys[i] == '\0') || (*(char *) p->key != keys[i])) {return 0;}
+        ++i;
+    }
+    return keys[i] == '\0';
+}
+
+/**
+ * This function checks the ordered_hashmap functions.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_ordered_hashmap(void)
+{
+    ordered_hashmap *map = ordered_hashmap_alloc(hash_char);
+    assert (map->index_width == 1);
+    const char *keys = "thequickbrownfxjmpsvlazydg";
+    int value = 1;
+    for (size_t i = 0; keys[i] != '\0'; ++i)
+    {
+        pair *p = pair_alloc(&keys[i], &value, char_key_cpy, int_value_cpy,
+                             char_key_cmp, int_value_cmp, char_key_free, int_value_free);
+        assert (ordered_hashmap_insert(map, p) == 1);
+        // inserted again, the key keeps its place.
+        assert (ordered_hashmap_insert(map, p) == 0);
+        pair_free((void **) &p);
+    }
+    const char *expected = "thequickbrownfxjmpsvlazydg";
+    assert (map->size == 26);
+    assert (ordered_keys_equal(map, expected));
+
+    // a replaced value keeps its place, an erased key leaves a hole.
+    char key = 'q';
+    value = 5;
+    pair *p = pair_alloc(&key, &value, char_key_cpy, int_value_cpy,
+                         char_key_cmp, int_value_cmp, char_key_free, int_value_free);
+    assert (ordered_hashmap_upsert(map, p) == 1);
+    assert (*(int *) ordered_hashmap_at(map, &key) == 5);
+    assert (ordered_keys_equal(map, expected));
+    assert (ordered_hashmap_erase(map, &key) == 1);
+    assert (ordered_hashmap_erase(map, &key) == 0);
+    assert (ordered_hashmap_at(map, &key) == NULL);
+    assert (map->entries_used == 26);
+    assert (ordered_keys_equal(map, "theuickbrownfxjmpsvlazydg"));
+    // inserted again, it goes last.
+    assert (ordered_hashmap_insert(map, p) == 1);
+    pair_free((void **) &p);
+    assert (ordered_keys_equal(map, "theuickbrownfxjmpsvlazydgq"));
+
+    // the holes are compacted once they outnumber the pairs.
+    const char *erased = "theuickbrownfx";
+    for (size_t i = 0; erased[i] != '\0'; ++i)
+    {
+        assert (ordered_hashmap_erase(map, &erased[i]) == 1);
+    }
+    assert (map->size == 12);
+    assert (map->entries_used < 27);
+    assert (ordered_keys_equal(map, "jmpsvlazydgq"));
+    assert (ordered_hashmap_compact(map) == 1);
+    assert (map->entries_used == 12);
+    assert (ordered_keys_equal(map, "jmpsvlazydgq"));
+    key = 'z';
+    assert (*(int *) ordered_hashmap_at(map, &key) == 1);
+    ordered_hashmap_free(&map);
+    assert (map == NULL);
+
+    // larger maps address their entries with wider integers.
+    ordered_hashmap *ints = ordered_hashmap_alloc(hash_int);
+    for (int i = 0; i < 1000; ++i)
+    {
+        p = pair_alloc(&i, &i, int_value_cpy, int_value_cpy,
+                       int_value_cmp, int_value_cmp, int_value_free, int_value_free);
+        assert (ordered_hashmap_insert(ints, p) == 1);
+        pair_free((void **) &p);
+    }
+    assert (ints->index_width == 2);
+    for (int i = 0; i < 1000; i += 2)
+    {
+        assert (ordered_hashmap_erase(ints, &i) == 1);
+    }
+    size_t cursor = 0;
+    for (int i = 1; i < 1000; i += 2)
+    {
+        p = ordered_hashmap_next(ints, &cursor);
+        assert (*(int *) p->key == i);
+        assert (*(int *) ordered_hashmap_at(ints, &i) == i);
+    }
+    assert (ordered_hashmap_next(ints, &cursor) == NULL);
+    ordered_hashmap_free(&ints);
+}
+
+static inline size_t typed_int_hash (int key) {return (size_t) key;}
+static inline int typed_int_eq (int key1, int key2) {return key1 == key2;}
+
+HASHMAP_DEFINE (int_map, int, int, typed_int_hash, typed_int_eq)
+
+/**
+ * Checks whether an int key is odd, for the typed hash map.
+ */
+int typed_key_odd (int key)
+{
+    return key % 2 != 0;
+}
+
+/**
+ * Doubles an int value in place, for the typed hash map.
+ */
+void typed_value_double (int *value)
+{
+    *value *= 2;
+}
+
+/**
+ * This function checks the functions HASHMAP_DEFINE generates.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_typed_hashmap(void)
+{
+    int_map *map = int_map_alloc();
+    assert (map->capacity == HASH_MAP_INITIAL_CAP);
+    assert (int_map_at(map, 3) == NULL);
+    assert (int_map_erase(map, 3) == 0);
+    for (int i = 0; i < 100; ++i)
+    {
+        assert (int_map_insert(map, i, i * 10) == 1);
+        assert (int_map_insert(map, i, 0) == 0);
+    }
+    assert (map->size == 100);
+    assert (map->capacity == 256);
+    assert (int_map_get_load_factor(map) == 100.0 / 256);
+    for (int i = 0; i < 100; ++i)
+    {
+        assert (*int_map_at(map, i) == i * 10);
+    }
+
+    // the returned value is stored in the map.
+    int inserted = -1;
+    ++(*int_map_find_or_insert(map, 7, 0, &inserted));
+    assert (inserted == 0);
+    assert (*int_map_at(map, 7) == 71);
+    ++(*int_map_find_or_insert(map, 1000, 0, &inserted));
+    assert (inserted == 1);
+    assert (*int_map_at(map, 1000) == 1);
+    assert (int_map_upsert(map, 1000, 5) == 1);
+    assert (*int_map_at(map, 1000) == 5);
+    assert (int_map_erase(map, 1000) == 1);
+    assert (int_map_at(map, 1000) == NULL);
+
+    assert (int_map_apply_if(map, typed_key_odd, typed_value_double) == 50);
+    assert (*int_map_at(map, 9) == 180);
+    assert (*int_map_at(map, 8) == 80);
+    assert (int_map_erase_if(map, typed_key_odd) == 50);
+    assert (map->size == 50);
+    assert (int_map_at(map, 9) == NULL);
+
+    // erasing shrinks the map as it shrinks a hashmap, reserving grows it.
+    hashmap *twin = hashmap_alloc(hash_int);
+    for (int i = 0; i < 100; i += 2)
+    {
+        pair *p = pair_alloc(&i, &i, int_value_cpy, int_value_cpy, int_value_cmp,
+                             int_value_cmp, int_value_free, int_value_free);
+        assert (hashmap_insert(twin, p) == 1);
+        pair_free((void **) &p);
+    }
+    assert (map->capacity == twin->capacity);
+    for (int i = 0; i < 100; i += 2)
+    {
+        assert (int_map_erase(map, i) == 1);
+        assert (hashmap_erase(twin, &i) == 1);
+        assert (map->capacity == twin->capacity);
+    }
+    assert (map->size == 0);
+    size_t capacity = map->capacity;
+    assert (capacity < 128);
+    hashmap_free(&twin);
+    assert (int_map_reserve(map, (size_t) -1 / 2) == 0);
+    assert (map->capacity == capacity);
+    assert (int_map_reserve(map, 1000) == 1);
+    assert (map->capacity == 2048);
+    for (int i = 0; i < 1000; ++i)
+    {
+        assert (int_map_insert(map, -i, i) == 1);
+    }
+    assert (map->capacity == 2048);
+    assert (*int_map_at(map, -999) == 999);
+    int_map_free(&map);
+    assert (map == NULL);
+    int_map_free(&map);
+}
+
+/**
+ * Counts the bytes and the blocks a counting allocator holds.
+ */
+typedef struct counting_context {
+    size_t bytes;
+    size_t blocks;
+    size_t calls;
+} counting_context;
+
+/**
+ * The alloc function of the counting allocator.
+ */
+void *counting_alloc(void *context, size_t size)
+{
+    counting_context *counts = context;
+    ++(counts->calls);
+    void *block = malloc(size);
+    if (block == NULL) {return NULL;}
+    counts->bytes += size;
+    ++(counts->blocks);
+    return block;
+}
+
+/**
+ * The realloc function of the counting allocator.
+ */
+void *counting_realloc(void *context, void *ptr, size_t old_size, size_t new_size)
+{
+    counting_context *counts = context;
+    ++(counts->calls);
+    void *block = realloc(ptr, new_size);
+    if (block == NULL) {return NULL;}
+    counts->bytes += new_size - old_size;
+    if (ptr == NULL) {++(counts->blocks);}
+    return block;
+}
+
+/**
+ * The free function of the counting allocator.
+ */
+void counting_free(void *context, void *ptr, size_t size)
+{
+    counting_context *counts = context;
+    counts->bytes -= size;
+    --(counts->blocks);
+    free(ptr);
+}
+
+/**
+ * Whether the failing allocator fails: it is read by the background threads too.
+ */
+int failing_now = 0;
+
+/**
+ * The alloc function of the failing allocator: NULL while failing_now is 1.
+ */
+void *failing_alloc(void *context, size_t size)
+{
+    (void) context;
+    if (__atomic_load_n(&failing_now, __ATOMIC_ACQUIRE) == 1) {return NULL;}
+    return malloc(size);
+}
+
+/**
+ * The realloc function of the failing allocator: NULL while failing_now is 1.
+ */
+void *failing_realloc(void *context, void *ptr, size_t old_size, size_t new_size)
+{
+    (void) context;
+    (void) old_size;
+    if (__atomic_load_n(&failing_now, __ATOMIC_ACQUIRE) == 1) {return NULL;}
+    return realloc(ptr, new_size);
+}
+
+/**
+ * The free function of the failing allocator.
+ */
+void failing_free(void *context, void *ptr, size_t size)
+{
+    (void) context;
+    (void) size;
+    free(ptr);
+}
+
+/**
+ * This function checks the allocator helpers and the arena.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_allocator(void)
+{
+    assert (allocator_releases_all(NULL) == 0);
+    assert (arena_allocator(NULL) == NULL);
+    void *block = allocator_alloc(NULL, 8);
+    block = allocator_realloc(NULL, block, 8, 64);
+    assert (block != NULL);
+    allocator_free(NULL, block, 64);
+    allocator_free(NULL, NULL, 0);
+
+    arena *a = arena_alloc(1024);
+    const allocator *alloc = arena_allocator(a);
+    assert (allocator_releases_all(alloc) == 1);
+    char *first = allocator_alloc(alloc, 10);
+    char *second = allocator_alloc(alloc, 10);
+    assert ((first != NULL) && (second != NULL));
+    assert (((size_t) first % ARENA_ALIGNMENT == 0) && (second == first + ARENA_ALIGNMENT));
+    strcpy(first, "arena");
+
+    // the last block grows in place, any other block is copied.
+    assert (allocator_realloc(alloc, second, 10, 100) == second);
+    char *moved = allocator_realloc(alloc, first, 10, 20);
+    assert ((moved != first) && (strcmp(moved, "arena") == 0));
+    allocator_free(alloc, moved, 20);
+
+    // a block larger than a chunk gets a chunk of its own.
+    size_t bytes = a->bytes;
+    assert (allocator_alloc(alloc, 4096) != NULL);
+    assert (a->bytes > bytes + 4096);
+    assert (allocator_alloc(alloc, (size_t) -1) == NULL);
+    arena_free(&a);
+    assert (a == NULL);
+    arena_free(&a);
+}
+
+arena *test_arena = NULL;
+
+/**
+ * Copies an int key or value into test_arena.
+ */
+void *arena_int_cpy(const void *value)
+{
+    int *new_int = allocator_alloc(arena_allocator(test_arena), sizeof(int));
+    *new_int = *(const int *) value;
+    return new_int;
+}
+
+/**
+ * Frees an int key or value of test_arena: it is released with the arena.
+ */
+void arena_int_free(void **value)
+{
+    *value = NULL;
+}
+
+/**
+ * This function checks the hash maps and vectors allocated with an allocator:
+ * a counting allocator, and an arena which frees its hash map in O(1).
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_allocator(void)
+{
+    counting_context counts = {0, 0, 0};
+    allocator counting = {counting_alloc, counting_realloc, counting_free, &counts, NULL};
+    assert (hashmap_alloc_ex(NULL, &counting) == NULL);
+    assert (counts.calls == 0);
+
+    vector *v = vector_alloc_ex(int_value_cpy, int_value_cmp, int_value_free, &counting);
+    for (int i = 0; i < 100; ++i)
+    {
+        assert (vector_push_back(v, &i) == 1);
+    }
+    assert ((counts.blocks == 2) && (counts.bytes == sizeof(vector) + sizeof(void *) * v->capacity));
+    vector_free(&v);
+    assert ((counts.blocks == 0) && (counts.bytes == 0));
+    v = vector_alloc_elem_ex(sizeof(int), &counting);
+    for (int i = 0; i < 100; ++i)
+    {
+        assert (vector_push_back(v, &i) == 1);
+    }
+    assert ((counts.blocks == 2) && (counts.bytes == sizeof(vector) + sizeof(int) * v->capacity));
+    vector_free(&v);
+    assert ((counts.blocks == 0) && (counts.bytes == 0));
+
+    // an element-size vector grows in its arena, and is released with it.
+    arena *a = arena_alloc(0);
+    v = vector_alloc_elem_ex(sizeof(int), arena_allocator(a));
+    assert ((v != NULL) && (v->allocator == arena_allocator(a)));
+    for (int i = 0; i < 100; ++i)
+    {
+        assert (vector_push_back(v, &i) == 1);
+    }
+    assert ((*(int *) vector_at(v, 99) == 99) && (a->bytes > sizeof(int) * 100));
+    vector_free(&v);
+    arena_free(&a);
+
+    hashmap *map = hashmap_alloc_ex(hash_int, &counting);
+    for (int i = 0; i < 100; ++i)
+    {
+        pair *p = pair_alloc(&i, &i, int_value_cpy, int_value_cpy,
+                             int_value_cmp, int_value_cmp, int_value_free, int_value_free);
+        assert (hashmap_insert_ttl(map, p, 1000000) == 1);
+        pair_free((void **) &p);
+    }
+    assert (((pair *) map->buckets[0].data[0])->allocator == &counting);
+    assert (counts.blocks > 200);
+    hashmap *clone = hashmap_clone(map);
+    assert ((clone != NULL) && (clone->allocator == &counting));
+    for (int i = 0; i < 100; i += 2)
+    {
+        assert (hashmap_erase(map, &i) == 1);
+    }
+    hashmap_free(&clone);
+    hashmap_free(&map);
+    assert ((counts.blocks == 0) && (counts.bytes == 0));
+
+    // an arena-backed hash map is freed without walking its pairs.
+    test_arena = arena_alloc(0);
+    map = hashmap_alloc_ex(hash_int, arena_allocator(test_arena));
+    for (int i = 0; i < 1000; ++i)
+    {
+        pair *p = pair_alloc(&i, &i, arena_int_cpy, arena_int_cpy,
+                             int_value_cmp, int_value_cmp, arena_int_free, arena_int_free);
+        assert (hashmap_insert(map, p) == 1);
+        pair_free((void **) &p);
+    }
+    for (int i = 0; i < 1000; i += 2)
+    {
+        assert (hashmap_erase(map, &i) == 1);
+    }
+    assert (*(int *) hashmap_at(map, &(int) {999}) == 999);
+
+    // the pairs moved to a hash map of another allocator are copied to its memory.
+    hashmap *dst = hashmap_alloc(hash_int);
+    assert (hashmap_merge_move(dst, &map, HASH_MAP_KEEP_DST) == 500);
+    assert (map == NULL);
+    assert (((pair *) dst->buckets[1].data[0])->allocator == NULL);
+    assert (*(int *) hashmap_at(dst, &(int) {999}) == 999);
+    hashmap_free(&dst);
+
+    map = hashmap_alloc_ex(hash_int, arena_allocator(test_arena));
+    for (int i = 0; i < 1000; ++i)
+    {
+        pair *p = pair_alloc(&i, &i, arena_int_cpy, arena_int_cpy,
+                             int_value_cmp, int_value_cmp, arena_int_free, arena_int_free);
+        assert (hashmap_insert_ttl(map, p, 1000000) == 1);
+        pair_free((void **) &p);
+    }
+    hashmap_free(&map);
+    assert (map == NULL);
+    arena_free(&test_arena);
+}
+
+/**
+ * Checks whether an int key is even, for the snapshot test.
+ */
+int snapshot_key_even(const_keyT key)
+{
+    return *(const int *) key % 2 == 0;
+}
+
+/**
+ * Inserts the int pair {key: value} to the hash map, for the snapshot test.
+ */
+void snapshot_insert(hashmap *map, int key, int value)
+{
+    pair *p = pair_alloc(&key, &value, int_value_cpy, int_value_cpy,
+                         int_value_cmp, int_value_cmp, int_value_free, int_value_free);
+    assert (hashmap_upsert(map, p) == 1);
+    pair_free((void **) &p);
+}
+
+/**
+ * This function checks the hashmap_snapshot function and the snapshots: the writes
+ * to the hash map after a snapshot was taken are not seen by it, and copy only the
+ * buckets they change.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_snapshot(void)
+{
+    assert (hashmap_snapshot(NULL) == NULL);
+    assert (hashmap_view_at(NULL, NULL) == NULL);
+    hashmap *map = hashmap_alloc(hash_int);
+    for (int i = 0; i < 100; ++i)
+    {
+        snapshot_insert(map, i, i);
+    }
+    hashmap_view *view = hashmap_snapshot(map);
+    assert ((view != NULL) && (view->size == 100) && (view->capacity == map->capacity));
+
+    // a write copies only the bucket it changes.
+    int key = 0;
+    assert (hashmap_erase(map, &key) == 1);
+#if HASH_MAP_COUNTERS
+    assert (map->counters.bucket_copies == 1);
+#endif
+    for (int i = 1; i < 50; ++i)
+    {
+        assert (hashmap_erase(map, &i) == 1);
+    }
+    for (int i = 100; i < 150; ++i)
+    {
+        snapshot_insert(map, i, i);
+    }
+    snapshot_insert(map, 60, -60);
+    assert (hashmap_apply_if(map, snapshot_key_even, double_value) == 50);
+    assert (hashmap_erase_if(map, snapshot_key_even) == 50);
+    assert (map->size == 50);
+    hashmap_view *later = hashmap_snapshot(map);
+    for (int i = 0; i < 150; ++i)
+    {
+        int *value = hashmap_view_at(view, &i);
+        assert ((i < 100) ? (*value == i) : (value == NULL));
+        value = hashmap_view_at(later, &i);
+        assert ((i >= 50) && (i % 2 == 1) ? (*value == i) : (value == NULL));
+    }
+    size_t bucket = 0, index = 0, visited = 0;
+    int sum = 0;
+    const pair *p = NULL;
+    while ((p = hashmap_view_next(view, &bucket, &index)) != NULL)
+    {
+        sum += *(int *) p->key;
+        ++visited;
+    }
+    assert ((visited == 100) && (sum == 99 * 100 / 2));
+    hashmap_view_free(&view);
+    assert (view == NULL);
+    hashmap_view_free(&view);
+
+    // a resize copies the shared buckets, the pairs expiring in the hash map do not
+    // expire in the snapshot, and a snapshot outlives its hash map.
+    ttl_test_now = 1000;
+    assert (hashmap_set_clock(map, ttl_test_clock) == 1);
+    key = 1000;
+    p = pair_alloc(&key, &key, int_value_cpy, int_value_cpy,
+                   int_value_cmp, int_value_cmp, int_value_free, int_value_free);
+    assert (hashmap_insert_ttl(map, p, 10) == 1);
+    pair_free((void **) &p);
+    view = hashmap_snapshot(map);
+    ttl_test_now += 10;
+    assert (hashmap_expire(map, ttl_test_now, 10) == 1);
+    assert ((hashmap_at(map, &key) == NULL) && (*(int *) hashmap_view_at(view, &key) == 1000));
+    for (int i = 1000; i < 2000; ++i)
+    {
+        snapshot_insert(map, i, i);
+    }
+    assert (map->shares == NULL);
+    hashmap_free(&map);
+    key = 99;
+    assert (*(int *) hashmap_view_at(view, &key) == 99);
+    assert (*(int *) hashmap_view_at(later, &key) == 99);
+    hashmap_view_free(&later);
+    hashmap_view_free(&view);
+
+    // out of memory, the expired pair of a shared bucket stays hidden, and is erased
+    // by a later expiration.
+    allocator failing = {failing_alloc, failing_realloc, failing_free, NULL, NULL};
+    map = hashmap_alloc_ex(hash_int, &failing);
+    assert (hashmap_set_clock(map, ttl_test_clock) == 1);
+    p = pair_alloc(&key, &key, int_value_cpy, int_value_cpy,
+                   int_value_cmp, int_value_cmp, int_value_free, int_value_free);
+    assert (hashmap_insert_ttl(map, p, 10) == 1);
+    pair_free((void **) &p);
+    view = hashmap_snapshot(map);
+    ttl_test_now += 10;
+    __atomic_store_n(&failing_now, 1, __ATOMIC_RELEASE);
+    assert (hashmap_expire(map, ttl_test_now, 0) == 0);
+    __atomic_store_n(&failing_now, 0, __ATOMIC_RELEASE);
+    assert ((map->size == 1) && (hashmap_at(map, &key) == NULL));
+    assert (hashmap_expire(map, ttl_test_now, 0) == 0);
+    ++ttl_test_now;
+    assert (hashmap_expire(map, ttl_test_now, 0) == 1);
+    assert ((map->size == 0) && (*(int *) hashmap_view_at(view, &key) == 99));
+    hashmap_free(&map);
+    hashmap_view_free(&view);
+}
+
+/**
+ * Encodes an int key or value in 4 bytes, for the durable map test.
+ */
+size_t durable_int_encode(const void *number, unsigned char *buffer, size_t capacity)
+{
+    if (capacity >= sizeof(int))
+    {
+        memcpy(buffer, number, sizeof(int));
+    }
+    return sizeof(int);
+}
+
+/**
+ * Decodes an int key or value, for the durable map test.
+ */
+void *durable_int_decode(const unsigned char *data, size_t size)
+{
+    if (size != sizeof(int))
+    {
+        return NULL;
+    }
+    int *number = malloc(sizeof(int));
+    memcpy(number, data, sizeof(int));
+    return number;
+}
+
+/**
+ * Upserts the int pair {key: value} to the durable map, for the durable map test.
+ */
+void durable_upsert(durable_hashmap *durable, int key, int value)
+{
+    pair *p = pair_alloc(&key, &value, int_value_cpy, int_value_cpy,
+                         int_value_cmp, int_value_cmp, int_value_free, int_value_free);
+    assert (durable_hashmap_upsert(durable, p) == 1);
+    pair_free((void **) &p);
+}
+
+/**
+ * This function checks the durable_hashmap functions: the inserts and erases are
+ * replayed from the log when it is opened again, a torn tail of the log is truncated,
+ * and a compaction keeps the pairs of the map.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_durable_hashmap(void)
+{
+    const char *path = "test_durable.log";
+    durable_codec codec = {durable_int_encode, durable_int_encode, durable_int_decode,
+                           durable_int_decode, int_value_cpy, int_value_cpy, int_value_cmp,
+                           int_value_cmp, int_value_free, int_value_free};
+    durable_options options = {64, 8, 0};
+    remove(path);
+    assert (durable_hashmap_open(NULL, hash_int, &codec, NULL) == NULL);
+    durable_hashmap *durable = durable_hashmap_open(path, hash_int, &codec, &options);
+    assert ((durable != NULL) && (durable->map->size == 0));
+    for (int i = 0; i < 100; ++i)
+    {
+        durable_upsert(durable, i, i);
+    }
+    int key = 5, value = 5;
+    pair *p = pair_alloc(&key, &value, int_value_cpy, int_value_cpy,
+                         int_value_cmp, int_value_cmp, int_value_free, int_value_free);
+    assert (durable_hashmap_insert(durable, p) == 0);
+    pair_free((void **) &p);
+    for (int i = 0; i < 100; i += 2)
+    {
+        assert (durable_hashmap_erase(durable, &i) == 1);
+    }
+    assert (durable_hashmap_erase(durable, &key) == 1);
+    assert (durable_hashmap_erase(durable, &key) == 0);
+    durable_upsert(durable, 7, 70);
+    assert ((durable->log_records == 152) && (durable->counters.records == 152));
+    assert ((durable->counters.writes > 1) && (durable->counters.syncs > 1));
+    assert (durable_hashmap_sync(durable) == 1);
+    durable_hashmap_free(&durable);
+    assert (durable == NULL);
+
+    // the log is replayed, a torn record at its end is dropped
+    FILE *log = fopen(path, "ab");
+    assert ((log != NULL) && (fwrite("\1\4\4torn", 1, 7, log) == 7));
+    fclose(log);
+    durable = durable_hashmap_open(path, hash_int, &codec, &options);
+    assert ((durable != NULL) && (durable->counters.replayed == 152));
+    assert ((durable->map->size == 49) && (durable->map->capacity >= 64));
+    for (int i = 0; i < 100; ++i)
+    {
+        int *found = durable_hashmap_at(durable, &i);
+        assert (((i % 2 == 0) || (i == 5)) ? (found == NULL) : (*found == ((i == 7) ? 70 : i)));
+    }
+
+    // a compaction keeps the records logged while it runs
+    assert (durable_hashmap_compact(durable) == 1);
+    durable_upsert(durable, 1000, 1000);
+    key = 1;
+    assert (durable_hashmap_erase(durable, &key) == 1);
+    assert (durable_hashmap_compact_wait(durable) == 1);
+    assert ((durable->counters.compactions == 1) && (durable->log_records == 51));
+    durable_upsert(durable, 1001, 1001);
+    durable_hashmap_free(&durable);
+    durable = durable_hashmap_open(path, hash_int, &codec, NULL);
+    assert ((durable != NULL) && (durable->counters.replayed == 52));
+    assert ((durable->map->size == 50) && (durable_hashmap_at(durable, &key) == NULL));
+    key = 1001;
+    assert (*(int *) durable_hashmap_at(durable, &key) == 1001);
+    key = 7;
+    assert (*(int *) durable_hashmap_at(durable, &key) == 70);
+    durable_hashmap_free(&durable);
+
+    // a corrupted number of keys in the header does not size the map
+    log = fopen(path, "r+b");
+    assert ((log != NULL) && (fseek(log, 8, SEEK_SET) == 0));
+    assert (fwrite("\0\0\20\0\0\0\0\0", 1, 8, log) == 8);
+    fclose(log);
+    durable = durable_hashmap_open(path, hash_int, &codec, NULL);
+    assert ((durable != NULL) && (durable->map->size == 50));
+    assert (durable->map->capacity <= 256);
+    durable_hashmap_free(&durable);
+
+    // a record which cannot be written is not applied to the map
+    options = (durable_options) {0, 0, 0};
+    durable = durable_hashmap_open(path, hash_int, &codec, &options);
+    int fd = durable->fd;
+    durable->fd = -1;
+    key = 2000;
+    p = pair_alloc(&key, &key, int_value_cpy, int_value_cpy,
+                   int_value_cmp, int_value_cmp, int_value_free, int_value_free);
+    assert (durable_hashmap_insert(durable, p) == 0);
+    assert (durable_hashmap_upsert(durable, p) == 0);
+    assert (durable_hashmap_at(durable, &key) == NULL);
+    key = 7;
+    assert (durable_hashmap_erase(durable, &key) == 0);
+    assert (*(int *) durable_hashmap_at(durable, &key) == 70);
+    assert ((durable->buffered == 0) && (durable->log_records == 52));
+    durable->fd = fd;
+    assert (durable_hashmap_upsert(durable, p) == 1);
+    pair_free((void **) &p);
+    durable_hashmap_free(&durable);
+    durable = durable_hashmap_open(path, hash_int, &codec, NULL);
+    assert ((durable->map->size == 51) && (durable->counters.replayed == 53));
+    assert (*(int *) durable_hashmap_at(durable, &key) == 70);
+    durable_hashmap_free(&durable);
+    remove(path);
+}
+
+/**
+ * Returns the next record {i: 2 * i} of a counter, up to 100, for the builder test.
+ */
+int builder_next(void *context, const_keyT *key, const_valueT *value)
+{
+    static int keys[100], values[100];
+    int *i = context;
+    if (*i == 100)
+    {
+        return 0;
+    }
+    keys[*i] = *i;
+    values[*i] = 2 * *i;
+    *key = &keys[*i];
+    *value = &values[*i];
+    ++*i;
+    return 1;
+}
+
+/**
+ * Decodes a text field as an int, for the builder test.
+ */
+void *builder_decode_text(const char *data, size_t size)
+{
+    char text[16] = {0};
+    if ((size == 0) || (size >= sizeof(text)))
+    {
+        return NULL;
+    }
+    memcpy(text, data, size);
+    int *number = malloc(sizeof(int));
+    *number = atoi(text);
+    return number;
+}
+
+/**
+ * Decodes a 4 bytes field as an int, for the builder test.
+ */
+void *builder_decode_binary(const char *data, size_t size)
+{
+    if (size != sizeof(int))
+    {
+        return NULL;
+    }
+    int *number = malloc(sizeof(int));
+    memcpy(number, data, sizeof(int));
+    return number;
+}
+
+/**
+ * This function checks the hashmap_builder functions: the records added from arrays,
+ * a stream and files are built into a hash map, and the duplicate keys are resolved
+ * by the policy of the builder.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_hashmap_builder(void)
+{
+    int key = 0, value = 0;
+    pair functions = {NULL, NULL, int_value_cpy, int_value_cpy, int_value_cmp, int_value_cmp,
+                      int_value_free, int_value_free, NULL, NULL};
+    assert (hashmap_builder_alloc(NULL, &functions, HASH_MAP_BUILD_UNIQUE) == NULL);
+    assert (hashmap_builder_build(NULL) == NULL);
+
+    // an array with every key twice, the last value is kept
+    int numbers[2000];
+    const_keyT keys[2000];
+    const_valueT values[2000];
+    for (int i = 0; i < 2000; ++i)
+    {
+        numbers[i] = i;
+        keys[i] = &numbers[i % 1000];
+        values[i] = &numbers[i];
+    }
+    hashmap_builder *builder = hashmap_builder_alloc(hash_int, &functions,
+                                                     HASH_MAP_BUILD_KEEP_LAST);
+    assert (hashmap_builder_add_array(builder, keys, values, 2000) == 1);
+    assert (builder->size == 2000);
+    hashmap *map = hashmap_builder_build(&builder);
+    assert ((builder == NULL) && (map != NULL) && (map->size == 1000));
+    assert (hashmap_get_load_factor(map) < HASH_MAP_MAX_LOAD_FACTOR);
+    for (int i = 0; i < 1000; ++i)
+    {
+        assert (*(int *) hashmap_at(map, &i) == i + 1000);
+    }
+    snapshot_insert(map, 1000, 1000);
+    assert (map->size == 1001);
+    hashmap_free(&map);
+
+    builder = hashmap_builder_alloc(hash_int, &functions, HASH_MAP_BUILD_KEEP_FIRST);
+    assert (hashmap_builder_add_array(builder, keys, values, 2000) == 1);
+    map = hashmap_builder_build(&builder);
+    assert ((map != NULL) && (map->size == 1000));
+    key = 7;
+    assert (*(int *) hashmap_at(map, &key) == 7);
+    hashmap_free(&map);
+
+    builder = hashmap_builder_alloc(hash_int, &functions, HASH_MAP_BUILD_REJECT);
+    assert (hashmap_builder_add_array(builder, keys, values, 1001) == 1);
+    assert (hashmap_builder_build(&builder) == NULL);
+
+    // a stream, with the keys known to be distinct
+    builder = hashmap_builder_alloc(hash_int, &functions, HASH_MAP_BUILD_UNIQUE);
+    int counter = 0;
+    assert (hashmap_builder_add_stream(builder, builder_next, &counter) == 1);
+    map = hashmap_builder_build(&builder);
+    assert ((map != NULL) && (map->size == 100));
+    key = 99;
+    assert (*(int *) hashmap_at(map, &key) == 198);
+    hashmap_free(&map);
+
+    // text and binary files
+    const char *path = "test_builder.txt";
+    FILE *file = fopen(path, "wb");
+    assert (file != NULL);
+    fprintf(file, "1,10\n2,20\r\n\n3,30");
+    fclose(file);
+    hashmap_builder_format format = {0, ',', builder_decode_text, builder_decode_text};
+    builder = hashmap_builder_alloc(hash_int, &functions, HASH_MAP_BUILD_KEEP_FIRST);
+    assert (hashmap_builder_add_file(builder, path, &format) == 1);
+    assert (builder->size == 3);
+    file = fopen(path, "wb");
+    fprintf(file, "4,40\nbad line\n");
+    fclose(file);
+    assert (hashmap_builder_add_file(builder, path, &format) == 0);
+    file = fopen(path, "wb");
+    for (int i = 5; i < 3000; ++i)
+    {
+        unsigned char size[4] = {sizeof(int), 0, 0, 0};
+        value = 10 * i;
+        fwrite(size, 1, 4, file);
+        fwrite(&i, sizeof(int), 1, file);
+        fwrite(size, 1, 4, file);
+        fwrite(&value, sizeof(int), 1, file);
+    }
+    fclose(file);
+    format.binary = 1;
+    format.decode_key = builder_decode_binary;
+    format.decode_value = builder_decode_binary;
+    assert (hashmap_builder_add_file(builder, path, &format) == 1);
+    assert (hashmap_builder_add_file(builder, "test_builder.missing", &format) == 0);
+    map = hashmap_builder_build(&builder);
+    assert ((map != NULL) && (map->size == 2999));
+    for (int i = 1; i < 3000; ++i)
+    {
+        assert (*(int *) hashmap_at(map, &i) == 10 * i);
+    }
+    hashmap_free(&map);
+
+    // a truncated binary record fails, the builder is freed with its records
+    file = fopen(path, "ab");
+    fwrite("\4\0\0\0ab", 1, 6, file);
+    fclose(file);
+    builder = hashmap_builder_alloc(hash_int, &functions, HASH_MAP_BUILD_UNIQUE);
+    assert (hashmap_builder_add_file(builder, path, &format) == 0);
+    assert (builder->size == 2995);
+    hashmap_builder_free(&builder);
+    assert (builder == NULL);
+    remove(path);
+}
+
+/**
+ * This function checks the background resize of a hash map: the operations done
+ * while the new bucket array is built see every pair inserted, replaced and erased,
+ * and the hash map holds exactly them once it is published.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_background_resize(void)
+{
+    assert (hashmap_background_resize_enable(NULL, 0) == 0);
+    assert (hashmap_resize_wait(NULL) == 0);
+    arena *a = arena_alloc(0);
+    hashmap *arena_map = hashmap_alloc_ex(hash_int, arena_allocator(a));
+    assert (hashmap_background_resize_enable(arena_map, 0) == 0);
+    hashmap_free(&arena_map);
+    arena_free(&a);
+
+    hashmap *map = hashmap_alloc(hash_int);
+    assert (hashmap_background_resize_enable(map, HASH_MAP_MAX_LOAD_FACTOR) == 0);
+    assert (hashmap_background_resize_enable(map, 0) == 1);
+    assert (map->hard_load_factor == HASH_MAP_HARD_LOAD_FACTOR);
+    // the smaller hash maps are extended inline.
+    assert (hashmap_reserve(map, 6144) == 1);
+    assert ((map->capacity == HASH_MAP_BACKGROUND_MIN_CAP) && (map->resize == NULL));
+    for (int i = 0; i < 6145; ++i)
+    {
+        snapshot_insert(map, i, i);
+    }
+    // the last insertion found the hash map at the maximal load factor.
+    assert ((map->resize != NULL) && (map->capacity == 8192) && (map->size == 6145));
+    for (int i = 0; i < 6145; ++i)
+    {
+        assert (*(int *) hashmap_at(map, &i) == i);
+    }
+    int key = 7000;
+    assert (hashmap_at(map, &key) == NULL);
+    for (int i = 6145; i < 6156; ++i)
+    {
+        snapshot_insert(map, i, i);
+    }
+    for (int i = 0; i < 24; i += 3)
+    {
+        assert (hashmap_erase(map, &i) == 1);
+        assert (hashmap_erase(map, &i) == 0);
+        assert (hashmap_at(map, &i) == NULL);
+    }
+    snapshot_insert(map, 1, -1);
+    snapshot_insert(map, 22, -22);
+    snapshot_insert(map, 3, 300);
+    assert (map->size == 6149);
+
+    // the functions reading the hash map leave the resize alone (it may be published
+    // already, if the thread finished before the last insertions).
+    hashmap_resize *running = map->resize;
+    hashmap_statistics stats;
+    assert ((hashmap_stats(map, &stats) == 1) && (stats.size == 6149));
+    assert ((running == NULL) || (stats.bucket_bytes >= sizeof(vector) * (8192 + 16384)));
+    hashmap *clone = hashmap_clone(map);
+    hashmap *merged = hashmap_alloc(hash_int);
+    assert (hashmap_merge(merged, map, HASH_MAP_KEEP_DST) == 6149);
+    assert (hashmap_apply_if(map, snapshot_key_even, double_value) == 3074);
+    size_t bucket = 0, index = 0, live = 0;
+    while (hashmap_next(map, &bucket, &index) != NULL) {++live;}
+    assert (live == 6149);
+    assert (map->resize == running);
+    assert ((clone->resize == NULL) && (clone->size == 6149) && (merged->size == 6149));
+    for (int i = 0; i < 6156; ++i)
+    {
+        int *value = hashmap_at(clone, &i);
+        assert ((value == NULL) == (hashmap_at(map, &i) == NULL));
+        assert ((value == NULL) || (*value == *(int *) hashmap_at(merged, &i)));
+    }
+    assert (*(int *) hashmap_at(clone, &(int) {3}) == 300);
+    hashmap_free(&clone);
+    hashmap_free(&merged);
+
+    assert (hashmap_resize_wait(map) == 1);
+    assert ((map->resize == NULL) && (map->capacity == 16384));
+    for (int i = 0; i < 6156; ++i)
+    {
+        int *value = hashmap_at(map, &i);
+        int factor = (i % 2 == 0) ? 2 : 1;
+        if (i == 3) {assert (*value == 300);}
+        else if ((i < 24) && (i % 3 == 0)) {assert (value == NULL);}
+        else if ((i == 1) || (i == 22)) {assert (*value == -i * factor);}
+        else {assert (*value == i * factor);}
+    }
+    assert ((hashmap_stats(map, &stats) == 1) && (stats.size == 6149));
+    hashmap_free(&map);
+
+    // an insertion at the hard load factor waits for the resize.
+    map = hashmap_alloc(hash_int);
+    assert (hashmap_background_resize_enable(map, 0.8) == 1);
+    assert (hashmap_filter_enable(map, 0.01, 0) == 1);
+    assert (hashmap_reserve(map, 6144) == 1);
+    for (int i = 0; i < 20000; ++i)
+    {
+        snapshot_insert(map, i, i);
+        assert ((double) map->size <= 0.8 * (double) map->capacity + 1);
+        if (i % 4 == 0)
+        {
+            int erased = i / 2;
+            hashmap_erase(map, &erased);
+            assert (hashmap_at(map, &erased) == NULL);
+        }
+    }
+    hashmap_background_resize_disable(map);
+    assert ((map->resize == NULL) && (map->hard_load_factor == 0));
+    size_t size = 0;
+    assert (map->counters.resizes_up >= 2);
+    for (int i = 0; i < 20000; ++i)
+    {
+        int *value = hashmap_at(map, &i);
+        int erased = (i % 2 == 0) && (i <= 9998);
+        assert (erased ? (value == NULL) : (*value == i));
+        size += !erased;
+    }
+    assert (map->size == size);
+    hashmap_free(&map);
+}
+
+/**
+ * Whether the key 0 is not hashed yet: the background thread hashing it waits.
+ */
+int publish_gate = 0;
+
+/**
+ * The number of keys hashed by hash_int_gated.
+ */
+size_t publish_hashes = 0;
+
+/**
+ * Hashes an int key like hash_int, counting the calls and waiting for
+ * publish_gate to open before hashing the key 0.
+ */
+size_t hash_int_gated(const_keyT key)
+{
+    __atomic_add_fetch(&publish_hashes, 1, __ATOMIC_RELAXED);
+    if (*(const int *) key == 0)
+    {
+        while (__atomic_load_n(&publish_gate, __ATOMIC_ACQUIRE) == 1) {}
+    }
+    return hash_int(key);
+}
+
+/**
+ * This function checks the publication of a background resize: it hashes none of
+ * the frozen keys, releases the old bucket array a few buckets at a time, and keeps
+ * the resize running with every pair when the side map cannot be replayed.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_background_publish(void)
+{
+    hashmap *map = hashmap_alloc(hash_int_gated);
+    assert (hashmap_background_resize_enable(map, 0) == 1);
+    assert (hashmap_filter_enable(map, 0.01, 0) == 1);
+    assert (hashmap_reserve(map, 6144) == 1);
+    for (int i = 0; i < 6145; ++i)
+    {
+        snapshot_insert(map, i, i);
+    }
+    assert (map->resize != NULL);
+    while (__atomic_load_n(&(map->resize->done), __ATOMIC_ACQUIRE) == 0) {}
+    // the thread built the filter: publishing the resize hashes none of the 6145 keys.
+    size_t hashes = __atomic_load_n(&publish_hashes, __ATOMIC_RELAXED);
+    snapshot_insert(map, 6145, 6145);
+    assert (publish_hashes - hashes < 8);
+    assert ((map->resize == NULL) && (map->capacity == 16384) && (map->filter != NULL));
+    assert ((map->released != NULL) && (map->released_capacity == 8192));
+    assert (map->released_left == 8192 - HASH_MAP_RELEASE_BUDGET);
+    for (int i = 0; i < 8192 / (int) HASH_MAP_RELEASE_BUDGET; ++i)
+    {
+        int missing = -1 - i;
+        assert (hashmap_erase(map, &missing) == 0);
+    }
+    assert ((map->released == NULL) && (map->released_left == 0));
+    for (int i = 0; i < 6146; ++i)
+    {
+        assert (*(int *) hashmap_at(map, &i) == i);
+    }
+    hashmap_free(&map);
+
+    allocator failing = {failing_alloc, failing_realloc, failing_free, NULL, NULL};
+    map = hashmap_alloc_ex(hash_int_gated, &failing);
+    assert (hashmap_background_resize_enable(map, 0) == 1);
+    assert (hashmap_reserve(map, 6144) == 1);
+    for (int i = 0; i < 6144; ++i)
+    {
+        snapshot_insert(map, i, i);
+    }
+    // the thread waits on the key 0 while the side map gets the keys of its bucket.
+    __atomic_store_n(&publish_gate, 1, __ATOMIC_RELEASE);
+    snapshot_insert(map, 6144, 6144);
+    assert (map->resize != NULL);
+    for (int k = 1; k <= 8; ++k)
+    {
+        snapshot_insert(map, k * 16384, k);
+    }
+    int erased = 5;
+    assert (hashmap_erase(map, &erased) == 1);
+    snapshot_insert(map, 7, -7);
+    __atomic_store_n(&publish_gate, 0, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&(map->resize->done), __ATOMIC_ACQUIRE) == 0) {}
+
+    // the bucket 0 cannot grow: the resize is left running, and no pair is lost.
+    __atomic_store_n(&failing_now, 1, __ATOMIC_RELEASE);
+    assert (hashmap_resize_wait(map) == 0);
+    assert ((map->resize != NULL) && (map->capacity == 8192) && (map->size == 6152));
+    __atomic_store_n(&failing_now, 0, __ATOMIC_RELEASE);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        assert (hashmap_at(map, &erased) == NULL);
+        for (int i = 0; i < 6145; ++i)
+        {
+            int *value = hashmap_at(map, &i);
+            assert ((i == 5) || (*value == ((i == 7) ? -7 : i)));
+        }
+        for (int k = 1; k <= 8; ++k)
+        {
+            int key = k * 16384;
+            assert (*(int *) hashmap_at(map, &key) == k);
+        }
+        if (pass == 0)
+        {
+            assert (hashmap_resize_wait(map) == 1);
+            assert ((map->resize == NULL) && (map->capacity == 16384));
+            assert (map->size == 6152);
+        }
+    }
+    hashmap_free(&map);
+}
+
+/**
+ * This function checks the page pool: its small, medium and large blocks, and a
+ * large hash map whose bucket array and pairs are backed by its mappings.
+ * If they fail at some points, the functions exits with exit code 1.
+ */
+void test_page_pool(void)
+{
+    assert (page_pool_allocator(NULL) == NULL);
+    assert (page_pool_stats_get(NULL, NULL) == 0);
+    page_pool_free(NULL);
+    assert (allocator_backing_of(NULL, &(int) {0}, sizeof(int)) == ALLOCATOR_BACKING_HEAP);
+
+    page_pool *pool = page_pool_alloc(PAGE_POOL_HUGE_TRANSPARENT, PAGE_POOL_NUMA_FIRST_TOUCH);
+    assert (pool != NULL);
+    const allocator *a = page_pool_allocator(pool);
+    page_pool_stats stats;
+    assert (page_pool_stats_get(pool, &stats) == 1);
+    assert ((stats.slabs == 0) && (stats.large_regions == 0) && (stats.heap_bytes == 0));
+
+    // the small blocks of a size class are reused once freed.
+    char *small = allocator_alloc(a, 40);
+    char *other = allocator_alloc(a, 48);
+    assert ((small != NULL) && (other != NULL) && (other - small == 48));
+    memset(small, 'a', 40);
+    assert (allocator_realloc(a, small, 40, 33) == small);
+    allocator_free(a, other, 48);
+    assert (allocator_alloc(a, 41) == other);
+    char *moved = allocator_realloc(a, small, 40, 100);
+    assert ((moved != NULL) && (moved != small) && (moved[39] == 'a'));
+    assert (allocator_backing_of(a, moved, 100) != ALLOCATOR_BACKING_HEAP);
+
+    // the medium blocks are taken from malloc, the large ones are mapped on their own.
+    char *medium = allocator_alloc(a, 4096);
+    assert (medium != NULL);
+    assert (allocator_backing_of(a, medium, 4096) == ALLOCATOR_BACKING_HEAP);
+    char *large = allocator_realloc(a, medium, 4096, PAGE_POOL_HUGE_PAGE + 1);
+    assert ((large != NULL) && ((size_t) large % PAGE_POOL_HUGE_PAGE == 0));
+    large[PAGE_POOL_HUGE_PAGE] = 'b';
+    assert (allocator_backing_of(a, large, PAGE_POOL_HUGE_PAGE + 1) != ALLOCATOR_BACKING_HEAP);
+    assert (page_pool_stats_get(pool, &stats) == 1);
+    assert ((stats.slabs == 1) && (stats.slab_bytes == PAGE_POOL_SLAB_SIZE));
+    assert ((stats.large_regions == 1) && (stats.large_bytes == 2 * PAGE_POOL_HUGE_PAGE));
+    assert ((stats.heap_bytes == 0) && (stats.interleaved_bytes == 0));
+    allocator_free(a, large, PAGE_POOL_HUGE_PAGE + 1);
+    allocator_free(a, moved, 100);
+    allocator_free(a, other, 41);
+    assert (page_pool_stats_get(pool, &stats) == 1);
+    assert (stats.large_regions == 0);
+
+    // the bucket array and the pairs of a large hash map live in the mappings.
+    hashmap *map = hashmap_alloc_ex(hash_int, a);
+    assert (hashmap_reserve(map, 100000) == 1);
+    for (int i = 0; i < 100000; ++i)
+    {
+        pair *p = pair_alloc(&i, &i, int_value_cpy, int_value_cpy,
+                             int_value_cmp, int_value_cmp, int_value_free, int_value_free);
+        assert (hashmap_insert(map, p) == 1);
+        pair_free((void **) &p);
+    }
+    assert (*(int *) hashmap_at(map, &(int) {99999}) == 99999);
+    hashmap_statistics map_stats;
+    assert (hashmap_stats(map, &map_stats) == 1);
+    assert (map_stats.bucket_bytes >= PAGE_POOL_HUGE_PAGE);
+    assert ((map_stats.bucket_backing == ALLOCATOR_BACKING_PAGES) ||
+            (map_stats.bucket_backing == ALLOCATOR_BACKING_TRANSPARENT));
+    assert (map_stats.pair_backing != ALLOCATOR_BACKING_HEAP);
+    assert (page_pool_stats_get(pool, &stats) == 1);
+    assert ((stats.large_regions == 1) && (stats.slabs > 1));
+    assert (stats.transparent_bytes <= stats.large_bytes + stats.slab_bytes);
+    for (int i = 0; i < 100000; i += 2)
+    {
+        assert (hashmap_erase(map, &i) == 1);
+    }
+    assert (hashmap_at(map, &(int) {0}) == NULL);
+    hashmap_free(&map);
+    assert (page_pool_stats_get(pool, &stats) == 1);
+    assert (stats.large_regions == 0);
+    page_pool_free(&pool);
+    assert (pool == NULL);
+
+    // without huge pages reserved, explicit huge pages fall back to transparent ones.
+    pool = page_pool_alloc(PAGE_POOL_HUGE_HUGETLB, PAGE_POOL_NUMA_INTERLEAVE);
+    large = allocator_alloc(page_pool_allocator(pool), PAGE_POOL_HUGE_PAGE);
+    assert (large != NULL);
+    large[0] = 'c';
+    assert (page_pool_stats_get(pool, &stats) == 1);
+    assert ((stats.large_regions == 1) && (stats.large_bytes == PAGE_POOL_HUGE_PAGE));
+    assert ((stats.hugetlb_bytes == 0) || (stats.hugetlb_bytes == PAGE_POOL_HUGE_PAGE));
+    page_pool_free(&pool);
+}
+
 //int main ()
 //{
 //    test_hash_map_insert ();
@@ -275,6 +2672,37 @@ void test_hash_map_apply_if()
 //    test_hash_map_erase ();
 //    test_hash_map_get_load_factor ();
 //    test_hash_map_apply_if ();
+//    test_hash_map_find_or_insert ();
+//    test_hash_map_upsert ();
+//    test_hash_map_erase_if ();
+//    test_hash_map_reserve ();
+//    test_hash_map_merge ();
+//    test_hash_map_merge_move ();
+//    test_hash_map_clone ();
+//    test_hash_map_stats ();
+//    test_hash_map_latency ();
+//    test_vector_erase_clear ();
+//    test_vector_erase_unordered ();
+//    test_vector_inline ();
+//    test_vector_elem ();
+//    test_simd_find ();
+//    test_hash_map_key_size ();
+//    test_lru_hashmap ();
+//    test_timer_wheel ();
+//    test_hash_map_ttl ();
+//    test_counter_map ();
+//    test_bloom_filter ();
+//    test_hash_map_filter ();
+//    test_ordered_hashmap ();
+//    test_typed_hashmap ();
+//    test_allocator ();
+//    test_hash_map_allocator ();
+//    test_hash_map_snapshot ();
+//    test_durable_hashmap ();
+//    test_hashmap_builder ();
+//    test_hash_map_background_resize ();
+//    test_hash_map_background_publish ();
+//    test_page_pool ();
 //
 //    printf("DONE\n");
 //    return 0;
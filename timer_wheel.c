@@ -0,0 +1,199 @@
+//
+// A hierarchical timing wheel, used to expire the entries of the hashmap.
+//
+#include "timer_wheel.h"
+
+void slot_insert (timer_node *sentinel, timer_node *node);
+void node_unlink (timer_node *node);
+void cascade (timer_wheel *wheel, size_t level);
+
+/**
+ * Allocates dynamically an empty timer wheel.
+ * @param now the current tick.
+ * @return pointer to dynamically allocated timer wheel.
+ * @if_fail return NULL.
+ */
+timer_wheel *timer_wheel_alloc (unsigned long long now)
+{
+    timer_wheel *wheel = (timer_wheel *) malloc (sizeof(timer_wheel));
+    if (wheel == NULL) {return NULL;}
+    wheel->now = now;
+    wheel->count = 0;
+    for (size_t level = 0; level < TIMER_WHEEL_LEVELS; ++level)
+    {
+        for (size_t slot = 0; slot < TIMER_WHEEL_SLOTS; ++slot)
+        {
+            timer_node *sentinel = &(wheel->slots[level][slot]);
+            sentinel->prev = sentinel;
+            sentinel->next = sentinel;
+            sentinel->expires = 0;
+            sentinel->data = NULL;
+        }
+    }
+    return wheel;
+}
+
+/**
+ * Frees a timer wheel. The timers still in it are not freed.
+ * @param p_wheel pointer to dynamically allocated pointer to timer wheel.
+ */
+void timer_wheel_free (timer_wheel **p_wheel)
+{
+    if ((p_wheel != NULL) && (*p_wheel != NULL))
+    {
+        free (*p_wheel);
+        *p_wheel = NULL;
+    }
+}
+
+/**
+ * Adds a timer to the wheel. Level l holds the timers expiring within
+ * TIMER_WHEEL_SLOTS^(l+1) ticks, in the slot of the level's digit of their
+ * expiry tick.
+ * @param wheel a timer wheel.
+ * @param node a timer not in any wheel, its expires and data already set.
+ */
+void timer_wheel_add (timer_wheel *wheel, timer_node *node)
+{
+    if ((wheel == NULL) || (node == NULL)) {return;}
+    unsigned long long expires = node->expires;
+    if (expires < wheel->now) {expires = wheel->now;}
+    unsigned long long delta = expires - wheel->now;
+    size_t level = 0;
+    while ((level < TIMER_WHEEL_LEVELS - 1) &&
+           (delta >= (1ULL << (TIMER_WHEEL_SLOT_BITS * (level + 1)))))
+    {
+        ++level;
+    }
+    unsigned long long range = 1ULL << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS);
+    if (delta >= range)
+    {
+        // placed as far as the last level reaches, and placed again from there
+        expires = wheel->now + range - 1;
+    }
+    size_t slot = (expires >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    slot_insert (&(wheel->slots[level][slot]), node);
+    ++(wheel->count);
+}
+
+/**
+ * Adds an expired timer back to the wheel, to expire again on the next tick. Its
+ * expires is kept, so it still reads as expired meanwhile.
+ * @param wheel a timer wheel.
+ * @param node a timer not in any wheel.
+ */
+void timer_wheel_defer (timer_wheel *wheel, timer_node *node)
+{
+    if ((wheel == NULL) || (node == NULL)) {return;}
+    // the slot of the current tick may be the one being expired
+    slot_insert (&(wheel->slots[0][(wheel->now + 1) & (TIMER_WHEEL_SLOTS - 1)]), node);
+    ++(wheel->count);
+}
+
+/**
+ * Removes a timer from the wheel, before it expires.
+ * @param wheel the timer wheel the timer is in.
+ * @param node the timer.
+ */
+void timer_wheel_remove (timer_wheel *wheel, timer_node *node)
+{
+    if ((wheel == NULL) || (node == NULL) || (node->next == NULL)) {return;}
+    node_unlink (node);
+    --(wheel->count);
+}
+
+/**
+ * Advances the wheel to the tick now, and expires the timers due by then.
+ * Every tick, the due slot of level 0 is drained; when a level wraps around,
+ * the next slot of the level above is cascaded down before.
+ * @param wheel a timer wheel.
+ * @param now the tick to advance to (a past tick only expires the due timers).
+ * @param budget the maximal number of timers to expire, 0 for no limit.
+ * @param func the function called with every expired timer.
+ * @param ctx the context passed to func.
+ * @return the number of timers expired.
+ */
+size_t timer_wheel_advance (timer_wheel *wheel, unsigned long long now, size_t budget,
+                            timer_expire_func func, void *ctx)
+{
+    if ((wheel == NULL) || (func == NULL)) {return 0;}
+    size_t expired = 0;
+    while (1)
+    {
+        timer_node *sentinel = &(wheel->slots[0][wheel->now & (TIMER_WHEEL_SLOTS - 1)]);
+        while (sentinel->next != sentinel)
+        {
+            if ((budget != 0) && (expired == budget)) {return expired;}
+            timer_node *node = sentinel->next;
+            node_unlink (node);
+            --(wheel->count);
+            ++expired;
+            func (node, ctx);
+        }
+        if (wheel->now >= now) {break;}
+        if (wheel->count == 0)
+        {
+            // nothing to cascade or expire on the way
+            wheel->now = now;
+            break;
+        }
+        ++(wheel->now);
+        for (size_t level = 1; level < TIMER_WHEEL_LEVELS; ++level)
+        {
+            unsigned long long mask = (1ULL << (TIMER_WHEEL_SLOT_BITS * level)) - 1;
+            if ((wheel->now & mask) != 0) {break;}
+            cascade (wheel, level);
+        }
+    }
+    return expired;
+}
+
+/**
+ * Adds a timer to the tail of a slot.
+ * @param sentinel the sentinel of the slot.
+ * @param node the timer.
+ */
+void slot_insert (timer_node *sentinel, timer_node *node)
+{
+    node->prev = sentinel->prev;
+    node->next = sentinel;
+    sentinel->prev->next = node;
+    sentinel->prev = node;
+}
+
+/**
+ * Removes a timer from its slot.
+ * @param node a timer in a slot.
+ */
+void node_unlink (timer_node *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = NULL;
+    node->next = NULL;
+}
+
+/**
+ * Places again the timers of the current slot of a level, now that they are
+ * closer than the level's span: they move to the levels below.
+ * @param wheel a timer wheel.
+ * @param level the level, at least 1.
+ */
+void cascade (timer_wheel *wheel, size_t level)
+{
+    size_t slot = (wheel->now >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    timer_node *sentinel = &(wheel->slots[level][slot]);
+    if (sentinel->next == sentinel) {return;}
+    // detach the whole list first, the timers may be placed back in this slot
+    timer_node *node = sentinel->next;
+    sentinel->prev->next = NULL;
+    sentinel->next = sentinel;
+    sentinel->prev = sentinel;
+    while (node != NULL)
+    {
+        timer_node *next = node->next;
+        --(wheel->count);
+        timer_wheel_add (wheel, node);
+        node = next;
+    }
+}
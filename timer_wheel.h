@@ -0,0 +1,111 @@
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <stdlib.h>
+
+/**
+ * @def TIMER_WHEEL_SLOT_BITS
+ * log2 of the number of slots of every level of the wheel.
+ */
+#define TIMER_WHEEL_SLOT_BITS 6UL
+
+/**
+ * @def TIMER_WHEEL_SLOTS
+ * The number of slots of every level of the wheel. A slot of level l spans
+ * TIMER_WHEEL_SLOTS^l ticks.
+ */
+#define TIMER_WHEEL_SLOTS (1UL << TIMER_WHEEL_SLOT_BITS)
+
+/**
+ * @def TIMER_WHEEL_LEVELS
+ * The number of levels of the wheel. Timers further than TIMER_WHEEL_SLOTS^LEVELS
+ * ticks away are kept in the last level, and placed again when it comes around.
+ */
+#define TIMER_WHEEL_LEVELS 4UL
+
+/**
+ * @struct timer_node - a timer, linked into a slot of the wheel.
+ * @param prev, next - the neighbours of the timer in its slot.
+ * @param expires the tick the timer expires at.
+ * @param data the user's data of the timer.
+ */
+typedef struct timer_node {
+    struct timer_node *prev;
+    struct timer_node *next;
+    unsigned long long expires;
+    void *data;
+} timer_node;
+
+/**
+ * @typedef timer_expire_func
+ * Function which is called with every expired timer (already removed from the
+ * wheel, so it may free it) and the context given to timer_wheel_advance.
+ */
+typedef void (*timer_expire_func) (timer_node *, void *);
+
+/**
+ * @struct timer_wheel - a hierarchical timing wheel: timers are added and removed
+ * in O(1), and advancing the wheel touches only the slots of the passed ticks,
+ * cascading the timers of the coarser levels down as their time approaches.
+ * @param now the current tick, all the timers expiring before it were expired.
+ * @param count the number of timers in the wheel.
+ * @param slots the sentinels of the circular timer lists of every slot.
+ */
+typedef struct timer_wheel {
+    unsigned long long now;
+    size_t count;
+    timer_node slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} timer_wheel;
+
+/**
+ * Allocates dynamically an empty timer wheel.
+ * @param now the current tick.
+ * @return pointer to dynamically allocated timer wheel.
+ * @if_fail return NULL.
+ */
+timer_wheel *timer_wheel_alloc (unsigned long long now);
+
+/**
+ * Frees a timer wheel. The timers still in it are not freed.
+ * @param p_wheel pointer to dynamically allocated pointer to timer wheel.
+ */
+void timer_wheel_free (timer_wheel **p_wheel);
+
+/**
+ * Adds a timer to the wheel. A timer expiring at or before the current tick
+ * expires on the next timer_wheel_advance.
+ * @param wheel a timer wheel.
+ * @param node a timer not in any wheel, its expires and data already set.
+ */
+void timer_wheel_add (timer_wheel *wheel, timer_node *node);
+
+/**
+ * Adds an expired timer back to the wheel, to expire again on the next tick. Its
+ * expires is kept, so it still reads as expired meanwhile.
+ * @param wheel a timer wheel.
+ * @param node a timer not in any wheel.
+ */
+void timer_wheel_defer (timer_wheel *wheel, timer_node *node);
+
+/**
+ * Removes a timer from the wheel, before it expires.
+ * @param wheel the timer wheel the timer is in.
+ * @param node the timer.
+ */
+void timer_wheel_remove (timer_wheel *wheel, timer_node *node);
+
+/**
+ * Advances the wheel to the tick now, and expires the timers due by then.
+ * @param wheel a timer wheel.
+ * @param now the tick to advance to (a past tick only expires the due timers).
+ * @param budget the maximal number of timers to expire, 0 for no limit. When the
+ * budget runs out the wheel stops at the tick it reached, and the next call resumes
+ * from there.
+ * @param func the function called with every expired timer.
+ * @param ctx the context passed to func.
+ * @return the number of timers expired.
+ */
+size_t timer_wheel_advance (timer_wheel *wheel, unsigned long long now, size_t budget,
+                            timer_expire_func func, void *ctx);
+
+#endif //TIMER_WHEEL_H_
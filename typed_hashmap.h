@@ -0,0 +1,287 @@
+#ifndef TYPED_HASHMAP_H_
+#define TYPED_HASHMAP_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "hashmap.h"
+
+/**
+ * @def HASHMAP_DEFINE(name, K, V, hash_fn, eq_fn)
+ * Defines a hash map type specialized for keys of type K and values of type V,
+ * with the functions of hashmap.h under the prefix name instead of hashmap:
+ *
+ *   name *name_alloc (void);
+ *   void name_free (name **p_map);
+ *   int name_insert (name *map, K key, V value);
+ *   V *name_find_or_insert (name *map, K key, V value, int *inserted);
+ *   int name_upsert (name *map, K key, V value);
+ *   V *name_at (const name *map, K key);
+ *   int name_erase (name *map, K key);
+ *   double name_get_load_factor (const name *map);
+ *   int name_reserve (name *map, size_t num_elements);
+ *   int name_apply_if (const name *map, int (*key_func) (K), void (*value_func) (V *));
+ *   int name_erase_if (name *map, int (*key_func) (K));
+ *
+ * The hash map has the buckets, capacities and load factors of hashmap, but the
+ * keys and values are stored by value in the buckets (copied by assignment, and
+ * never freed by the hash map), and hash_fn and eq_fn are called directly, so the
+ * compiler can inline them into the lookups. name_at and name_find_or_insert
+ * return a pointer to the stored value, valid until the next insertion or erasure.
+ * Use it once per translation unit and type (the functions are static inline).
+ * @param name the name of the hash map type, and the prefix of its functions.
+ * @param K, V - the key and value types.
+ * @param hash_fn a function or macro, size_t hash_fn (K key).
+ * @param eq_fn a function or macro, int eq_fn (K key1, K key2), 1 if equal.
+ *
+ * Example: static inline size_t int_hash (int key) {return (size_t) key;}
+ *          static inline int int_eq (int a, int b) {return a == b;}
+ *          HASHMAP_DEFINE (int_map, int, int, int_hash, int_eq)
+ *          int_map *counts = int_map_alloc ();
+ *          ++(*int_map_find_or_insert (counts, 42, 0, NULL));
+ */
+#define HASHMAP_DEFINE(name, K, V, hash_fn, eq_fn)                                      \
+                                                                                        \
+typedef struct name##_entry {                                                           \
+    K key;                                                                              \
+    V value;                                                                            \
+} name##_entry;                                                                         \
+                                                                                        \
+typedef struct name##_bucket {                                                          \
+    name##_entry *entries;                                                              \
+    size_t size;                                                                        \
+    size_t capacity;                                                                    \
+} name##_bucket;                                                                        \
+                                                                                        \
+typedef struct name {                                                                   \
+    name##_bucket *buckets;                                                             \
+    size_t size;                                                                        \
+    size_t capacity;                                                                    \
+} name;                                                                                 \
+                                                                                        \
+static inline name *name##_alloc (void)                                                 \
+{                                                                                       \
+    name *map = (name *) malloc (sizeof(name));                                         \
+    if (map == NULL) {return NULL;}                                                     \
+    map->buckets = (name##_bucket *) calloc (HASH_MAP_INITIAL_CAP, sizeof(name##_bucket)); \
+    if (map->buckets == NULL)                                                           \
+    {                                                                                   \
+        free (map);                                                                     \
+        return NULL;                                                                    \
+    }                                                                                   \
+    map->size = 0;                                                                      \
+    map->capacity = HASH_MAP_INITIAL_CAP;                                               \
+    return map;                                                                         \
+}                                                                                       \
+                                                                                        \
+static inline void name##_free (name **p_map)                                           \
+{                                                                                       \
+    if ((p_map == NULL) || (*p_map == NULL)) {return;}                                  \
+    for (size_t i = 0; i < (*p_map)->capacity; ++i)                                     \
+    {                                                                                   \
+        free ((*p_map)->buckets[i].entries);                                            \
+    }                                                                                   \
+    free ((*p_map)->buckets);                                                           \
+    free (*p_map);                                                                      \
+    *p_map = NULL;                                                                      \
+}                                                                                       \
+                                                                                        \
+static inline double name##_get_load_factor (const name *map)                           \
+{                                                                                       \
+    if ((map == NULL) || (map->capacity == 0)) {return -1;}                             \
+    return (double) map->size / (double) map->capacity;                                 \
+}                                                                                       \
+                                                                                        \
+/* appends an entry to a bucket, growing it geometrically */                            \
+static inline int name##_bucket_push (name##_bucket *bucket, K key, V value)            \
+{                                                                                       \
+    if (bucket->size == bucket->capacity)                                               \
+    {                                                                                   \
+        size_t capacity = (bucket->capacity == 0) ? 2 : bucket->capacity * 2;           \
+        name##_entry *entries = (name##_entry *) realloc (                              \
+            bucket->entries, capacity * sizeof(name##_entry));                          \
+        if (entries == NULL) {return 0;}                                                \
+        bucket->entries = entries;                                                      \
+        bucket->capacity = capacity;                                                    \
+    }                                                                                   \
+    bucket->entries[bucket->size].key = key;                                            \
+    bucket->entries[bucket->size].value = value;                                        \
+    ++(bucket->size);                                                                   \
+    return 1;                                                                           \
+}                                                                                       \
+                                                                                        \
+/* moves the entries to new_capacity buckets, on failure the map is unchanged */        \
+static inline int name##_resize (name *map, size_t new_capacity)                        \
+{                                                                                       \
+    name##_bucket *buckets = (name##_bucket *) calloc (new_capacity,                    \
+                                                       sizeof(name##_bucket));          \
+    if (buckets == NULL) {return 0;}                                                    \
+    int success = 1;                                                                    \
+    for (size_t i = 0; (success == 1) && (i < map->capacity); ++i)                      \
+    {                                                                                   \
+        const name##_bucket *old = &(map->buckets[i]);                                  \
+        for (size_t j = 0; (success == 1) && (j < old->size); ++j)                      \
+        {                                                                               \
+            const name##_entry *e = &(old->entries[j]);                                 \
+            success = name##_bucket_push (                                              \
+                &(buckets[hash_fn (e->key) & (new_capacity - 1)]), e->key, e->value);   \
+        }                                                                               \
+    }                                                                                   \
+    name##_bucket *released = (success == 1) ? map->buckets : buckets;                  \
+    size_t released_capacity = (success == 1) ? map->capacity : new_capacity;           \
+    for (size_t i = 0; i < released_capacity; ++i)                                      \
+    {                                                                                   \
+        free (released[i].entries);                                                     \
+    }                                                                                   \
+    free (released);                                                                    \
+    if (success == 1)                                                                   \
+    {                                                                                   \
+        map->buckets = buckets;                                                         \
+        map->capacity = new_capacity;                                                   \
+    }                                                                                   \
+    return success;                                                                     \
+}                                                                                       \
+                                                                                        \
+static inline V *name##_at (const name *map, K key)                                     \
+{                                                                                       \
+    if (map == NULL) {return NULL;}                                                     \
+    const name##_bucket *bucket = &(map->buckets[hash_fn (key) & (map->capacity - 1)]); \
+    for (size_t i = 0; i < bucket->size; ++i)                                           \
+    {                                                                                   \
+        if (eq_fn (bucket->entries[i].key, key)) {return &(bucket->entries[i].value);}  \
+    }                                                                                   \
+    return NULL;                                                                        \
+}                                                                                       \
+                                                                                        \
+static inline V *name##_find_or_insert (name *map, K key, V value, int *inserted)       \
+{                                                                                       \
+    if (inserted != NULL) {*inserted = 0;}                                              \
+    if (map == NULL) {return NULL;}                                                     \
+    size_t hash = hash_fn (key);                                                        \
+    name##_bucket *bucket = &(map->buckets[hash & (map->capacity - 1)]);                \
+    for (size_t i = 0; i < bucket->size; ++i)                                           \
+    {                                                                                   \
+        if (eq_fn (bucket->entries[i].key, key)) {return &(bucket->entries[i].value);}  \
+    }                                                                                   \
+    if (name##_get_load_factor (map) >= HASH_MAP_MAX_LOAD_FACTOR)                       \
+    {                                                                                   \
+        if (name##_resize (map, map->capacity * HASH_MAP_GROWTH_FACTOR) == 0)           \
+        {                                                                               \
+            return NULL;                                                                \
+        }                                                                               \
+        bucket = &(map->buckets[hash & (map->capacity - 1)]);                           \
+    }                                                                                   \
+    if (name##_bucket_push (bucket, key, value) == 0) {return NULL;}                    \
+    ++(map->size);                                                                      \
+    if (inserted != NULL) {*inserted = 1;}                                              \
+    return &(bucket->entries[bucket->size - 1].value);                                  \
+}                                                                                       \
+                                                                                        \
+static inline int name##_insert (name *map, K key, V value)                             \
+{                                                                                       \
+    int inserted = 0;                                                                   \
+    if (name##_find_or_insert (map, key, value, &inserted) == NULL) {return 0;}         \
+    return inserted;                                                                    \
+}                                                                                       \
+                                                                                        \
+static inline int name##_upsert (name *map, K key, V value)                             \
+{                                                                                       \
+    V *stored = name##_find_or_insert (map, key, value, NULL);                          \
+    if (stored == NULL) {return 0;}                                                     \
+    *stored = value;                                                                    \
+    return 1;                                                                           \
+}                                                                                       \
+                                                                                        \
+/* minimizes the map once its load factor dropped to the minimum */                     \
+static inline void name##_minimize (name *map)                                          \
+{                                                                                       \
+    size_t new_capacity = map->capacity;                                                \
+    while ((new_capacity > 1) &&                                                        \
+           ((double) map->size / (double) new_capacity <= HASH_MAP_MIN_LOAD_FACTOR))    \
+    {                                                                                   \
+        new_capacity /= HASH_MAP_GROWTH_FACTOR;                                         \
+    }                                                                                   \
+    if (new_capacity != map->capacity) {name##_resize (map, new_capacity);}             \
+}                                                                                       \
+                                                                                        \
+static inline int name##_erase (name *map, K key)                                       \
+{                                                                                       \
+    if (map == NULL) {return 0;}                                                        \
+    /* shrinks one step before the lookup, as hashmap_erase does */                     \
+    if (((double) map->size / (double) map->capacity <= HASH_MAP_MIN_LOAD_FACTOR) &&    \
+        (map->capacity > 1) &&                                                          \
+        (name##_resize (map, map->capacity / HASH_MAP_GROWTH_FACTOR) == 0))             \
+    {                                                                                   \
+        return 0;                                                                       \
+    }                                                                                   \
+    name##_bucket *bucket = &(map->buckets[hash_fn (key) & (map->capacity - 1)]);       \
+    for (size_t i = 0; i < bucket->size; ++i)                                           \
+    {                                                                                   \
+        if (eq_fn (bucket->entries[i].key, key))                                        \
+        {                                                                               \
+            /* the order of the entries in a bucket does not matter */                  \
+            bucket->entries[i] = bucket->entries[bucket->size - 1];                     \
+            --(bucket->size);                                                           \
+            --(map->size);                                                              \
+            return 1;                                                                   \
+        }                                                                               \
+    }                                                                                   \
+    return 0;                                                                           \
+}                                                                                       \
+                                                                                        \
+static inline int name##_reserve (name *map, size_t num_elements)                       \
+{                                                                                       \
+    if (map == NULL) {return 0;}                                                        \
+    size_t new_capacity = map->capacity;                                                \
+    while ((num_elements > 0) &&                                                        \
+           ((double) (num_elements - 1) / (double) new_capacity >=                      \
+            HASH_MAP_MAX_LOAD_FACTOR))                                                  \
+    {                                                                                   \
+        /* no number of buckets can hold that many entries */                           \
+        if (new_capacity > SIZE_MAX / HASH_MAP_GROWTH_FACTOR) {return 0;}               \
+        new_capacity *= HASH_MAP_GROWTH_FACTOR;                                         \
+    }                                                                                   \
+    if (new_capacity == map->capacity) {return 1;}                                      \
+    return name##_resize (map, new_capacity);                                           \
+}                                                                                       \
+                                                                                        \
+static inline int name##_apply_if (const name *map, int (*key_func) (K),                \
+                                   void (*value_func) (V *))                            \
+{                                                                                       \
+    if ((map == NULL) || (key_func == NULL) || (value_func == NULL)) {return -1;}       \
+    int applied = 0;                                                                    \
+    for (size_t i = 0; i < map->capacity; ++i)                                          \
+    {                                                                                   \
+        name##_bucket *bucket = &(map->buckets[i]);                                     \
+        for (size_t j = 0; j < bucket->size; ++j)                                       \
+        {                                                                               \
+            if (key_func (bucket->entries[j].key) == 1)                                 \
+            {                                                                           \
+                value_func (&(bucket->entries[j].value));                               \
+                ++applied;                                                              \
+            }                                                                           \
+        }                                                                               \
+    }                                                                                   \
+    return applied;                                                                     \
+}                                                                                       \
+                                                                                        \
+static inline int name##_erase_if (name *map, int (*key_func) (K))                      \
+{                                                                                       \
+    if ((map == NULL) || (key_func == NULL)) {return -1;}                               \
+    int erased = 0;                                                                     \
+    for (size_t i = 0; i < map->capacity; ++i)                                          \
+    {                                                                                   \
+        name##_bucket *bucket = &(map->buckets[i]);                                     \
+        size_t kept = 0;                                                                \
+        for (size_t j = 0; j < bucket->size; ++j)                                       \
+        {                                                                               \
+            if (key_func (bucket->entries[j].key) == 1) {++erased;}                     \
+            else {bucket->entries[kept++] = bucket->entries[j];}                        \
+        }                                                                               \
+        bucket->size = kept;                                                            \
+    }                                                                                   \
+    map->size -= (size_t) erased;                                                       \
+    name##_minimize (map);                                                              \
+    return erased;                                                                      \
+}
+
+#endif //TYPED_HASHMAP_H_
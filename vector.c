@@ -2,7 +2,17 @@
 // Created by anna_seli on 25/05/2021.
 //
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
 #include "vector.h"
+#include "simd_find.h"
+
+int vector_resize(vector *vector, size_t new_capacity);
+void *vector_elem_address(const vector *vector, size_t ind);
+int vector_find_elem(const vector *vector, const void *value);
+void vector_free_elements(vector *vector);
+size_t vector_slot_size(const vector *vector);
+int vector_at_max_load(size_t size, size_t capacity);
 
 /**
  * Dynamically allocates a new vector.
@@ -18,25 +28,87 @@ vector *vector_alloc(vector_elem_cpy elem_copy_func,
                      vector_elem_cmp elem_cmp_func,
                      vector_elem_free elem_free_func)
 {
-    vector *v = (vector *) malloc (sizeof(vector));
-    if (v == NULL) {return NULL;}
+    return vector_alloc_ex(elem_copy_func, elem_cmp_func, elem_free_func, NULL);
+}
+
+/**
+ * Dynamically allocates a new vector whose struct and data array are allocated
+ * with the given allocator.
+ * @param elem_copy_func func which copies the element stored in the vector
+ * (returns dynamically allocated copy).
+ * @param elem_cmp_func func which is used to compare elements stored in the
+ * vector.
+ * @param elem_free_func func which frees elements stored in the vector.
+ * @param allocator the allocator of the vector, NULL for malloc.
+ * @return pointer to dynamically allocated vector.
+ * @if_fail return NULL.
+ */
+vector *vector_alloc_ex(vector_elem_cpy elem_copy_func,
+                        vector_elem_cmp elem_cmp_func,
+                        vector_elem_free elem_free_func,
+                        const allocator *allocator)
+{
     if ((elem_copy_func == NULL) || (elem_cmp_func == NULL) ||
         (elem_free_func == NULL))
     {
         return NULL;
     }
+    vector *v = (vector *) allocator_alloc (allocator, sizeof(vector));
+    if (v == NULL) {return NULL;}
     v->capacity = VECTOR_INITIAL_CAP;
     v->size = 0;
-    v->data = (void **) malloc (sizeof(void *) * v->capacity);
+    v->data = (void **) allocator_alloc (allocator, sizeof(void *) * v->capacity);
     if (v->data == NULL)
     {
-        free(v);
-        v = NULL;
+        allocator_free(allocator, v, sizeof(vector));
         return NULL;
     }
     v->elem_copy_func = elem_copy_func;
     v->elem_cmp_func = elem_cmp_func;
     v->elem_free_func = elem_free_func;
+    v->elem_size = 0;
+    v->allocator = allocator;
+    return v;
+}
+
+/**
+ * Dynamically allocates a new element-size vector, which stores its elements
+ * contiguously and copies them with memcpy.
+ * @param elem_size the size in bytes of an element.
+ * @return pointer to dynamically allocated vector.
+ * @if_fail return NULL.
+ */
+vector *vector_alloc_elem(size_t elem_size)
+{
+    return vector_alloc_elem_ex(elem_size, NULL);
+}
+
+/**
+ * Dynamically allocates a new element-size vector whose struct and data array are
+ * allocated with the given allocator.
+ * @param elem_size the size in bytes of an element.
+ * @param allocator the allocator of the vector, NULL for malloc.
+ * @return pointer to dynamically allocated vector.
+ * @if_fail return NULL.
+ */
+vector *vector_alloc_elem_ex(size_t elem_size, const allocator *allocator)
+{
+    if ((elem_size == 0) || (elem_size > SIZE_MAX / VECTOR_INITIAL_CAP)) {return NULL;}
+    vector *v = (vector *) allocator_alloc (allocator, sizeof(vector));
+    if (v == NULL) {return NULL;}
+    v->capacity = VECTOR_INITIAL_CAP;
+    v->size = 0;
+    v->data = (void **) allocator_alloc (allocator, elem_size * v->capacity);
+    if (v->data == NULL)
+    {
+        allocator_free(allocator, v, sizeof(vector));
+        return NULL;
+    }
+    v->elem_copy_func = NULL;
+    v->elem_cmp_func = NULL;
+    v->elem_free_func = NULL;
+    v->elem_size = elem_size;
+    v->allocator = allocator;
     return v;
 }
 
@@ -48,17 +120,92 @@ void vector_free(vector **p_vector)
 {
     if ((p_vector != NULL) && (*p_vector != NULL))
     {
-        vector_clear(*p_vector);
         if ((*p_vector)->data != NULL)
         {
-            free((*p_vector)->data);
+            vector_free_elements(*p_vector);
+            if ((*p_vector)->data != (*p_vector)->inline_data)
+            {
+                allocator_free((*p_vector)->allocator, (*p_vector)->data,
+                               (*p_vector)->capacity * vector_slot_size(*p_vector));
+            }
             (*p_vector)->data = NULL;
         }
-        free(*p_vector);
+        allocator_free((*p_vector)->allocator, *p_vector, sizeof(vector));
         *p_vector = NULL;
     }
 }
 
+/**
+ * Initializes a vector in memory owned by the caller, storing its first
+ * VECTOR_INLINE_CAP elements inside the struct.
+ * @param vector a pointer to the vector to initialize.
+ * @param elem_copy_func func which copies the element stored in the vector
+ * (returns dynamically allocated copy).
+ * @param elem_cmp_func func which is used to compare elements stored in the
+ * vector.
+ * @param elem_free_func func which frees elements stored in the vector.
+ * @return 1 if the vector was initialized successfully, 0 otherwise.
+ */
+int vector_init_inline(vector *vector, vector_elem_cpy elem_copy_func,
+                       vector_elem_cmp elem_cmp_func,
+                       vector_elem_free elem_free_func)
+{
+    return vector_init_inline_ex(vector, elem_copy_func, elem_cmp_func,
+                                 elem_free_func, NULL);
+}
+
+/**
+ * Initializes an inline vector, as vector_init_inline, whose heap data is
+ * allocated with the given allocator.
+ * @param vector a pointer to the vector to initialize.
+ * @param elem_copy_func func which copies the element stored in the vector
+ * (returns dynamically allocated copy).
+ * @param elem_cmp_func func which is used to compare elements stored in the
+ * vector.
+ * @param elem_free_func func which frees elements stored in the vector.
+ * @param allocator the allocator of the heap data, NULL for malloc.
+ * @return 1 if the vector was initialized successfully, 0 otherwise.
+ */
+int vector_init_inline_ex(vector *vector, vector_elem_cpy elem_copy_func,
+                          vector_elem_cmp elem_cmp_func,
+                          vector_elem_free elem_free_func,
+                          const allocator *allocator)
+{
+    if ((vector == NULL) || (elem_copy_func == NULL) ||
+        (elem_cmp_func == NULL) || (elem_free_func == NULL))
+    {
+        return 0;
+    }
+    vector->capacity = VECTOR_INLINE_CAP;
+    vector->size = 0;
+    vector->data = vector->inline_data;
+    vector->elem_copy_func = elem_copy_func;
+    vector->elem_cmp_func = elem_cmp_func;
+    vector->elem_free_func = elem_free_func;
+    vector->elem_size = 0;
+    vector->allocator = allocator;
+    return 1;
+}
+
+/**
+ * Frees the elements and the heap data of a vector initialized by
+ * vector_init_inline, without freeing the vector struct itself.
+ * @param vector a pointer to the vector.
+ */
+void vector_destroy(vector *vector)
+{
+    if ((vector == NULL) || (vector->data == NULL)) {return;}
+    vector_free_elements(vector);
+    if (vector->data != vector->inline_data)
+    {
+        allocator_free(vector->allocator, vector->data,
+                       vector->capacity * vector_slot_size(vector));
+    }
+    vector->capacity = VECTOR_INLINE_CAP;
+    vector->size = 0;
+    vector->data = vector->inline_data;
+}
+
 /**
  * Returns the element at the given index.
  * @param vector pointer to a vector.
@@ -70,6 +217,7 @@ void vector_free(vector **p_vector)
 void *vector_at(const vector *vector, size_t ind)
 {
     if ((vector == NULL) || (ind >= vector->size)) {return NULL;}
+    if (vector->elem_size != 0) {return vector_elem_address(vector, ind);}
     return (vector->data)[ind];
 }
 
@@ -84,6 +232,7 @@ void *vector_at(const vector *vector, size_t ind)
 int vector_find(const vector *vector, const void *value)
 {
     if ((vector == NULL) || (value == NULL)) {return -1;}
+    if (vector->elem_size != 0) {return vector_find_elem(vector, value);}
     for (size_t i = 0; i < vector->size; ++i)
     {
         if (vector->elem_cmp_func (vector->data[i], value) == 1)
@@ -103,23 +252,137 @@ int vector_find(const vector *vector, const void *value)
 int vector_push_back(vector *vector, const void *value)
 {
     if ((vector == NULL) || (value == NULL)) {return 0;}
-    double load = vector_get_load_factor(vector);
-    if (load >= VECTOR_MAX_LOAD_FACTOR)
-    {
-        size_t resize = vector->capacity * VECTOR_GROWTH_FACTOR * sizeof(void *);
-        void **temp = realloc(vector->data, resize);
-        if (temp == NULL) {return 0;}
-        vector->capacity *= VECTOR_GROWTH_FACTOR;
-        vector->data = temp;
-    }
+    if (vector->elem_size != 0) {return vector_append_range(vector, value, 1);}
     void *new_value = (vector->elem_copy_func) (value);
     if (new_value == NULL) {return 0;}
-    (vector->data)[vector->size] = new_value;
-    //printf("%p\n\n", (vector->data)[vector->size]);
+    if (vector_emplace_back(vector, new_value) == 0)
+    {
+        vector->elem_free_func(&new_value);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Adds the given value itself (not a copy of it) to the back of the vector.
+ * The vector takes ownership of the value and frees it with elem_free_func.
+ * @param vector a pointer to vector.
+ * @param value a dynamically allocated value to be moved into the vector.
+ * @return 1 if the adding has been done successfully, 0 otherwise.
+ */
+int vector_emplace_back(vector *vector, void *value)
+{
+    if ((vector == NULL) || (value == NULL) || (vector->elem_size != 0)) {return 0;}
+    if (vector_at_max_load(vector->size, vector->capacity))
+    {
+        if (vector_resize(vector, vector->capacity * VECTOR_GROWTH_FACTOR) == 0) {return 0;}
+    }
+    (vector->data)[vector->size] = value;
     ++(vector->size);
     return 1;
 }
 
+/**
+ * Checks whether size elements reach VECTOR_MAX_LOAD_FACTOR (3/4) of a capacity,
+ * in integers: capacity - capacity / 4 is the capacity times 3/4 rounded up, and
+ * neither side can overflow.
+ * @param size a number of elements.
+ * @param capacity a capacity.
+ * @return 1 if the vector has to be extended before it holds one more element.
+ */
+int vector_at_max_load(size_t size, size_t capacity)
+{
+    return size >= capacity - capacity / 4;
+}
+
+/**
+ * Extends the vector, if needed, so that it can hold n elements without being
+ * reallocated.
+ * @param vector a pointer to vector.
+ * @param n the number of elements the vector should be able to hold.
+ * @return 1 if the vector can hold n elements, 0 otherwise.
+ */
+int vector_reserve(vector *vector, size_t n)
+{
+    if (vector == NULL) {return 0;}
+    size_t new_capacity = vector->capacity;
+    // the n-th element is added at size n - 1, which must not reach the max load factor
+    while ((n > 0) && vector_at_max_load(n - 1, new_capacity))
+    {
+        // no data array can hold that many elements
+        if (new_capacity > SIZE_MAX / VECTOR_GROWTH_FACTOR) {return 0;}
+        new_capacity *= VECTOR_GROWTH_FACTOR;
+    }
+    if (new_capacity == vector->capacity) {return 1;}
+    return vector_resize(vector, new_capacity);
+}
+
+/**
+ * Adds count values to the back of the vector, reallocating it at most once.
+ * For an element-size vector, values is a contiguous array of count elements,
+ * otherwise it is an array of count pointers to the elements to be copied.
+ * On failure the vector is left unchanged.
+ * @param vector a pointer to vector.
+ * @param values the values to be added to the vector.
+ * @param count the number of values.
+ * @return 1 if the adding has been done successfully, 0 otherwise.
+ */
+int vector_append_range(vector *vector, const void *values, size_t count)
+{
+    if ((vector == NULL) || (values == NULL)) {return 0;}
+    if (count == 0) {return 1;}
+    if (count > SIZE_MAX - vector->size) {return 0;}
+    if (vector->elem_size != 0)
+    {
+        // values may point into the vector itself, which the reallocation moves
+        uintptr_t begin = (uintptr_t) vector->data;
+        uintptr_t end = begin + vector->size * vector->elem_size;
+        uintptr_t source = (uintptr_t) values;
+        int aliased = (source >= begin) && (source < end);
+        if (vector_reserve(vector, vector->size + count) == 0) {return 0;}
+        if (aliased)
+        {
+            values = (const char *) vector->data + (source - begin);
+        }
+        memmove(vector_elem_address(vector, vector->size), values,
+                count * vector->elem_size);
+        vector->size += count;
+        return 1;
+    }
+    if (vector_reserve(vector, vector->size + count) == 0) {return 0;}
+    const void *const *elements = values;
+    size_t old_size = vector->size;
+    for (size_t i = 0; i < count; ++i)
+    {
+        void *new_value = (elements[i] == NULL) ? NULL :
+                          (vector->elem_copy_func) (elements[i]);
+        if (new_value == NULL)
+        {
+            while (vector->size > old_size)
+            {
+                --(vector->size);
+                vector->elem_free_func(&(vector->data[vector->size]));
+            }
+            return 0;
+        }
+        (vector->data)[vector->size] = new_value;
+        ++(vector->size);
+    }
+    return 1;
+}
+
+/**
+ * Returns the storage of the vector: the contiguous elements of an element-size
+ * vector, or the array of element pointers of any other vector.
+ * @param vector a pointer to vector.
+ * @return pointer to the first of vector_size elements, NULL if the function failed.
+ */
+void *vector_data(const vector *vector)
+{
+    if (vector == NULL) {return NULL;}
+    return vector->data;
+}
+
 /**
  * This function returns the load factor of the vector.
  * @param vector a vector.
@@ -142,50 +405,205 @@ double vector_get_load_factor(const vector *vector)
 int vector_erase(vector *vector, size_t ind)
 {
     if ((vector == NULL) || (ind >= vector->size)) {return 0;}
-    if (vector->data[ind] == NULL) {return 0;}
-    if (vector_get_load_factor(vector) <= VECTOR_MIN_LOAD_FACTOR )
+    if (vector->elem_size != 0)
     {
-        size_t resize = vector->capacity / VECTOR_GROWTH_FACTOR * sizeof(void *);
-        void **temp = realloc(vector->data, resize);
-        if (temp == NULL) {return 0;}
-        vector->capacity /= VECTOR_GROWTH_FACTOR;
-        vector->data = temp;
+        memmove(vector_elem_address(vector, ind), vector_elem_address(vector, ind + 1),
+                vector->elem_size * (vector->size - ind - 1));
     }
-    if (vector->data[ind] == NULL) {return 0;}
-    vector->elem_free_func(&(vector->data[ind]));
-    for (size_t i = ind; i < (vector->size - 1); ++i)
+    else
     {
-        vector->data[i] = vector->data[i + 1];
+        if (vector->data[ind] == NULL) {return 0;}
+        vector->elem_free_func(&(vector->data[ind]));
+        memmove(&(vector->data[ind]), &(vector->data[ind + 1]),
+                sizeof(void *) * (vector->size - ind - 1));
     }
     --(vector->size);
+    // a vector is never minimized below its initial capacity
+    if ((vector->capacity > VECTOR_INITIAL_CAP) &&
+        ((double) vector->size <= (double) vector->capacity * VECTOR_MIN_LOAD_FACTOR))
+    {
+        // a failed minimization leaves a valid (only sparser) vector
+        vector_resize(vector, vector->capacity / VECTOR_GROWTH_FACTOR);
+    }
+    return 1;
+}
+
+/**
+ * Removes the element at the given index from the vector in O(1): the last element
+ * is moved to the index, so the order of the remaining elements is not kept.
+ * @param vector a pointer to vector.
+ * @param ind the index of the element to be removed.
+ * @return 1 if the removing has been done successfully, 0 otherwise.
+ */
+int vector_erase_unordered(vector *vector, size_t ind)
+{
+    if ((vector == NULL) || (ind >= vector->size)) {return 0;}
+    if (vector->elem_size != 0)
+    {
+        --(vector->size);
+        if (ind != vector->size)
+        {
+            memcpy(vector_elem_address(vector, ind),
+                   vector_elem_address(vector, vector->size), vector->elem_size);
+        }
+    }
+    else
+    {
+        if (vector->data[ind] == NULL) {return 0;}
+        vector->elem_free_func(&(vector->data[ind]));
+        --(vector->size);
+        vector->data[ind] = vector->data[vector->size];
+    }
+    if ((vector->capacity > VECTOR_INITIAL_CAP) &&
+        ((double) vector->size <= (double) vector->capacity * VECTOR_MIN_LOAD_FACTOR))
+    {
+        vector_resize(vector, vector->capacity / VECTOR_GROWTH_FACTOR);
+    }
     return 1;
 }
 
 /**
  * Deletes all the elements in the vector.
+ * The vector is minimized back to its initial capacity.
  * @param vector vector a pointer to vector.
  */
 void vector_clear(vector *vector)
 {
     if ((vector != NULL) && (vector->data != NULL))
     {
-        int size = vector->size;
-        if (size > 0)
+        vector_free_elements(vector);
+        vector->size = 0;
+        if (vector->capacity > VECTOR_INITIAL_CAP)
         {
-            for (int i = 0; i < size; ++i)
+            vector_resize(vector, VECTOR_INITIAL_CAP);
+        }
+    }
+}
+
+/**
+ * Reallocates the data array of the vector to new_capacity elements.
+ * An inline vector outgrowing its inline storage moves its data to the heap.
+ * On failure the vector is left unchanged.
+ * @param vector a pointer to vector.
+ * @param new_capacity the new capacity, at least the size of the vector.
+ * @return 1 if the data array was reallocated successfully, 0 otherwise.
+ */
+int vector_resize(vector *vector, size_t new_capacity)
+{
+    size_t elem_size = vector_slot_size(vector);
+    if ((new_capacity == 0) || (new_capacity < vector->size) ||
+        (new_capacity > SIZE_MAX / elem_size))
+    {
+        return 0;
+    }
+    void **temp = NULL;
+    if (vector->data == vector->inline_data)
+    {
+        temp = (void **) allocator_alloc (vector->allocator, new_capacity * elem_size);
+        if (temp == NULL) {return 0;}
+        memcpy(temp, vector->inline_data, vector->size * elem_size);
+    }
+    else
+    {
+        temp = allocator_realloc(vector->allocator, vector->data,
+                                 vector->capacity * elem_size, new_capacity * elem_size);
+        if (temp == NULL) {return 0;}
+    }
+    vector->capacity = new_capacity;
+    vector->data = temp;
+    return 1;
+}
+
+/**
+ * Returns the number of bytes a slot of the data array of the vector takes.
+ * @param vector a pointer to vector.
+ * @return elem_size for an element-size vector, the size of a pointer otherwise.
+ */
+size_t vector_slot_size(const vector *vector)
+{
+    return (vector->elem_size != 0) ? vector->elem_size : sizeof(void *);
+}
+
+/**
+ * Returns the address of the element at the given index of an element-size vector.
+ * @param vector a pointer to an element-size vector.
+ * @param ind the index of the element (may be the index one past the last element).
+ * @return the address of the element in the vector's storage.
+ */
+void *vector_elem_address(const vector *vector, size_t ind)
+{
+    return (char *) vector->data + ind * vector->elem_size;
+}
+
+/**
+ * Looks for a value in an element-size vector, comparing the elements byte by byte.
+ * Elements of 1, 2, 4 or 8 bytes are compared as integers of that width, many at
+ * a time (see simd_find.h).
+ * @param vector a pointer to an element-size vector.
+ * @param value the value to look for.
+ * @return the index of the first element equal to the value, -1 if there is none.
+ */
+int vector_find_elem(const vector *vector, const void *value)
+{
+    const char *elements = (const char *) vector->data;
+    size_t index = vector->size;
+    switch (vector->elem_size)
+    {
+        case sizeof(uint8_t):
+        {
+            uint8_t target;
+            memcpy(&target, value, sizeof(target));
+            index = simd_find_u8((const uint8_t *) elements, vector->size, target);
+            break;
+        }
+        case sizeof(uint16_t):
+        {
+            uint16_t target;
+            memcpy(&target, value, sizeof(target));
+            index = simd_find_u16((const uint16_t *) elements, vector->size, target);
+            break;
+        }
+        case sizeof(uint32_t):
+        {
+            uint32_t target;
+            memcpy(&target, value, sizeof(target));
+            index = simd_find_u32((const uint32_t *) elements, vector->size, target);
+            break;
+        }
+        case sizeof(uint64_t):
+        {
+            uint64_t target;
+            memcpy(&target, value, sizeof(target));
+            index = simd_find_u64((const uint64_t *) elements, vector->size, target);
+            break;
+        }
+        default:
+            for (index = 0; index < vector->size; ++index)
             {
-                //printf("%p\n", vector->data[i]);
-                //printf("%d\n", vector->data[i]);
-                if (vector->data[i] != NULL)
+                if (memcmp(elements + index * vector->elem_size, value,
+                           vector->elem_size) == 0)
                 {
-                    (vector->elem_free_func)(&(vector->data[i]));
-                    --(vector->size);
-                    if (vector_get_load_factor(vector) < VECTOR_MIN_LOAD_FACTOR )
-                    {
-                        vector->capacity /= VECTOR_GROWTH_FACTOR;
-                    }
+                    break;
                 }
             }
+            break;
+    }
+    return (index == vector->size) ? -1 : (int) index;
+}
+
+/**
+ * Frees the elements of the vector with elem_free_func. The elements of an
+ * element-size vector are stored in its data array, so nothing is freed.
+ * @param vector a pointer to vector.
+ */
+void vector_free_elements(vector *vector)
+{
+    if (vector->elem_size != 0) {return;}
+    for (size_t i = 0; i < vector->size; ++i)
+    {
+        if (vector->data[i] != NULL)
+        {
+            (vector->elem_free_func)(&(vector->data[i]));
         }
     }
 }
@@ -2,6 +2,7 @@
 #define VECTOR_H_
 
 #include <stdlib.h>
+#include "allocator.h"
 
 /**
  * @def VECTOR_INITIAL_CAP
@@ -9,6 +10,13 @@
  */
 #define VECTOR_INITIAL_CAP 16UL
 
+/**
+ * @def VECTOR_INLINE_CAP
+ * The number of elements an inline vector (see vector_init_inline) stores
+ * inside the vector struct itself, before its data spills to the heap.
+ */
+#define VECTOR_INLINE_CAP 2UL
+
 /**
  * @def VECTOR_GROWTH_FACTOR
  * The growth factor of the vector.
@@ -26,6 +34,7 @@
  * @def VECTOR_MIN_LOAD_FACTOR
  * The minimal load factor the vector can be in before
  * size decreasing (vector need to be decreased if the load factor is <0.25).
+ * A vector is never decreased below VECTOR_INITIAL_CAP.
  */
 #define VECTOR_MIN_LOAD_FACTOR 0.25
 
@@ -54,13 +63,22 @@ typedef void (*vector_elem_free)(void **);
  * @struct vector - a generic vector struct.
  * @param capacity - the capacity of the vector.
  * @param size - the current size of the vector.
- * @param data - the values stored inside the vector.
+ * @param data - the values stored inside the vector. In an element-size vector
+ * (see vector_alloc_elem) data is a contiguous array of capacity elements of
+ * elem_size bytes each, not an array of pointers.
  * @param elem_copy_func - a function which copies (returns
  * a dynamically allocates copy) of elements of the type stored in the vector.
  * @param elem_cmp_func - a function which compares the elements
  * stored in the vector.
  * @param elem_free_func - a function which frees the elements stored
  * in the vector.
+ * @param elem_size - the size in bytes of the elements of an element-size vector,
+ * 0 for a vector of pointers to dynamically allocated elements.
+ * @param inline_data - the storage an inline vector uses for its first
+ * VECTOR_INLINE_CAP elements (data points to it until the vector outgrows it).
+ * An inline vector points into itself, so its struct must not be copied or moved.
+ * @param allocator - the allocator of the struct (see vector_alloc_ex) and of the
+ * data array, NULL for malloc.
  */
 typedef struct vector {
   size_t capacity;
@@ -69,6 +87,9 @@ typedef struct vector {
   vector_elem_cpy elem_copy_func;
   vector_elem_cmp elem_cmp_func;
   vector_elem_free elem_free_func;
+  size_t elem_size;
+  void *inline_data[VECTOR_INLINE_CAP];
+  const allocator *allocator;
 } vector;
 
 /**
@@ -83,12 +104,84 @@ typedef struct vector {
 vector *vector_alloc(vector_elem_cpy elem_copy_func, vector_elem_cmp elem_cmp_func,
                      vector_elem_free elem_free_func);
 
+/**
+ * Dynamically allocates a new vector, as vector_alloc, whose struct and data array
+ * are allocated with the given allocator. The elements are still allocated by
+ * elem_copy_func.
+ * @param elem_copy_func func which copies the element stored in the vector.
+ * @param elem_cmp_func func which is used to compare elements stored in the vector.
+ * @param elem_free_func func which frees elements stored in the vector.
+ * @param allocator the allocator of the vector, NULL for malloc.
+ * @return pointer to dynamically allocated vector.
+ * @if_fail return NULL.
+ */
+vector *vector_alloc_ex(vector_elem_cpy elem_copy_func, vector_elem_cmp elem_cmp_func,
+                        vector_elem_free elem_free_func, const allocator *allocator);
+
+/**
+ * Dynamically allocates a new element-size vector, which stores its elements
+ * contiguously and copies them in and out with memcpy, without allocating them
+ * one by one. Elements are compared byte by byte, so they should be plain data
+ * without padding.
+ * vector_at and vector_data return pointers into the vector's storage, which
+ * are valid until the vector is next changed.
+ * @param elem_size the size in bytes of an element.
+ * @return pointer to dynamically allocated vector.
+ * @if_fail return NULL.
+ */
+vector *vector_alloc_elem(size_t elem_size);
+
+/**
+ * Dynamically allocates a new element-size vector, as vector_alloc_elem, whose
+ * struct and data array are allocated with the given allocator.
+ * @param elem_size the size in bytes of an element.
+ * @param allocator the allocator of the vector, NULL for malloc.
+ * @return pointer to dynamically allocated vector.
+ * @if_fail return NULL.
+ */
+vector *vector_alloc_elem_ex(size_t elem_size, const allocator *allocator);
+
 /**
  * Frees a vector and the elements the vector itself allocated.
  * @param p_vector pointer to dynamically allocated pointer to vector.
  */
 void vector_free(vector **p_vector);
 
+/**
+ * Initializes a vector in memory owned by the caller (e.g. an array of buckets).
+ * The first VECTOR_INLINE_CAP elements are stored inside the struct, so a small
+ * vector needs no allocation at all. Release it with vector_destroy.
+ * @param vector a pointer to the vector to initialize.
+ * @param elem_copy_func func which copies the element stored in the vector (returns
+ * dynamically allocated copy).
+ * @param elem_cmp_func func which is used to compare elements stored in the vector.
+ * @param elem_free_func func which frees elements stored in the vector.
+ * @return 1 if the vector was initialized successfully, 0 otherwise.
+ */
+int vector_init_inline(vector *vector, vector_elem_cpy elem_copy_func,
+                       vector_elem_cmp elem_cmp_func, vector_elem_free elem_free_func);
+
+/**
+ * Initializes an inline vector, as vector_init_inline, whose data is allocated with
+ * the given allocator once it spills from the struct.
+ * @param vector a pointer to the vector to initialize.
+ * @param elem_copy_func func which copies the element stored in the vector.
+ * @param elem_cmp_func func which is used to compare elements stored in the vector.
+ * @param elem_free_func func which frees elements stored in the vector.
+ * @param allocator the allocator of the data, NULL for malloc.
+ * @return 1 if the vector was initialized successfully, 0 otherwise.
+ */
+int vector_init_inline_ex(vector *vector, vector_elem_cpy elem_copy_func,
+                          vector_elem_cmp elem_cmp_func, vector_elem_free elem_free_func,
+                          const allocator *allocator);
+
+/**
+ * Frees the elements and the heap data of a vector initialized by vector_init_inline,
+ * without freeing the vector struct itself. The vector is left empty and inline.
+ * @param vector a pointer to the vector.
+ */
+void vector_destroy(vector *vector);
+
 /**
  * Returns the element at the given index.
  * @param vector pointer to a vector.
@@ -115,6 +208,45 @@ int vector_find(const vector *vector, const void *value);
  */
 int vector_push_back(vector *vector, const void *value);
 
+/**
+ * Adds the given value itself (not a copy of it) to the back of the vector.
+ * The vector takes ownership of the value and frees it with elem_free_func.
+ * Element-size vectors copy their elements, so they do not support this.
+ * @param vector a pointer to vector.
+ * @param value a dynamically allocated value to be moved into the vector.
+ * @return 1 if the adding has been done successfully, 0 otherwise.
+ */
+int vector_emplace_back(vector *vector, void *value);
+
+/**
+ * Extends the vector, if needed, so that it can hold n elements without being
+ * reallocated.
+ * @param vector a pointer to vector.
+ * @param n the number of elements the vector should be able to hold.
+ * @return 1 if the vector can hold n elements, 0 otherwise.
+ */
+int vector_reserve(vector *vector, size_t n);
+
+/**
+ * Adds count values to the back of the vector, reallocating it at most once.
+ * For an element-size vector, values is a contiguous array of count elements,
+ * otherwise it is an array of count pointers to the elements to be copied.
+ * On failure the vector is left unchanged.
+ * @param vector a pointer to vector.
+ * @param values the values to be added to the vector.
+ * @param count the number of values.
+ * @return 1 if the adding has been done successfully, 0 otherwise.
+ */
+int vector_append_range(vector *vector, const void *values, size_t count);
+
+/**
+ * Returns the storage of the vector: the contiguous elements of an element-size
+ * vector, or the array of element pointers of any other vector.
+ * @param vector a pointer to vector.
+ * @return pointer to the first of vector_size elements, NULL if the function failed.
+ */
+void *vector_data(const vector *vector);
+
 /**
  * This function returns the load factor of the vector.
  * @param vector a vector.
@@ -131,8 +263,18 @@ double vector_get_load_factor(const vector *vector);
  */
 int vector_erase(vector *vector, size_t ind);
 
+/**
+ * Removes the element at the given index from the vector in O(1): the last element
+ * is moved to the index, so the order of the remaining elements is not kept.
+ * @param vector a pointer to vector.
+ * @param ind the index of the element to be removed.
+ * @return 1 if the removing has been done successfully, 0 otherwise.
+ */
+int vector_erase_unordered(vector *vector, size_t ind);
+
 /**
  * Deletes all the elements in the vector.
+ * The vector is minimized back to VECTOR_INITIAL_CAP.
  * @param vector vector a pointer to vector.
  */
 void vector_clear(vector *vector);